@@ -0,0 +1,22 @@
+package com.audio.study.ffmpegdecoder.player.engine
+
+import androidx.test.ext.junit.runners.AndroidJUnit4
+
+import org.junit.Test
+import org.junit.runner.RunWith
+
+import org.junit.Assert.*
+
+/**
+ * The native YUV kernels (scalar and whatever SIMD set the device runs) must
+ * match sws_scale within one step per channel.
+ */
+@RunWith(AndroidJUnit4::class)
+class ColorConversionTest {
+    @Test
+    fun kernelsMatchSwscale() {
+        val diff = EngineDiagnostics.checkColorConversion()
+        assertTrue("native check failed", diff >= 0)
+        assertTrue("kernels differ from sws_scale by $diff", diff <= 1)
+    }
+}
@@ -0,0 +1,30 @@
+package com.audio.study.ffmpegdecoder.player.engine
+
+import androidx.test.ext.junit.runners.AndroidJUnit4
+
+import org.junit.Test
+import org.junit.runner.RunWith
+
+import org.junit.Assert.*
+
+/**
+ * Seek and stop on a source that stalls mid-stream must not hang on the
+ * blocked read (interrupt callback + per-operation deadlines).
+ */
+@RunWith(AndroidJUnit4::class)
+class SlowSourceTest {
+    companion object {
+        // MediaDemuxer::SEEK_TIMEOUT_MS plus slack
+        private const val SEEK_BOUND_MS = 6_000L
+        // a few interrupt polls of the blocked read
+        private const val STOP_BOUND_MS = 1_000L
+    }
+
+    @Test
+    fun seekAndStopReturnWhileTheSourceStalls() {
+        val ms = EngineDiagnostics.checkSlowSourceAbort()
+        assertEquals("native check failed", 2, ms.size)
+        assertTrue("seek took ${ms[0]} ms", ms[0] < SEEK_BOUND_MS)
+        assertTrue("stop took ${ms[1]} ms", ms[1] < STOP_BOUND_MS)
+    }
+}
@@ -0,0 +1,121 @@
+package com.audio.study.ffmpegdecoder.player.engine
+
+import com.audio.study.ffmpegdecoder.utils.LogUtil
+
+/**
+ * Native benchmarks and self-checks. Debug builds only: the native side is
+ * compiled in with FFMPEGDECODER_DIAGNOSTICS (see app/build.gradle), release
+ * libraries do not carry these entry points.
+ */
+object EngineDiagnostics {
+    private const val TAG = "EngineDiagnostics"
+
+    /** Keep in sync with VIDEO_THREAD_POLICY_COUNT */
+    private const val THREAD_POLICY_COUNT = 4
+
+    init {
+        try {
+            System.loadLibrary("ffmpegdecoder")
+        } catch (e: UnsatisfiedLinkError) {
+            LogUtil.e(TAG, "Failed to load native library: ${e.message}")
+        }
+    }
+
+    /**
+     * Hand [items] pointers from one thread to another through the old
+     * mutex + condvar queue and through the lock-free SPSC ring used by
+     * the decoder controllers, both bounded to [depth].
+     * @return average ns per item: [0] mutex queue, [1] SPSC ring; empty on failure
+     */
+    fun benchmarkQueues(items: Int = 200_000, depth: Int = 30): LongArray {
+        val ns = LongArray(2)
+        if (nativeBenchmarkQueues(items, depth, ns) != 0) return LongArray(0)
+        LogUtil.i(TAG, "benchmarkQueues mutex=${ns[0]}ns spsc=${ns[1]}ns per item")
+        return ns
+    }
+
+    @JvmStatic
+    private external fun nativeBenchmarkQueues(items: Int, depth: Int, nsOut: LongArray): Int
+
+    /**
+     * Open [path] [rounds] times with stream probing and [rounds] times
+     * served from the probe cache.
+     * @return average us per open: [0] probed, [1] cached; empty on failure
+     */
+    fun benchmarkOpen(path: String, rounds: Int = 5): LongArray {
+        val us = LongArray(2)
+        if (nativeBenchmarkOpen(path, rounds, us) != 0) return LongArray(0)
+        LogUtil.i(TAG, "benchmarkOpen probed=${us[0]}us cached=${us[1]}us")
+        return us
+    }
+
+    @JvmStatic
+    private external fun nativeBenchmarkOpen(path: String, rounds: Int, usOut: LongArray): Int
+
+    /**
+     * Decode the first [frames] frames of [path] once per thread policy
+     * (FfmpegVideoEngine.THREADS_*), without conversion or rendering. Run it on a 1080p and
+     * a 4K sample to choose [FfmpegVideoEngine.setThreadPolicy] for a device.
+     * @return one result per policy, indexed by THREADS_*; empty on failure
+     */
+    fun benchmarkDecodeThreads(path: String, frames: Int = 300): List<DecodeThreadBench> {
+        val fields = 8
+        val out = LongArray(fields * THREAD_POLICY_COUNT)
+        if (nativeBenchmarkDecodeThreads(path, frames, out) != 0) return emptyList()
+        return List(THREAD_POLICY_COUNT) { policy ->
+            val o = policy * fields
+            DecodeThreadBench(
+                policy, out[o].toInt(), out[o + 1].toInt(), out[o + 2].toInt(),
+                out[o + 3] / 100.0, out[o + 4], out[o + 5], out[o + 6], out[o + 7].toInt()
+            ).also { LogUtil.i(TAG, "benchmarkDecodeThreads $it") }
+        }
+    }
+
+    @JvmStatic
+    private external fun nativeBenchmarkDecodeThreads(path: String, frames: Int, out: LongArray): Int
+
+    /**
+     * Run every native YUV → RGBA / RGB565 kernel built for this CPU
+     * against sws_scale (both colour matrices, both ranges).
+     * @return the largest per-channel difference, -1 on failure; the
+     *         kernels are expected within 1
+     */
+    fun checkColorConversion(): Int {
+        val diff = nativeCheckColorConversion()
+        LogUtil.i(TAG, "checkColorConversion maxDiff=$diff")
+        return if (diff < 0) -1 else diff
+    }
+
+    @JvmStatic
+    private external fun nativeCheckColorConversion(): Int
+
+    /**
+     * Seek and stop while the source stalls: a loopback server sends half
+     * of a generated clip and then nothing. Both must come back within
+     * the I/O deadlines instead of hanging on the blocked read.
+     * @return ms until [0] the demuxer seek and [1] the controller stop
+     *         returned; empty on failure
+     */
+    fun checkSlowSourceAbort(): LongArray {
+        val ms = LongArray(2)
+        if (nativeCheckSlowSourceAbort(ms) != 0) return LongArray(0)
+        LogUtil.i(TAG, "checkSlowSourceAbort seek=${ms[0]}ms stop=${ms[1]}ms")
+        return ms
+    }
+
+    @JvmStatic
+    private external fun nativeCheckSlowSourceAbort(msOut: LongArray): Int
+
+    /** One policy of [benchmarkDecodeThreads]; latencies as in [FfmpegVideoEngine.ThreadingStats]. */
+    data class DecodeThreadBench(
+        val policy: Int,
+        val threadCount: Int,
+        val activeType: Int,
+        val frames: Int,
+        val fps: Double,
+        val firstFrameUs: Long,
+        val avgLatencyUs: Long,
+        val maxLatencyUs: Long,
+        val maxFramesInFlight: Int
+    )
+}
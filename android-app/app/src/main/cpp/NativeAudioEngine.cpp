@@ -164,4 +164,38 @@ Java_com_audio_study_ffmpegdecoder_player_engine_OpenSlAudioEngine_nativeGetAudi
     jlong clockMs = (jlong) service->getAudioClockMs(); // implement if missing
     return clockMs;
 }
+
+/**
+ * void nativeSetLiveMode(boolean enable, long targetMs)
+ *
+ * Applies to the next nativePrepare(): low-latency open of a live stream, and
+ * audio played slightly faster while more than targetMs is buffered.
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_OpenSlAudioEngine_nativeSetLiveMode(
+        JNIEnv *env,
+        jobject /*thiz*/,
+        jboolean enable,
+        jlong targetMs) {
+    SoundService *service = SoundService::GetInstance();
+    if (!service) return;
+
+    service->setLiveMode(enable == JNI_TRUE, targetMs);
+}
+
+/**
+ * long nativeGetLiveLatencyMs()
+ *
+ * Live content buffered ahead of playback (newest media read - played), -1
+ * when not live.
+ */
+JNIEXPORT jlong JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_OpenSlAudioEngine_nativeGetLiveLatencyMs(
+        JNIEnv *env,
+        jobject /*thiz*/) {
+    SoundService *service = SoundService::GetInstance();
+    if (!service) return -1;
+
+    return (jlong) service->getLiveLatencyMs();
+}
 }// extern "C"
\ No newline at end of file
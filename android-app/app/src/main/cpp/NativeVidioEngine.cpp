@@ -3,13 +3,113 @@
 //
 
 #include <jni.h>
+#include <cstdio>
 #include <string>
+#include <pthread.h>
 #include "video_decoder_controller.h"  // your existing class
 #include "CommonTools.h"
 #include "MediaStatus.h"
+#include "VideoFormat.h"
+#include "keyframe_index.h"
+#include "media_cache.h"
+#include "probe_cache.h"
+#include "sound_service.h"
+#include "video_decoder_pool.h"
+
+extern "C" {
+#include <libavutil/time.h>
+}
 
 static VideoDecoderController* gVideoController = nullptr;
 
+// keep in sync with FfmpegVideoEngine.IO_*
+static int gIoMode = MEDIA_IO_DEFAULT;
+static int gIoBlockSize = 0;
+static bool gFastStart = false;
+static bool gLive = false;
+static int64_t gLiveTargetMs = LiveCatchUp::DEFAULT_TARGET_MS;
+// keep in sync with FfmpegVideoEngine.THREADS_*
+static int gThreadPolicy = VIDEO_THREADS_AUTO;
+static int gDecodeThreads = 0;
+
+// keep in sync with FfmpegVideoEngine.CLOCK_*
+static const int MASTER_CLOCK_NONE = 0;
+static const int MASTER_CLOCK_OPENSL = 1;     // SoundService audio clock, read natively
+static const int MASTER_CLOCK_EXTERNAL = 2;   // pushed from Java via nativeUpdateMasterClock
+
+static int64_t openSlAudioClock(void* /*opaque*/) {
+    SoundService* service = SoundService::GetInstance();
+    return service ? service->getAudioClockMs() : -1;
+}
+
+// next playlist item, opened and prerolled by a background thread (nativePreload)
+static pthread_t gPreloadThread;
+static bool gPreloadStarted = false;
+static std::string gPreloadPath;
+static MediaIoOptions gPreloadIo;
+static VideoDecoderController* gPreloaded = nullptr;   // written by the preload thread
+
+// a controller opened on `path` with the current settings, nullptr on failure
+static VideoDecoderController* createController(const char* path, const MediaIoOptions& io) {
+    auto* controller = new VideoDecoderController();
+    controller->setIoOptions(io);
+    controller->setFastStart(gFastStart);
+    controller->setLiveTarget(gLiveTargetMs);
+    controller->setThreadPolicy(gThreadPolicy, gDecodeThreads);
+    int result = controller->init(path);   // adapt to your init method
+    if (result != MEDIA_STATUS_OK) {
+        LOGE("VideoDecoderController init failed");
+        delete controller;
+        return nullptr;
+    }
+    return controller;
+}
+
+static void* preloadThreadEntry(void* /*arg*/) {
+    VideoDecoderController* controller = createController(gPreloadPath.c_str(), gPreloadIo);
+    if (controller && controller->preroll() != MEDIA_STATUS_OK) {
+        delete controller;
+        controller = nullptr;
+    }
+    gPreloaded = controller;
+    LOGI("FfmpegVideoEngine: preloaded %s: %s", gPreloadPath.c_str(), controller ? "ready" : "failed");
+    return nullptr;
+}
+
+// waits for the preload thread; returns its controller when it was opened on
+// `path` with the same I/O, otherwise drops it (path == nullptr: always)
+static VideoDecoderController* takePreloaded(const char* path, const MediaIoOptions& io) {
+    if (!gPreloadStarted) return nullptr;
+    pthread_join(gPreloadThread, nullptr);
+    gPreloadStarted = false;
+    VideoDecoderController* controller = gPreloaded;
+    gPreloaded = nullptr;
+    const bool matches = controller && path && gPreloadPath == path &&
+                         gPreloadIo.mode == io.mode && gPreloadIo.live == io.live;
+    if (!matches) {
+        delete controller;
+        return nullptr;
+    }
+    return controller;
+}
+
+// replaces gVideoController with one opened on `path`
+static jboolean prepareController(const char* path, const MediaIoOptions& io) {
+    if (gVideoController) {
+        // parks its decoder, which the new controller may pick up warm
+        delete gVideoController;
+        gVideoController = nullptr;
+    }
+
+    gVideoController = takePreloaded(path, io);
+    if (gVideoController) {
+        LOGI("FfmpegVideoEngine: %s was preloaded", path);
+        return JNI_TRUE;
+    }
+    gVideoController = createController(path, io);
+    return gVideoController ? JNI_TRUE : JNI_FALSE;
+}
+
 extern "C" {
 
 // jstring → std::string again
@@ -31,27 +131,335 @@ Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativePrepare
         jstring jPath) {
 
     std::string path = JStringToStdString(env, jPath);
-    LOGI("FfmpegVideoEngine.nativePrepare path=%s", path.c_str());
+    LOGI("FfmpegVideoEngine.nativePrepare path=%s io=%d", path.c_str(), gIoMode);
 
-    if (gVideoController) {
-        delete gVideoController;
-        gVideoController = nullptr;
-    }
+    MediaIoOptions io;
+    io.mode = gIoMode;
+    io.blockSize = gIoBlockSize;
+    io.live = gLive;
+    return prepareController(path.c_str(), io);
+}
 
-    gVideoController = new VideoDecoderController();
-    if (!gVideoController) {
-        LOGE("Failed to allocate VideoDecoderController");
+/**
+ * boolean nativePrepareMemory(ByteBuffer data, int size)
+ *
+ * Plays `size` bytes of a direct buffer without duplicating them (packets are
+ * copied straight out of it, see MemorySource); the buffer is pinned by a
+ * global reference until the demuxer closes.
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativePrepareMemory(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jobject jBuffer,
+        jint size) {
+    auto* data = jBuffer ? (const uint8_t*)env->GetDirectBufferAddress(jBuffer) : nullptr;
+    if (!data || size <= 0 || size > env->GetDirectBufferCapacity(jBuffer)) {
+        LOGE("nativePrepareMemory: need a direct buffer of at least %d bytes", size);
         return JNI_FALSE;
     }
 
-    int result = gVideoController->init(path.c_str());   // adapt to your init method
-    if (result != MEDIA_STATUS_OK) {
-        LOGE("VideoDecoderController init failed");
-        delete gVideoController;
-        gVideoController = nullptr;
-        return JNI_FALSE;
+    JavaVM* vm = nullptr;
+    env->GetJavaVM(&vm);
+    jobject pinned = env->NewGlobalRef(jBuffer);
+    MediaIoOptions io;
+    io.mode = MEDIA_IO_MEMORY;
+    io.data = data;
+    io.size = size;
+    // released by whichever thread drops the demuxer last
+    io.owner = std::shared_ptr<void>(pinned, [vm](void* ref) {
+        JNIEnv* releaseEnv = nullptr;
+        bool attached = false;
+        if (vm->GetEnv((void**)&releaseEnv, JNI_VERSION_1_6) != JNI_OK) {
+            if (vm->AttachCurrentThread(&releaseEnv, nullptr) != JNI_OK) return;
+            attached = true;
+        }
+        releaseEnv->DeleteGlobalRef((jobject)ref);
+        if (attached) vm->DetachCurrentThread();
+    });
+
+    // names the source for the shared-demuxer registry and the logs
+    char name[48];
+    snprintf(name, sizeof(name), "memory:%p+%d", (const void*)data, size);
+    LOGI("FfmpegVideoEngine.nativePrepareMemory %s", name);
+    return prepareController(name, io);
+}
+
+/**
+ * void nativePreload(String path)
+ *
+ * Opens `path` in the background with the current settings and starts
+ * decoding it without playing; a later nativePrepare(path) takes it over.
+ * Replaces an earlier preload. The path currently playing is not preloaded.
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativePreload(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jstring jPath) {
+    takePreloaded(nullptr, MediaIoOptions());
+
+    std::string path = JStringToStdString(env, jPath);
+    if (gVideoController && gVideoController->getSourcePath() == path) {
+        // it would get the playing clip's shared demuxer, take its packets
+        // and seek it; prepare() of the same path reopens it instead
+        LOGI("FfmpegVideoEngine.nativePreload %s is playing, not preloaded", path.c_str());
+        return;
     }
+    gPreloadPath = path;
+    gPreloadIo = MediaIoOptions();
+    gPreloadIo.mode = gIoMode;
+    gPreloadIo.blockSize = gIoBlockSize;
+    gPreloadIo.live = gLive;
+    gPreloadStarted = pthread_create(&gPreloadThread, nullptr, preloadThreadEntry, nullptr) == 0;
+    LOGI("FfmpegVideoEngine.nativePreload %s%s", gPreloadPath.c_str(), gPreloadStarted ? "" : " failed");
+}
+
+/**
+ * void nativeCancelPreload()
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeCancelPreload(
+        JNIEnv* env,
+        jobject /*thiz*/) {
+    takePreloaded(nullptr, MediaIoOptions());
+}
+
+/**
+ * static void nativeTrimDecoderPool()
+ *
+ * Frees the decoders and decode threads kept warm for the next clip.
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeTrimDecoderPool(
+        JNIEnv* env,
+        jclass /*clazz*/) {
+    VideoDecoderPool::clear();
+    DecodeWorker::clear();
+}
+
+/**
+ * static boolean nativeGetDecoderPoolStats(long[] out)
+ *
+ * out[0] idle decoders, out[1] decoders handed out, out[2] of which warm,
+ * out[3] evictions
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeGetDecoderPoolStats(
+        JNIEnv* env,
+        jclass /*clazz*/,
+        jlongArray jOut) {
+    if (!jOut || env->GetArrayLength(jOut) < 4) return JNI_FALSE;
 
+    VideoDecoderPoolStats stats = VideoDecoderPool::getStats();
+    jlong values[4] = {
+            (jlong)stats.idle,
+            (jlong)stats.obtained,
+            (jlong)stats.warm,
+            (jlong)stats.evictions
+    };
+    env->SetLongArrayRegion(jOut, 0, 4, values);
+    return JNI_TRUE;
+}
+
+/**
+ * void nativeSetIoMode(int mode, int blockSize)
+ *
+ * How the next nativePrepare() reads the file: 0 FFmpeg default, 1 mmap,
+ * 3 large-block read-ahead. blockSize <= 0 uses the native default.
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeSetIoMode(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jint mode,
+        jint blockSize) {
+    gIoMode = (mode == MEDIA_IO_MMAP || mode == MEDIA_IO_READ_AHEAD) ? mode : MEDIA_IO_DEFAULT;
+    gIoBlockSize = blockSize;
+}
+
+/**
+ * void nativeSetFastStart(boolean enable)
+ *
+ * Applies to the next prepare: smaller probesize / analyzeduration, and
+ * nativePrimeFirstFrame() may decode the first frame ahead of nativeStart().
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeSetFastStart(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jboolean enable) {
+    gFastStart = enable == JNI_TRUE;
+}
+
+/**
+ * boolean nativePrimeFirstFrame(int format)
+ *
+ * Decodes the first frame and converts it to `format` (VideoFormat.*) with the
+ * current output transform, before nativeStart(). False leaves the first frame
+ * to the decode thread.
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativePrimeFirstFrame(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jint format) {
+    if (!gVideoController) return JNI_FALSE;
+    return gVideoController->primeFirstFrame(format) == MEDIA_STATUS_OK ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * boolean nativeGetStartupStats(long[] out)
+ *
+ * out[0] fast start (0/1), out[1] probe cached (0/1), out[2] open us,
+ * out[3] first decode us, out[4] first convert us, out[5] thread start us,
+ * out[6] play → first frame us, out[7] prepare → first frame us,
+ * out[8] codec context reused (0/1), out[9] prerolled by nativePreload (0/1)
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeGetStartupStats(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jlongArray jOut) {
+    if (!gVideoController || !jOut || env->GetArrayLength(jOut) < 10) return JNI_FALSE;
+
+    VideoStartupStats stats = gVideoController->getStartupStats();
+    jlong values[10] = {
+            (jlong)(stats.fastStart ? 1 : 0),
+            (jlong)(stats.probeCached ? 1 : 0),
+            (jlong)stats.openUs,
+            (jlong)stats.firstDecodeUs,
+            (jlong)stats.firstConvertUs,
+            (jlong)stats.threadStartUs,
+            (jlong)stats.playToFirstFrameUs,
+            (jlong)stats.firstFrameUs,
+            (jlong)(stats.codecReused ? 1 : 0),
+            (jlong)(stats.prerolled ? 1 : 0)
+    };
+    env->SetLongArrayRegion(jOut, 0, 10, values);
+    return JNI_TRUE;
+}
+
+/**
+ * void nativeSetThreadPolicy(int policy, int threads)
+ *
+ * Codec threading of the next nativePrepare(): 0 auto, 1 frame threads,
+ * 2 slice threads, 3 single thread. threads <= 0 picks by core count.
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeSetThreadPolicy(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jint policy,
+        jint threads) {
+    gThreadPolicy = (policy >= VIDEO_THREADS_AUTO && policy < VIDEO_THREAD_POLICY_COUNT)
+                    ? policy : VIDEO_THREADS_AUTO;
+    gDecodeThreads = threads;
+}
+
+/**
+ * boolean nativeGetThreadingStats(long[] out)
+ *
+ * out[0] policy (resolved), out[1] thread count, out[2] active FF_THREAD_* type,
+ * out[3] frames measured, out[4] avg decode latency us, out[5] max latency us,
+ * out[6] max frames in flight
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeGetThreadingStats(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jlongArray jOut) {
+    if (!gVideoController || !jOut || env->GetArrayLength(jOut) < 7) return JNI_FALSE;
+
+    VideoThreadingStats stats = gVideoController->getThreadingStats();
+    jlong values[7] = {
+            (jlong)stats.policy,
+            (jlong)stats.threadCount,
+            (jlong)stats.activeType,
+            (jlong)stats.frames,
+            (jlong)stats.avgLatencyUs,
+            (jlong)stats.maxLatencyUs,
+            (jlong)stats.maxFramesInFlight
+    };
+    env->SetLongArrayRegion(jOut, 0, 7, values);
+    return JNI_TRUE;
+}
+
+/**
+ * void nativeSetLiveMode(boolean enable, long targetMs)
+ *
+ * The next nativePrepare() opens a live stream: no avformat buffering,
+ * minimal probing, low-delay decoding. Over targetMs of buffered content
+ * non-reference frames are skipped until it is back at the target.
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeSetLiveMode(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jboolean enable,
+        jlong targetMs) {
+    gLive = enable == JNI_TRUE;
+    if (targetMs > 0) gLiveTargetMs = targetMs;
+    if (gVideoController) gVideoController->setLiveTarget(gLiveTargetMs);
+}
+
+/**
+ * boolean nativeGetLiveStats(long[] out)
+ *
+ * out[0] live (0/1), out[1] catching up (0/1), out[2] target ms,
+ * out[3] buffered ms (live edge - last frame handed out, -1 unknown),
+ * out[4] catch-up episodes, out[5] ms spent catching up,
+ * out[6] backlog skips, out[7] ms skipped
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeGetLiveStats(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jlongArray jOut) {
+    if (!gVideoController || !jOut || env->GetArrayLength(jOut) < 8) return JNI_FALSE;
+
+    VideoLiveStats stats = gVideoController->getLiveStats();
+    jlong values[8] = {
+            (jlong)(stats.live ? 1 : 0),
+            (jlong)(stats.catchingUp ? 1 : 0),
+            (jlong)stats.targetMs,
+            (jlong)stats.bufferMs,
+            (jlong)stats.catchUps,
+            (jlong)stats.catchUpMs,
+            (jlong)stats.skips,
+            (jlong)stats.skippedMs
+    };
+    env->SetLongArrayRegion(jOut, 0, 8, values);
+    return JNI_TRUE;
+}
+
+/**
+ * boolean nativeGetIoStats(long[] out)
+ *
+ * out[0] mode, out[1] source size, out[2] bytes read, out[3] read callbacks,
+ * out[4] syscalls (read / pread / madvise), out[5] seeks, out[6] bytes on disk
+ * (network cache, else -1), out[7] bytes read from the cache, out[8] downloaded
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeGetIoStats(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jlongArray jOut) {
+    if (!gVideoController || !jOut || env->GetArrayLength(jOut) < 9) return JNI_FALSE;
+
+    MediaIoStats stats = gVideoController->getIoStats();
+    jlong values[9] = {
+            (jlong)stats.mode,
+            (jlong)stats.size,
+            (jlong)stats.bytesRead,
+            (jlong)stats.readCalls,
+            (jlong)stats.syscalls,
+            (jlong)stats.seeks,
+            (jlong)stats.cachedBytes,
+            (jlong)stats.cacheHitBytes,
+            (jlong)stats.downloadedBytes
+    };
+    env->SetLongArrayRegion(jOut, 0, 9, values);
     return JNI_TRUE;
 }
 
@@ -183,4 +591,554 @@ Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeReadFra
     return result;
 }
 
-} // extern "C"
\ No newline at end of file
+/**
+ * int nativeGetFrameBufferSize(int format)
+ *
+ * Bytes needed for one frame in the given VideoFormat.
+ */
+JNIEXPORT jint JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeGetFrameBufferSize(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jint format) {
+    if (!gVideoController) return 0;
+    return (jint)gVideoController->getFrameBufferSize(format);
+}
+
+/**
+ * int nativeReadFrameFormat(ByteBuffer buffer, int format, long[] ptsOut, int[] stridesOut)
+ *
+ * Same as nativeReadFrame but lets the caller pick the output layout
+ * (VideoFormat.RGBA / I420 / NV12 / RGB565). Planes are packed back to back,
+ * stridesOut[0..2] receives the per-plane line size.
+ */
+JNIEXPORT jint JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeReadFrameFormat(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jobject jBuffer,
+        jint format,
+        jlongArray jPtsOut,
+        jintArray jStridesOut) {
+
+    if (!gVideoController || !jBuffer || !jPtsOut) {
+        return (jint)MEDIA_STATUS_ERROR;
+    }
+
+    uint8_t* dst = (uint8_t*)env->GetDirectBufferAddress(jBuffer);
+    jlong cap = env->GetDirectBufferCapacity(jBuffer);
+    if (!dst || cap <= 0) {
+        LOGE("nativeReadFrameFormat: buffer is not direct");
+        return (jint)MEDIA_STATUS_ERROR;
+    }
+
+    int64_t ptsMs = 0;
+    int strides[VIDEO_FORMAT_MAX_PLANES] = {0, 0, 0};
+    int result = gVideoController->readFrame(format, dst, (int)cap, strides, &ptsMs);
+
+    jlong ptsValue = (jlong)ptsMs;
+    env->SetLongArrayRegion(jPtsOut, 0, 1, &ptsValue);
+    if (jStridesOut && env->GetArrayLength(jStridesOut) >= VIDEO_FORMAT_MAX_PLANES) {
+        jint jStrides[VIDEO_FORMAT_MAX_PLANES] = {strides[0], strides[1], strides[2]};
+        env->SetIntArrayRegion(jStridesOut, 0, VIDEO_FORMAT_MAX_PLANES, jStrides);
+    }
+
+    return result;
+}
+
+/**
+ * int nativeStepFrame(int direction, ByteBuffer buffer, int format, long[] ptsOut,
+ *                     int[] stridesOut, long timeoutMs)
+ *
+ * Previous (direction < 0) or next frame from the GOP cache, laid out like
+ * nativeReadFrameFormat. Pauses forward decoding. Returns BUFFERING when the
+ * GOP is still being decoded after timeoutMs, EOF at either end.
+ */
+JNIEXPORT jint JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeStepFrame(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jint direction,
+        jobject jBuffer,
+        jint format,
+        jlongArray jPtsOut,
+        jintArray jStridesOut,
+        jlong timeoutMs) {
+
+    if (!gVideoController || !jBuffer || !jPtsOut) {
+        return (jint)MEDIA_STATUS_ERROR;
+    }
+
+    uint8_t* dst = (uint8_t*)env->GetDirectBufferAddress(jBuffer);
+    jlong cap = env->GetDirectBufferCapacity(jBuffer);
+    if (!dst || cap <= 0) {
+        LOGE("nativeStepFrame: buffer is not direct");
+        return (jint)MEDIA_STATUS_ERROR;
+    }
+
+    int64_t ptsMs = 0;
+    int strides[VIDEO_FORMAT_MAX_PLANES] = {0, 0, 0};
+    int result = gVideoController->stepFrame(direction, format, dst, (int)cap, strides, &ptsMs,
+                                             timeoutMs);
+    if (result == MEDIA_STATUS_OK) {
+        jlong ptsValue = (jlong)ptsMs;
+        env->SetLongArrayRegion(jPtsOut, 0, 1, &ptsValue);
+        if (jStridesOut && env->GetArrayLength(jStridesOut) >= VIDEO_FORMAT_MAX_PLANES) {
+            jint jStrides[VIDEO_FORMAT_MAX_PLANES] = {strides[0], strides[1], strides[2]};
+            env->SetIntArrayRegion(jStridesOut, 0, VIDEO_FORMAT_MAX_PLANES, jStrides);
+        }
+    }
+    return result;
+}
+
+/**
+ * void nativeSetGopCacheBudget(long maxBytes)
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeSetGopCacheBudget(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jlong maxBytes) {
+    if (!gVideoController) return;
+    gVideoController->setGopCacheBudget(maxBytes);
+}
+
+/**
+ * boolean nativeGetGopCacheStats(long[] out)
+ *
+ * out[0] runs, out[1] frames, out[2] bytes, out[3] budget bytes, out[4] hits,
+ * out[5] misses, out[6] GOPs decoded, out[7] of which prefetched,
+ * out[8] evictions, out[9] last GOP decode us
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeGetGopCacheStats(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jlongArray jOut) {
+    if (!gVideoController || !jOut || env->GetArrayLength(jOut) < 10) return JNI_FALSE;
+
+    GopCacheStats stats = gVideoController->getGopCacheStats();
+    jlong values[10] = {
+            (jlong)stats.runs,
+            (jlong)stats.frames,
+            (jlong)stats.bytes,
+            (jlong)stats.budgetBytes,
+            (jlong)stats.hits,
+            (jlong)stats.misses,
+            (jlong)stats.gopsDecoded,
+            (jlong)stats.prefetched,
+            (jlong)stats.evictions,
+            (jlong)stats.lastDecodeUs
+    };
+    env->SetLongArrayRegion(jOut, 0, 10, values);
+    return JNI_TRUE;
+}
+
+/**
+ * void nativeSetConvertThreads(int count)
+ *
+ * Number of threads used for colour conversion (1 = single sws_scale call).
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeSetConvertThreads(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jint count) {
+    if (!gVideoController) return;
+    LOGI("FfmpegVideoEngine.nativeSetConvertThreads: %d", count);
+    gVideoController->setConvertThreads(count);
+}
+
+/**
+ * int nativeBenchmarkConvert(int format, int iterations, long[] avgUsOut)
+ *
+ * Converts the next queued frame with 1..avgUsOut.size threads and writes the
+ * average microseconds per frame for each thread count.
+ */
+JNIEXPORT jint JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeBenchmarkConvert(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jint format,
+        jint iterations,
+        jlongArray jAvgUsOut) {
+    if (!gVideoController || !jAvgUsOut) return (jint)MEDIA_STATUS_ERROR;
+
+    int maxThreads = env->GetArrayLength(jAvgUsOut);
+    if (maxThreads > SliceConverter::MAX_THREADS) maxThreads = SliceConverter::MAX_THREADS;
+    int64_t avgUs[SliceConverter::MAX_THREADS] = {0};
+    int ret = gVideoController->benchmarkConvert(format, maxThreads, iterations, avgUs);
+    if (ret > 0) {
+        jlong values[SliceConverter::MAX_THREADS];
+        for (int i = 0; i < ret; i++) values[i] = (jlong)avgUs[i];
+        env->SetLongArrayRegion(jAvgUsOut, 0, ret, values);
+    }
+    return ret;
+}
+
+/**
+ * void nativeSetOutputTransform(int dstWidth, int dstHeight, int rotation,
+ *                               int cropX, int cropY, int cropWidth, int cropHeight,
+ *                               boolean keepAspect)
+ *
+ * Crop / rotate / scale frames to the target surface while converting.
+ * 0 sizes = native, rotation -1 = follow the stream's display matrix.
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeSetOutputTransform(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jint dstWidth,
+        jint dstHeight,
+        jint rotation,
+        jint cropX,
+        jint cropY,
+        jint cropWidth,
+        jint cropHeight,
+        jboolean keepAspect) {
+    if (!gVideoController) return;
+
+    VideoTransform transform;
+    transform.dstWidth = dstWidth;
+    transform.dstHeight = dstHeight;
+    transform.rotation = rotation;
+    transform.cropX = cropX;
+    transform.cropY = cropY;
+    transform.cropWidth = cropWidth;
+    transform.cropHeight = cropHeight;
+    transform.keepAspect = keepAspect == JNI_TRUE;
+    gVideoController->setOutputTransform(transform);
+}
+
+/**
+ * int nativeGetDisplayRotation()
+ *
+ * Clockwise rotation (0/90/180/270) stored in the stream's display matrix.
+ */
+JNIEXPORT jint JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeGetDisplayRotation(
+        JNIEnv* env,
+        jobject /*thiz*/) {
+    if (!gVideoController) return 0;
+    return (jint)gVideoController->getDisplayRotation();
+}
+
+/**
+ * void nativeSetAccurateSeek(boolean enable)
+ *
+ * true: seeks decode and drop frames up to the exact target instead of
+ * returning the previous keyframe.
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeSetAccurateSeek(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jboolean enable) {
+    if (!gVideoController) return;
+    gVideoController->setAccurateSeek(enable == JNI_TRUE);
+}
+
+/**
+ * boolean nativeGetSeekStats(long[] out)
+ *
+ * out[0] target ms, out[1] landed ms, out[2] latency us,
+ * out[3] discarded frames, out[4] completed seeks
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeGetSeekStats(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jlongArray jOut) {
+    if (!gVideoController || !jOut || env->GetArrayLength(jOut) < 5) return JNI_FALSE;
+
+    VideoSeekStats stats = gVideoController->getSeekStats();
+    jlong values[5] = {
+            (jlong)stats.targetMs,
+            (jlong)stats.landedMs,
+            (jlong)stats.latencyUs,
+            (jlong)stats.discardedFrames,
+            (jlong)stats.seekCount
+    };
+    env->SetLongArrayRegion(jOut, 0, 5, values);
+    return JNI_TRUE;
+}
+
+/**
+ * boolean nativeGetSeekLatencyStats(long[] out)
+ *
+ * out[0] seek requests, out[1] coalesced, out[2] aborted decodes,
+ * out[3] samples, out[4] p50 us, out[5] p90 us, out[6] p99 us,
+ * out[7] max us, out[8] last us (seek() to first frame handed out)
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeGetSeekLatencyStats(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jlongArray jOut) {
+    if (!gVideoController || !jOut || env->GetArrayLength(jOut) < 9) return JNI_FALSE;
+
+    VideoSeekLatencyStats stats = gVideoController->getSeekLatencyStats();
+    jlong values[9] = {
+            (jlong)stats.requests,
+            (jlong)stats.coalesced,
+            (jlong)stats.aborted,
+            (jlong)stats.samples,
+            (jlong)stats.p50Us,
+            (jlong)stats.p90Us,
+            (jlong)stats.p99Us,
+            (jlong)stats.maxUs,
+            (jlong)stats.lastUs
+    };
+    env->SetLongArrayRegion(jOut, 0, 9, values);
+    return JNI_TRUE;
+}
+
+/**
+ * void nativeSetAdaptiveQuality(boolean enable, int maxLevel)
+ *
+ * Degrade decode quality (FfmpegVideoEngine.QOS_*) while the decoder falls behind.
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeSetAdaptiveQuality(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jboolean enable,
+        jint maxLevel) {
+    if (!gVideoController) return;
+    gVideoController->setQosEnabled(enable == JNI_TRUE, maxLevel);
+}
+
+/**
+ * boolean nativeGetQosStats(long[] out)
+ *
+ * out[0] current level, out[1] step downs, out[2] step ups,
+ * out[3] underruns, out[4] microseconds at the current level
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeGetQosStats(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jlongArray jOut) {
+    if (!gVideoController || !jOut || env->GetArrayLength(jOut) < 5) return JNI_FALSE;
+
+    VideoQosStats stats = gVideoController->getQosStats();
+    jlong values[5] = {
+            (jlong)stats.level,
+            (jlong)stats.stepDowns,
+            (jlong)stats.stepUps,
+            (jlong)stats.underruns,
+            (jlong)(av_gettime_relative() - stats.levelSinceUs)
+    };
+    env->SetLongArrayRegion(jOut, 0, 5, values);
+    return JNI_TRUE;
+}
+
+/**
+ * void nativeSetFrameQueueBudget(long maxBytes, long maxDurationMs)
+ *
+ * Decoded frames kept ahead of the renderer; <= 0 keeps the current limit.
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeSetFrameQueueBudget(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jlong maxBytes,
+        jlong maxDurationMs) {
+    if (!gVideoController) return;
+    gVideoController->setQueueBudget(maxBytes, maxDurationMs);
+}
+
+/**
+ * boolean nativeGetFrameQueueStats(long[] out)
+ *
+ * out[0] frames, out[1] bytes, out[2] buffered ms,
+ * out[3] byte budget, out[4] duration budget, out[5] pool capacity
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeGetFrameQueueStats(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jlongArray jOut) {
+    if (!gVideoController || !jOut || env->GetArrayLength(jOut) < 6) return JNI_FALSE;
+
+    VideoQueueStats stats = gVideoController->getQueueStats();
+    jlong values[6] = {
+            (jlong)stats.frames,
+            (jlong)stats.bytes,
+            (jlong)stats.durationMs,
+            (jlong)stats.maxBytes,
+            (jlong)stats.maxDurationMs,
+            (jlong)stats.poolCapacity
+    };
+    env->SetLongArrayRegion(jOut, 0, 6, values);
+    return JNI_TRUE;
+}
+
+/**
+ * void nativeSetPacketBufferLimits(long maxBytes, long maxDurationMs)
+ *
+ * Read-ahead of the demux thread; <= 0 keeps the current limit.
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeSetPacketBufferLimits(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jlong maxBytes,
+        jlong maxDurationMs) {
+    if (!gVideoController) return;
+    gVideoController->setPacketBufferLimits(maxBytes, maxDurationMs);
+}
+
+/**
+ * boolean nativeGetDemuxStats(long[] out)
+ *
+ * out[0..3] video queue: packets, bytes, buffered ms, decoder waits
+ * out[4..7] audio queue: packets, bytes, buffered ms, decoder waits
+ * out[8] queued bytes of all streams, out[9] packets read,
+ * out[10] reads interrupted by seek / close, out[11] I/O deadlines hit
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeGetDemuxStats(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jlongArray jOut) {
+    if (!gVideoController || !jOut || env->GetArrayLength(jOut) < 12) return JNI_FALSE;
+
+    MediaDemuxerStats stats = gVideoController->getDemuxStats();
+    MediaDemuxerQueueStats video = gVideoController->getPacketQueueStats(AVMEDIA_TYPE_VIDEO);
+    MediaDemuxerQueueStats audio = gVideoController->getPacketQueueStats(AVMEDIA_TYPE_AUDIO);
+    jlong values[12] = {
+            (jlong)video.packets,
+            (jlong)video.bytes,
+            (jlong)video.durationMs,
+            (jlong)video.waits,
+            (jlong)audio.packets,
+            (jlong)audio.bytes,
+            (jlong)audio.durationMs,
+            (jlong)audio.waits,
+            (jlong)stats.queuedBytes,
+            (jlong)stats.packetsRead,
+            (jlong)stats.ioInterrupts,
+            (jlong)stats.ioTimeouts
+    };
+    env->SetLongArrayRegion(jOut, 0, 12, values);
+    return JNI_TRUE;
+}
+
+/**
+ * void nativeSetMasterClock(int source, long lateThresholdMs)
+ *
+ * source: 0 none, 1 OpenSL audio clock, 2 pushed by nativeUpdateMasterClock.
+ * Frames later than lateThresholdMs are dropped before conversion.
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeSetMasterClock(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jint source,
+        jlong lateThresholdMs) {
+    if (!gVideoController) return;
+    switch (source) {
+        case MASTER_CLOCK_OPENSL:
+            gVideoController->setMasterClock(&openSlAudioClock, nullptr, lateThresholdMs);
+            break;
+        case MASTER_CLOCK_EXTERNAL:
+            gVideoController->setMasterClock(&VideoDecoderController::pushedMasterClock,
+                                             gVideoController, lateThresholdMs);
+            break;
+        case MASTER_CLOCK_NONE:
+        default:
+            gVideoController->setMasterClock(nullptr, nullptr, 0);
+            break;
+    }
+}
+
+/**
+ * void nativeUpdateMasterClock(long clockMs)
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeUpdateMasterClock(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jlong clockMs) {
+    if (!gVideoController) return;
+    gVideoController->updateMasterClock(clockMs);
+}
+
+/**
+ * long nativeGetLateDropCount()
+ *
+ * Frames dropped natively for being behind the master clock since prepare.
+ */
+JNIEXPORT jlong JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeGetLateDropCount(
+        JNIEnv* env,
+        jobject /*thiz*/) {
+    if (!gVideoController) return 0;
+    return (jlong)gVideoController->getLateDropCount();
+}
+
+/**
+ * static void nativeSetIndexCacheDir(String dir)
+ *
+ * Where keyframe index and probe cache sidecars are stored (audio and video decoders).
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeSetIndexCacheDir(
+        JNIEnv* env,
+        jclass /*clazz*/,
+        jstring jDir) {
+    std::string dir = JStringToStdString(env, jDir);
+    KeyframeIndex::setCacheDir(dir.c_str());
+    ProbeCache::setCacheDir(dir.c_str());
+}
+
+/**
+ * static void nativeSetNetworkCache(String dir, long maxBytes)
+ *
+ * Disk cache for http(s) media; an empty dir disables it. Entries beyond
+ * maxBytes are evicted least recently used first.
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeSetNetworkCache(
+        JNIEnv* env,
+        jclass /*clazz*/,
+        jstring jDir,
+        jlong maxBytes) {
+    std::string dir = JStringToStdString(env, jDir);
+    MediaCache::setCacheDir(dir.c_str(), (int64_t)maxBytes);
+}
+
+/**
+ * static void nativeClearNetworkCache()
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeClearNetworkCache(
+        JNIEnv* env,
+        jclass /*clazz*/) {
+    MediaCache::clear();
+}
+
+/**
+ * static boolean nativeGetNetworkCacheStats(long[] out)
+ *
+ * out[0] bytes on disk, out[1] entries, out[2] evictions since start
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_FfmpegVideoEngine_nativeGetNetworkCacheStats(
+        JNIEnv* env,
+        jclass /*clazz*/,
+        jlongArray jOut) {
+    if (!jOut || env->GetArrayLength(jOut) < 3) return JNI_FALSE;
+
+    MediaCacheStats stats = MediaCache::getStats();
+    jlong values[3] = {
+            (jlong)stats.usedBytes,
+            (jlong)stats.entries,
+            (jlong)stats.evictions
+    };
+    env->SetLongArrayRegion(jOut, 0, 3, values);
+    return JNI_TRUE;
+}
+
+} // extern "C"
@@ -0,0 +1,145 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include <jni.h>
+#include <string>
+#include <vector>
+#include "thumbnail_generator.h"
+
+#define LOG_TAG "ThumbnailBridge"
+#include "CommonTools.h"
+
+static ThumbnailGenerator* gThumbnailGenerator = nullptr;
+
+extern "C" {
+
+static std::string JStringToStdString(JNIEnv* env, jstring jstr) {
+    if (!jstr) return {};
+    const char* utf = env->GetStringUTFChars(jstr, nullptr);
+    std::string result(utf ? utf : "");
+    env->ReleaseStringUTFChars(jstr, utf);
+    return result;
+}
+
+/**
+ * boolean nativeStart(String path, long intervalMs, int cellWidth, int columns,
+ *                     int maxCount, int format, int lowres, String cacheDir)
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_ThumbnailGenerator_nativeStart(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jstring jPath,
+        jlong intervalMs,
+        jint cellWidth,
+        jint columns,
+        jint maxCount,
+        jint format,
+        jint lowres,
+        jstring jCacheDir) {
+
+    std::string path = JStringToStdString(env, jPath);
+    LOGI("ThumbnailGenerator.nativeStart path=%s", path.c_str());
+
+    if (gThumbnailGenerator) {
+        delete gThumbnailGenerator;
+        gThumbnailGenerator = nullptr;
+    }
+    gThumbnailGenerator = new ThumbnailGenerator();
+
+    ThumbnailOptions options;
+    options.intervalMs = intervalMs;
+    options.cellWidth = cellWidth;
+    options.columns = columns;
+    options.maxCount = maxCount;
+    options.format = format;
+    options.lowres = lowres;
+    options.cacheDir = JStringToStdString(env, jCacheDir);
+
+    if (gThumbnailGenerator->start(path.c_str(), options) < 0) {
+        LOGE("ThumbnailGenerator start failed");
+        delete gThumbnailGenerator;
+        gThumbnailGenerator = nullptr;
+        return JNI_FALSE;
+    }
+    return JNI_TRUE;
+}
+
+/**
+ * boolean nativeGetInfo(int[] out)
+ *
+ * out: count, columns, rows, cellWidth, cellHeight, format, atlasBytes
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_ThumbnailGenerator_nativeGetInfo(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jintArray jOut) {
+    if (!gThumbnailGenerator || !jOut || env->GetArrayLength(jOut) < 7) return JNI_FALSE;
+
+    ThumbnailAtlasInfo info = gThumbnailGenerator->getInfo();
+    jint values[7] = {info.count, info.columns, info.rows, info.cellWidth,
+                      info.cellHeight, info.format, info.atlasBytes};
+    env->SetIntArrayRegion(jOut, 0, 7, values);
+    return JNI_TRUE;
+}
+
+/**
+ * int nativeCopyAtlas(ByteBuffer atlas, long[] ptsOut)
+ *
+ * Copies the sprite sheet and the per-cell pts (-1 = not decoded yet).
+ * Returns the number of ready cells, <0 on error.
+ */
+JNIEXPORT jint JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_ThumbnailGenerator_nativeCopyAtlas(
+        JNIEnv* env,
+        jobject /*thiz*/,
+        jobject jBuffer,
+        jlongArray jPtsOut) {
+    if (!gThumbnailGenerator || !jBuffer) return -1;
+
+    auto* dst = (uint8_t*)env->GetDirectBufferAddress(jBuffer);
+    jlong cap = env->GetDirectBufferCapacity(jBuffer);
+    if (!dst || cap <= 0) {
+        LOGE("nativeCopyAtlas: buffer is not direct");
+        return -1;
+    }
+
+    int ptsCount = jPtsOut ? env->GetArrayLength(jPtsOut) : 0;
+    std::vector<int64_t> pts((size_t)ptsCount);
+    int ready = gThumbnailGenerator->copyAtlas(dst, (int)cap, pts.data(), ptsCount);
+    if (ready >= 0 && ptsCount > 0) {
+        std::vector<jlong> values(pts.begin(), pts.end());
+        env->SetLongArrayRegion(jPtsOut, 0, ptsCount, values.data());
+    }
+    return ready;
+}
+
+/**
+ * boolean nativeIsDone()
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_ThumbnailGenerator_nativeIsDone(
+        JNIEnv* env,
+        jobject /*thiz*/) {
+    if (!gThumbnailGenerator) return JNI_TRUE;
+    return gThumbnailGenerator->isDone() ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * void nativeRelease()
+ */
+JNIEXPORT void JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_ThumbnailGenerator_nativeRelease(
+        JNIEnv* env,
+        jobject /*thiz*/) {
+    LOGI("ThumbnailGenerator.nativeRelease");
+    if (gThumbnailGenerator) {
+        gThumbnailGenerator->stop();
+        delete gThumbnailGenerator;
+        gThumbnailGenerator = nullptr;
+    }
+}
+
+} // extern "C"
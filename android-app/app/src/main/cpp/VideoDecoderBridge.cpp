@@ -101,7 +101,7 @@ Java_com_audio_study_ffmpegdecoder_video_VideoPlayer_nativeDecodeToRgba(
     } else if (ret < MEDIA_STATUS_EOF) {
         // Other error
         if (frame) {
-            VideoDecoderController::freeFrame(frame);
+            gVideoController->freeFrame(frame);
         }
         return ret;
     }
@@ -109,7 +109,7 @@ Java_com_audio_study_ffmpegdecoder_video_VideoPlayer_nativeDecodeToRgba(
     // ret == 1: we have a valid frame
     if (!frame || !frame->data || frame->dataSize <= 0) {
         if (frame) {
-            VideoDecoderController::freeFrame(frame);
+            gVideoController->freeFrame(frame);
         }
         return MEDIA_STATUS_ERROR;
     }
@@ -117,7 +117,7 @@ Java_com_audio_study_ffmpegdecoder_video_VideoPlayer_nativeDecodeToRgba(
     // Ensure buffer is big enough
     if (cap < frame->dataSize) {
         // Java buffer too small: this is a usage/config error
-        VideoDecoderController::freeFrame(frame);
+        gVideoController->freeFrame(frame);
         return MEDIA_STATUS_ERROR;
     }
 
@@ -126,7 +126,7 @@ Java_com_audio_study_ffmpegdecoder_video_VideoPlayer_nativeDecodeToRgba(
     int written = frame->dataSize;
 
     // Free frame back on native side
-    VideoDecoderController::freeFrame(frame);
+    gVideoController->freeFrame(frame);
 
     return written;
 }
@@ -153,7 +153,7 @@ Java_com_audio_study_ffmpegdecoder_video_VideoPlayer_nativeDecodeToRgbaWithPts(
         return MEDIA_STATUS_BUFFERING;
     } else if (ret < MEDIA_STATUS_EOF) {
         if (frame) {
-            VideoDecoderController::freeFrame(frame);
+            gVideoController->freeFrame(frame);
         }
         return MEDIA_STATUS_ERROR; // ERROR
     }
@@ -161,13 +161,13 @@ Java_com_audio_study_ffmpegdecoder_video_VideoPlayer_nativeDecodeToRgbaWithPts(
     // ret == 1: got a frame
     if (!frame || !frame->data || frame->dataSize <= 0) {
         if (frame) {
-            VideoDecoderController::freeFrame(frame);
+            gVideoController->freeFrame(frame);
         }
         return MEDIA_STATUS_ERROR;
     }
 
     if (cap < frame->dataSize) {
-        VideoDecoderController::freeFrame(frame);
+        gVideoController->freeFrame(frame);
         return MEDIA_STATUS_ERROR;
     }
 
@@ -179,7 +179,7 @@ Java_com_audio_study_ffmpegdecoder_video_VideoPlayer_nativeDecodeToRgbaWithPts(
     env->SetLongArrayRegion(ptsOutMs, 0, 1, &pts);
 
     int written = frame->dataSize;
-    VideoDecoderController::freeFrame(frame);
+    gVideoController->freeFrame(frame);
 
     return written;
 }
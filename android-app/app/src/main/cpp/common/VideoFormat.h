@@ -0,0 +1,17 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+#pragma once
+
+// Output pixel formats understood by the native video read path.
+// Keep in sync with com.audio.study.ffmpegdecoder.common.VideoFormat.
+static const int VIDEO_FORMAT_RGBA   = 0;  // packed RGBA8888, 4 bytes/pixel
+static const int VIDEO_FORMAT_I420   = 1;  // planar Y, U, V (4:2:0), 1.5 bytes/pixel
+static const int VIDEO_FORMAT_NV12   = 2;  // planar Y + interleaved UV (4:2:0)
+static const int VIDEO_FORMAT_RGB565 = 3;  // packed RGB565 little-endian, 2 bytes/pixel
+
+static const int VIDEO_FORMAT_MAX_PLANES = 3;
+
+// Output rotation: 0 / 90 / 180 / 270 clockwise, or follow the stream's
+// display matrix.
+static const int VIDEO_ROTATION_AUTO = -1;
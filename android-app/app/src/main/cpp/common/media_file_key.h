@@ -0,0 +1,42 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <sys/stat.h>
+
+/**
+ * Identity of a local media file for on-disk caches: path + size + mtime.
+ * Any change to the file invalidates everything keyed on it.
+ */
+struct MediaFileKey {
+    std::string path;
+    int64_t size = 0;
+    int64_t mtime = 0;
+
+    // false for non-regular files (network / content URLs)
+    bool load(const char* mediaPath) {
+        struct stat st{};
+        if (!mediaPath || stat(mediaPath, &st) != 0 || !S_ISREG(st.st_mode)) return false;
+        path = mediaPath;
+        size = st.st_size;
+        mtime = st.st_mtime;
+        return true;
+    }
+
+    bool sameFile(int64_t otherSize, int64_t otherMtime) const {
+        return size == otherSize && mtime == otherMtime;
+    }
+
+    // FNV-1a of the path, stable across runs (std::hash is not guaranteed to be)
+    uint64_t pathHash() const {
+        uint64_t h = 1469598103934665603ULL;
+        for (unsigned char c : path) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+};
@@ -0,0 +1,144 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+#include <pthread.h>
+
+/**
+ * Bounded single-producer / single-consumer ring.
+ *
+ * push() is called from exactly one thread, pop() / front() from exactly one
+ * other thread; both are wait-free (no lock, no CAS). The two indices live on
+ * separate cache lines, each next to its owner's cached copy of the other
+ * index, so the threads only touch the other side's line when the cached copy
+ * says the ring looks full / empty.
+ *
+ * The capacity is rounded up to a power of two. size() / empty() can be called
+ * from any thread but are only a snapshot.
+ */
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t minCapacity)
+            : mask(roundUpPow2(minCapacity) - 1), slots(mask + 1) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // producer: false when full
+    bool push(const T& value) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead > mask) return false;
+        }
+        slots[t & mask] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer: false when empty
+    bool pop(T& out) {
+        T* slot = front();
+        if (!slot) return false;
+        out = *slot;
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer: the next element without removing it, nullptr when empty
+    T* front() {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail) return nullptr;
+        }
+        return &slots[h & mask];
+    }
+
+    size_t size() const {
+        // head first: tail never falls behind it
+        const size_t h = head.load(std::memory_order_acquire);
+        const size_t t = tail.load(std::memory_order_acquire);
+        return t - h;
+    }
+
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return mask + 1; }
+
+private:
+    static size_t roundUpPow2(size_t n) {
+        size_t p = 2;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    static constexpr size_t CACHE_LINE = 64;
+
+    // consumer side
+    alignas(CACHE_LINE) std::atomic<size_t> head{0};
+    size_t cachedTail = 0;
+
+    // producer side
+    alignas(CACHE_LINE) std::atomic<size_t> tail{0};
+    size_t cachedHead = 0;
+
+    alignas(CACHE_LINE) const size_t mask;
+    std::vector<T> slots;
+};
+
+/**
+ * Blocking side channel for SpscRing users: the thread that has to wait (the
+ * decoder on a full queue) parks in wait(), the other side calls notify()
+ * after changing the state the predicate looks at. notify() only takes the
+ * mutex when somebody is actually parked, so the non-blocking side stays
+ * lock-free in the steady state.
+ */
+class SpscWaiter {
+public:
+    SpscWaiter() {
+        pthread_mutex_init(&mutex, nullptr);
+        pthread_cond_init(&cond, nullptr);
+    }
+
+    ~SpscWaiter() {
+        pthread_cond_destroy(&cond);
+        pthread_mutex_destroy(&mutex);
+    }
+
+    SpscWaiter(const SpscWaiter&) = delete;
+    SpscWaiter& operator=(const SpscWaiter&) = delete;
+
+    // block until ready() returns true; ready() must only read atomics
+    template <typename Pred>
+    void wait(Pred ready) {
+        pthread_mutex_lock(&mutex);
+        waiters.fetch_add(1, std::memory_order_relaxed);
+        // pairs with the fence in notify(): either we see the new state or
+        // notify() sees us parked
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (!ready()) {
+            pthread_cond_wait(&cond, &mutex);
+        }
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+        pthread_mutex_unlock(&mutex);
+    }
+
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) == 0) return;
+        pthread_mutex_lock(&mutex);
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&mutex);
+    }
+
+private:
+    pthread_mutex_t mutex{};
+    pthread_cond_t cond{};
+    std::atomic<int> waiters{0};
+};
@@ -17,19 +17,16 @@ int AudioDecoder::initAudioDecoder(const char *string) {
     // 1. register all decoders
     avcodec_register_all();
 
-    avFormatContext = avformat_alloc_context();
-
-    result = avformat_open_input(&avFormatContext, string, NULL, NULL);
-    if (result != 0) {
+    demuxer = MediaDemuxer::acquire(string, true, &result, ioOptions);
+    if (!demuxer) {
         return -1;
     }
-
-    avformat_find_stream_info(avFormatContext, NULL);
+    avFormatContext = demuxer->context();
 
     // find audio stream
     for (int i = 0; i < avFormatContext->nb_streams; i++) {
         AVStream *stream = avFormatContext->streams[i];
-        if (AVMEDIA_TYPE_AUDIO == stream->codec->codec_type) {
+        if (AVMEDIA_TYPE_AUDIO == stream->codecpar->codec_type) {
             audioIndex = i;
         }
     }
@@ -40,11 +37,20 @@ int AudioDecoder::initAudioDecoder(const char *string) {
 
     audioStream     = avFormatContext->streams[audioIndex];
     time_base       = av_q2d(audioStream->time_base);
-    avCodecContext  = audioStream->codec;
-    AVCodec *avCodec = avcodec_find_decoder(avCodecContext->codec_id);
+    // every audio packet is a keyframe: keep one index entry per second
+    demuxer->subscribe(audioIndex, av_rescale_q(1, AVRational{1, 1}, audioStream->time_base));
+    // own context from codecpar: stream->codec is only filled by probing,
+    // which a ProbeCache hit skips
+    AVCodec *avCodec = avcodec_find_decoder(audioStream->codecpar->codec_id);
     if (avCodec == NULL) {
         return -1;
     }
+    avCodecContext = avcodec_alloc_context3(avCodec);
+    if (avCodecContext == NULL ||
+        avcodec_parameters_to_context(avCodecContext, audioStream->codecpar) < 0) {
+        return -1;
+    }
+    avCodecContext->pkt_timebase = audioStream->time_base;
     result = avcodec_open2(avCodecContext, avCodec, NULL);
     if (result != 0) {
         return -1;
@@ -74,8 +80,9 @@ int AudioDecoder::initAudioDecoder(const char *string) {
          avCodecContext->frame_size,
          (long long) duration, channels);
 
-    // resample if needed
-    if (!audioCodecIsSupported()) {
+    // resample if needed; live sources always go through swr so they can be
+    // time-compressed while catching up
+    if (!audioCodecIsSupported() || demuxer->isLive()) {
         swrContext = swr_alloc_set_opts(
                 NULL,
                 AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_S16, sampleRate,
@@ -132,6 +139,7 @@ PcmFrame* AudioDecoder::decoderAudioPacket() {
         audioPacket->audioSize      = stereoSampleSize;
         audioPacket->duration       = audioDuration;
         audioPacket->startPosition  = audioStartPosition;
+        audioPacket->speed          = speed;
     } else {
         // no data, mark as EOF/error
         delete[] resample;
@@ -162,7 +170,8 @@ int AudioDecoder::readSampleData(short *samples, int size) {
             size -= copySize;
             audioBufferCursor += copySize;
         } else {
-            if (readFrame() < 0) {
+            // a stalled source must not hold up stop / seek
+            if (interrupted() || readFrame() < 0) {
                 break;
             }
         }
@@ -177,40 +186,62 @@ int AudioDecoder::readSampleData(short *samples, int size) {
 int AudioDecoder::readFrame() {
     int ret = 0;
     avPacket = av_packet_alloc();
-    if (av_read_frame(avFormatContext, avPacket) >= 0) {
-        if (avPacket->stream_index == audioIndex) {
-            avcodec_send_packet(avCodecContext, avPacket);
-            av_packet_unref(avPacket);
-            int re = avcodec_receive_frame(avCodecContext, avFrame);
-            if (re != 0) {
-                ret = -1;
-            } else {
-                int numChannels = av_get_channel_layout_nb_channels(AV_CH_LAYOUT_STEREO);
-                int numFrames = 0;
-                int size = av_samples_get_buffer_size(
-                        NULL,
-                        numChannels,
-                        avFrame->nb_samples * numChannels,
-                        AV_SAMPLE_FMT_S16,
-                        1);
-                uint8_t *resampleOutBuffer = (uint8_t *) malloc(size);
-                if (swrContext) {
-                    numFrames = swr_convert(
-                            swrContext,
-                            &resampleOutBuffer, avFrame->nb_samples * numChannels,
-                            (const u_int8_t **) avFrame->data, avFrame->nb_samples);
-                } else {
-                    resampleOutBuffer = *avFrame->data;
-                    numFrames = avFrame->nb_samples;
+    int64_t resumeMs = -1;
+    int readRet = demuxer->readPacket(audioIndex, avPacket, &resumeMs);
+    if (readRet == MediaDemuxer::DISCONTINUITY) {
+        // the video decoder repositioned the shared demuxer
+        avcodec_flush_buffers(avCodecContext);
+        discard_until_pts = resumeMs >= 0
+                            ? av_rescale_q(resumeMs, AVRational{1, 1000}, audioStream->time_base)
+                            : AV_NOPTS_VALUE;
+    } else if (readRet == AVERROR(EAGAIN)) {
+        // packet buffer ran dry (slow I/O): nothing decoded, the caller retries
+    } else if (readRet >= 0) {
+        avcodec_send_packet(avCodecContext, avPacket);
+        av_packet_unref(avPacket);
+        int re = avcodec_receive_frame(avCodecContext, avFrame);
+        if (re != 0) {
+            ret = -1;
+        } else if (discard_until_pts != AV_NOPTS_VALUE && avFrame->pts != AV_NOPTS_VALUE &&
+                   avFrame->pts + avFrame->pkt_duration <= discard_until_pts) {
+            // seek landed before the target, skip up to it
+        } else {
+            discard_until_pts = AV_NOPTS_VALUE;
+            int numChannels = av_get_channel_layout_nb_channels(AV_CH_LAYOUT_STEREO);
+            int numFrames = 0;
+            int size = av_samples_get_buffer_size(
+                    NULL,
+                    numChannels,
+                    avFrame->nb_samples * numChannels,
+                    AV_SAMPLE_FMT_S16,
+                    1);
+            uint8_t *resampleOutBuffer = (uint8_t *) malloc(size);
+            if (swrContext && (speed != 1.0f || compensating)) {
+                // drop (speed - 1) / speed of this frame's samples, spread
+                // over the frame; (0, 0) ends the compensation
+                int wanted = (int) (avFrame->nb_samples / speed);
+                bool compensate = speed != 1.0f;
+                if (swr_set_compensation(swrContext, compensate ? wanted - avFrame->nb_samples : 0,
+                                         compensate ? wanted : 0) >= 0) {
+                    compensating = compensate;
                 }
-                audioBuffer       = (short*) resampleOutBuffer;
-                audioBufferCursor = 0;
-                audioBufferSize   = numFrames * numChannels;  // samples
+            }
+            if (swrContext) {
+                numFrames = swr_convert(
+                        swrContext,
+                        &resampleOutBuffer, avFrame->nb_samples * numChannels,
+                        (const u_int8_t **) avFrame->data, avFrame->nb_samples);
+            } else {
+                resampleOutBuffer = *avFrame->data;
+                numFrames = avFrame->nb_samples;
+            }
+            audioBuffer       = (short*) resampleOutBuffer;
+            audioBufferCursor = 0;
+            audioBufferSize   = numFrames * numChannels;  // samples
 
-                audioDuration += av_frame_get_pkt_duration(avFrame) * time_base;
-                if (audioStartPosition == 0) {
-                    audioStartPosition = avFrame->pts * time_base;
-                }
+            audioDuration += avFrame->pkt_duration * time_base;
+            if (audioStartPosition == 0) {
+                audioStartPosition = avFrame->pts * time_base;
             }
         }
     } else {
@@ -230,10 +261,9 @@ void AudioDecoder::seekFrame() {
 
         int64_t seek_pts = av_rescale_q(time_seek, srcTimeBase, dstTimeBase);
 
-        int ret = av_seek_frame(avFormatContext,
-                                audioIndex,
-                                seek_pts,
-                                AVSEEK_FLAG_BACKWARD);
+        // lands on an index entry or the video keyframe before the target
+        int ret = demuxer->seek(audioIndex, time_seek);
+        discard_until_pts = ret >= 0 ? seek_pts : AV_NOPTS_VALUE;
 
         if (ret < 0) {
             LOGI("seekFrame-- failed! time_position=%f s",
@@ -254,19 +284,25 @@ void AudioDecoder::seekFrame() {
     LOGI("seekFrame--end");
 }
 
+bool AudioDecoder::interrupted() const {
+    return (runningFlag && !runningFlag->load()) || (seekFlag && seekFlag->load());
+}
+
 bool AudioDecoder::audioCodecIsSupported() {
     return avCodecContext->sample_fmt == AV_SAMPLE_FMT_S16;
 }
 
 void AudioDecoder::destroy() {
     if (avCodecContext) {
-        avcodec_close(avCodecContext);
-        avCodecContext = nullptr;
+        avcodec_free_context(&avCodecContext);
     }
-    if (avFormatContext) {
-        avformat_close_input(&avFormatContext);
-        avFormatContext = nullptr;
+    if (demuxer) {
+        if (audioIndex >= 0) {
+            demuxer->unsubscribe(audioIndex);
+        }
+        demuxer.reset();
     }
+    avFormatContext = nullptr;
     audioStream = nullptr;
 
     swrContext = nullptr;
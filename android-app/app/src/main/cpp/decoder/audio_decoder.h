@@ -8,6 +8,9 @@
 #include "audio_decoder.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <atomic>
+#include <memory>
+#include "media_demuxer.h"
 
 extern "C" {
 #include <libavformat/avformat.h>
@@ -29,6 +32,7 @@ struct PcmFrame {
     int   audioSize;       // number of samples (interleaved)
     float duration;
     float startPosition;
+    float speed = 1.0f;    // media time per played time, >1 while time-compressed
     PcmFrame() {
         audioBuffer    = NULL;
         audioSize      = 0;
@@ -50,10 +54,10 @@ class AudioDecoder {
 
 private:
     AVFormatContext *avFormatContext;
-    AVCodecContext  *avCodecContext;
+    AVCodecContext  *avCodecContext = nullptr;   // owned
     AVPacket        *avPacket;
     AVFrame         *avFrame;
-    SwrContext      *swrContext;
+    SwrContext      *swrContext = nullptr;
     AVStream        *audioStream = nullptr;
 
     int     audioIndex = AVERROR_STREAM_NOT_FOUND;
@@ -74,10 +78,26 @@ private:
     /** seek **/
     bool    need_seek = false;
     int64_t time_seek = -1;
+    // after a seek: drop frames ending before this pts
+    int64_t discard_until_pts = AV_NOPTS_VALUE;
+    // shared with the video decoder of the same path, owns avFormatContext
+    std::shared_ptr<MediaDemuxer> demuxer;
+    // owner's flags: stop waiting for a dry packet buffer once either says so
+    const std::atomic<bool>* runningFlag = nullptr;
+    const std::atomic<bool>* seekFlag = nullptr;
+
+    MediaIoOptions ioOptions;
+    // live catch-up, see setSpeed(); decoder thread
+    float speed = 1.0f;
+    bool  compensating = false;
 
     void seekFrame();
+    bool interrupted() const;
 
 public:
+    // how the container bytes are read, see MediaSource; before initAudioDecoder().
+    // The demuxer shared with the video decoder keeps whichever mode opened it.
+    void  setIoOptions(const MediaIoOptions& options) { ioOptions = options; }
     int   initAudioDecoder(const char *string);
     bool  audioCodecIsSupported();
     void  destroy();
@@ -96,6 +116,21 @@ public:
     int   getFramesPerPacket() { return packetBufferSize / CHANNEL_PER_FRAME; }
 
     void  seek(const long seek_time);
+
+    // time-compress the output: >1 plays `speed` times faster (slightly
+    // higher pitch) through swr compensation. Live sources always resample, so
+    // this only has an effect there. Decoder thread.
+    void  setSpeed(float newSpeed) { speed = newSpeed; }
+    float getSpeed() const { return speed; }
+    // live source: newest media time read by the demuxer, -1 unknown
+    int64_t getLiveEdgeMs() const { return demuxer ? demuxer->getLiveEdgeMs() : -1; }
+    bool  isLive() const { return demuxer && demuxer->isLive(); }
+
+    // decoderAudioPacket() returns early when !*running or *seekRequested
+    void  setInterruptFlags(const std::atomic<bool>* running, const std::atomic<bool>* seekRequested) {
+        runningFlag = running;
+        seekFlag = seekRequested;
+    }
 };
 
 #endif //FFMPEGDECODER_AUDIO_DECODER_H
\ No newline at end of file
@@ -15,6 +15,7 @@ AudioDecoderController::~AudioDecoderController() {
 int AudioDecoderController::getMusicMeta(const char *audioPath, int *metaArray) {
     int result = 0;
     audioDecoder = new AudioDecoder();
+    audioDecoder->setIoOptions(ioOptions);
     result = audioDecoder->initAudioDecoder(audioPath);
     if (result == 0) {
         metaArray[0] = audioDecoder->getSampleRate();
@@ -38,14 +39,18 @@ int AudioDecoderController::prepare(const char *audioPath) {
     }
 
     audioDecoder = new AudioDecoder();
+    audioDecoder->setIoOptions(ioOptions);
     result = audioDecoder->initAudioDecoder(audioPath);
     if (result != 0) {
+        // leaves the shared demuxer
+        audioDecoder->destroy();
         delete audioDecoder;
         audioDecoder = nullptr;
         return result;
     }
 
     audioDecoder->prepare();
+    audioDecoder->setInterruptFlags(&isRunning, &needSeek);
 
     // Reset timeline & clock
     progressMs            = 0;
@@ -54,6 +59,9 @@ int AudioDecoderController::prepare(const char *audioPath) {
     lastBufferDurationMs  = 0;
     needSeek              = false;
     seekTime              = -1;
+    decodeSerial          = seekSerial;
+    lastPacketSpeed       = 1.0f;
+    liveCatchUp.reset();
 
     initDecoderThread();
     return result;
@@ -61,26 +69,24 @@ int AudioDecoderController::prepare(const char *audioPath) {
 
 void AudioDecoderController::seek(const long seek_time) {
     // If decoder thread was already torn down, just ignore the seek
-    if (!mutexValid) {
+    if (!threadValid) {
         LOGE("AudioDecoderController::seek called after destroy, ignore");
         return;
     }
 
-    if (!isRunning) {
-        LOGI("seek: decoder thread is not running, restart it");
-        initDecoderThread();   // re-create mutex/cond + thread
-    }
-
-    pthread_mutex_lock(&mLock);
-
-    needSeek = true;
+    // queued PCM is stale from here on, readSamples() drops it
     seekTime = seek_time;
+    seekSerial++;
+    needSeek = true;
 
     // Immediately update “public” time so UI gets value
-    progressMs = seekTime;
+    progressMs = seek_time;
 
-    pthread_cond_signal(&mCondition);
-    pthread_mutex_unlock(&mLock);
+    if (!isRunning) {
+        LOGI("seek: decoder thread is not running, restart it");
+        initDecoderThread();
+    }
+    decoderWaiter.notify();
 }
 
 int64_t AudioDecoderController::getProgress() {
@@ -101,34 +107,32 @@ int AudioDecoderController::readSamples(short *samples, int size) {
     int result = 0;
     PcmFrame *audioPacket = nullptr;
 
-    // ---- 1) Take one packet from queue under lock ----
-    pthread_mutex_lock(&mLock);
-
-    bool localNeedSeek = needSeek;
-    if (!audioFrameQueue.empty() && !localNeedSeek) {
-        audioPacket = audioFrameQueue.front();
-        audioFrameQueue.pop();
+    // ---- 1) Take one packet from the ring, no lock on the callback path ----
+    if (!needSeek) {
+        const uint32_t serial = seekSerial;
+        QueuedPcmFrame queued;
+        while (audioFrameQueue.pop(queued)) {
+            if (queued.serial == serial) {
+                audioPacket = queued.frame;
+                break;
+            }
+            // decoded before the last seek
+            delete queued.frame;
+        }
 
         // If queue is going low, wake decoder thread (to refill)
         if (audioFrameQueue.size() < QUEUE_SIZE_MIN_THRESHOLD && isRunning) {
-            pthread_cond_signal(&mCondition);
-        }
-    } else {
-        // No packet to consume
-        if (isRunning || needSeek) {
-            result = MEDIA_STATUS_BUFFERING;
-        } else {
-            // decoder finished and queue empty
-            result = MEDIA_STATUS_EOF;
+            decoderWaiter.notify();
         }
     }
 
-    pthread_mutex_unlock(&mLock);
-    // ---- end of queue critical section ----
-
     if (!audioPacket) {
-        // No audioPacket pulled -> return status decided above
-        return result;
+        // No packet to consume
+        if (isRunning || needSeek) {
+            return MEDIA_STATUS_BUFFERING;
+        }
+        // decoder finished and queue empty
+        return MEDIA_STATUS_EOF;
     }
 
     // ---- 2) Use the packet outside the lock ----
@@ -167,6 +171,7 @@ int AudioDecoderController::readSamples(short *samples, int size) {
 
     // Update global "progress" (UI timeline)
     progressMs = baseMs;
+    lastPacketSpeed = audioPacket->speed;
 
     // Update clock state used by getAudioClockMs()
     audioClockStartMs     = baseMs;
@@ -189,39 +194,23 @@ void AudioDecoderController::destroy() {
     LOGI("destroy");
 
     // If already cleaned up, do nothing
-    if (!mutexValid && !isRunning && audioDecoder == nullptr && audioFrameQueue.empty()) {
+    if (!threadValid && !isRunning && audioDecoder == nullptr && audioFrameQueue.empty()) {
         return;
     }
 
     // 1) Ask thread to stop
-    if (isRunning) {
-        isRunning = false;
-
-        if (mutexValid) {
-            pthread_mutex_lock(&mLock);
-            pthread_cond_signal(&mCondition);
-            pthread_mutex_unlock(&mLock);
-        }
+    isRunning = false;
+    decoderWaiter.notify();
 
-        // 2) Join the decoder thread to ensure it's fully exited
-        if (audioDecoderThread) {
-            pthread_join(audioDecoderThread, nullptr);
-            audioDecoderThread = 0;
-        }
+    // 2) Join the decoder thread to ensure it's fully exited (also when it
+    //    already left its loop on EOF)
+    if (audioDecoderThread) {
+        pthread_join(audioDecoderThread, nullptr);
+        audioDecoderThread = 0;
     }
 
     // 3) Clean remaining packets in queue
-    if (mutexValid) {
-        pthread_mutex_lock(&mLock);
-    }
-    while (!audioFrameQueue.empty()) {
-        PcmFrame* packet = audioFrameQueue.front();
-        audioFrameQueue.pop();
-        delete packet;
-    }
-    if (mutexValid) {
-        pthread_mutex_unlock(&mLock);
-    }
+    drainQueue();
 
     // 4) Destroy underlying decoder
     if (audioDecoder != nullptr) {
@@ -230,24 +219,28 @@ void AudioDecoderController::destroy() {
         audioDecoder = nullptr;
     }
 
-    // 5) Now it's safe to destroy mutex & cond
-    if (mutexValid) {
-        pthread_mutex_destroy(&mLock);
-        pthread_cond_destroy(&mCondition);
-        mutexValid = false;
-    }
+    threadValid = false;
 
     LOGI("destroy -- done");
 }
 
+void AudioDecoderController::drainQueue() {
+    QueuedPcmFrame queued;
+    while (audioFrameQueue.pop(queued)) {
+        delete queued.frame;
+    }
+}
+
 void AudioDecoderController::initDecoderThread() {
     LOGI("initDecoderThread--start");
-    isRunning = true;
-    if (!mutexValid) {
-        pthread_mutex_init(&mLock, NULL);
-        pthread_cond_init(&mCondition, NULL);
-        mutexValid = true;
+    if (isRunning) return;
+    // the previous thread left its loop on EOF, reap it before replacing the handle
+    if (audioDecoderThread) {
+        pthread_join(audioDecoderThread, nullptr);
+        audioDecoderThread = 0;
     }
+    isRunning = true;
+    threadValid = true;
     pthread_create(&audioDecoderThread, nullptr, startDecoderThread, this);
 }
 
@@ -256,45 +249,35 @@ void* AudioDecoderController::startDecoderThread(void *ptr) {
 
     while (decoderController->isRunning) {
 
-        long localSeekTime = -1;
-
-        pthread_mutex_lock(&decoderController->mLock);
-        if (decoderController->needSeek && decoderController->seekTime >= 0) {
-            localSeekTime = decoderController->seekTime;
-
-            while (!decoderController->audioFrameQueue.empty()) {
-                PcmFrame *audioPacket = decoderController->audioFrameQueue.front();
-                decoderController->audioFrameQueue.pop();
-                delete audioPacket;
+        if (decoderController->needSeek.exchange(false)) {
+            // frames queued so far are dropped by readSamples()
+            decoderController->decodeSerial = decoderController->seekSerial;
+            int64_t localSeekTime = decoderController->seekTime.exchange(-1);
+            if (localSeekTime >= 0) {
+                decoderController->audioDecoder->seek(localSeekTime);
             }
-
-            decoderController->seekTime = -1;
-            decoderController->needSeek = false;
-        }
-        pthread_mutex_unlock(&decoderController->mLock);
-
-        if (localSeekTime >= 0) {
-            // Perform seek outside the lock (can be slow)
-            decoderController->audioDecoder->seek(localSeekTime);
             continue; // then continue decoding
         }
 
-        pthread_mutex_lock(&decoderController->mLock);
-        while (decoderController->isRunning &&
-               decoderController->audioFrameQueue.size() >= QUEUE_SIZE_MAX_THRESHOLD &&
-               !decoderController->needSeek) {
-            pthread_cond_wait(&decoderController->mCondition,
-                              &decoderController->mLock);
-        }
-        bool stillRunning = decoderController->isRunning;
-        pthread_mutex_unlock(&decoderController->mLock);
+        decoderController->decoderWaiter.wait([decoderController] {
+            return !decoderController->isRunning ||
+                   decoderController->needSeek ||
+                   decoderController->audioFrameQueue.size() < QUEUE_SIZE_MAX_THRESHOLD;
+        });
 
-        if (!stillRunning) {
+        if (!decoderController->isRunning) {
             break;
         }
+        if (decoderController->needSeek) {
+            continue;
+        }
 
         int result = decoderController->decodeSongPacket();
         if (result == -1) {
+            if (decoderController->needSeek) {
+                // cut short by the seek, not the end of the stream
+                continue;
+            }
             // EOF or error
             break;
         }
@@ -325,6 +308,13 @@ int AudioDecoderController::getChannels() {
 }
 
 int AudioDecoderController::decodeSongPacket() {
+    if (audioDecoder->isLive()) {
+        // queued PCM and the OpenSL buffers count too: measured from what
+        // the consumer last took, not from what was decoded
+        int64_t edgeMs = audioDecoder->getLiveEdgeMs();
+        bool catchUp = liveCatchUp.update(edgeMs >= 0 ? edgeMs - progressMs : -1, nowMonotonicMs());
+        audioDecoder->setSpeed(catchUp ? LiveCatchUp::AUDIO_CATCH_UP_SPEED : 1.0f);
+    }
     PcmFrame *audioPacket = audioDecoder->decoderAudioPacket();
     if (audioPacket->audioSize == -1) {
         int ret = audioPacket->audioSize;
@@ -338,14 +328,14 @@ int AudioDecoderController::decodeSongPacket() {
                     audioDecoder->getSampleRate());
         }
 
-        // Push into queue under lock
-        if (mutexValid) {
-            pthread_mutex_lock(&mLock);
-            audioFrameQueue.push(audioPacket);
-            pthread_mutex_unlock(&mLock);
-        } else {
-            // Fallback, should not really happen if properly initialized
-            audioFrameQueue.push(audioPacket);
+        // Push into the ring, tagged with the current seek generation
+        QueuedPcmFrame queued;
+        queued.frame = audioPacket;
+        queued.serial = decodeSerial;
+        if (!audioFrameQueue.push(queued)) {
+            // stale frames not drained yet, should not really happen
+            LOGE("decodeSongPacket: queue full, packet dropped");
+            delete audioPacket;
         }
         return 1;
     }
@@ -6,8 +6,10 @@
 #define FFMPEGDECODER_MUSIC_DECODER_CORTROLLER_H
 
 #include "audio_decoder.h"
+#include <atomic>
 #include <pthread.h>
-#include <queue>
+#include "spsc_ring.h"
+#include "live_latency.h"
 
 #define LOG_TAG "AudioDecoderControllerLog"
 
@@ -15,17 +17,26 @@
 // 10 * 40ms ≈ 400ms, 4 * 40ms ≈ 160ms.
 #define QUEUE_SIZE_MAX_THRESHOLD 10
 #define QUEUE_SIZE_MIN_THRESHOLD 4
+// ring slots, > QUEUE_SIZE_MAX_THRESHOLD plus frames of a flushed seek
+#define AUDIO_QUEUE_RING_CAPACITY 32
+
+// PCM frame tagged with the seek generation it was decoded in
+struct QueuedPcmFrame {
+    PcmFrame* frame = nullptr;
+    uint32_t  serial = 0;
+};
 
 class AudioDecoderController {
 
 private:
     AudioDecoder *audioDecoder = nullptr;
-    bool mutexValid = false;
+    bool threadValid = false;       // prepared and not destroyed yet
     pthread_t     audioDecoderThread{};
-    std::queue<PcmFrame *> audioFrameQueue;
-    bool          isRunning = false;
-    pthread_mutex_t mLock{};
-    pthread_cond_t  mCondition{};
+    // decoder thread → readSamples() (OpenSL callback), lock-free so the
+    // callback never blocks on the decoder thread
+    SpscRing<QueuedPcmFrame> audioFrameQueue{AUDIO_QUEUE_RING_CAPACITY};
+    SpscWaiter    decoderWaiter;    // decoder thread parks on a full queue
+    std::atomic<bool> isRunning{false};
 
     int64_t progressMs = 0;
 
@@ -36,16 +47,26 @@ private:
     int64_t audioClockUpdateMs   = 0; // monotonic time when we last refilled
     int     lastBufferDurationMs = 0; // duration of current buffer in ms
 
-    int64_t seekTime = -1;
-    bool    needSeek = false;
+    // seek() bumps seekSerial, readSamples() drops frames of older serials
+    std::atomic<int64_t>  seekTime{-1};
+    std::atomic<bool>     needSeek{false};
+    std::atomic<uint32_t> seekSerial{0};
+    uint32_t decodeSerial = 0;      // decoder thread
 
     bool visualizerEnabled = false;  // default: no visualizer
+    MediaIoOptions ioOptions;        // applied by the next prepare()
+
+    // live catch-up: buffer checked by the decoder thread before each packet
+    LiveCatchUp liveCatchUp;
+    float lastPacketSpeed = 1.0f;    // readSamples(): speed of the packet it returned
 
     static void* startDecoderThread(void *ptr);
 
     void   initDecoderThread();
     int    decodeSongPacket();
     void   destroyDecoderThread();
+    // decoder thread joined and nobody reading
+    void   drainQueue();
 
 public:
     int dataSize = 0;
@@ -54,6 +75,17 @@ public:
     virtual ~AudioDecoderController();
     int      getMusicMeta(const char *audioPath, int *metaArray);
     int      prepare(const char *audioPath);
+    // custom AVIO for the next prepare(), see MediaSource
+    void     setIoOptions(const MediaIoOptions& options) { ioOptions = options; }
+    // live sources (MediaIoOptions::live): time-compress the audio while the
+    // buffer is over targetMs, see LiveCatchUp
+    void     setLiveTarget(int64_t targetMs) { liveCatchUp.setTarget(targetMs); }
+    // media time per played time of the last packet readSamples() returned,
+    // so the consumer's clock can follow time-compressed audio
+    float    getLastPacketSpeed() const { return lastPacketSpeed; }
+    // live buffer: newest media time read - position played, -1 unknown
+    int64_t  getLiveLatencyMs() const { return liveCatchUp.getLatencyMs(); }
+    bool     isCatchingUp() const { return liveCatchUp.isCatchingUp(); }
     void     seek(const long seek_time);
     int64_t  getProgress();
     int64_t  getAudioClockMs() const;
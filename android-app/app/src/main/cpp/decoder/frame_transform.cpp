@@ -0,0 +1,254 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include "frame_transform.h"
+#include <cmath>
+
+#define LOG_TAG "FrameTransform"
+#include "CommonTools.h"
+
+static const int FIXED_SHIFT = 16;
+static const double FIXED_ONE = (double) (1 << FIXED_SHIFT);
+
+static int normalizeRotation(int degrees) {
+    int r = ((degrees % 360) + 360) % 360;
+    // snap to the nearest quarter turn
+    return ((r + 45) / 90 % 4) * 90;
+}
+
+static int clampInt(int v, int lo, int hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+TransformPlan FrameTransform::resolve(const VideoTransform& req, int srcWidth, int srcHeight,
+                                      int displayRotation) {
+    TransformPlan plan;
+    if (srcWidth <= 0 || srcHeight <= 0) return plan;
+
+    plan.rotation = normalizeRotation(req.rotation == VIDEO_ROTATION_AUTO
+                                      ? displayRotation : req.rotation);
+
+    plan.cropX = clampInt(req.cropX, 0, srcWidth - 1);
+    plan.cropY = clampInt(req.cropY, 0, srcHeight - 1);
+    plan.cropWidth = req.cropWidth > 0 ? req.cropWidth : srcWidth - plan.cropX;
+    plan.cropHeight = req.cropHeight > 0 ? req.cropHeight : srcHeight - plan.cropY;
+    plan.cropWidth = clampInt(plan.cropWidth, 1, srcWidth - plan.cropX);
+    plan.cropHeight = clampInt(plan.cropHeight, 1, srcHeight - plan.cropY);
+
+    const bool swapped = plan.rotation == 90 || plan.rotation == 270;
+    const int rotWidth = swapped ? plan.cropHeight : plan.cropWidth;
+    const int rotHeight = swapped ? plan.cropWidth : plan.cropHeight;
+
+    int outW = rotWidth;
+    int outH = rotHeight;
+    if (req.dstWidth > 0 || req.dstHeight > 0) {
+        double sx = req.dstWidth > 0 ? (double) req.dstWidth / rotWidth : 0.0;
+        double sy = req.dstHeight > 0 ? (double) req.dstHeight / rotHeight : 0.0;
+        if (req.keepAspect || sx == 0.0 || sy == 0.0) {
+            double scale = sx == 0.0 ? sy : (sy == 0.0 ? sx : (sx < sy ? sx : sy));
+            // never materialise more than the source has, the view can upscale for free
+            if (req.keepAspect && scale > 1.0) scale = 1.0;
+            outW = (int) lround(rotWidth * scale);
+            outH = (int) lround(rotHeight * scale);
+        } else {
+            outW = req.dstWidth;
+            outH = req.dstHeight;
+        }
+        // even sizes keep 4:2:0 outputs and RGB565 rows simple
+        if (outW != rotWidth) outW &= ~1;
+        if (outH != rotHeight) outH &= ~1;
+        if (outW < 2) outW = 2;
+        if (outH < 2) outH = 2;
+    }
+    plan.outWidth = outW;
+    plan.outHeight = outH;
+
+    // output pixel (ox, oy) → rotated crop (u, v), pixel centres aligned
+    const double su = (double) rotWidth / outW;
+    const double sv = (double) rotHeight / outH;
+    const double u0 = 0.5 * su - 0.5;
+    const double v0 = 0.5 * sv - 0.5;
+
+    // rotated crop (u, v) → crop (x, y): x = ax + xu*u + xv*v, y = ay + yu*u + yv*v
+    double ax = 0, xu = 1, xv = 0, ay = 0, yu = 0, yv = 1;
+    const double lastX = plan.cropWidth - 1;
+    const double lastY = plan.cropHeight - 1;
+    switch (plan.rotation) {
+        case 90:  ax = 0;     xu = 0;  xv = 1;  ay = lastY; yu = -1; yv = 0;  break;
+        case 180: ax = lastX; xu = -1; xv = 0;  ay = lastY; yu = 0;  yv = -1; break;
+        case 270: ax = lastX; xu = 0;  xv = -1; ay = 0;     yu = 1;  yv = 0;  break;
+        default: break;
+    }
+
+    plan.originX = plan.cropX + ax + xu * u0 + xv * v0;
+    plan.originY = plan.cropY + ay + yu * u0 + yv * v0;
+    plan.colX = xu * su;
+    plan.colY = yu * su;
+    plan.rowX = xv * sv;
+    plan.rowY = yv * sv;
+
+    plan.identity = plan.rotation == 0 &&
+                    plan.cropX == 0 && plan.cropY == 0 &&
+                    plan.cropWidth == srcWidth && plan.cropHeight == srcHeight &&
+                    outW == srcWidth && outH == srcHeight;
+    return plan;
+}
+
+bool FrameTransform::supportsSource(AVPixelFormat srcFormat) {
+    return srcFormat == AV_PIX_FMT_YUV420P || srcFormat == AV_PIX_FMT_YUVJ420P ||
+           srcFormat == AV_PIX_FMT_NV12;
+}
+
+int FrameTransform::scratchSize(const TransformPlan& plan) {
+    // one luma row + one U row + one V row
+    return plan.outWidth + 2 * ((plan.outWidth + 1) / 2);
+}
+
+// Nearest samples of `count` points along a line of one plane.
+static void sampleLineNearest(const uint8_t* plane, int stride, int w, int h, int pixStep,
+                              int32_t fx, int32_t fy, int32_t dx, int32_t dy,
+                              uint8_t* out, int outStep, int count) {
+    const int32_t half = 1 << (FIXED_SHIFT - 1);
+    for (int i = 0; i < count; i++, fx += dx, fy += dy, out += outStep) {
+        int x = clampInt((fx + half) >> FIXED_SHIFT, 0, w - 1);
+        int y = clampInt((fy + half) >> FIXED_SHIFT, 0, h - 1);
+        *out = plane[(ptrdiff_t) y * stride + x * pixStep];
+    }
+}
+
+// Bilinear samples of `count` points along a line of one plane.
+// fx/fy and the steps are 16.16 plane coordinates; samples outside the plane
+// are clamped to the edge. pixStep = 2 reads one channel of interleaved UV.
+static void sampleLine(const uint8_t* plane, int stride, int w, int h, int pixStep,
+                       int32_t fx, int32_t fy, int32_t dx, int32_t dy,
+                       uint8_t* out, int outStep, int count, bool nearest) {
+    if (nearest) {
+        sampleLineNearest(plane, stride, w, h, pixStep, fx, fy, dx, dy, out, outStep, count);
+        return;
+    }
+    const int32_t maxX = (w - 1) << FIXED_SHIFT;
+    const int32_t maxY = (h - 1) << FIXED_SHIFT;
+    for (int i = 0; i < count; i++, fx += dx, fy += dy, out += outStep) {
+        int32_t cx = fx < 0 ? 0 : (fx > maxX ? maxX : fx);
+        int32_t cy = fy < 0 ? 0 : (fy > maxY ? maxY : fy);
+        int x0 = cx >> FIXED_SHIFT;
+        int y0 = cy >> FIXED_SHIFT;
+        int wx = (cx >> 8) & 0xFF;
+        int wy = (cy >> 8) & 0xFF;
+        int x1 = x0 + (x0 < w - 1 ? 1 : 0);
+        const uint8_t* r0 = plane + (ptrdiff_t) y0 * stride;
+        const uint8_t* r1 = y0 < h - 1 ? r0 + stride : r0;
+        int a = r0[x0 * pixStep], b = r0[x1 * pixStep];
+        int c = r1[x0 * pixStep], d = r1[x1 * pixStep];
+        int top = (a << 8) + (b - a) * wx;
+        int bottom = (c << 8) + (d - c) * wx;
+        int v = (top << 8) + (bottom - top) * wy;
+        *out = (uint8_t) ((v + (1 << 15)) >> 16);
+    }
+}
+
+static inline int32_t toFixed(double v) {
+    return (int32_t) lround(v * FIXED_ONE);
+}
+
+// luma → 4:2:0 chroma plane coordinate (centred siting)
+static inline int32_t lumaToChroma(int32_t lumaFixed) {
+    return (lumaFixed >> 1) - (1 << (FIXED_SHIFT - 2));
+}
+
+struct SourcePlanes {
+    const uint8_t* y;
+    const uint8_t* u;
+    const uint8_t* v;
+    int yStride, cStride;
+    int width, height;
+    int chromaWidth, chromaHeight;
+    int chromaStep;   // 1 = planar U/V, 2 = interleaved UV
+};
+
+// chroma samples for output positions (ox0 + 2k + 0.5, oy), k = 0..count-1
+// (oy is in output luma rows, possibly fractional for 4:2:0 outputs)
+static void sampleChroma(const SourcePlanes& sp, const TransformPlan& plan, double ox, double oy,
+                         uint8_t* uOut, uint8_t* vOut, int outStep, int count) {
+    double lx = plan.originX + ox * plan.colX + oy * plan.rowX;
+    double ly = plan.originY + ox * plan.colY + oy * plan.rowY;
+    int32_t fx = lumaToChroma(toFixed(lx));
+    int32_t fy = lumaToChroma(toFixed(ly));
+    // two output pixels per chroma sample, halved again for the chroma plane
+    int32_t dx = toFixed(plan.colX);
+    int32_t dy = toFixed(plan.colY);
+    sampleLine(sp.u, sp.cStride, sp.chromaWidth, sp.chromaHeight, sp.chromaStep,
+               fx, fy, dx, dy, uOut, outStep, count, plan.nearest);
+    sampleLine(sp.v, sp.cStride, sp.chromaWidth, sp.chromaHeight, sp.chromaStep,
+               fx, fy, dx, dy, vOut, outStep, count, plan.nearest);
+}
+
+int FrameTransform::convertRows(const AVFrame* src, const TransformPlan& plan,
+                                int y0, int rows,
+                                AVPixelFormat dstFormat, uint8_t* const dstData[4],
+                                const int dstLinesize[4],
+                                const YuvCoeffs& coeffs, uint8_t* scratch) {
+    auto srcFormat = static_cast<AVPixelFormat>(src->format);
+    if (!supportsSource(srcFormat) || !scratch) return -1;
+
+    SourcePlanes sp{};
+    sp.y = src->data[0];
+    sp.yStride = src->linesize[0];
+    sp.width = src->width;
+    sp.height = src->height;
+    sp.chromaWidth = (src->width + 1) / 2;
+    sp.chromaHeight = (src->height + 1) / 2;
+    if (srcFormat == AV_PIX_FMT_NV12) {
+        sp.u = src->data[1];
+        sp.v = src->data[1] + 1;
+        sp.cStride = src->linesize[1];
+        sp.chromaStep = 2;
+    } else {
+        sp.u = src->data[1];
+        sp.v = src->data[2];
+        sp.cStride = src->linesize[1];
+        sp.chromaStep = 1;
+    }
+
+    const int outW = plan.outWidth;
+    const int chromaW = (outW + 1) / 2;
+    const int32_t dx = toFixed(plan.colX);
+    const int32_t dy = toFixed(plan.colY);
+
+    auto lumaRow = [&](int oy, uint8_t* out) {
+        sampleLine(sp.y, sp.yStride, sp.width, sp.height, 1,
+                   toFixed(plan.originX + oy * plan.rowX),
+                   toFixed(plan.originY + oy * plan.rowY),
+                   dx, dy, out, 1, outW, plan.nearest);
+    };
+
+    if (dstFormat == AV_PIX_FMT_RGBA || dstFormat == AV_PIX_FMT_RGB565LE) {
+        const YuvRowKernels& k = YuvConvert::kernels();
+        YuvRowFn rowFn = dstFormat == AV_PIX_FMT_RGBA ? k.i420ToRGBA : k.i420ToRGB565;
+        uint8_t* yRow = scratch;
+        uint8_t* uRow = yRow + outW;
+        uint8_t* vRow = uRow + chromaW;
+        for (int oy = y0; oy < y0 + rows; oy++) {
+            lumaRow(oy, yRow);
+            sampleChroma(sp, plan, 0.5, oy, uRow, vRow, 1, chromaW);
+            rowFn(yRow, uRow, vRow, dstData[0] + (ptrdiff_t) oy * dstLinesize[0], outW, &coeffs);
+        }
+        return 0;
+    }
+
+    if (dstFormat == AV_PIX_FMT_YUV420P || dstFormat == AV_PIX_FMT_NV12) {
+        for (int oy = y0; oy < y0 + rows; oy++) {
+            lumaRow(oy, dstData[0] + (ptrdiff_t) oy * dstLinesize[0]);
+        }
+        const bool nv12 = dstFormat == AV_PIX_FMT_NV12;
+        for (int cy = y0 / 2; cy < (y0 + rows + 1) / 2; cy++) {
+            uint8_t* u = dstData[1] + (ptrdiff_t) cy * dstLinesize[1];
+            uint8_t* v = nv12 ? u + 1 : dstData[2] + (ptrdiff_t) cy * dstLinesize[2];
+            sampleChroma(sp, plan, 0.5, 2 * cy + 0.5, u, v, nv12 ? 2 : 1, chromaW);
+        }
+        return 0;
+    }
+
+    return -1;
+}
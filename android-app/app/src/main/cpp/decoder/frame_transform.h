@@ -0,0 +1,97 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <cstdint>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+#include "VideoFormat.h"
+#include "yuv_convert.h"
+
+/**
+ * Requested output geometry for the software read path.
+ * All zero / AUTO = native size, display-matrix rotation, no crop.
+ */
+struct VideoTransform {
+    // crop rectangle in decoded (unrotated) pixels, 0 width/height = full frame
+    int cropX = 0;
+    int cropY = 0;
+    int cropWidth = 0;
+    int cropHeight = 0;
+
+    // 0 / 90 / 180 / 270 clockwise, VIDEO_ROTATION_AUTO = stream display matrix
+    int rotation = VIDEO_ROTATION_AUTO;
+
+    // target surface size, 0 = cropped (and rotated) size
+    int dstWidth = 0;
+    int dstHeight = 0;
+
+    // true: shrink the output to fit inside dstWidth x dstHeight keeping the
+    // aspect ratio; false: stretch to exactly dstWidth x dstHeight
+    bool keepAspect = true;
+};
+
+/**
+ * A VideoTransform resolved against one stream: clamped crop, final rotation,
+ * output size, and the affine map from output pixels back to source luma
+ * coordinates (pixel centres).
+ */
+struct TransformPlan {
+    int cropX = 0;
+    int cropY = 0;
+    int cropWidth = 0;
+    int cropHeight = 0;
+    int rotation = 0;
+    int outWidth = 0;
+    int outHeight = 0;
+
+    // src = origin + ox * col + oy * row, in source luma pixels
+    double originX = 0.0, originY = 0.0;
+    double colX = 0.0, colY = 0.0;
+    double rowX = 0.0, rowY = 0.0;
+
+    // no crop, rotation or scaling: plain colour conversion is enough
+    bool identity = true;
+
+    // nearest-neighbour instead of bilinear sampling (cheaper, blockier)
+    bool nearest = false;
+};
+
+/**
+ * Fused crop + rotate + scale + colour conversion.
+ *
+ * Output rows are produced directly from the decoded yuv420p / nv12 planes:
+ * each row is bilinearly sampled into a small scratch row, then run through
+ * the YuvConvert row kernels (RGBA / RGB565) or written straight into the
+ * output planes (I420 / NV12). Only the target-size image is ever written,
+ * so a 4K stream shown in a 720p view costs 720p worth of conversion.
+ */
+class FrameTransform {
+public:
+    // resolve `req` for a srcWidth x srcHeight stream. displayRotation is the
+    // clockwise rotation from the stream's display matrix (used for AUTO).
+    static TransformPlan resolve(const VideoTransform& req, int srcWidth, int srcHeight,
+                                 int displayRotation);
+
+    // true when `srcFormat` can be sampled directly
+    static bool supportsSource(AVPixelFormat srcFormat);
+
+    // scratch bytes convertRows() needs for one band
+    static int scratchSize(const TransformPlan& plan);
+
+    /**
+     * Produce output rows [y0, y0 + rows) of the plan. y0 must be even.
+     * dstData / dstLinesize point at the start of the whole output image.
+     * return: 0 on success, <0 on unsupported formats
+     */
+    static int convertRows(const AVFrame* src, const TransformPlan& plan,
+                           int y0, int rows,
+                           AVPixelFormat dstFormat, uint8_t* const dstData[4], const int dstLinesize[4],
+                           const YuvCoeffs& coeffs, uint8_t* scratch);
+};
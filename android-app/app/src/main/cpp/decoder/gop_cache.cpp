@@ -0,0 +1,412 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include "gop_cache.h"
+#include "video_decoder.h"
+#include "MediaStatus.h"
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+#define LOG_TAG "GopCache"
+#include "CommonTools.h"
+
+GopCache::GopCache() {
+    pthread_mutex_init(&mutex, nullptr);
+    pthread_cond_init(&cond, nullptr);
+}
+
+GopCache::~GopCache() {
+    close();
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+}
+
+int64_t GopCache::ptsUs(double ptsMs) {
+    return (int64_t) llround(ptsMs * 1000.0);
+}
+
+int GopCache::open(const char* path, const MediaIoOptions& io, int threadPolicy, int threads) {
+    close();
+
+    decoder = new VideoDecoder();
+    // seeks on every GOP: must not move the player's read position
+    decoder->setShareDemuxer(false);
+    decoder->setIoOptions(io);
+    // whole GOPs are decoded in one go, frame threads pay off
+    decoder->setThreadPolicy(threadPolicy, threads);
+    decoder->setInterruptFlag(&interrupt);
+    int ret = decoder->open(path);
+    if (ret < 0) {
+        delete decoder;
+        decoder = nullptr;
+        return ret;
+    }
+
+    abortRequested = false;
+    interrupt = false;
+    cursorUs = demandUs = failedUs = decodingUs = -1;
+    direction = -1;
+    stats = GopCacheStats();
+    if (pthread_create(&worker, nullptr, &GopCache::workerEntry, this) != 0) {
+        decoder->close();
+        delete decoder;
+        decoder = nullptr;
+        return -1;
+    }
+    workerStarted = true;
+    LOGI("GopCache::open %s, budget %lld MB", path, (long long) (budgetBytes >> 20));
+    return 0;
+}
+
+void GopCache::close() {
+    if (workerStarted) {
+        pthread_mutex_lock(&mutex);
+        abortRequested = true;
+        interrupt = true;
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&mutex);
+        pthread_join(worker, nullptr);
+        workerStarted = false;
+    }
+    if (decoder) {
+        decoder->close();
+        delete decoder;
+        decoder = nullptr;
+    }
+    pthread_mutex_lock(&mutex);
+    for (Run* run : runs) freeRun(run);
+    runs.clear();
+    bytes = 0;
+    pthread_mutex_unlock(&mutex);
+}
+
+void GopCache::setBudget(int64_t budget) {
+    if (budget <= 0) return;
+    pthread_mutex_lock(&mutex);
+    budgetBytes = budget;
+    evictLocked(nullptr);
+    pthread_mutex_unlock(&mutex);
+}
+
+void GopCache::freeRun(Run* run) {
+    for (CachedFrame& f : run->frames) av_frame_free(&f.frame);
+    delete run;
+}
+
+void* GopCache::workerEntry(void* arg) {
+    static_cast<GopCache*>(arg)->workerLoop();
+    return nullptr;
+}
+
+void GopCache::workerLoop() {
+    pthread_mutex_lock(&mutex);
+    while (!abortRequested) {
+        const bool demand = demandUs >= 0;
+        const int64_t target = demand ? demandUs : prefetchTargetLocked();
+        if (target < 0 || target == failedUs) {
+            pthread_cond_wait(&cond, &mutex);
+            continue;
+        }
+        decodingUs = target;
+        interrupt = false;
+        pthread_mutex_unlock(&mutex);
+
+        const int64_t startUs = av_gettime_relative();
+        const bool decoded = decodeRun(target);
+        const int64_t elapsedUs = av_gettime_relative() - startUs;
+
+        pthread_mutex_lock(&mutex);
+        decodingUs = -1;
+        if (demand && demandUs == target) demandUs = -1;
+        const bool interrupted = interrupt.exchange(false);
+        if (decoded) {
+            stats.lastDecodeUs = elapsedUs;
+            if (!demand) stats.prefetched++;
+            // a run that still does not answer the step (odd timestamps, a
+            // GOP beyond the budget): do not decode it over and over
+            bool atEnd = false;
+            const bool unanswered = demand
+                    ? !findLocked(cursorUs, direction, &atEnd) && !atEnd
+                    : prefetchTargetLocked() == target;
+            if (unanswered && !interrupted) failedUs = target;
+        } else if (!interrupted) {
+            LOGE("GopCache: nothing decoded at %lld us", (long long) target);
+            failedUs = target;
+        }
+        pthread_cond_broadcast(&cond);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+bool GopCache::decodeRun(int64_t targetUs) {
+    pthread_mutex_lock(&mutex);
+    // leave room for the run on screen
+    const int64_t limit = budgetBytes / 2;
+    pthread_mutex_unlock(&mutex);
+
+    decoder->setSeekPosition(MAX(targetUs, (int64_t) 0) / 1000);
+    decoder->seekFrame();
+
+    bool stored = false;
+    Run* run = nullptr;
+    while (true) {
+        int ret = decoder->decodeFrame();
+        if (ret == AVERROR(EAGAIN)) {
+            continue;
+        }
+        if (ret <= 0) {
+            // AVERROR_EXIT: interrupted, the partial run is still contiguous
+            if (run && ret == 0) run->nextUs = NEXT_EOF;
+            break;
+        }
+
+        AVFrame* frame = av_frame_alloc();
+        if (!frame) break;
+        decoder->takeFrame(frame);
+        const int64_t pts = ptsUs(decoder->getFramePtsMs(frame));
+        const bool key = frame->key_frame != 0;
+        if (frame->best_effort_timestamp == AV_NOPTS_VALUE ||
+            (!run && !key && frame->pict_type != AV_PICTURE_TYPE_I) ||
+            (run && pts <= run->lastUs())) {
+            // leading frames of an open GOP miss their references
+            av_frame_free(&frame);
+            continue;
+        }
+
+        if (key && run) {
+            // the next GOP begins
+            run->nextUs = pts;
+            if (targetUs < pts) {
+                av_frame_free(&frame);
+                break;
+            }
+            // the seek landed on an earlier keyframe: keep going
+            storeRun(run);
+            stored = true;
+            run = nullptr;
+        }
+        if (!run) {
+            run = new Run();
+            // nothing before the keyframe the seek landed on
+            run->atStart = !stored && (pts > targetUs || targetUs <= 0);
+        }
+
+        int frameBytes = 0;
+        for (AVBufferRef* buf : frame->buf) {
+            if (buf) frameBytes += buf->size;
+        }
+        if (!run->frames.empty() && run->bytes + frameBytes > limit) {
+            if (run->lastUs() >= targetUs) {
+                // enough around the target
+                run->nextUs = pts;
+                av_frame_free(&frame);
+                break;
+            }
+            // GOP larger than the budget: keep the frames nearest the target
+            CachedFrame& oldest = run->frames.front();
+            run->bytes -= oldest.bytes;
+            av_frame_free(&oldest.frame);
+            run->frames.erase(run->frames.begin());
+            run->atStart = false;
+        }
+        run->frames.push_back(CachedFrame{pts, frame, frameBytes});
+        run->bytes += frameBytes;
+    }
+
+    if (run && !run->frames.empty()) {
+        storeRun(run);
+        stored = true;
+    } else if (run) {
+        delete run;
+    }
+    return stored;
+}
+
+void GopCache::storeRun(Run* run) {
+    pthread_mutex_lock(&mutex);
+    for (auto it = runs.begin(); it != runs.end();) {
+        Run* old = *it;
+        if (old->firstUs() <= run->firstUs() && old->lastUs() >= run->lastUs() &&
+            (old->nextUs != NEXT_UNKNOWN || run->nextUs == NEXT_UNKNOWN)) {
+            // already cached
+            pthread_mutex_unlock(&mutex);
+            freeRun(run);
+            return;
+        }
+        if (old->firstUs() >= run->firstUs() && old->lastUs() <= run->lastUs()) {
+            if (old->lastUs() == run->lastUs() && run->nextUs == NEXT_UNKNOWN) {
+                run->nextUs = old->nextUs;
+            }
+            if (old->firstUs() == run->firstUs() && old->atStart) run->atStart = true;
+            bytes -= old->bytes;
+            freeRun(old);
+            it = runs.erase(it);
+            continue;
+        }
+        ++it;
+    }
+    runs.push_back(run);
+    bytes += run->bytes;
+    stats.gopsDecoded++;
+    evictLocked(run);
+    pthread_mutex_unlock(&mutex);
+}
+
+void GopCache::evictLocked(const Run* keep) {
+    while (bytes > budgetBytes) {
+        auto victim = runs.end();
+        int64_t victimDistance = -1;
+        for (auto it = runs.begin(); it != runs.end(); ++it) {
+            const Run* run = *it;
+            if (run == keep || (run->firstUs() <= cursorUs && cursorUs <= run->lastUs())) continue;
+            const int64_t distance = cursorUs < run->firstUs() ? run->firstUs() - cursorUs
+                                                               : cursorUs - run->lastUs();
+            if (distance > victimDistance) {
+                victim = it;
+                victimDistance = distance;
+            }
+        }
+        if (victim == runs.end()) break;
+        bytes -= (*victim)->bytes;
+        freeRun(*victim);
+        runs.erase(victim);
+        stats.evictions++;
+    }
+}
+
+const GopCache::CachedFrame* GopCache::findLocked(int64_t cursor, int dir, bool* atEnd) const {
+    *atEnd = false;
+    auto byPts = [](const CachedFrame& f, int64_t pts) { return f.ptsUs < pts; };
+    for (const Run* run : runs) {
+        const std::vector<CachedFrame>& frames = run->frames;
+        if (dir < 0) {
+            if (cursor <= run->firstUs()) {
+                if (run->atStart) *atEnd = true;
+                continue;
+            }
+            // contiguous from the run's first frame up to the cursor
+            if (cursor > run->lastUs() && (run->nextUs == NEXT_UNKNOWN || cursor > run->nextUs)) continue;
+            auto it = std::lower_bound(frames.begin(), frames.end(), cursor, byPts);
+            return &*(it - 1);
+        }
+        if (run->firstUs() > cursor) {
+            if (run->atStart) return &frames.front();
+            continue;
+        }
+        if (cursor < run->lastUs()) {
+            auto it = std::upper_bound(frames.begin(), frames.end(), cursor,
+                                       [](int64_t pts, const CachedFrame& f) { return pts < f.ptsUs; });
+            return &*it;
+        }
+        if (run->nextUs == NEXT_EOF) {
+            *atEnd = true;
+            return nullptr;
+        }
+        if (run->nextUs == NEXT_UNKNOWN || cursor >= run->nextUs) continue;
+        // the frame after the run starts another one
+        for (const Run* other : runs) {
+            if (other->firstUs() == run->nextUs) return &other->frames.front();
+        }
+    }
+    return nullptr;
+}
+
+int64_t GopCache::demandTargetLocked(int64_t cursor, int dir) const {
+    if (dir < 0) {
+        // the GOP holding the frame before the cursor
+        return MAX(cursor - 1, (int64_t) 0);
+    }
+    for (const Run* run : runs) {
+        if (run->firstUs() <= cursor && cursor <= run->lastUs() && run->nextUs != NEXT_UNKNOWN) {
+            return run->nextUs;
+        }
+    }
+    return cursor + 1;
+}
+
+int64_t GopCache::prefetchTargetLocked() const {
+    if (cursorUs < 0) return -1;
+    for (const Run* run : runs) {
+        if (run->firstUs() > cursorUs || cursorUs > run->lastUs()) continue;
+        bool atEnd = false;
+        if (direction < 0) {
+            if (findLocked(run->firstUs(), -1, &atEnd) || atEnd) return -1;
+            return MAX(run->firstUs() - 1, (int64_t) 0);
+        }
+        if (findLocked(run->lastUs(), 1, &atEnd) || atEnd) return -1;
+        return run->nextUs != NEXT_UNKNOWN ? run->nextUs : run->lastUs() + 1;
+    }
+    return -1;
+}
+
+int GopCache::step(int64_t cursor, int dir, int64_t timeoutMs, AVFrame* dst, int64_t* pts) {
+    if (!workerStarted || !dst) return MEDIA_STATUS_ERROR;
+    dir = dir < 0 ? -1 : 1;
+
+    struct timespec deadline{};
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    const int64_t waitMs = MAX(timeoutMs, (int64_t) 0);
+    deadline.tv_sec += waitMs / 1000;
+    deadline.tv_nsec += (long) (waitMs % 1000) * 1000000L;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+
+    int ret;
+    bool waited = false;
+    pthread_mutex_lock(&mutex);
+    if (cursor != cursorUs) failedUs = -1;
+    cursorUs = cursor;
+    direction = dir;
+    while (true) {
+        bool atEnd = false;
+        const CachedFrame* found = findLocked(cursor, dir, &atEnd);
+        if (found) {
+            ret = av_frame_ref(dst, found->frame) == 0 ? MEDIA_STATUS_OK : MEDIA_STATUS_ERROR;
+            if (pts) *pts = found->ptsUs;
+            if (!waited) stats.hits++;
+            break;
+        }
+        if (atEnd) {
+            ret = MEDIA_STATUS_EOF;
+            break;
+        }
+        const int64_t target = demandTargetLocked(cursor, dir);
+        if (target == failedUs) {
+            ret = MEDIA_STATUS_ERROR;
+            break;
+        }
+        if (demandUs != target) {
+            demandUs = target;
+            stats.misses++;
+            // a prefetch of another GOP gives way
+            if (decodingUs >= 0 && decodingUs != target) interrupt = true;
+            pthread_cond_broadcast(&cond);
+        }
+        waited = true;
+        if (waitMs == 0 || pthread_cond_timedwait(&cond, &mutex, &deadline) != 0) {
+            ret = MEDIA_STATUS_BUFFERING;
+            break;
+        }
+    }
+    // the worker moves on to the next GOP in this direction
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+    return ret;
+}
+
+GopCacheStats GopCache::getStats() {
+    pthread_mutex_lock(&mutex);
+    GopCacheStats out = stats;
+    out.runs = (int) runs.size();
+    for (const Run* run : runs) out.frames += (int) run->frames.size();
+    out.bytes = bytes;
+    out.budgetBytes = budgetBytes;
+    pthread_mutex_unlock(&mutex);
+    return out;
+}
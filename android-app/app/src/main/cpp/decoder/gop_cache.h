@@ -0,0 +1,141 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+#include "media_source.h"
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+class VideoDecoder;
+
+struct GopCacheStats {
+    int      runs = 0;          // contiguous decoded runs held (usually whole GOPs)
+    int      frames = 0;
+    int64_t  bytes = 0;         // decoded buffers held
+    int64_t  budgetBytes = 0;
+    uint64_t hits = 0;          // steps answered from memory
+    uint64_t misses = 0;        // steps that had to wait for a decode
+    uint64_t gopsDecoded = 0;   // runs decoded (demand + prefetch)
+    uint64_t prefetched = 0;    // of which ahead of the steps
+    uint64_t evictions = 0;
+    int64_t  lastDecodeUs = 0;  // seek + decode of the last run
+};
+
+/**
+ * Decoded-frame cache for frame stepping and reverse playback.
+ *
+ * A private VideoDecoder (own demuxer, the player's read position stays put)
+ * seeks to the keyframe before a position and decodes the whole GOP; its
+ * frames are kept as refcounted YUV references, in display order. A step
+ * from a cached frame to its neighbour is a lookup, so stepping backwards
+ * costs one GOP decode per GOP instead of one per frame. After every step the
+ * worker decodes the next GOP in the stepping direction (the previous one
+ * when going backwards) while the current one is being shown.
+ *
+ * Runs are contiguous: no frame of the stream lies between two frames of a
+ * run, and `nextUs` names the frame that follows the last one, so runs of
+ * adjacent GOPs link up. A GOP too large for half the budget is cut to the
+ * frames nearest the requested position. The run farthest from the current
+ * position is evicted first.
+ *
+ * step() is called by the consumer thread, the worker decodes; frames are
+ * handed out as new references and stay valid after an eviction.
+ */
+class GopCache {
+public:
+    static constexpr int64_t DEFAULT_BUDGET_BYTES = 128LL * 1024 * 1024;
+
+    GopCache();
+    ~GopCache();
+
+    // private decoder on the same source, starts the worker
+    int open(const char* path, const MediaIoOptions& io, int threadPolicy, int threads);
+    void close();
+
+    // <=0 keeps the current budget
+    void setBudget(int64_t bytes);
+
+    /**
+     * Frame next to `cursorUs` (pts in microseconds) in `direction` (<0 back,
+     * >0 forward), referenced into dst. Waits up to timeoutMs for the GOP to
+     * be decoded (0: just request it).
+     *
+     * @return MEDIA_STATUS_OK / EOF (start or end of the stream) /
+     *         BUFFERING (still decoding) / ERROR
+     */
+    int step(int64_t cursorUs, int direction, int64_t timeoutMs, AVFrame* dst, int64_t* ptsUs);
+
+    GopCacheStats getStats();
+
+    // the key frames are cached and looked up with
+    static int64_t ptsUs(double ptsMs);
+
+private:
+    struct CachedFrame {
+        int64_t  ptsUs;
+        AVFrame* frame;
+        int      bytes;
+    };
+    struct Run {
+        std::vector<CachedFrame> frames;   // ascending pts
+        int64_t bytes = 0;
+        int64_t nextUs = NEXT_UNKNOWN;     // pts of the frame after the last one
+        bool    atStart = false;           // first frame of the stream
+        int64_t firstUs() const { return frames.front().ptsUs; }
+        int64_t lastUs() const { return frames.back().ptsUs; }
+    };
+
+    static constexpr int64_t NEXT_UNKNOWN = -1;
+    static constexpr int64_t NEXT_EOF = INT64_MAX;
+
+    static void* workerEntry(void* arg);
+    void workerLoop();
+    // seek before targetUs and decode until its GOP is complete; false when
+    // nothing usable was decoded
+    bool decodeRun(int64_t targetUs);
+    void storeRun(Run* run);
+    static void freeRun(Run* run);
+
+    // mutex held: neighbour of cursorUs, nullptr when not cached;
+    // *atEnd: the stream has no frame there
+    const CachedFrame* findLocked(int64_t cursorUs, int direction, bool* atEnd) const;
+    // mutex held: position to decode for a step that missed
+    int64_t demandTargetLocked(int64_t cursorUs, int direction) const;
+    // mutex held: next GOP in the stepping direction, -1 when it is cached
+    int64_t prefetchTargetLocked() const;
+    void evictLocked(const Run* keep);
+
+private:
+    VideoDecoder* decoder = nullptr;
+    pthread_t worker{};
+    bool workerStarted = false;
+
+    pthread_mutex_t mutex{};
+    pthread_cond_t  cond{};
+    std::vector<Run*> runs;
+    int64_t bytes = 0;
+    int64_t budgetBytes = DEFAULT_BUDGET_BYTES;
+
+    // steps, consumer → worker
+    int64_t cursorUs = -1;
+    int     direction = -1;
+    int64_t demandUs = -1;           // GOP a step is waiting for, -1 none
+    int64_t failedUs = -1;           // decode that produced nothing, not retried
+    int64_t decodingUs = -1;         // worker: job in progress
+    bool    abortRequested = false;
+    // decoder interrupt: abort, or a step needs another GOP than the one
+    // being decoded
+    std::atomic<bool> interrupt{false};
+
+    GopCacheStats stats;
+};
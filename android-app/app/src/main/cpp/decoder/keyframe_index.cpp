@@ -0,0 +1,289 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include "keyframe_index.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG_TAG "KeyframeIndex"
+#include "CommonTools.h"
+
+static const uint32_t INDEX_MAGIC = 0x5846494B;   // "KIFX"
+// 2: demuxer indexes that only covered the probed start are no longer saved
+static const uint32_t INDEX_VERSION = 2;
+// a cue index counts as complete when it reaches this close to the end
+static const int64_t MAX_KEYFRAME_GAP_MS = 10000;
+
+struct KeyframeIndex::Header {
+    uint32_t magic;
+    uint32_t version;
+    int64_t  fileSize;
+    int64_t  fileMtime;
+    int32_t  streamIndex;
+    int32_t  timeBaseNum;
+    int32_t  timeBaseDen;
+    uint32_t complete;
+    uint64_t count;
+};
+
+/**
+ * Demuxer index entries are used only when they were read in full at open
+ * and hold presentation timestamps: Matroska / WebM cues reaching the end of
+ * the stream. MP4 sample tables are DTS, and FLV (without a keyframes
+ * object), TS and most others index just what avformat_find_stream_info
+ * read so far.
+ */
+static bool demuxerIndexComplete(const AVFormatContext* ctx, const AVStream* st) {
+    if (!ctx->iformat || !strstr(ctx->iformat->name, "matroska") || st->nb_index_entries <= 0) {
+        return false;
+    }
+    int64_t duration = st->duration;
+    if (duration == AV_NOPTS_VALUE || duration <= 0) {
+        if (ctx->duration <= 0) return false;
+        duration = av_rescale_q(ctx->duration, AV_TIME_BASE_Q, st->time_base);
+    }
+    const int64_t start = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+    const int64_t last = st->index_entries[st->nb_index_entries - 1].timestamp;
+    const int64_t gap = av_rescale_q(MAX_KEYFRAME_GAP_MS, AVRational{1, 1000}, st->time_base);
+    return last - start >= duration - gap;
+}
+
+std::string KeyframeIndex::cacheDir;
+pthread_mutex_t KeyframeIndex::cacheDirMutex = PTHREAD_MUTEX_INITIALIZER;
+
+KeyframeIndex::KeyframeIndex() = default;
+
+KeyframeIndex::~KeyframeIndex() {
+    close();
+}
+
+void KeyframeIndex::setCacheDir(const char* dir) {
+    pthread_mutex_lock(&cacheDirMutex);
+    cacheDir = dir ? dir : "";
+    pthread_mutex_unlock(&cacheDirMutex);
+    LOGI("KeyframeIndex::setCacheDir %s", dir ? dir : "(none)");
+}
+
+std::string KeyframeIndex::sidecarPath() const {
+    pthread_mutex_lock(&cacheDirMutex);
+    std::string dir = cacheDir;
+    pthread_mutex_unlock(&cacheDirMutex);
+    if (dir.empty()) return {};
+
+    char name[64];
+    snprintf(name, sizeof(name), "/%016llx_%d.kfi",
+             (unsigned long long) fileKey.pathHash(), streamIndex);
+    return dir + name;
+}
+
+int KeyframeIndex::open(const char* path, AVFormatContext* ctx, int stream, int64_t spacing) {
+    close();
+    if (!path || !ctx || stream < 0 || stream >= (int) ctx->nb_streams) return -1;
+
+    if (!fileKey.load(path)) {
+        // network / content URLs: nothing stable to key the sidecar on
+        return -1;
+    }
+
+    fmtCtx = ctx;
+    streamIndex = stream;
+    minSpacing = spacing;
+
+    if (load()) {
+        LOGI("KeyframeIndex: loaded %zu entries (complete=%d) for stream %d",
+             count, complete ? 1 : 0, streamIndex);
+        return 0;
+    }
+
+    // demuxer already read every keyframe (Matroska cues)
+    AVStream* st0 = ctx->streams[stream];
+    if (demuxerIndexComplete(ctx, st0)) {
+        recorded.reserve((size_t) st0->nb_index_entries);
+        for (int i = 0; i < st0->nb_index_entries; i++) {
+            const AVIndexEntry& e = st0->index_entries[i];
+            if (!(e.flags & AVINDEX_KEYFRAME) || e.pos < 0) continue;
+            if (!recorded.empty() && e.timestamp - recorded.back().pts < minSpacing) continue;
+            recorded.push_back({e.timestamp, e.pos});
+        }
+        if (!recorded.empty()) {
+            entries = recorded.data();
+            count = recorded.size();
+            complete = true;
+            dirty = true;
+            LOGI("KeyframeIndex: %zu entries from demuxer index, stream %d", count, streamIndex);
+            return 0;
+        }
+    }
+
+    // record packet pts while playing from the start
+    recording = true;
+    return 0;
+}
+
+void KeyframeIndex::close() {
+    if (dirty) {
+        save();
+    }
+    unmap();
+    recorded.clear();
+    recorded.shrink_to_fit();
+    entries = nullptr;
+    count = 0;
+    complete = recording = dirty = false;
+    fmtCtx = nullptr;
+    streamIndex = -1;
+}
+
+void KeyframeIndex::record(const AVPacket* packet) {
+    if (!recording || !packet || packet->stream_index != streamIndex) return;
+    if (!(packet->flags & AV_PKT_FLAG_KEY) || packet->pos < 0) return;
+
+    int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+    if (pts == AV_NOPTS_VALUE) return;
+    if (!recorded.empty()) {
+        // must stay sorted; also thins out all-keyframe (audio) streams
+        if (pts <= recorded.back().pts || pts - recorded.back().pts < minSpacing) return;
+    }
+
+    recorded.push_back({pts, packet->pos});
+    entries = recorded.data();
+    count = recorded.size();
+    dirty = true;
+}
+
+void KeyframeIndex::markEof() {
+    if (!recording) return;
+    recording = false;
+    complete = true;
+    dirty = true;
+    save();
+}
+
+const KeyframeIndex::Entry* KeyframeIndex::findEntry(int64_t targetPts) const {
+    if (count == 0 || targetPts < entries[0].pts) return nullptr;
+    // a partial index only knows the range it has seen
+    if (!complete && targetPts > entries[count - 1].pts) return nullptr;
+
+    size_t lo = 0, hi = count;   // last entry with pts <= target
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (entries[mid].pts <= targetPts) lo = mid; else hi = mid;
+    }
+    return &entries[lo];
+}
+
+int KeyframeIndex::seek(int64_t targetPts, int64_t* keyframePts) {
+    if (!fmtCtx) return -1;
+
+    // positions recorded from here on would not be contiguous any more
+    recording = false;
+
+    const Entry* e = findEntry(targetPts);
+    if (!e) return -1;
+
+    int ret;
+    if (fmtCtx->iformat && (fmtCtx->iformat->flags & AVFMT_NO_BYTE_SEEK)) {
+        // exact keyframe timestamp: the demuxer lands on it without searching
+        ret = av_seek_frame(fmtCtx, streamIndex, e->pts, AVSEEK_FLAG_BACKWARD);
+    } else {
+        ret = av_seek_frame(fmtCtx, -1, e->pos, AVSEEK_FLAG_BYTE);
+    }
+    if (ret >= 0 && keyframePts) {
+        *keyframePts = e->pts;
+    }
+    return ret;
+}
+
+bool KeyframeIndex::load() {
+    std::string file = sidecarPath();
+    if (file.empty()) return false;
+
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(Header)) {
+        ::close(fd);
+        return false;
+    }
+    void* mem = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) return false;
+
+    const auto* header = static_cast<const Header*>(mem);
+    const AVRational tb = fmtCtx->streams[streamIndex]->time_base;
+    bool valid = header->magic == INDEX_MAGIC &&
+                 header->version == INDEX_VERSION &&
+                 fileKey.sameFile(header->fileSize, header->fileMtime) &&
+                 header->streamIndex == streamIndex &&
+                 header->timeBaseNum == tb.num &&
+                 header->timeBaseDen == tb.den &&
+                 header->count > 0 &&
+                 sizeof(Header) + header->count * sizeof(Entry) <= (size_t) st.st_size;
+    if (!valid) {
+        munmap(mem, (size_t) st.st_size);
+        unlink(file.c_str());   // stale: media file changed
+        return false;
+    }
+
+    mapped = mem;
+    mappedSize = (size_t) st.st_size;
+    entries = reinterpret_cast<const Entry*>(static_cast<const uint8_t*>(mem) + sizeof(Header));
+    count = (size_t) header->count;
+    complete = header->complete != 0;
+    // an incomplete index keeps growing if this run starts from the beginning
+    if (!complete) {
+        recorded.assign(entries, entries + count);
+        entries = recorded.data();
+        unmap();
+        recording = true;
+    }
+    return true;
+}
+
+bool KeyframeIndex::save() {
+    dirty = false;
+    std::string file = sidecarPath();
+    if (file.empty() || count == 0 || !fmtCtx) return false;
+
+    Header header{};
+    header.magic = INDEX_MAGIC;
+    header.version = INDEX_VERSION;
+    header.fileSize = fileKey.size;
+    header.fileMtime = fileKey.mtime;
+    header.streamIndex = streamIndex;
+    header.timeBaseNum = fmtCtx->streams[streamIndex]->time_base.num;
+    header.timeBaseDen = fmtCtx->streams[streamIndex]->time_base.den;
+    header.complete = complete ? 1 : 0;
+    header.count = count;
+
+    // write a temp file and rename, readers never see a torn index
+    std::string tmp = file + ".tmp";
+    FILE* fp = fopen(tmp.c_str(), "wb");
+    if (!fp) {
+        LOGE("KeyframeIndex: cannot write %s", tmp.c_str());
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+              fwrite(entries, sizeof(Entry), count, fp) == count;
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), file.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    LOGI("KeyframeIndex: saved %zu entries (complete=%d) to %s", count, complete ? 1 : 0, file.c_str());
+    return true;
+}
+
+void KeyframeIndex::unmap() {
+    if (mapped) {
+        munmap(mapped, mappedSize);
+        mapped = nullptr;
+        mappedSize = 0;
+    }
+}
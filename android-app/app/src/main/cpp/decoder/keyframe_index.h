@@ -0,0 +1,95 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "media_file_key.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+/**
+ * Keyframe pts → byte offset index for one stream of a local file, persisted
+ * as a small sidecar in the cache directory so later opens can seek straight
+ * to a keyframe instead of letting the demuxer scan the container.
+ *
+ * Sources, in order:
+ *   1. an existing sidecar (validated against file size / mtime), mmap'ed
+ *   2. the demuxer's own AVStream index entries, when they cover the whole
+ *      stream in presentation time (Matroska cues)
+ *   3. keyframes recorded from packets while the file is played from the
+ *      start; saved on close, marked complete once EOF is reached
+ *
+ * Seeks use byte positions for containers that allow it and fall back to an
+ * exact keyframe timestamp (AVFMT_NO_BYTE_SEEK, e.g. MP4) otherwise.
+ */
+class KeyframeIndex {
+public:
+    struct Entry {
+        int64_t pts;   // stream time base
+        int64_t pos;   // byte offset of the packet
+    };
+
+    KeyframeIndex();
+    ~KeyframeIndex();
+
+    // directory for sidecar files; empty = keep indexes in memory only
+    static void setCacheDir(const char* dir);
+
+    // minSpacing: drop keyframes closer than this to the previous entry
+    // (stream time base); audio uses it, every audio packet is a keyframe
+    int open(const char* path, AVFormatContext* fmtCtx, int streamIndex, int64_t minSpacing = 0);
+    // writes the sidecar if new entries were recorded
+    void close();
+
+    // feed every demuxed packet of the stream (ignored once complete / after a seek)
+    void record(const AVPacket* packet);
+    // demuxer reached EOF after recording from the start
+    void markEof();
+
+    /**
+     * Seek fmtCtx to the last keyframe at or before targetPts.
+     * return: >=0 on success, <0 when the index cannot answer (caller falls
+     *         back to av_seek_frame)
+     */
+    int seek(int64_t targetPts, int64_t* keyframePts = nullptr);
+
+    int  size() const { return (int) count; }
+    bool isComplete() const { return complete; }
+
+private:
+    struct Header;
+
+    bool load();
+    bool save();
+    void unmap();
+    const Entry* findEntry(int64_t targetPts) const;
+    std::string sidecarPath() const;
+
+private:
+    static std::string cacheDir;
+    static pthread_mutex_t cacheDirMutex;
+
+    AVFormatContext* fmtCtx = nullptr;
+    int streamIndex = -1;
+    int64_t minSpacing = 0;
+
+    MediaFileKey fileKey;
+
+    // entries point either into the mmap'ed sidecar or into `recorded`
+    const Entry* entries = nullptr;
+    size_t count = 0;
+    std::vector<Entry> recorded;
+    void*  mapped = nullptr;
+    size_t mappedSize = 0;
+
+    bool complete = false;    // covers the whole file
+    bool recording = false;   // contiguous from the start, no seek yet
+    bool dirty = false;       // recorded entries not yet saved
+};
@@ -0,0 +1,76 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Latency target of a live stream, shared by the audio and video controllers.
+ *
+ * Each controller feeds update() with the content it holds between the live
+ * edge (newest packet read, MediaDemuxer::getLiveEdgeMs()) and what it has
+ * played. Above target + HYSTERESIS_MS it catches up (audio plays slightly
+ * faster, video skips non-reference frames) until the buffer is back at the
+ * target, so catching up does not flap around the threshold. A backlog far
+ * beyond that is cut by the demuxer instead (maxBacklogMs()).
+ *
+ * update() on one thread, the getters from any.
+ */
+class LiveCatchUp {
+public:
+    static constexpr int64_t DEFAULT_TARGET_MS = 1500;
+    static constexpr int64_t MIN_TARGET_MS = 200;
+    static constexpr int64_t HYSTERESIS_MS = 300;
+    // audio time compression while catching up: 8% is hard to hear and
+    // drains one second of backlog in ~13 s
+    static constexpr float AUDIO_CATCH_UP_SPEED = 1.08f;
+
+    // demuxer cut-off for a target: slow catch-up only handles drift
+    static int64_t maxBacklogMs(int64_t targetMs) { return targetMs * 2 + 2000; }
+
+    void setTarget(int64_t ms) { targetMs = ms < MIN_TARGET_MS ? MIN_TARGET_MS : ms; }
+    int64_t getTarget() const { return targetMs; }
+
+    // buffered content in ms, <0 unknown; returns whether to catch up
+    bool update(int64_t bufferMs, int64_t nowMs) {
+        if (bufferMs < 0) return catchingUp;
+        latencyMs = bufferMs;
+        const bool wasCatchingUp = catchingUp;
+        if (!wasCatchingUp && bufferMs > targetMs + HYSTERESIS_MS) {
+            catchingUp = true;
+            catchUps++;
+            catchUpStartMs = nowMs;
+        } else if (wasCatchingUp && bufferMs <= targetMs) {
+            catchingUp = false;
+            catchUpMs += nowMs - catchUpStartMs;
+        }
+        return catchingUp;
+    }
+
+    void reset() {
+        latencyMs = -1;
+        catchingUp = false;
+        catchUps = 0;
+        catchUpMs = 0;
+    }
+
+    bool isCatchingUp() const { return catchingUp; }
+    // last buffer reported to update(), -1 before the first
+    int64_t getLatencyMs() const { return latencyMs; }
+    uint64_t getCatchUps() const { return catchUps; }
+    // time spent catching up, including the current episode
+    int64_t getCatchUpMs(int64_t nowMs) const {
+        return catchUpMs + (catchingUp ? nowMs - catchUpStartMs : 0);
+    }
+
+private:
+    std::atomic<int64_t>  targetMs{DEFAULT_TARGET_MS};
+    std::atomic<int64_t>  latencyMs{-1};
+    std::atomic<bool>     catchingUp{false};
+    std::atomic<uint64_t> catchUps{0};
+    std::atomic<int64_t>  catchUpMs{0};
+    std::atomic<int64_t>  catchUpStartMs{0};
+};
@@ -0,0 +1,784 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include "media_cache.h"
+#include "media_file_key.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iterator>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/base64.h>
+#include <libavutil/error.h>
+}
+
+#define LOG_TAG "MediaCache"
+#include "CommonTools.h"
+
+static const uint32_t INDEX_MAGIC = 0x58494D43;   // "CMIX"
+static const uint32_t INDEX_VERSION = 2;
+// a corrupt index must not make us allocate gigabytes
+static const int32_t MAX_URL_LENGTH = 16 * 1024;
+static const int32_t MAX_VALIDATOR_LENGTH = 1024;
+static const int32_t MAX_RANGES = 1024 * 1024;
+static const char* const DATA_SUFFIX = ".data";
+static const char* const INDEX_SUFFIX = ".index";
+// HEAD request for the validator
+static const int MAX_REDIRECTS = 5;
+static const size_t MAX_RESPONSE_HEADER = 16 * 1024;
+static const char* const HEAD_TIMEOUT_US = "5000000";
+
+struct CacheIndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    int64_t  length;           // size of the resource
+    int32_t  urlLength;
+    int32_t  validatorLength;  // ETag / Last-Modified when it was fetched, may be 0
+    int32_t  rangeCount;
+};
+// followed by the URL, the validator and rangeCount int64 (start, end) pairs
+
+void ByteRangeSet::add(int64_t start, int64_t end) {
+    if (end <= start) return;
+    auto it = ranges.upper_bound(start);
+    if (it != ranges.begin()) {
+        auto prev = std::prev(it);
+        if (prev->second >= start) {
+            start = prev->first;
+            end = MAX(end, prev->second);
+            it = ranges.erase(prev);
+        }
+    }
+    while (it != ranges.end() && it->first <= end) {
+        end = MAX(end, it->second);
+        it = ranges.erase(it);
+    }
+    ranges[start] = end;
+}
+
+int64_t ByteRangeSet::coveredUntil(int64_t pos) const {
+    auto it = ranges.upper_bound(pos);
+    if (it == ranges.begin()) return -1;
+    --it;
+    return it->second > pos ? it->second : -1;
+}
+
+int64_t ByteRangeSet::firstMissing(int64_t from, int64_t to) const {
+    int64_t pos = from;
+    while (pos < to) {
+        int64_t end = coveredUntil(pos);
+        if (end < 0) return pos;
+        pos = end;
+    }
+    return -1;
+}
+
+int64_t ByteRangeSet::totalBytes() const {
+    int64_t total = 0;
+    for (const auto& range : ranges) total += range.second - range.first;
+    return total;
+}
+
+// ranges of the index at path when it belongs to url, *length and *validator;
+// *length < 0 / an empty *validator accept any and store the recorded one
+static bool loadIndexFile(const std::string& path, const std::string& url, int64_t* length,
+                          std::string* validator, ByteRangeSet* out) {
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (!fp) return false;
+    CacheIndexHeader header{};
+    bool ok = fread(&header, sizeof(header), 1, fp) == 1 &&
+              header.magic == INDEX_MAGIC && header.version == INDEX_VERSION &&
+              header.length > 0 && (*length < 0 || header.length == *length) &&
+              header.urlLength == (int32_t) url.size() && header.urlLength <= MAX_URL_LENGTH &&
+              header.validatorLength >= 0 && header.validatorLength <= MAX_VALIDATOR_LENGTH &&
+              header.rangeCount >= 0 && header.rangeCount <= MAX_RANGES;
+    if (ok) {
+        std::string stored((size_t) header.urlLength, '\0');
+        ok = fread(&stored[0], 1, stored.size(), fp) == stored.size() && stored == url;
+    }
+    std::string storedValidator((size_t) header.validatorLength, '\0');
+    if (ok && header.validatorLength > 0) {
+        ok = fread(&storedValidator[0], 1, storedValidator.size(), fp) == storedValidator.size();
+    }
+    // changed on the server since it was fetched
+    if (ok && !validator->empty() && *validator != storedValidator) {
+        LOGI("MediaCache: %s changed on the server, dropping the cached ranges", url.c_str());
+        ok = false;
+    }
+    for (int32_t i = 0; ok && i < header.rangeCount; i++) {
+        int64_t range[2];
+        ok = fread(range, sizeof(range), 1, fp) == 1 &&
+             range[0] >= 0 && range[0] < range[1] && range[1] <= header.length;
+        if (ok) out->add(range[0], range[1]);
+    }
+    fclose(fp);
+    if (!ok) {
+        out->clear();
+        return false;
+    }
+    *length = header.length;
+    if (validator->empty()) *validator = storedValidator;
+    return true;
+}
+
+static std::string lowercase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char) tolower(c); });
+    return text;
+}
+
+// value of the response header `name` (lower case), empty when absent
+static std::string headerValue(const std::string& response, const std::string& lowerResponse,
+                               const char* name) {
+    const std::string key = std::string("\r\n") + name + ":";
+    size_t at = lowerResponse.find(key);
+    if (at == std::string::npos) return {};
+    size_t begin = at + key.size();
+    size_t end = response.find("\r\n", begin);
+    if (end == std::string::npos) end = response.size();
+    while (begin < end && (response[begin] == ' ' || response[begin] == '\t')) begin++;
+    while (end > begin && (response[end - 1] == ' ' || response[end - 1] == '\t')) end--;
+    return response.substr(begin, end - begin);
+}
+
+/**
+ * ETag, else Last-Modified of an http URL, from a HEAD request over tcp://
+ * (this FFmpeg's http protocol does not expose response headers). Follows
+ * redirects. Empty when the server sends neither or cannot be asked; the
+ * entry is then only validated by its length.
+ */
+static std::string fetchValidator(const std::string& url, const AVIOInterruptCB& interrupt) {
+    std::string location = url;
+    for (int redirect = 0; redirect <= MAX_REDIRECTS; redirect++) {
+        char proto[16], auth[256], host[256], path[4096];
+        int port = -1;
+        av_url_split(proto, sizeof(proto), auth, sizeof(auth), host, sizeof(host), &port,
+                     path, sizeof(path), location.c_str());
+        if (strcmp(proto, "http") != 0 || !host[0]) return {};
+        if (port < 0) port = 80;
+
+        char tcpUrl[300];
+        snprintf(tcpUrl, sizeof(tcpUrl), "tcp://%s:%d", host, port);
+        AVDictionary* opts = nullptr;
+        av_dict_set(&opts, "rw_timeout", HEAD_TIMEOUT_US, 0);
+        AVIOContext* io = nullptr;
+        int ret = avio_open2(&io, tcpUrl, AVIO_FLAG_READ_WRITE, &interrupt, &opts);
+        av_dict_free(&opts);
+        if (ret < 0) return {};
+
+        std::string request = std::string("HEAD ") + (path[0] ? path : "/") + " HTTP/1.1\r\n";
+        request += std::string("Host: ") + host + (port != 80 ? ":" + std::to_string(port) : "") + "\r\n";
+        if (auth[0]) {
+            char encoded[AV_BASE64_SIZE(sizeof(auth))];
+            av_base64_encode(encoded, sizeof(encoded), (const uint8_t*) auth, (int) strlen(auth));
+            request += std::string("Authorization: Basic ") + encoded + "\r\n";
+        }
+        request += "User-Agent: " LIBAVFORMAT_IDENT "\r\nAccept: */*\r\nConnection: close\r\n\r\n";
+        avio_write(io, (const unsigned char*) request.data(), (int) request.size());
+        avio_flush(io);
+
+        std::string response;
+        uint8_t buf[1024];
+        while (response.find("\r\n\r\n") == std::string::npos && response.size() < MAX_RESPONSE_HEADER) {
+            int n = avio_read_partial(io, buf, sizeof(buf));
+            if (n <= 0) break;
+            response.append((const char*) buf, (size_t) n);
+        }
+        avio_closep(&io);
+
+        int status = 0;
+        if (sscanf(response.c_str(), "HTTP/%*d.%*d %d", &status) != 1) return {};
+        const std::string lower = lowercase(response);
+        if (status >= 300 && status < 400) {
+            std::string next = headerValue(response, lower, "location");
+            if (next.empty()) return {};
+            if (next[0] == '/') {
+                next = std::string("http://") + host + ":" + std::to_string(port) + next;
+            }
+            location = next;
+            continue;
+        }
+        if (status < 200 || status >= 300) return {};
+        std::string etag = headerValue(response, lower, "etag");
+        if (!etag.empty()) return "etag " + etag;
+        std::string modified = headerValue(response, lower, "last-modified");
+        return modified.empty() ? std::string() : "modified " + modified;
+    }
+    return {};
+}
+
+/**
+ * One open of a cached URL. The demux thread reads from the data file; a
+ * fetch thread owns the upstream AVIOContext and fills the chunks the reader
+ * is waiting for, then the ones ahead of it. The index only ever lists bytes
+ * that were synced to the data file, so a crash loses downloads but never
+ * serves holes.
+ *
+ * Sources of the same URL in this process share a MediaCacheEntry and write
+ * identical bytes. A player in another process may use the files too; each
+ * merges the other's ranges when it saves the index.
+ */
+class CachingSource : public MediaSource {
+public:
+    CachingSource() : MediaSource(MEDIA_IO_CACHE) {
+        pthread_cond_init(&workCond, nullptr);
+    }
+
+    ~CachingSource() override {
+        shutdown();
+        pthread_cond_destroy(&workCond);
+    }
+
+    // AVERROR(ENOSYS): the URL cannot be cached, read it directly
+    int open(const char* url, const std::string& dir, const AVIOInterruptCB& interrupt) {
+        this->url = url;
+        outerInterrupt = interrupt;
+        AVIOInterruptCB cb = {&CachingSource::upstreamInterrupt, this};
+        int ret = avio_open2(&upstream, url, AVIO_FLAG_READ, &cb, nullptr);
+        if (ret < 0) {
+            // server unreachable: serve what an earlier session fetched
+            length = MediaCache::cachedLength(dir, this->url, &validator);
+            if (length <= 0) return ret;
+            offlineError = ret;
+            LOGI("MediaCache: %s unreachable (%d), reading the cached ranges only", url, ret);
+        } else {
+            length = avio_size(upstream);
+            if (length <= 0 || !(upstream->seekable & AVIO_SEEKABLE_NORMAL)) {
+                // no length or no range requests: nothing to index by
+                LOGI("MediaCache: %s not cacheable (size %lld, seekable %d)", url, (long long) length,
+                     upstream->seekable);
+                return AVERROR(ENOSYS);
+            }
+            upstreamPos = 0;
+            // a resource replaced by one of the same size must not be served
+            // from the old bytes
+            validator = fetchValidator(this->url, cb);
+            if ((int32_t) validator.size() > MAX_VALIDATOR_LENGTH) validator.clear();
+        }
+        const int failure = offlineError < 0 ? offlineError : AVERROR(ENOSYS);
+
+        dataPath = MediaCache::entryPath(dir, this->url, DATA_SUFFIX);
+        indexPath = MediaCache::entryPath(dir, this->url, INDEX_SUFFIX);
+        fd = ::open(dataPath.c_str(), O_RDWR | O_CLOEXEC | (offlineError < 0 ? 0 : O_CREAT), 0600);
+        if (fd < 0) {
+            LOGE("MediaCache: cannot open %s: %s", dataPath.c_str(), strerror(errno));
+            return failure;
+        }
+        // sparse data file: only fetched chunks take space
+        entry = MediaCache::acquireEntry(dir, this->url, length, validator, fd, offlineError == 0);
+        if (!entry) return failure;
+        // the data file's mtime orders eviction
+        futimens(fd, nullptr);
+
+        if (offlineError == 0) {
+            if (pthread_create(&fetchThread, nullptr, &CachingSource::fetchThreadEntry, this) != 0) {
+                return AVERROR(EAGAIN);
+            }
+            threadStarted = true;
+        }
+        LOGI("MediaCache: %s, %lld of %lld bytes cached", url, (long long) entry->cachedTotal.load(),
+             (long long) length);
+        return 0;
+    }
+
+protected:
+    // demux thread: blocks until the cursor's chunk is on disk
+    int read(uint8_t* buf, int size) override {
+        if (cursor >= length) return 0;
+        bool hit = true;
+        int64_t end;
+        pthread_mutex_lock(&entry->mutex);
+        while ((end = entry->ranges.coveredUntil(cursor)) < 0) {
+            if (offlineError < 0) {
+                // no upstream: the bytes that were never fetched cannot be read
+                pthread_mutex_unlock(&entry->mutex);
+                return offlineError;
+            }
+            if (fetchError < 0) {
+                int err = fetchError;
+                fetchError = 0;
+                pthread_mutex_unlock(&entry->mutex);
+                return err;
+            }
+            if (outerInterrupt.callback && outerInterrupt.callback(outerInterrupt.opaque)) {
+                wantedChunk = -1;
+                pthread_mutex_unlock(&entry->mutex);
+                return AVERROR_EXIT;
+            }
+            const int64_t chunk = cursor / MediaCache::CHUNK_SIZE;
+            if (wantedChunk != chunk) {
+                wantedChunk = chunk;
+                pthread_cond_signal(&workCond);
+            }
+            hit = false;
+            struct timespec deadline{};
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += (long) READ_WAIT_MS * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&entry->readyCond, &entry->mutex, &deadline);
+        }
+        // a short chunk may have covered the cursor and still reported an error
+        fetchError = 0;
+        if (readAt != cursor) {
+            // moves the prefetch window
+            readAt = cursor;
+            pthread_cond_signal(&workCond);
+        }
+        pthread_mutex_unlock(&entry->mutex);
+
+        const size_t n = (size_t) MIN((int64_t) size, end - cursor);
+        ssize_t got = pread(fd, buf, n, cursor);
+        syscalls++;
+        if (got < 0) return AVERROR(errno);
+        if (got == 0) return AVERROR(EIO);
+        cursor += got;
+        if (hit) cacheHitBytes += (uint64_t) got;
+        return (int) got;
+    }
+
+    int64_t seekTo(int64_t offset) override {
+        if (offset < 0 || offset > length) return AVERROR(EINVAL);
+        cursor = offset;
+        return cursor;
+    }
+
+    int64_t position() const override { return cursor; }
+    int64_t size() const override { return length; }
+    int64_t cachedBytes() const override { return entry ? entry->cachedTotal.load() : 0; }
+
+private:
+    static constexpr int64_t READ_WAIT_MS = 50;
+    // persist the index (and check the size cap) after this much new data
+    static constexpr int64_t INDEX_SAVE_BYTES = 4 * 1024 * 1024;
+    // a failing prefetch is retried after this, demand fetches right away
+    static constexpr int64_t PREFETCH_RETRY_MS = 1000;
+
+    // FFmpeg polls this inside upstream I/O, on the fetch thread
+    static int upstreamInterrupt(void* opaque) {
+        auto* self = static_cast<CachingSource*>(opaque);
+        if (self->stop) return 1;
+        const AVIOInterruptCB& outer = self->outerInterrupt;
+        return outer.callback ? outer.callback(outer.opaque) : 0;
+    }
+
+    static void* fetchThreadEntry(void* arg) {
+        static_cast<CachingSource*>(arg)->fetchLoop();
+        return nullptr;
+    }
+
+    void fetchLoop() {
+        std::vector<uint8_t> buffer((size_t) MediaCache::CHUNK_SIZE);
+        int64_t unsavedBytes = 0;
+        pthread_mutex_lock(&entry->mutex);
+        while (!stop) {
+            const bool demand = wantedChunk >= 0;
+            int64_t chunk = wantedChunk;
+            if (!demand) {
+                int64_t missing = entry->ranges.firstMissing(readAt, MIN(length, readAt + MediaCache::PREFETCH_BYTES));
+                if (missing >= 0) chunk = missing / MediaCache::CHUNK_SIZE;
+            }
+            if (chunk < 0) {
+                pthread_cond_wait(&workCond, &entry->mutex);
+                continue;
+            }
+            pthread_mutex_unlock(&entry->mutex);
+
+            const int64_t start = chunk * MediaCache::CHUNK_SIZE;
+            const int expected = (int) MIN(MediaCache::CHUNK_SIZE, length - start);
+            int ret = fetchChunk(start, expected, buffer.data());
+
+            pthread_mutex_lock(&entry->mutex);
+            if (ret > 0) {
+                entry->ranges.add(start, start + ret);
+                entry->cachedTotal = entry->ranges.totalBytes();
+                unsavedBytes += ret;
+            }
+            if (ret < expected && !stop) {
+                // short read: the server's length was wrong, report end of data
+                const int err = ret < 0 ? ret : AVERROR_EOF;
+                if (demand && wantedChunk == chunk) {
+                    fetchError = err;
+                } else if (!demand && err != AVERROR_EXIT) {
+                    LOGE("MediaCache: prefetch at %lld failed %d", (long long) start, err);
+                    struct timespec deadline{};
+                    clock_gettime(CLOCK_REALTIME, &deadline);
+                    deadline.tv_sec += PREFETCH_RETRY_MS / 1000;
+                    pthread_cond_timedwait(&workCond, &entry->mutex, &deadline);
+                }
+            }
+            if (wantedChunk == chunk) wantedChunk = -1;
+            pthread_cond_broadcast(&entry->readyCond);
+
+            if (unsavedBytes >= INDEX_SAVE_BYTES) {
+                const int64_t saved = unsavedBytes;
+                unsavedBytes = 0;
+                pthread_mutex_unlock(&entry->mutex);
+                saveIndex();
+                MediaCache::addUsage(saved);
+                pthread_mutex_lock(&entry->mutex);
+            }
+        }
+        pthread_mutex_unlock(&entry->mutex);
+        // counted by shutdown()
+        unaccountedBytes = unsavedBytes;
+    }
+
+    // fetch thread: bytes stored, <0 AVERROR
+    int fetchChunk(int64_t start, int len, uint8_t* buf) {
+        if (upstreamPos != start) {
+            int64_t pos = avio_seek(upstream, start, SEEK_SET);
+            if (pos < 0) {
+                upstreamPos = -1;
+                return (int) pos;
+            }
+            upstreamPos = start;
+        }
+        int got = 0;
+        while (got < len) {
+            int n = avio_read(upstream, buf + got, len - got);
+            if (n == 0 || n == AVERROR_EOF) break;
+            if (n < 0) {
+                upstreamPos = -1;
+                return n;
+            }
+            got += n;
+        }
+        upstreamPos = start + got;
+        for (int written = 0; written < got;) {
+            ssize_t n = pwrite(fd, buf + written, (size_t) (got - written), start + written);
+            if (n <= 0) {
+                int err = AVERROR(errno);
+                LOGE("MediaCache: write %s failed: %s", dataPath.c_str(), strerror(errno));
+                return err;
+            }
+            written += (int) n;
+        }
+        downloadedBytes += (uint64_t) got;
+        return got;
+    }
+
+    // any thread but the reader's; merges what another player saved
+    void saveIndex() {
+        // the index must never list bytes that are not on disk yet
+        fdatasync(fd);
+        pthread_mutex_lock(&entry->saveMutex);
+        ByteRangeSet onDisk;
+        int64_t indexedLength = length;
+        std::string indexedValidator = entry->validator;
+        loadIndexFile(indexPath, url, &indexedLength, &indexedValidator, &onDisk);
+        pthread_mutex_lock(&entry->mutex);
+        for (const auto& range : onDisk.all()) entry->ranges.add(range.first, range.second);
+        entry->cachedTotal = entry->ranges.totalBytes();
+        std::map<int64_t, int64_t> snapshot = entry->ranges.all();
+        pthread_mutex_unlock(&entry->mutex);
+
+        CacheIndexHeader header{};
+        header.magic = INDEX_MAGIC;
+        header.version = INDEX_VERSION;
+        header.length = length;
+        header.urlLength = (int32_t) url.size();
+        header.validatorLength = (int32_t) entry->validator.size();
+        header.rangeCount = (int32_t) snapshot.size();
+
+        std::string tmp = indexPath + ".tmp";
+        FILE* fp = fopen(tmp.c_str(), "wb");
+        if (!fp) {
+            pthread_mutex_unlock(&entry->saveMutex);
+            LOGE("MediaCache: cannot write %s", tmp.c_str());
+            return;
+        }
+        bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+                  fwrite(url.data(), 1, url.size(), fp) == url.size() &&
+                  fwrite(entry->validator.data(), 1, entry->validator.size(), fp) == entry->validator.size();
+        for (auto it = snapshot.begin(); ok && it != snapshot.end(); ++it) {
+            const int64_t range[2] = {it->first, it->second};
+            ok = fwrite(range, sizeof(range), 1, fp) == 1;
+        }
+        ok = (fclose(fp) == 0) && ok;
+        if (!ok || rename(tmp.c_str(), indexPath.c_str()) != 0) {
+            unlink(tmp.c_str());
+        }
+        pthread_mutex_unlock(&entry->saveMutex);
+    }
+
+    void shutdown() {
+        if (threadStarted) {
+            // aborts an upstream read in flight
+            stop = true;
+            pthread_mutex_lock(&entry->mutex);
+            pthread_cond_broadcast(&workCond);
+            pthread_mutex_unlock(&entry->mutex);
+            pthread_join(fetchThread, nullptr);
+            threadStarted = false;
+        }
+        if (upstream) avio_closep(&upstream);
+        if (fd >= 0) {
+            if (entry && offlineError == 0) saveIndex();
+            ::close(fd);
+            fd = -1;
+        }
+        if (unaccountedBytes > 0) {
+            MediaCache::addUsage(unaccountedBytes);
+            unaccountedBytes = 0;
+        }
+        if (entry) {
+            MediaCache::releaseEntry(entry);
+            entry.reset();
+        }
+    }
+
+    std::string url;
+    std::string validator;           // of the resource as served now, may be empty
+    std::shared_ptr<MediaCacheEntry> entry;
+    std::string dataPath;
+    std::string indexPath;
+    AVIOInterruptCB outerInterrupt{};
+    int fd = -1;
+    int64_t length = 0;
+    int64_t cursor = 0;              // demux thread
+
+    AVIOContext* upstream = nullptr; // fetch thread once it runs
+    int64_t upstreamPos = -1;        // where the next avio_read() lands, -1 after errors
+    int offlineError = 0;            // upstream open failed: only cached ranges are served
+
+    pthread_t fetchThread{};
+    bool threadStarted = false;
+    int64_t unaccountedBytes = 0;    // written by the fetch thread after its last save
+    std::atomic<bool> stop{false};
+
+    // guarded by entry->mutex
+    pthread_cond_t workCond;         // reader -> fetch thread: demand or cursor moved
+    int64_t wantedChunk = -1;        // the reader blocks on it
+    int64_t readAt = 0;              // prefetch starts here
+    int fetchError = 0;              // failure of wantedChunk, consumed by read()
+};
+
+pthread_mutex_t MediaCache::mutex = PTHREAD_MUTEX_INITIALIZER;
+std::string MediaCache::cacheDir;
+int64_t MediaCache::maxBytes = MediaCache::DEFAULT_MAX_BYTES;
+std::map<std::string, std::shared_ptr<MediaCacheEntry>> MediaCache::openEntries;
+uint64_t MediaCache::evictions = 0;
+int64_t MediaCache::usedBytes = -1;
+
+void MediaCache::setCacheDir(const char* dir, int64_t maxSize) {
+    pthread_mutex_lock(&mutex);
+    cacheDir = dir ? dir : "";
+    maxBytes = maxSize > 0 ? maxSize : DEFAULT_MAX_BYTES;
+    usedBytes = -1;
+    if (!cacheDir.empty()) trimLocked(maxBytes);
+    pthread_mutex_unlock(&mutex);
+}
+
+bool MediaCache::accepts(const char* path) {
+    if (!path || (strncmp(path, "http://", 7) != 0 && strncmp(path, "https://", 8) != 0)) {
+        return false;
+    }
+    pthread_mutex_lock(&mutex);
+    bool enabled = !cacheDir.empty();
+    pthread_mutex_unlock(&mutex);
+    return enabled;
+}
+
+std::unique_ptr<MediaSource> MediaCache::open(const char* url, const MediaIoOptions& options, int* err) {
+    if (err) *err = 0;
+    pthread_mutex_lock(&mutex);
+    std::string dir = cacheDir;
+    pthread_mutex_unlock(&mutex);
+    if (!url || dir.empty()) return nullptr;
+
+    std::unique_ptr<CachingSource> source(new CachingSource());
+    int ret = source->open(url, dir, options.interrupt);
+    if (ret == AVERROR(ENOSYS)) return nullptr;
+    if (ret < 0) {
+        if (err) *err = ret;
+        return nullptr;
+    }
+    return source;
+}
+
+void MediaCache::clear() {
+    pthread_mutex_lock(&mutex);
+    usedBytes = -1;
+    if (!cacheDir.empty()) trimLocked(0);
+    pthread_mutex_unlock(&mutex);
+}
+
+std::string MediaCache::entryPath(const std::string& dir, const std::string& url, const char* suffix) {
+    MediaFileKey key;
+    key.path = url;
+    char name[48];
+    snprintf(name, sizeof(name), "/%016llx%s", (unsigned long long) key.pathHash(), suffix);
+    return dir + name;
+}
+
+// entry name: the data and index file names without suffix
+static std::string entryName(const std::string& url) {
+    MediaFileKey key;
+    key.path = url;
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long) key.pathHash());
+    return name;
+}
+
+std::shared_ptr<MediaCacheEntry> MediaCache::acquireEntry(const std::string& dir, const std::string& url,
+                                                          int64_t length, const std::string& validator,
+                                                          int fd, bool mayReset) {
+    const std::string name = entryName(url);
+    pthread_mutex_lock(&mutex);
+    auto it = openEntries.find(name);
+    if (it != openEntries.end()) {
+        std::shared_ptr<MediaCacheEntry> open = it->second;
+        if (open->url != url || open->length != length ||
+            (!validator.empty() && !open->validator.empty() && open->validator != validator)) {
+            // hash collision, or the resource changed under a running player:
+            // its data file must stay as it is
+            pthread_mutex_unlock(&mutex);
+            LOGI("MediaCache: %s busy with another resource, not cached", url.c_str());
+            return nullptr;
+        }
+        open->opens++;
+        pthread_mutex_unlock(&mutex);
+        return open;
+    }
+
+    std::shared_ptr<MediaCacheEntry> entry = std::make_shared<MediaCacheEntry>();
+    entry->name = name;
+    entry->url = url;
+    entry->length = length;
+    int64_t indexedLength = length;
+    std::string indexedValidator = validator;
+    struct stat st{};
+    const bool statOk = fstat(fd, &st) == 0;
+    if (!statOk || st.st_size != length ||
+        !loadIndexFile(entryPath(dir, url, INDEX_SUFFIX), url, &indexedLength, &indexedValidator,
+                       &entry->ranges)) {
+        entry->ranges.clear();
+        indexedValidator = validator;
+        if (!mayReset) {
+            pthread_mutex_unlock(&mutex);
+            return nullptr;
+        }
+        // nobody in this process has the file open, so nothing is served from it
+        if (statOk && usedBytes >= 0) usedBytes = MAX(usedBytes - (int64_t) st.st_blocks * 512, (int64_t) 0);
+        if (ftruncate(fd, 0) != 0 || ftruncate(fd, length) != 0) {
+            pthread_mutex_unlock(&mutex);
+            LOGE("MediaCache: cannot size %s: %s", name.c_str(), strerror(errno));
+            return nullptr;
+        }
+    }
+    entry->validator = indexedValidator;
+    entry->cachedTotal = entry->ranges.totalBytes();
+    entry->opens = 1;
+    openEntries[name] = entry;
+    if (!cacheDir.empty()) trimLocked(maxBytes);
+    pthread_mutex_unlock(&mutex);
+    return entry;
+}
+
+void MediaCache::releaseEntry(const std::shared_ptr<MediaCacheEntry>& entry) {
+    pthread_mutex_lock(&mutex);
+    auto it = openEntries.find(entry->name);
+    if (--entry->opens == 0 && it != openEntries.end() && it->second == entry) openEntries.erase(it);
+    if (!cacheDir.empty()) trimLocked(maxBytes);
+    pthread_mutex_unlock(&mutex);
+}
+
+int64_t MediaCache::cachedLength(const std::string& dir, const std::string& url, std::string* validator) {
+    pthread_mutex_lock(&mutex);
+    auto it = openEntries.find(entryName(url));
+    int64_t length = -1;
+    if (it != openEntries.end() && it->second->url == url) {
+        length = it->second->length;
+        *validator = it->second->validator;
+    }
+    pthread_mutex_unlock(&mutex);
+    if (length > 0) return length;
+    ByteRangeSet ranges;
+    validator->clear();
+    return loadIndexFile(entryPath(dir, url, INDEX_SUFFIX), url, &length, validator, &ranges) ? length : -1;
+}
+
+void MediaCache::addUsage(int64_t bytes) {
+    pthread_mutex_lock(&mutex);
+    if (usedBytes >= 0) usedBytes += bytes;
+    if (!cacheDir.empty()) trimLocked(maxBytes);
+    pthread_mutex_unlock(&mutex);
+}
+
+namespace {
+struct CacheEntryFile {
+    std::string name;       // without suffix
+    int64_t bytes;          // allocated, the data file is sparse
+    int64_t mtime;
+};
+
+// every entry in dir, least recently used first
+std::vector<CacheEntryFile> listEntries(const std::string& dir) {
+    std::vector<CacheEntryFile> files;
+    DIR* d = opendir(dir.c_str());
+    if (!d) return files;
+    const size_t suffixLength = strlen(DATA_SUFFIX);
+    while (struct dirent* ent = readdir(d)) {
+        const size_t nameLength = strlen(ent->d_name);
+        if (nameLength <= suffixLength || strcmp(ent->d_name + nameLength - suffixLength, DATA_SUFFIX) != 0) {
+            continue;
+        }
+        std::string base(ent->d_name, nameLength - suffixLength);
+        struct stat st{};
+        if (stat((dir + "/" + ent->d_name).c_str(), &st) != 0) continue;
+        int64_t bytes = (int64_t) st.st_blocks * 512;
+        struct stat indexSt{};
+        if (stat((dir + "/" + base + INDEX_SUFFIX).c_str(), &indexSt) == 0) bytes += indexSt.st_size;
+        files.push_back({base, bytes, (int64_t) st.st_mtime});
+    }
+    closedir(d);
+    std::sort(files.begin(), files.end(), [](const CacheEntryFile& a, const CacheEntryFile& b) {
+        return a.mtime < b.mtime;
+    });
+    return files;
+}
+}
+
+// the directory is only listed when the running total is unknown or over the
+// cap, the listing then resyncs it
+void MediaCache::trimLocked(int64_t maxUsed) {
+    if (usedBytes >= 0 && usedBytes <= maxUsed) return;
+    std::vector<CacheEntryFile> files = listEntries(cacheDir);
+    int64_t used = 0;
+    for (const CacheEntryFile& file : files) used += file.bytes;
+    for (const CacheEntryFile& file : files) {
+        if (used <= maxUsed) break;
+        // an open entry is still being read, and may be growing
+        if (openEntries.count(file.name)) continue;
+        unlink((cacheDir + "/" + file.name + DATA_SUFFIX).c_str());
+        unlink((cacheDir + "/" + file.name + INDEX_SUFFIX).c_str());
+        used -= file.bytes;
+        evictions++;
+        LOGI("MediaCache: evicted %s, %lld bytes", file.name.c_str(), (long long) file.bytes);
+    }
+    usedBytes = used;
+}
+
+MediaCacheStats MediaCache::getStats() {
+    MediaCacheStats stats;
+    pthread_mutex_lock(&mutex);
+    if (!cacheDir.empty()) {
+        for (const CacheEntryFile& file : listEntries(cacheDir)) {
+            stats.usedBytes += file.bytes;
+            stats.entries++;
+        }
+    }
+    stats.evictions = evictions;
+    pthread_mutex_unlock(&mutex);
+    return stats;
+}
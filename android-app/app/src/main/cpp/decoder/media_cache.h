@@ -0,0 +1,140 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <pthread.h>
+
+#include "media_source.h"
+
+/**
+ * Sorted, merged [start, end) byte ranges: which parts of a cached file are
+ * on disk. Not thread safe.
+ */
+class ByteRangeSet {
+public:
+    void add(int64_t start, int64_t end);
+    void clear() { ranges.clear(); }
+
+    // end of the cached run that contains pos, or -1 when pos is missing
+    int64_t coveredUntil(int64_t pos) const;
+    // first missing byte in [from, to), or -1 when all of it is cached
+    int64_t firstMissing(int64_t from, int64_t to) const;
+    int64_t totalBytes() const;
+
+    const std::map<int64_t, int64_t>& all() const { return ranges; }
+
+private:
+    std::map<int64_t, int64_t> ranges;   // start -> end
+};
+
+/**
+ * One cached URL while it is open in this process. Every CachingSource of the
+ * URL (player, GOP cache, thumbnails, preload) shares it, so only the first
+ * opener sizes the data file and a chunk fetched by one source is visible to
+ * the readers of all of them.
+ */
+struct MediaCacheEntry {
+    MediaCacheEntry() {
+        pthread_mutex_init(&mutex, nullptr);
+        pthread_cond_init(&readyCond, nullptr);
+        pthread_mutex_init(&saveMutex, nullptr);
+    }
+    ~MediaCacheEntry() {
+        pthread_mutex_destroy(&saveMutex);
+        pthread_cond_destroy(&readyCond);
+        pthread_mutex_destroy(&mutex);
+    }
+
+    std::string name;
+    std::string url;
+    int64_t length = 0;
+    std::string validator;       // ETag / Last-Modified the ranges belong to, may be empty
+    std::atomic<int64_t> cachedTotal{0};
+
+    pthread_mutex_t mutex;
+    pthread_cond_t readyCond;    // a chunk finished, from any source's fetch thread
+    ByteRangeSet ranges;         // guarded by mutex
+    pthread_mutex_t saveMutex;   // one index writer at a time
+
+    int opens = 0;               // guarded by MediaCache's mutex
+};
+
+struct MediaCacheStats {
+    int64_t  usedBytes = 0;    // on disk, all entries
+    int      entries = 0;
+    uint64_t evictions = 0;
+};
+
+/**
+ * Persistent disk cache for http(s) media, used as MEDIA_IO_CACHE.
+ *
+ * Each URL gets a sparse data file of the resource's full size plus an index
+ * of the byte ranges already fetched. A background thread downloads aligned
+ * chunks: first whatever the demuxer is blocked on, then up to
+ * PREFETCH_BYTES ahead of the read cursor. Replays and seeks into fetched
+ * ranges are served from disk without touching the network, also after an
+ * app restart.
+ *
+ * Each index records the resource's ETag (or Last-Modified) from a HEAD
+ * request; when the server reports another one, the cached ranges are
+ * dropped. Servers that send neither are validated by length only.
+ *
+ * When the server cannot be reached, a URL with a saved index is still opened:
+ * fetched ranges are served from disk and reads of the others fail.
+ *
+ * Entries are evicted least recently opened first once the directory grows
+ * past the size cap; entries that are open are never evicted. The size is a
+ * running total, the directory is only listed to evict (or once after
+ * setCacheDir()). Servers without
+ * range requests or a known length are not cached (open() returns nullptr
+ * with *err == 0, the demuxer then reads the URL directly).
+ */
+class MediaCache {
+public:
+    static constexpr int64_t CHUNK_SIZE = 256 * 1024;
+    static constexpr int64_t PREFETCH_BYTES = 4 * 1024 * 1024;
+    static constexpr int64_t DEFAULT_MAX_BYTES = 256LL * 1024 * 1024;
+
+    // empty dir disables the cache; maxBytes <= 0 uses the default
+    static void setCacheDir(const char* dir, int64_t maxBytes);
+    // the URL would be cached (cache enabled, http or https)
+    static bool accepts(const char* path);
+    static std::unique_ptr<MediaSource> open(const char* url, const MediaIoOptions& options, int* err);
+    // delete every entry that is not open
+    static void clear();
+
+    static MediaCacheStats getStats();
+
+    // entry files of `url` in dir
+    static std::string entryPath(const std::string& dir, const std::string& url, const char* suffix);
+
+    // CachingSource bookkeeping. The first open of a URL loads its index when
+    // length and validator (empty: any) match, or resizes the data file (fd)
+    // when mayReset; nullptr when it cannot be used.
+    static std::shared_ptr<MediaCacheEntry> acquireEntry(const std::string& dir, const std::string& url,
+                                                         int64_t length, const std::string& validator,
+                                                         int fd, bool mayReset);
+    static void releaseEntry(const std::shared_ptr<MediaCacheEntry>& entry);
+    // resource length and validator recorded for url, -1 when nothing is cached
+    static int64_t cachedLength(const std::string& dir, const std::string& url, std::string* validator);
+    // bytes written to the directory; evicts when it no longer fits the cap
+    static void addUsage(int64_t bytes);
+
+private:
+    // mutex held
+    static void trimLocked(int64_t maxUsed);
+
+    static pthread_mutex_t mutex;
+    static std::string cacheDir;
+    static int64_t maxBytes;
+    static std::map<std::string, std::shared_ptr<MediaCacheEntry>> openEntries;
+    static uint64_t evictions;
+    static int64_t usedBytes;   // running total of the directory, -1 unknown
+};
@@ -0,0 +1,795 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include "media_demuxer.h"
+#include "media_cache.h"
+#include "probe_cache.h"
+#include <unistd.h>
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+#define LOG_TAG "MediaDemuxer"
+#include "CommonTools.h"
+
+static const AVRational MS_TIME_BASE = {1, 1000};
+
+pthread_mutex_t MediaDemuxer::registryMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t MediaDemuxer::registryCond = PTHREAD_COND_INITIALIZER;
+std::map<std::string, std::weak_ptr<MediaDemuxer>> MediaDemuxer::registry;
+std::map<std::string, std::shared_ptr<MediaDemuxer::PendingOpen>> MediaDemuxer::opening;
+
+std::shared_ptr<MediaDemuxer> MediaDemuxer::acquire(const char* path, bool shared, int* err,
+                                                   const MediaIoOptions& io) {
+    if (err) *err = 0;
+    if (!path) {
+        if (err) *err = AVERROR(EINVAL);
+        return nullptr;
+    }
+
+    if (!shared) {
+        auto demuxer = std::make_shared<MediaDemuxer>();
+        int ret = demuxer->open(path, io);
+        if (ret < 0) {
+            if (err) *err = ret;
+            return nullptr;
+        }
+        return demuxer;
+    }
+
+    pthread_mutex_lock(&registryMutex);
+    auto it = registry.find(path);
+    std::shared_ptr<MediaDemuxer> demuxer = it != registry.end() ? it->second.lock() : nullptr;
+    if (demuxer) {
+        pthread_mutex_unlock(&registryMutex);
+        return demuxer;
+    }
+    auto pending = opening.find(path);
+    if (pending != opening.end()) {
+        // the second decoder waits for the first open instead of opening the
+        // file a second time, and shares its failure
+        std::shared_ptr<PendingOpen> first = pending->second;
+        while (!first->done) {
+            pthread_cond_wait(&registryCond, &registryMutex);
+        }
+        pthread_mutex_unlock(&registryMutex);
+        if (first->result < 0 && err) *err = first->result;
+        return first->demuxer;
+    }
+    // placeholder: the open itself (network probing included) runs unlocked,
+    // acquires of other paths go ahead meanwhile
+    std::shared_ptr<PendingOpen> placeholder = std::make_shared<PendingOpen>();
+    opening[path] = placeholder;
+    pthread_mutex_unlock(&registryMutex);
+
+    demuxer = std::make_shared<MediaDemuxer>();
+    int ret = demuxer->open(path, io);
+    if (ret < 0) {
+        demuxer.reset();
+        if (err) *err = ret;
+    } else {
+        demuxer->shared = true;
+    }
+
+    pthread_mutex_lock(&registryMutex);
+    if (demuxer) registry[path] = demuxer;
+    opening.erase(path);
+    placeholder->demuxer = demuxer;
+    placeholder->result = ret;
+    placeholder->done = true;
+    pthread_cond_broadcast(&registryCond);
+    pthread_mutex_unlock(&registryMutex);
+    return demuxer;
+}
+
+MediaDemuxer::MediaDemuxer() {
+    pthread_mutex_init(&mutex, nullptr);
+    pthread_cond_init(&fillCond, nullptr);
+    pthread_cond_init(&dataCond, nullptr);
+    pthread_cond_init(&seekCond, nullptr);
+}
+
+MediaDemuxer::~MediaDemuxer() {
+    close();
+    if (shared) {
+        pthread_mutex_lock(&registryMutex);
+        auto it = registry.find(path);
+        // a new instance may already be registered for the same path
+        if (it != registry.end() && it->second.expired()) {
+            registry.erase(it);
+        }
+        pthread_mutex_unlock(&registryMutex);
+    }
+    pthread_cond_destroy(&seekCond);
+    pthread_cond_destroy(&dataCond);
+    pthread_cond_destroy(&fillCond);
+    pthread_mutex_destroy(&mutex);
+}
+
+int MediaDemuxer::open(const char* mediaPath, const MediaIoOptions& io) {
+    int ret = 0;
+    MediaIoOptions options = io;
+    if (options.mode == MEDIA_IO_DEFAULT && !options.live && MediaCache::accepts(mediaPath)) {
+        options.mode = MEDIA_IO_CACHE;
+    }
+
+    // probing included: a source that never answers fails the open
+    beginIo(OPEN_TIMEOUT_MS);
+    if (options.mode != MEDIA_IO_DEFAULT) {
+        options.interrupt.callback = &MediaDemuxer::interruptCallback;
+        options.interrupt.opaque = this;
+        source = MediaSource::create(mediaPath, options, &ret);
+        if (!source && ret == 0 && options.mode == MEDIA_IO_CACHE) {
+            // no length or no range requests: read the URL directly
+            options.mode = MEDIA_IO_DEFAULT;
+        } else if (!source || !source->avio()) {
+            endIo();
+            source.reset();
+            return ret < 0 ? ret : AVERROR(ENOMEM);
+        }
+    }
+
+    fmtCtx = avformat_alloc_context();
+    if (!fmtCtx) {
+        endIo();
+        source.reset();
+        return AVERROR(ENOMEM);
+    }
+    fmtCtx->interrupt_callback.callback = &MediaDemuxer::interruptCallback;
+    fmtCtx->interrupt_callback.opaque = this;
+    if (source) {
+        fmtCtx->pb = source->avio();
+        fmtCtx->flags |= AVFMT_FLAG_CUSTOM_IO;
+    }
+    if (io.probeSize > 0) fmtCtx->probesize = io.probeSize;
+    if (io.analyzeDurationUs > 0) fmtCtx->max_analyze_duration = io.analyzeDurationUs;
+    live = io.live;
+    liveMaxBacklogMs = io.liveMaxBacklogMs;
+    if (live) {
+        // probed packets are still handed out, this only shortens the open
+        fmtCtx->flags |= AVFMT_FLAG_NOBUFFER;
+        if (io.probeSize <= 0) fmtCtx->probesize = LIVE_PROBE_SIZE;
+        if (io.analyzeDurationUs <= 0) fmtCtx->max_analyze_duration = LIVE_ANALYZE_US;
+    }
+
+    ret = avformat_open_input(&fmtCtx, mediaPath, nullptr, nullptr);
+    probeSkipped = false;
+    if (ret >= 0 && options.mode != MEDIA_IO_MEMORY && ProbeCache::restore(mediaPath, fmtCtx)) {
+        probeSkipped = true;
+    } else if (ret >= 0) {
+        ret = avformat_find_stream_info(fmtCtx, nullptr);
+        if (ret < 0) {
+            avformat_close_input(&fmtCtx);
+        } else if (options.mode != MEDIA_IO_MEMORY) {
+            ProbeCache::store(mediaPath, fmtCtx);
+        }
+    }
+    if (endIo()) {
+        stats.ioTimeouts++;
+        LOGE("MediaDemuxer::open %s timed out after %lld ms", mediaPath, (long long) OPEN_TIMEOUT_MS);
+        if (fmtCtx) {
+            avformat_close_input(&fmtCtx);
+        }
+        source.reset();
+        return AVERROR(ETIMEDOUT);
+    }
+    if (ret < 0) {
+        // avformat_open_input() frees the context on failure
+        source.reset();
+        return ret;
+    }
+
+    path = mediaPath;
+    streams.resize(fmtCtx->nb_streams);
+    for (unsigned i = 0; i < fmtCtx->nb_streams; i++) {
+        fmtCtx->streams[i]->discard = AVDISCARD_ALL;
+    }
+    readPkt = av_packet_alloc();
+    if (!readPkt) {
+        close();
+        return AVERROR(ENOMEM);
+    }
+
+    quit = false;
+    if (pthread_create(&demuxThread, nullptr, &MediaDemuxer::demuxThreadEntry, this) != 0) {
+        close();
+        return AVERROR(EAGAIN);
+    }
+    threadStarted = true;
+    LOGI("MediaDemuxer::open %s, %u streams, io mode %d%s%s", mediaPath, fmtCtx->nb_streams, options.mode,
+         probeSkipped ? ", probe cached" : "", live ? ", live" : "");
+    return 0;
+}
+
+void MediaDemuxer::close() {
+    if (threadStarted) {
+        // wakes the demux thread; the interrupt callback cuts a blocking read
+        // or seek short
+        quit = true;
+        pthread_mutex_lock(&mutex);
+        pthread_cond_broadcast(&fillCond);
+        pthread_cond_broadcast(&dataCond);
+        pthread_cond_broadcast(&seekCond);
+        pthread_mutex_unlock(&mutex);
+        pthread_join(demuxThread, nullptr);
+        threadStarted = false;
+    }
+
+    for (StreamState& s : streams) {
+        clearQueue(s);
+        // saves freshly recorded indexes, needs fmtCtx
+        if (s.index) {
+            s.index->close();
+            s.index.reset();
+        }
+    }
+    streams.clear();
+    if (readPkt) {
+        av_packet_free(&readPkt);
+    }
+    if (fmtCtx) {
+        LOGI("MediaDemuxer::close packets=%llu seeks=%llu coalesced=%llu waits=%llu",
+             (unsigned long long) stats.packetsRead, (unsigned long long) stats.seeks,
+             (unsigned long long) stats.coalescedSeeks, (unsigned long long) stats.readWaits);
+        avformat_close_input(&fmtCtx);
+    }
+    if (source) {
+        MediaIoStats io = source->getStats();
+        LOGI("MediaDemuxer::close io mode=%d bytes=%lld reads=%llu syscalls=%llu seeks=%llu",
+             io.mode, (long long) io.bytesRead, (unsigned long long) io.readCalls,
+             (unsigned long long) io.syscalls, (unsigned long long) io.seeks);
+        source.reset();
+    }
+}
+
+void* MediaDemuxer::demuxThreadEntry(void* arg) {
+    static_cast<MediaDemuxer*>(arg)->demuxLoop();
+    return nullptr;
+}
+
+void MediaDemuxer::demuxLoop() {
+    pthread_mutex_lock(&mutex);
+    while (!quit) {
+        if (streamsPending || discardDirty) {
+            const bool requested = streamsPending.exchange(false);
+            uint64_t serial = streamsRequestSerial;
+            applyStreamsLocked();
+            if (requested) {
+                streamsDoneSerial = serial;
+                pthread_cond_broadcast(&seekCond);
+            }
+            continue;
+        }
+        if (seekPending) {
+            seekPending = false;
+            uint64_t serial = seekRequestSerial;
+            lastSeekResult = seekLocked(pendingSeekMs);
+            // superseded while the lock was released: the newer request
+            // answers both callers
+            if (seekPending && !quit) continue;
+            seekDoneSerial = serial;
+            pthread_cond_broadcast(&seekCond);
+            pthread_cond_broadcast(&dataCond);
+            continue;
+        }
+        if (eof || queuesFull()) {
+            pthread_cond_wait(&fillCond, &mutex);
+            continue;
+        }
+
+        // the only blocking I/O: readers keep draining their queues meanwhile
+        pthread_mutex_unlock(&mutex);
+        beginIo(READ_TIMEOUT_MS);
+        reading = true;
+        int ret = av_read_frame(fmtCtx, readPkt);
+        reading = false;
+        bool timedOut = endIo();
+        pthread_mutex_lock(&mutex);
+
+        if (seekPending || quit) {
+            // read from the old position, queues were already flushed
+            if (ret == AVERROR_EXIT) stats.ioInterrupts++;
+            av_packet_unref(readPkt);
+            continue;
+        }
+        if (ret == AVERROR_EXIT && (noSubscribers || streamsPending)) {
+            // the last decoder left, or one is joining, while the read was
+            // blocked; whoever subscribes next rewinds the source
+            stats.ioInterrupts++;
+            readAny = true;
+            continue;
+        }
+        if (timedOut) {
+            stats.ioTimeouts++;
+            LOGE("MediaDemuxer: no data for %lld ms, giving up", (long long) READ_TIMEOUT_MS);
+            ret = AVERROR(ETIMEDOUT);
+        }
+        if (ret == AVERROR(EAGAIN)) {
+            pthread_mutex_unlock(&mutex);
+            usleep(10 * 1000);
+            pthread_mutex_lock(&mutex);
+            continue;
+        }
+        if (ret < 0) {
+            eof = true;
+            readError = ret;
+            if (ret == AVERROR_EOF) {
+                for (StreamState& s : streams) {
+                    if (s.index) s.index->markEof();
+                }
+            } else {
+                LOGE("MediaDemuxer: av_read_frame failed %d", ret);
+            }
+            pthread_cond_broadcast(&dataCond);
+            continue;
+        }
+        stats.packetsRead++;
+        readAny = true;
+
+        const int index = readPkt->stream_index;
+        if (index < 0 || index >= (int) streams.size() || !streams[index].subscribed) {
+            av_packet_unref(readPkt);
+            continue;
+        }
+        if (readPkt->pts != AV_NOPTS_VALUE) {
+            AVRational tb = fmtCtx->streams[index]->time_base;
+            int64_t endMs = av_rescale_q(readPkt->pts + MAX(readPkt->duration, (int64_t) 0), tb, MS_TIME_BASE);
+            if (endMs > liveEdgeMs) liveEdgeMs = endMs;
+        }
+        streams[index].index->record(readPkt);
+        enqueue(index, readPkt);
+        if (live && liveMaxBacklogMs > 0 && index == primaryStream() &&
+            queuedDurationMs(index) > liveMaxBacklogMs) {
+            skipToLiveEdgeLocked(index);
+        }
+        pthread_cond_broadcast(&dataCond);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+int MediaDemuxer::subscribe(int streamIndex, int64_t indexSpacing) {
+    pthread_mutex_lock(&mutex);
+    if (!fmtCtx || streamIndex < 0 || streamIndex >= (int) streams.size()) {
+        pthread_mutex_unlock(&mutex);
+        return AVERROR(EINVAL);
+    }
+
+    StreamState& s = streams[streamIndex];
+    if (!s.subscribed) {
+        if (!s.subscribeRequested) {
+            s.subscribeRequested = true;
+            s.indexSpacing = indexSpacing;
+            noSubscribers = false;
+            streamsPending = true;
+            ++streamsRequestSerial;
+            pthread_cond_broadcast(&fillCond);
+        }
+        // the demux thread opens the index and enables the stream
+        uint64_t serial = streamsRequestSerial;
+        while (streamsDoneSerial < serial && !quit) {
+            pthread_cond_wait(&seekCond, &mutex);
+        }
+        if (quit || !s.subscribed) {
+            pthread_mutex_unlock(&mutex);
+            return quit ? AVERROR_EXIT : AVERROR(EINVAL);
+        }
+
+        if (s.joinedLate) {
+            s.joinedLate = false;
+            // this stream's packets were skipped so far: start over, the others
+            // drop what they already had
+            for (int i = 0; i < (int) streams.size(); i++) {
+                StreamState& other = streams[i];
+                clearQueue(other);
+                if (i == streamIndex || !other.subscribed) continue;
+                // nothing handed out yet at the start: the rewind is invisible
+                if (!other.readSinceSeek && lastSeekMs < 0) continue;
+                other.discontinuity = true;
+                other.resumeMs = other.readSinceSeek ? other.lastEndMs : lastSeekMs;
+            }
+            readAny = false;
+            lastSeekMs = -1;
+            requestSeekLocked(0);
+            LOGI("MediaDemuxer: stream %d joined late, rewound", streamIndex);
+        }
+        // a new subscriber may need the thread to read again
+        pthread_cond_broadcast(&fillCond);
+    }
+    pthread_mutex_unlock(&mutex);
+    return 0;
+}
+
+void MediaDemuxer::unsubscribe(int streamIndex) {
+    pthread_mutex_lock(&mutex);
+    if (fmtCtx && streamIndex >= 0 && streamIndex < (int) streams.size()) {
+        StreamState& s = streams[streamIndex];
+        clearQueue(s);
+        // the last owner closes (and saves) it: a seek in flight may hold it
+        s.index.reset();
+        s.subscribed = false;
+        s.discontinuity = false;
+        s.subscribeRequested = false;
+        // AVDISCARD_ALL is set by the demux thread before its next read
+        discardDirty = true;
+        bool any = false;
+        for (const StreamState& other : streams) any = any || other.subscribed;
+        // a blocked read is for nobody now: abort it
+        noSubscribers = !any;
+        pthread_cond_broadcast(&fillCond);
+        pthread_cond_broadcast(&dataCond);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+int MediaDemuxer::readPacket(int streamIndex, AVPacket* pkt, int64_t* resumeMs) {
+    pthread_mutex_lock(&mutex);
+    if (!fmtCtx || streamIndex < 0 || streamIndex >= (int) streams.size() ||
+        !streams[streamIndex].subscribed) {
+        pthread_mutex_unlock(&mutex);
+        return AVERROR(EINVAL);
+    }
+
+    StreamState& s = streams[streamIndex];
+    bool waited = false;
+    int ret;
+    while (true) {
+        if (s.discontinuity) {
+            s.discontinuity = false;
+            if (resumeMs) *resumeMs = s.resumeMs;
+            ret = DISCONTINUITY;
+            break;
+        }
+        if (!s.packets.empty()) {
+            AVPacket* queued = s.packets.front();
+            s.packets.pop_front();
+            s.queuedBytes -= queued->size;
+            totalBytes -= queued->size;
+            av_packet_move_ref(pkt, queued);
+            av_packet_free(&queued);
+            handOut(streamIndex, pkt);
+            // room for the demux thread again
+            pthread_cond_signal(&fillCond);
+            ret = 0;
+            break;
+        }
+        if ((eof && !seekPending) || quit || !s.subscribed) {
+            ret = s.subscribed ? readError : AVERROR(EINVAL);
+            break;
+        }
+        if (waited) {
+            ret = AVERROR(EAGAIN);
+            break;
+        }
+
+        // starving: let the demux thread read past the limits for us
+        waited = true;
+        s.waits++;
+        stats.readWaits++;
+        s.waiters++;
+        pthread_cond_signal(&fillCond);
+        struct timespec deadline{};
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long) READ_WAIT_MS * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&dataCond, &mutex, &deadline);
+        s.waiters--;
+    }
+    pthread_mutex_unlock(&mutex);
+    return ret;
+}
+
+int MediaDemuxer::seek(int streamIndex, int64_t targetMs) {
+    pthread_mutex_lock(&mutex);
+    if (!fmtCtx || streamIndex < 0 || streamIndex >= (int) streams.size()) {
+        pthread_mutex_unlock(&mutex);
+        return AVERROR(EINVAL);
+    }
+
+    StreamState& s = streams[streamIndex];
+    if (targetMs == lastSeekMs && !s.readSinceSeek) {
+        // the other decoder's seek to the same target already positioned us
+        s.discontinuity = false;
+        stats.coalescedSeeks++;
+        uint64_t serial = seekRequestSerial;
+        while (seekDoneSerial < serial && !quit) {
+            pthread_cond_wait(&seekCond, &mutex);
+        }
+        int ret = lastSeekResult;
+        pthread_mutex_unlock(&mutex);
+        return ret;
+    }
+
+    for (int i = 0; i < (int) streams.size(); i++) {
+        StreamState& other = streams[i];
+        clearQueue(other);
+        if (i != streamIndex && other.subscribed) {
+            other.discontinuity = true;
+            other.resumeMs = targetMs;
+        }
+    }
+    s.discontinuity = false;
+    lastSeekMs = targetMs;
+
+    int ret = requestSeekLocked(targetMs);
+    pthread_mutex_unlock(&mutex);
+    return ret;
+}
+
+// mutex held: hand the seek to the demux thread (it may be inside
+// av_read_frame) and wait for it
+int MediaDemuxer::requestSeekLocked(int64_t targetMs) {
+    pendingSeekMs = targetMs;
+    seekPending = true;
+    uint64_t serial = ++seekRequestSerial;
+    pthread_cond_broadcast(&fillCond);
+    while (seekDoneSerial < serial && !quit) {
+        pthread_cond_wait(&seekCond, &mutex);
+    }
+    return quit ? AVERROR_EXIT : lastSeekResult;
+}
+
+// demux thread, mutex held, no av_read_frame in flight: the only place that
+// reads index entries for a new subscriber and changes the discard flags
+void MediaDemuxer::applyStreamsLocked() {
+    for (int i = 0; i < (int) streams.size(); i++) {
+        StreamState& s = streams[i];
+        if (s.subscribeRequested) {
+            s.subscribeRequested = false;
+            s.subscribed = true;
+            s.index = std::make_shared<KeyframeIndex>();
+            s.index->open(path.c_str(), fmtCtx, i, s.indexSpacing);
+            // its packets were skipped so far
+            s.joinedLate = readAny;
+        }
+        fmtCtx->streams[i]->discard = s.subscribed ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    }
+    discardDirty = false;
+}
+
+// demux thread, mutex held; released around the blocking seek itself
+int MediaDemuxer::seekLocked(int64_t targetMs) {
+    for (StreamState& s : streams) {
+        clearQueue(s);
+        s.readSinceSeek = false;
+    }
+    eof = false;
+    readError = AVERROR_EOF;
+    stats.seeks++;
+    liveEdgeMs = -1;
+
+    const int primary = primaryStream();
+    if (primary < 0) return AVERROR_STREAM_NOT_FOUND;
+
+    int64_t seekPts = av_rescale_q(targetMs, MS_TIME_BASE, fmtCtx->streams[primary]->time_base);
+    if (seekPts < 0) seekPts = 0;
+
+    // readers, subscribers and stats must not wait on a slow source; the
+    // queues stay empty because only this thread fills them
+    std::shared_ptr<KeyframeIndex> index = streams[primary].index;
+    pthread_mutex_unlock(&mutex);
+
+    int ret = -1;
+    beginIo(SEEK_TIMEOUT_MS);
+    if (index) {
+        ret = index->seek(seekPts);
+    }
+    if (ret < 0 && !quit) {
+        ret = av_seek_frame(fmtCtx, primary, seekPts, AVSEEK_FLAG_BACKWARD);
+    }
+    const bool timedOut = endIo();
+    index.reset();
+
+    pthread_mutex_lock(&mutex);
+    if (timedOut) {
+        stats.ioTimeouts++;
+        LOGE("MediaDemuxer: seek to %lld ms timed out", (long long) targetMs);
+        ret = AVERROR(ETIMEDOUT);
+    }
+    return ret;
+}
+
+// any thread, no lock: called by FFmpeg from inside blocking I/O
+int MediaDemuxer::interruptCallback(void* opaque) {
+    auto* self = static_cast<MediaDemuxer*>(opaque);
+    // a subscriber cuts reads only: the seek in flight may be its rewind
+    if (self->quit || self->seekPending || self->noSubscribers ||
+        (self->streamsPending && self->reading)) {
+        return 1;
+    }
+    const int64_t deadline = self->ioDeadlineUs;
+    if (deadline > 0 && av_gettime_relative() > deadline) {
+        self->ioTimedOut = true;
+        return 1;
+    }
+    return 0;
+}
+
+void MediaDemuxer::beginIo(int64_t timeoutMs) {
+    ioTimedOut = false;
+    ioDeadlineUs = av_gettime_relative() + timeoutMs * 1000;
+}
+
+bool MediaDemuxer::endIo() {
+    ioDeadlineUs = 0;
+    return ioTimedOut.exchange(false);
+}
+
+// video when subscribed (seeks must land on its keyframes), else any subscriber
+int MediaDemuxer::primaryStream() const {
+    int fallback = -1;
+    for (int i = 0; i < (int) streams.size(); i++) {
+        if (!streams[i].subscribed) continue;
+        if (fmtCtx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) return i;
+        if (fallback < 0) fallback = i;
+    }
+    return fallback;
+}
+
+// enough buffered: maxBytes in total, or maxDurationMs in every subscribed
+// stream (not for live sources). A starving reader overrides both.
+bool MediaDemuxer::queuesFull() const {
+    bool anySubscribed = false;
+    bool allLongEnough = true;
+    for (int i = 0; i < (int) streams.size(); i++) {
+        const StreamState& s = streams[i];
+        if (!s.subscribed) continue;
+        anySubscribed = true;
+        if (s.waiters > 0 && s.packets.empty()) return false;
+        if (queuedDurationMs(i) < maxDurationMs) allLongEnough = false;
+    }
+    if (!anySubscribed) return true;
+    return totalBytes >= maxBytes || (allLongEnough && !live);
+}
+
+int64_t MediaDemuxer::queuedDurationMs(int streamIndex) const {
+    const StreamState& s = streams[streamIndex];
+    if (s.packets.empty()) return 0;
+    const AVPacket* first = s.packets.front();
+    const AVPacket* last = s.packets.back();
+    if (first->pts == AV_NOPTS_VALUE || last->pts == AV_NOPTS_VALUE) return 0;
+    AVRational tb = fmtCtx->streams[streamIndex]->time_base;
+    return av_rescale_q(last->pts + last->duration - first->pts, tb, MS_TIME_BASE);
+}
+
+void MediaDemuxer::clearQueue(StreamState& s) {
+    for (AVPacket* queued : s.packets) {
+        totalBytes -= queued->size;
+        av_packet_free(&queued);
+    }
+    s.packets.clear();
+    s.queuedBytes = 0;
+    s.skipToKeyframe = false;
+}
+
+void MediaDemuxer::skipToLiveEdgeLocked(int primary) {
+    StreamState& p = streams[primary];
+    // newest keyframe; the front one means there is nothing to skip to yet
+    size_t key = p.packets.size();
+    while (key > 1 && !(p.packets[key - 1]->flags & AV_PKT_FLAG_KEY)) key--;
+    if (key <= 1 || p.packets[key - 1]->pts == AV_NOPTS_VALUE) return;
+    key--;
+
+    const AVPacket* keyPkt = p.packets[key];
+    const AVPacket* front = p.packets.front();
+    const AVRational ptb = fmtCtx->streams[primary]->time_base;
+    const int64_t cutMs = av_rescale_q(keyPkt->pts, ptb, MS_TIME_BASE);
+    const int64_t skippedMs = front->pts != AV_NOPTS_VALUE
+                              ? cutMs - av_rescale_q(front->pts, ptb, MS_TIME_BASE) : 0;
+
+    for (int i = 0; i < (int) streams.size(); i++) {
+        StreamState& s = streams[i];
+        if (!s.subscribed) continue;
+        const AVRational tb = fmtCtx->streams[i]->time_base;
+        while (!s.packets.empty()) {
+            AVPacket* oldest = s.packets.front();
+            if (i == primary ? oldest == keyPkt
+                             : (oldest->pts != AV_NOPTS_VALUE &&
+                                av_rescale_q(oldest->pts, tb, MS_TIME_BASE) >= cutMs)) {
+                break;
+            }
+            s.packets.pop_front();
+            s.queuedBytes -= oldest->size;
+            totalBytes -= oldest->size;
+            av_packet_free(&oldest);
+        }
+        // decoders flush and resume from the keyframe
+        s.discontinuity = true;
+        s.resumeMs = cutMs;
+    }
+    stats.liveSkips++;
+    stats.liveSkippedMs += skippedMs;
+    LOGI("MediaDemuxer: live backlog, skipped %lld ms to the keyframe at %lld ms",
+         (long long) skippedMs, (long long) cutMs);
+}
+
+void MediaDemuxer::handOut(int streamIndex, AVPacket* pkt) {
+    StreamState& s = streams[streamIndex];
+    s.readSinceSeek = true;
+    if (pkt->pts != AV_NOPTS_VALUE) {
+        AVRational tb = fmtCtx->streams[streamIndex]->time_base;
+        s.lastEndMs = av_rescale_q(pkt->pts + MAX(pkt->duration, (int64_t) 0), tb, MS_TIME_BASE);
+    }
+}
+
+void MediaDemuxer::enqueue(int streamIndex, AVPacket* pkt) {
+    StreamState& s = streams[streamIndex];
+    if (s.skipToKeyframe) {
+        if (!(pkt->flags & AV_PKT_FLAG_KEY)) {
+            av_packet_unref(pkt);
+            return;
+        }
+        s.skipToKeyframe = false;
+    }
+    AVPacket* queued = av_packet_alloc();
+    if (!queued) {
+        av_packet_unref(pkt);
+        return;
+    }
+    av_packet_move_ref(queued, pkt);
+    s.packets.push_back(queued);
+    s.queuedBytes += queued->size;
+    totalBytes += queued->size;
+
+    // that decoder stopped pulling (e.g. its thread is gone) while the other
+    // one keeps the thread reading: don't buffer the whole file for it
+    if (s.queuedBytes <= STALLED_STREAM_BYTES) return;
+    // drop the oldest packets, then on to the next keyframe: the decoder must
+    // not resume in the middle of a GOP
+    int dropped = 0;
+    while (!s.packets.empty() &&
+           (s.queuedBytes > STALLED_STREAM_BYTES || !(s.packets.front()->flags & AV_PKT_FLAG_KEY))) {
+        AVPacket* oldest = s.packets.front();
+        s.packets.pop_front();
+        s.queuedBytes -= oldest->size;
+        totalBytes -= oldest->size;
+        av_packet_free(&oldest);
+        dropped++;
+    }
+    // no keyframe left: keep dropping until the source delivers one
+    if (s.packets.empty()) s.skipToKeyframe = true;
+    if (!s.discontinuity) {
+        // flush the codec, nothing to discard
+        s.discontinuity = true;
+        s.resumeMs = -1;
+    }
+    LOGI("MediaDemuxer: stream %d stalled, dropped %d packets", streamIndex, dropped);
+}
+
+void MediaDemuxer::setQueueLimits(int64_t bytes, int64_t durationMs) {
+    pthread_mutex_lock(&mutex);
+    if (bytes > 0) maxBytes = bytes;
+    if (durationMs > 0) maxDurationMs = durationMs;
+    pthread_cond_broadcast(&fillCond);
+    pthread_mutex_unlock(&mutex);
+}
+
+MediaDemuxerStats MediaDemuxer::getStats() {
+    pthread_mutex_lock(&mutex);
+    MediaDemuxerStats copy = stats;
+    copy.queuedBytes = totalBytes;
+    copy.maxBytes = maxBytes;
+    copy.maxDurationMs = maxDurationMs;
+    pthread_mutex_unlock(&mutex);
+    return copy;
+}
+
+MediaIoStats MediaDemuxer::getIoStats() const {
+    return source ? source->getStats() : MediaIoStats();
+}
+
+MediaDemuxerQueueStats MediaDemuxer::getQueueStats(int streamIndex) {
+    MediaDemuxerQueueStats copy;
+    pthread_mutex_lock(&mutex);
+    if (streamIndex >= 0 && streamIndex < (int) streams.size()) {
+        const StreamState& s = streams[streamIndex];
+        copy.packets = (int) s.packets.size();
+        copy.bytes = s.queuedBytes;
+        copy.durationMs = queuedDurationMs(streamIndex);
+        copy.waits = s.waits;
+    }
+    pthread_mutex_unlock(&mutex);
+    return copy;
+}
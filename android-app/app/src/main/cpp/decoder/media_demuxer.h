@@ -0,0 +1,256 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "keyframe_index.h"
+#include "media_source.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+struct MediaDemuxerStats {
+    uint64_t packetsRead = 0;     // av_read_frame() calls that returned a packet
+    uint64_t seeks = 0;           // repositions of the shared context
+    uint64_t coalescedSeeks = 0;  // seeks answered by the previous reposition
+    uint64_t readWaits = 0;       // readPacket() found its queue empty and waited
+    uint64_t ioInterrupts = 0;    // blocking reads abandoned for a seek / close
+    uint64_t ioTimeouts = 0;      // open / read / seek that hit its deadline
+    uint64_t liveSkips = 0;       // live: backlog dropped up to the newest keyframe
+    int64_t  liveSkippedMs = 0;   // live: content dropped by those skips
+    int64_t  queuedBytes = 0;     // all stream queues
+    int64_t  maxBytes = 0;
+    int64_t  maxDurationMs = 0;
+};
+
+struct MediaDemuxerQueueStats {
+    int      packets = 0;
+    int64_t  bytes = 0;
+    int64_t  durationMs = 0;      // pts span of the queued packets
+    uint64_t waits = 0;           // times this stream's decoder had to wait
+};
+
+/**
+ * One AVFormatContext per media source, shared by its audio and video decoders.
+ *
+ * A demux thread runs av_read_frame() and routes packets by stream index into
+ * per-stream queues; decoders subscribe to their stream and only pull from its
+ * queue with readPacket(). The thread keeps reading until the queues hold
+ * maxBytes in total or every subscribed stream holds maxDurationMs, so an I/O
+ * stall is absorbed by what is buffered instead of stalling the decoders (and
+ * a slow decoder never stalls I/O). A decoder waiting on an empty queue lets
+ * the thread read past the limits. Streams nobody subscribed to are
+ * AVDISCARD_ALL, so the demuxer skips them.
+ *
+ * Seeks are executed by the demux thread and reposition the shared context
+ * for everyone, keyframe-aligned on the video stream when there is one
+ * (keyframe index first, av_seek_frame otherwise). The other subscribers get
+ * a DISCONTINUITY from their next readPacket(): flush the codec and drop
+ * output before resumeMs. A/V playback seeks both decoders to the same
+ * target; the second seek is answered by the first one as long as that
+ * stream has not read since.
+ *
+ * Subscribing and unsubscribing are applied by the demux thread between two
+ * reads, like seeks, since av_read_frame() keeps changing the context (index
+ * entries) while it runs. A stream subscribing after the thread started
+ * reading rewinds the source to the start; the existing subscribers resume
+ * where they were.
+ *
+ * All blocking I/O runs under an AVIOInterruptCB: a pending seek, subscribe,
+ * close or the last decoder unsubscribing (its controller stopped) aborts the
+ * read in progress, and open / read / seek each give up after their own deadline
+ * (AVERROR(ETIMEDOUT)), so neither a seek nor tearing a decoder down waits on
+ * a stalled source for longer than that.
+ *
+ * Live sources (MediaIoOptions::live) are opened with AVFMT_FLAG_NOBUFFER and
+ * small probing limits, and read regardless of the duration limit: a live
+ * server must never see back-pressure, what arrives is queued (maxBytes still
+ * applies). When the primary queue spans more than liveMaxBacklogMs, the
+ * queues are cut at the newest video keyframe and every subscriber gets a
+ * DISCONTINUITY, as for a seek. getLiveEdgeMs() is the newest media time read.
+ */
+class MediaDemuxer {
+public:
+    // readPacket(): the source was repositioned, see resumeMs
+    static const int DISCONTINUITY = 1;
+
+    static constexpr int64_t DEFAULT_MAX_BYTES = 8 * 1024 * 1024;
+    static constexpr int64_t DEFAULT_MAX_DURATION_MS = 3000;
+    // one stream's queue beyond this is a decoder that stopped pulling: its
+    // oldest packets are dropped up to a keyframe (with a DISCONTINUITY)
+    // instead of buffering the whole file
+    static constexpr int64_t STALLED_STREAM_BYTES = 32 * 1024 * 1024;
+    // readPacket() gives up with AVERROR(EAGAIN) after waiting this long, so
+    // decode loops can still react to stop / seek
+    static constexpr int READ_WAIT_MS = 100;
+    // per-operation I/O deadlines; a read that stalls this long ends the stream
+    static constexpr int64_t OPEN_TIMEOUT_MS = 15000;
+    static constexpr int64_t READ_TIMEOUT_MS = 10000;
+    static constexpr int64_t SEEK_TIMEOUT_MS = 5000;
+    // live probing: the FLV header and sequence headers come first
+    static constexpr int64_t LIVE_PROBE_SIZE = 64 * 1024;
+    static constexpr int64_t LIVE_ANALYZE_US = 500 * 1000;
+
+    /**
+     * shared = true: the instance already open for `path`, if any, else a new
+     * one registered for it. shared = false: a private instance (thumbnails,
+     * probing) that never moves anybody else's read position.
+     * io selects how bytes are read; a shared instance keeps the mode it was
+     * opened with. For MEDIA_IO_MEMORY `path` only names the source.
+     * err receives the avformat error on failure.
+     */
+    static std::shared_ptr<MediaDemuxer> acquire(const char* path, bool shared, int* err,
+                                                 const MediaIoOptions& io = MediaIoOptions());
+
+    MediaDemuxer();
+    ~MediaDemuxer();
+
+    // streams and metadata; av_read_frame / seeks must go through this class
+    AVFormatContext* context() const { return fmtCtx; }
+    // streams came from ProbeCache, avformat_find_stream_info() was skipped
+    bool probeCached() const { return probeSkipped; }
+    // opened with MediaIoOptions::live
+    bool isLive() const { return live; }
+    // end of the newest packet read from the source, ms; -1 before the first
+    int64_t getLiveEdgeMs() const { return liveEdgeMs; }
+
+    // start routing packets of `streamIndex`; indexSpacing as KeyframeIndex::open
+    int subscribe(int streamIndex, int64_t indexSpacing = 0);
+    void unsubscribe(int streamIndex);
+
+    /**
+     * Next packet of `streamIndex` into pkt (must be empty).
+     * return: 0 packet, DISCONTINUITY (*resumeMs set, pkt untouched),
+     *         AVERROR(EAGAIN) nothing buffered yet, AVERROR_EOF, <0 on error
+     */
+    int readPacket(int streamIndex, AVPacket* pkt, int64_t* resumeMs);
+
+    /**
+     * Reposition for `streamIndex` at or before targetMs. Blocks until the
+     * demux thread has done it.
+     * return: >=0 on success, <0 when neither the index nor av_seek_frame could
+     */
+    int seek(int streamIndex, int64_t targetMs);
+
+    // read-ahead limits, <=0 keeps the current value
+    void setQueueLimits(int64_t maxBytes, int64_t maxDurationMs);
+
+    MediaDemuxerStats getStats();
+    // custom AVIO counters, mode MEDIA_IO_DEFAULT when FFmpeg reads the path itself
+    MediaIoStats getIoStats() const;
+    MediaDemuxerQueueStats getQueueStats(int streamIndex);
+
+private:
+    struct StreamState {
+        bool subscribed = false;
+        bool subscribeRequested = false;  // subscribe() waits for the demux thread to apply it
+        int64_t indexSpacing = 0;
+        bool joinedLate = false;          // packets were read before it was applied: rewind
+        std::deque<AVPacket*> packets;
+        int64_t queuedBytes = 0;
+        bool discontinuity = false;
+        int64_t resumeMs = -1;
+        bool skipToKeyframe = false;  // stalled queue was cut: drop packets up to the next keyframe
+        bool readSinceSeek = false;
+        int64_t lastEndMs = -1;   // end of the last packet handed out
+        int waiters = 0;          // readers blocked on the empty queue
+        uint64_t waits = 0;
+        std::shared_ptr<KeyframeIndex> index;   // also held by a seek in flight
+    };
+
+    // a shared open in progress; acquire() of the same path waits for it
+    struct PendingOpen {
+        bool done = false;
+        int result = 0;
+        std::shared_ptr<MediaDemuxer> demuxer;
+    };
+
+    int open(const char* path, const MediaIoOptions& io);
+    void close();
+
+    static void* demuxThreadEntry(void* arg);
+    static int interruptCallback(void* opaque);
+    // arm / disarm the deadline of one blocking call; endIo(): it expired
+    void beginIo(int64_t timeoutMs);
+    bool endIo();
+    void demuxLoop();
+
+    // mutex held
+    int  requestSeekLocked(int64_t targetMs);
+    void applyStreamsLocked();          // demux thread only
+    int  seekLocked(int64_t targetMs);   // releases it around the I/O
+    int  primaryStream() const;
+    bool queuesFull() const;
+    int64_t queuedDurationMs(int streamIndex) const;
+    void clearQueue(StreamState& s);
+    // live: drop the backlog up to the newest keyframe of `primary`
+    void skipToLiveEdgeLocked(int primary);
+    void handOut(int streamIndex, AVPacket* pkt);
+    void enqueue(int streamIndex, AVPacket* pkt);
+
+private:
+    static pthread_mutex_t registryMutex;
+    static pthread_cond_t registryCond;      // an entry of `opening` is done
+    static std::map<std::string, std::weak_ptr<MediaDemuxer>> registry;
+    static std::map<std::string, std::shared_ptr<PendingOpen>> opening;
+
+    pthread_mutex_t mutex{};
+    pthread_cond_t  fillCond{};   // demux thread: space freed / request posted / quit
+    pthread_cond_t  dataCond{};   // readers: packet queued / eof / discontinuity
+    pthread_cond_t  seekCond{};   // seek and subscribe callers: request done
+
+    AVFormatContext* fmtCtx = nullptr;
+    std::unique_ptr<MediaSource> source;   // custom AVIO, outlives fmtCtx
+    bool probeSkipped = false;
+    AVPacket* readPkt = nullptr;
+    std::string path;
+    bool shared = false;
+    std::vector<StreamState> streams;
+
+    pthread_t demuxThread{};
+    bool threadStarted = false;
+    // also read lock-free by interruptCallback()
+    std::atomic<bool> quit{false};
+    std::atomic<bool> noSubscribers{false};   // every stream was unsubscribed again
+
+    bool eof = false;
+    int  readError = AVERROR_EOF;  // returned to readers once their queue is drained at eof
+    bool readAny = false;          // packets read from the source since open / the last rewind
+    int64_t lastSeekMs = -1;
+    int lastSeekResult = 0;
+
+    // seek requests, executed by the demux thread
+    std::atomic<bool> seekPending{false};
+    int64_t  pendingSeekMs = 0;
+    uint64_t seekRequestSerial = 0;
+    uint64_t seekDoneSerial = 0;
+
+    // subscription changes, applied by the demux thread between reads
+    std::atomic<bool> streamsPending{false};   // a subscribe() waits
+    std::atomic<bool> reading{false};          // av_read_frame() in flight
+    bool     discardDirty = false;             // an unsubscribe() does not
+    uint64_t streamsRequestSerial = 0;
+    uint64_t streamsDoneSerial = 0;
+
+    std::atomic<int64_t> ioDeadlineUs{0};   // 0: no blocking call armed
+    std::atomic<bool>    ioTimedOut{false};
+
+    bool live = false;
+    int64_t liveMaxBacklogMs = 0;
+    std::atomic<int64_t> liveEdgeMs{-1};
+
+    int64_t maxBytes = DEFAULT_MAX_BYTES;
+    int64_t maxDurationMs = DEFAULT_MAX_DURATION_MS;
+    int64_t totalBytes = 0;
+    MediaDemuxerStats stats;
+};
@@ -0,0 +1,307 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include "media_source.h"
+#include "media_cache.h"
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+extern "C" {
+#include <libavutil/error.h>
+#include <libavutil/mem.h>
+}
+
+#define LOG_TAG "MediaSource"
+#include "CommonTools.h"
+
+static int openReadOnly(const char* path, int64_t* size) {
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return AVERROR(errno);
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+        int err = AVERROR(errno);
+        ::close(fd);
+        return err;
+    }
+    *size = st.st_size;
+    return fd;
+}
+
+/**
+ * Whole file mapped read-only. The kernel is told the access is sequential,
+ * and the next window is prefetched with MADV_WILLNEED once reading crosses
+ * the middle of the current one, so page faults are mostly served from the
+ * page cache. A seek restarts the window at the new position.
+ */
+class MmapSource : public MediaSource {
+public:
+    MmapSource() : MediaSource(MEDIA_IO_MMAP) {}
+
+    ~MmapSource() override {
+        if (base) munmap((void*) base, (size_t) length);
+    }
+
+    int open(const char* path, int windowBytes) {
+        int64_t fileSize = 0;
+        int fd = openReadOnly(path, &fileSize);
+        if (fd < 0) return fd;
+        if (fileSize <= 0 || (uint64_t) fileSize > SIZE_MAX) {
+            ::close(fd);
+            return AVERROR(EINVAL);
+        }
+        void* mapped = mmap(nullptr, (size_t) fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        // the mapping keeps the file referenced
+        ::close(fd);
+        if (mapped == MAP_FAILED) return AVERROR(errno);
+
+        base = (const uint8_t*) mapped;
+        length = fileSize;
+        const int64_t page = sysconf(_SC_PAGESIZE);
+        window = MAX(page, (int64_t) windowBytes & ~(page - 1));
+        pageMask = page - 1;
+        madvise((void*) base, (size_t) length, MADV_SEQUENTIAL);
+        syscalls++;
+        return 0;
+    }
+
+protected:
+    int read(uint8_t* buf, int size) override {
+        if (cursor >= length) return 0;
+        const int n = (int) MIN((int64_t) size, length - cursor);
+        if (cursor + n > advisedEnd - window / 2 && advisedEnd < length) {
+            // page aligned start, the window never runs past the mapping
+            int64_t start = MAX(advisedEnd, cursor) & ~pageMask;
+            int64_t len = MIN(window, length - start);
+            madvise((void*) (base + start), (size_t) len, MADV_WILLNEED);
+            syscalls++;
+            advisedEnd = start + len;
+        }
+        memcpy(buf, base + cursor, (size_t) n);
+        cursor += n;
+        return n;
+    }
+
+    int64_t seekTo(int64_t offset) override {
+        if (offset < 0 || offset > length) return AVERROR(EINVAL);
+        if (offset < advisedEnd - window || offset > advisedEnd) {
+            // jumped out of the prefetched range
+            advisedEnd = offset;
+        }
+        cursor = offset;
+        return cursor;
+    }
+
+    int64_t position() const override { return cursor; }
+    int64_t size() const override { return length; }
+
+private:
+    const uint8_t* base = nullptr;
+    int64_t length = 0;
+    int64_t cursor = 0;
+    int64_t window = DEFAULT_MMAP_WINDOW;
+    int64_t pageMask = 4095;
+    int64_t advisedEnd = 0;
+};
+
+/**
+ * Caller-owned bytes. AVIO runs in direct mode, so packet payloads are
+ * copied once, from the caller's memory into the packet; only the small
+ * header reads go through AVIO's buffer. Its buffer cannot simply alias the
+ * caller's memory: FFmpeg refills, reallocates and frees that buffer.
+ */
+class MemorySource : public MediaSource {
+public:
+    MemorySource(const uint8_t* data, int64_t length, std::shared_ptr<void> owner)
+            : MediaSource(MEDIA_IO_MEMORY), data(data), length(length), owner(std::move(owner)) {}
+
+protected:
+    int read(uint8_t* buf, int size) override {
+        if (cursor >= length) return 0;
+        const int n = (int) MIN((int64_t) size, length - cursor);
+        memcpy(buf, data + cursor, (size_t) n);
+        cursor += n;
+        return n;
+    }
+
+    int64_t seekTo(int64_t offset) override {
+        if (offset < 0 || offset > length) return AVERROR(EINVAL);
+        cursor = offset;
+        return cursor;
+    }
+
+    int64_t position() const override { return cursor; }
+    int64_t size() const override { return length; }
+    bool directReads() const override { return true; }
+
+private:
+    const uint8_t* data;
+    const int64_t length;
+    std::shared_ptr<void> owner;
+    int64_t cursor = 0;
+};
+
+/**
+ * pread() of blockSize bytes at a time into a private buffer: slow storage
+ * (SD cards, FUSE) sees a few large requests instead of one per AVIO refill.
+ * Seeks inside the current block cost nothing.
+ */
+class ReadAheadSource : public MediaSource {
+public:
+    ReadAheadSource() : MediaSource(MEDIA_IO_READ_AHEAD) {}
+
+    ~ReadAheadSource() override {
+        if (fd >= 0) ::close(fd);
+    }
+
+    int open(const char* path, int blockBytes) {
+        fd = openReadOnly(path, &length);
+        if (fd < 0) return fd;
+        block.resize((size_t) blockBytes);
+        return 0;
+    }
+
+protected:
+    int read(uint8_t* buf, int size) override {
+        if (cursor >= length) return 0;
+        if (cursor < blockStart || cursor >= blockStart + blockLength) {
+            ssize_t got;
+            do {
+                got = pread(fd, block.data(), block.size(), (off_t) cursor);
+                syscalls++;
+            } while (got < 0 && errno == EINTR);
+            if (got < 0) return AVERROR(errno);
+            if (got == 0) return 0;
+            blockStart = cursor;
+            blockLength = got;
+        }
+        const int n = (int) MIN((int64_t) size, blockStart + blockLength - cursor);
+        memcpy(buf, block.data() + (cursor - blockStart), (size_t) n);
+        cursor += n;
+        return n;
+    }
+
+    int64_t seekTo(int64_t offset) override {
+        if (offset < 0 || offset > length) return AVERROR(EINVAL);
+        cursor = offset;
+        return cursor;
+    }
+
+    int64_t position() const override { return cursor; }
+    int64_t size() const override { return length; }
+
+private:
+    int fd = -1;
+    int64_t length = 0;
+    int64_t cursor = 0;
+    std::vector<uint8_t> block;
+    int64_t blockStart = 0;
+    int64_t blockLength = 0;
+};
+
+std::unique_ptr<MediaSource> MediaSource::create(const char* path, const MediaIoOptions& options, int* err) {
+    if (err) *err = 0;
+    switch (options.mode) {
+        case MEDIA_IO_MMAP: {
+            std::unique_ptr<MmapSource> source(new MmapSource());
+            int ret = source->open(path, options.blockSize > 0 ? options.blockSize : DEFAULT_MMAP_WINDOW);
+            if (ret == 0) return source;
+            // e.g. larger than a 32-bit address space: large-block reads instead
+            LOGE("MediaSource: mmap %s failed %d, using read-ahead", path, ret);
+            MediaIoOptions fallback = options;
+            fallback.mode = MEDIA_IO_READ_AHEAD;
+            fallback.blockSize = 0;
+            return create(path, fallback, err);
+        }
+        case MEDIA_IO_MEMORY:
+            if (!options.data || options.size <= 0) {
+                if (err) *err = AVERROR(EINVAL);
+                return nullptr;
+            }
+            return std::unique_ptr<MediaSource>(new MemorySource(options.data, options.size, options.owner));
+        case MEDIA_IO_READ_AHEAD: {
+            std::unique_ptr<ReadAheadSource> source(new ReadAheadSource());
+            int ret = source->open(path, options.blockSize > 0 ? options.blockSize : DEFAULT_READ_AHEAD_BLOCK);
+            if (ret < 0) {
+                if (err) *err = ret;
+                return nullptr;
+            }
+            return source;
+        }
+        case MEDIA_IO_CACHE:
+            return MediaCache::open(path, options, err);
+        default:
+            return nullptr;
+    }
+}
+
+MediaSource::~MediaSource() {
+    if (ioCtx) {
+        // libavformat may have replaced the buffer we allocated
+        av_freep(&ioCtx->buffer);
+        avio_context_free(&ioCtx);
+    }
+}
+
+AVIOContext* MediaSource::avio() {
+    if (!ioCtx) {
+        auto* buffer = (unsigned char*) av_malloc(AVIO_BUFFER_SIZE);
+        if (!buffer) return nullptr;
+        ioCtx = avio_alloc_context(buffer, AVIO_BUFFER_SIZE, 0, this,
+                                   &MediaSource::readPacket, nullptr, &MediaSource::seekPacket);
+        if (!ioCtx) {
+            av_free(buffer);
+            return nullptr;
+        }
+        ioCtx->direct = directReads() ? 1 : 0;
+    }
+    return ioCtx;
+}
+
+MediaIoStats MediaSource::getStats() const {
+    MediaIoStats stats;
+    stats.mode = mode;
+    stats.size = size();
+    stats.bytesRead = bytesRead;
+    stats.readCalls = readCalls;
+    stats.syscalls = syscalls;
+    stats.seeks = seeks;
+    stats.cachedBytes = cachedBytes();
+    stats.cacheHitBytes = cacheHitBytes;
+    stats.downloadedBytes = downloadedBytes;
+    return stats;
+}
+
+int MediaSource::readPacket(void* opaque, uint8_t* buf, int size) {
+    auto* self = static_cast<MediaSource*>(opaque);
+    self->readCalls++;
+    int n = self->read(buf, size);
+    if (n == 0) return AVERROR_EOF;
+    if (n > 0) self->bytesRead += n;
+    return n;
+}
+
+int64_t MediaSource::seekPacket(void* opaque, int64_t offset, int whence) {
+    auto* self = static_cast<MediaSource*>(opaque);
+    switch (whence & ~AVSEEK_FORCE) {
+        case AVSEEK_SIZE:
+            return self->size();
+        case SEEK_SET:
+            break;
+        case SEEK_CUR:
+            offset += self->position();
+            break;
+        case SEEK_END:
+            offset += self->size();
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+    self->seeks++;
+    return self->seekTo(offset);
+}
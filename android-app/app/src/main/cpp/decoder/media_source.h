@@ -0,0 +1,114 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+extern "C" {
+#include <libavformat/avio.h>
+}
+
+// how MediaDemuxer reads its bytes
+enum MediaIoMode {
+    MEDIA_IO_DEFAULT    = 0,   // FFmpeg's own protocols (file, http...)
+    MEDIA_IO_MMAP       = 1,   // local file mapped read-only, madvise read-ahead
+    MEDIA_IO_MEMORY     = 2,   // bytes already in RAM, copied straight into packets
+    MEDIA_IO_READ_AHEAD = 3,   // local file read in large blocks (slow storage)
+    MEDIA_IO_CACHE      = 4,   // http(s) through the persistent disk cache, see MediaCache
+};
+
+struct MediaIoOptions {
+    int mode = MEDIA_IO_DEFAULT;
+    // MMAP: madvise window, READ_AHEAD: block size; <=0 uses the default
+    int blockSize = 0;
+    // MEDIA_IO_MEMORY: kept alive by `owner` for as long as the source exists
+    const uint8_t* data = nullptr;
+    int64_t size = 0;
+    std::shared_ptr<void> owner;
+    // avformat probing limits (bytes / microseconds), <=0 keeps FFmpeg's
+    // defaults; fast start lowers them
+    int64_t probeSize = 0;
+    int64_t analyzeDurationUs = 0;
+    // live network stream (HTTP-FLV...), see MediaDemuxer: no avformat
+    // buffering, minimal probing, packets read as soon as they arrive.
+    // liveMaxBacklogMs > 0: skip to the newest keyframe once the queued
+    // packets span more than this
+    bool live = false;
+    int64_t liveMaxBacklogMs = 0;
+    // set by the demuxer: aborts the blocking network I/O of MEDIA_IO_CACHE
+    AVIOInterruptCB interrupt{};
+};
+
+struct MediaIoStats {
+    int      mode = MEDIA_IO_DEFAULT;
+    int64_t  size = -1;         // source size, -1 unknown
+    int64_t  bytesRead = 0;     // handed to the demuxer
+    uint64_t readCalls = 0;     // AVIO read callbacks
+    uint64_t syscalls = 0;      // read / pread / madvise issued for them
+    uint64_t seeks = 0;
+    // MEDIA_IO_CACHE: bytes of the source on disk (-1 otherwise), read
+    // without waiting for the network, and fetched by this source
+    int64_t  cachedBytes = -1;
+    uint64_t cacheHitBytes = 0;
+    uint64_t downloadedBytes = 0;
+};
+
+/**
+ * Byte source behind a custom AVIOContext, see MediaIoMode.
+ *
+ * The demuxer installs avio() as AVFormatContext::pb (AVFMT_FLAG_CUSTOM_IO);
+ * all callbacks run on the thread that drives the AVFormatContext. Stats can
+ * be read from any thread.
+ */
+class MediaSource {
+public:
+    static constexpr int DEFAULT_MMAP_WINDOW = 2 * 1024 * 1024;
+    static constexpr int DEFAULT_READ_AHEAD_BLOCK = 1024 * 1024;
+    // AVIO's own buffer: the demuxer copies out of it in these steps
+    static constexpr int AVIO_BUFFER_SIZE = 64 * 1024;
+
+    /**
+     * nullptr for MEDIA_IO_DEFAULT (use the path with avformat_open_input) or
+     * on failure, err receives the AVERROR then. MEDIA_IO_CACHE also returns
+     * nullptr with *err == 0 when the URL cannot be cached.
+     */
+    static std::unique_ptr<MediaSource> create(const char* path, const MediaIoOptions& options, int* err);
+
+    virtual ~MediaSource();
+
+    // created on first use, owned by the source
+    AVIOContext* avio();
+    MediaIoStats getStats() const;
+
+protected:
+    explicit MediaSource(int mode) : mode(mode) {}
+
+    // at most size bytes at the cursor; 0 at end, <0 AVERROR
+    virtual int read(uint8_t* buf, int size) = 0;
+    // absolute position, returns it or <0
+    virtual int64_t seekTo(int64_t offset) = 0;
+    virtual int64_t position() const = 0;
+    virtual int64_t size() const = 0;
+    virtual int64_t cachedBytes() const { return -1; }
+    // AVIOContext::direct: large reads skip AVIO's buffer, seeks always call
+    // seekTo(); only worth it when read() is a plain memcpy
+    virtual bool directReads() const { return false; }
+
+    std::atomic<uint64_t> syscalls{0};
+    std::atomic<uint64_t> cacheHitBytes{0};
+    std::atomic<uint64_t> downloadedBytes{0};
+
+private:
+    static int readPacket(void* opaque, uint8_t* buf, int size);
+    static int64_t seekPacket(void* opaque, int64_t offset, int whence);
+
+    const int mode;
+    AVIOContext* ioCtx = nullptr;
+    std::atomic<int64_t>  bytesRead{0};
+    std::atomic<uint64_t> readCalls{0};
+    std::atomic<uint64_t> seeks{0};
+};
@@ -0,0 +1,317 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include "probe_cache.h"
+#include "media_file_key.h"
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#define LOG_TAG "ProbeCache"
+#include "CommonTools.h"
+
+static const uint32_t PROBE_MAGIC = 0x42525046;   // "FPRB"
+static const uint32_t PROBE_VERSION = 1;
+// a corrupt sidecar must not make us allocate gigabytes
+static const int32_t MAX_STREAMS = 64;
+static const int32_t MAX_EXTRADATA = 1024 * 1024;
+
+struct ProbeFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    int64_t  fileSize;
+    int64_t  fileMtime;
+    int64_t  duration;
+    int64_t  startTime;
+    int64_t  bitRate;
+    int32_t  streamCount;
+    int32_t  recordSize;
+};
+
+pthread_mutex_t ProbeCache::mutex = PTHREAD_MUTEX_INITIALIZER;
+std::string ProbeCache::cacheDir;
+bool ProbeCache::enabled = true;
+uint64_t ProbeCache::useCounter = 0;
+std::map<std::string, ProbeCache::Entry> ProbeCache::entries;
+ProbeCacheStats ProbeCache::stats;
+
+void ProbeCache::setCacheDir(const char* dir) {
+    pthread_mutex_lock(&mutex);
+    cacheDir = dir ? dir : "";
+    pthread_mutex_unlock(&mutex);
+}
+
+void ProbeCache::setEnabled(bool enable) {
+    pthread_mutex_lock(&mutex);
+    enabled = enable;
+    pthread_mutex_unlock(&mutex);
+}
+
+bool ProbeCache::restore(const char* path, AVFormatContext* fmtCtx) {
+    MediaFileKey key;
+    if (!fmtCtx || !key.load(path)) return false;
+
+    pthread_mutex_lock(&mutex);
+    if (!enabled) {
+        pthread_mutex_unlock(&mutex);
+        return false;
+    }
+    Entry entry;
+    auto it = entries.find(key.path);
+    bool found = it != entries.end() && key.sameFile(it->second.fileSize, it->second.fileMtime);
+    if (found) {
+        it->second.lastUse = ++useCounter;
+        entry = it->second;
+    } else if (!cacheDir.empty() && loadSidecar(sidecarPath(cacheDir, key.path), &entry) &&
+               key.sameFile(entry.fileSize, entry.fileMtime)) {
+        found = true;
+        remember(key.path, entry);
+    }
+    if (!found) {
+        stats.misses++;
+        pthread_mutex_unlock(&mutex);
+        return false;
+    }
+
+    // the header must declare exactly the streams that were probed
+    bool fits = fmtCtx->nb_streams == entry.streams.size();
+    for (unsigned i = 0; fits && i < fmtCtx->nb_streams; i++) {
+        const AVCodecParameters* par = fmtCtx->streams[i]->codecpar;
+        const StreamRecord& rec = entry.streams[i];
+        if ((par->codec_type != AVMEDIA_TYPE_UNKNOWN && par->codec_type != rec.codecType) ||
+            (par->codec_id != AV_CODEC_ID_NONE && par->codec_id != rec.codecId)) {
+            fits = false;
+        }
+    }
+    if (!fits) {
+        stats.mismatches++;
+        pthread_mutex_unlock(&mutex);
+        return false;
+    }
+    stats.hits++;
+    pthread_mutex_unlock(&mutex);
+
+    for (unsigned i = 0; i < fmtCtx->nb_streams; i++) {
+        AVStream* st = fmtCtx->streams[i];
+        AVCodecParameters* par = st->codecpar;
+        const StreamRecord& rec = entry.streams[i];
+        const std::vector<uint8_t>& extra = entry.extradata[i];
+
+        par->codec_type = (AVMediaType) rec.codecType;
+        par->codec_id = (AVCodecID) rec.codecId;
+        par->codec_tag = rec.codecTag;
+        par->format = rec.format;
+        par->bit_rate = rec.bitRate;
+        par->profile = rec.profile;
+        par->level = rec.level;
+        par->width = rec.width;
+        par->height = rec.height;
+        par->sample_aspect_ratio = AVRational{rec.sarNum, rec.sarDen};
+        par->field_order = (AVFieldOrder) rec.fieldOrder;
+        par->color_range = (AVColorRange) rec.colorRange;
+        par->color_primaries = (AVColorPrimaries) rec.colorPrimaries;
+        par->color_trc = (AVColorTransferCharacteristic) rec.colorTrc;
+        par->color_space = (AVColorSpace) rec.colorSpace;
+        par->chroma_location = (AVChromaLocation) rec.chromaLocation;
+        par->video_delay = rec.videoDelay;
+        par->channel_layout = rec.channelLayout;
+        par->channels = rec.channels;
+        par->sample_rate = rec.sampleRate;
+        par->frame_size = rec.frameSize;
+        par->block_align = rec.blockAlign;
+        par->initial_padding = rec.initialPadding;
+        par->bits_per_coded_sample = rec.bitsPerCodedSample;
+        par->bits_per_raw_sample = rec.bitsPerRawSample;
+        if (!extra.empty() && par->extradata_size == 0) {
+            // e.g. SPS/PPS that probing pulled out of the bitstream
+            par->extradata = (uint8_t*) av_mallocz(extra.size() + AV_INPUT_BUFFER_PADDING_SIZE);
+            if (par->extradata) {
+                memcpy(par->extradata, extra.data(), extra.size());
+                par->extradata_size = (int) extra.size();
+            }
+        }
+
+        st->r_frame_rate = AVRational{rec.rFrameRateNum, rec.rFrameRateDen};
+        st->avg_frame_rate = AVRational{rec.avgFrameRateNum, rec.avgFrameRateDen};
+        if (st->start_time == AV_NOPTS_VALUE) st->start_time = rec.startTime;
+        if (st->duration == AV_NOPTS_VALUE) st->duration = rec.duration;
+        if (st->nb_frames == 0) st->nb_frames = rec.nbFrames;
+    }
+    fmtCtx->duration = entry.duration;
+    fmtCtx->start_time = entry.startTime;
+    fmtCtx->bit_rate = entry.bitRate;
+    return true;
+}
+
+void ProbeCache::store(const char* path, const AVFormatContext* fmtCtx) {
+    MediaFileKey key;
+    if (!fmtCtx || !key.load(path) || fmtCtx->nb_streams > (unsigned) MAX_STREAMS) return;
+
+    Entry entry;
+    entry.fileSize = key.size;
+    entry.fileMtime = key.mtime;
+    entry.duration = fmtCtx->duration;
+    entry.startTime = fmtCtx->start_time;
+    entry.bitRate = fmtCtx->bit_rate;
+    for (unsigned i = 0; i < fmtCtx->nb_streams; i++) {
+        const AVStream* st = fmtCtx->streams[i];
+        const AVCodecParameters* par = st->codecpar;
+        StreamRecord rec{};
+        rec.codecType = par->codec_type;
+        rec.codecId = par->codec_id;
+        rec.codecTag = par->codec_tag;
+        rec.format = par->format;
+        rec.bitRate = par->bit_rate;
+        rec.profile = par->profile;
+        rec.level = par->level;
+        rec.width = par->width;
+        rec.height = par->height;
+        rec.sarNum = par->sample_aspect_ratio.num;
+        rec.sarDen = par->sample_aspect_ratio.den;
+        rec.fieldOrder = par->field_order;
+        rec.colorRange = par->color_range;
+        rec.colorPrimaries = par->color_primaries;
+        rec.colorTrc = par->color_trc;
+        rec.colorSpace = par->color_space;
+        rec.chromaLocation = par->chroma_location;
+        rec.videoDelay = par->video_delay;
+        rec.channelLayout = par->channel_layout;
+        rec.channels = par->channels;
+        rec.sampleRate = par->sample_rate;
+        rec.frameSize = par->frame_size;
+        rec.blockAlign = par->block_align;
+        rec.initialPadding = par->initial_padding;
+        rec.bitsPerCodedSample = par->bits_per_coded_sample;
+        rec.bitsPerRawSample = par->bits_per_raw_sample;
+        rec.rFrameRateNum = st->r_frame_rate.num;
+        rec.rFrameRateDen = st->r_frame_rate.den;
+        rec.avgFrameRateNum = st->avg_frame_rate.num;
+        rec.avgFrameRateDen = st->avg_frame_rate.den;
+        rec.startTime = st->start_time;
+        rec.duration = st->duration;
+        rec.nbFrames = st->nb_frames;
+
+        std::vector<uint8_t> extra;
+        if (par->extradata && par->extradata_size > 0 && par->extradata_size <= MAX_EXTRADATA) {
+            extra.assign(par->extradata, par->extradata + par->extradata_size);
+        }
+        rec.extradataSize = (int32_t) extra.size();
+        entry.streams.push_back(rec);
+        entry.extradata.push_back(std::move(extra));
+    }
+
+    pthread_mutex_lock(&mutex);
+    if (enabled) {
+        remember(key.path, entry);
+        stats.stores++;
+        if (!cacheDir.empty()) {
+            saveSidecar(sidecarPath(cacheDir, key.path), entry);
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+void ProbeCache::invalidate(const char* path) {
+    if (!path) return;
+    pthread_mutex_lock(&mutex);
+    entries.erase(path);
+    if (!cacheDir.empty()) {
+        unlink(sidecarPath(cacheDir, path).c_str());
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+ProbeCacheStats ProbeCache::getStats() {
+    pthread_mutex_lock(&mutex);
+    ProbeCacheStats copy = stats;
+    pthread_mutex_unlock(&mutex);
+    return copy;
+}
+
+void ProbeCache::remember(const std::string& path, const Entry& entry) {
+    if (entries.find(path) == entries.end() && (int) entries.size() >= MAX_MEMORY_ENTRIES) {
+        auto oldest = entries.begin();
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->second.lastUse < oldest->second.lastUse) oldest = it;
+        }
+        entries.erase(oldest);
+    }
+    Entry& slot = entries[path];
+    slot = entry;
+    slot.lastUse = ++useCounter;
+}
+
+std::string ProbeCache::sidecarPath(const std::string& dir, const std::string& path) {
+    MediaFileKey key;
+    key.path = path;
+    char name[48];
+    snprintf(name, sizeof(name), "/%016llx.probe", (unsigned long long) key.pathHash());
+    return dir + name;
+}
+
+bool ProbeCache::loadSidecar(const std::string& file, Entry* entry) {
+    FILE* fp = fopen(file.c_str(), "rb");
+    if (!fp) return false;
+
+    ProbeFileHeader header{};
+    bool ok = fread(&header, sizeof(header), 1, fp) == 1 &&
+              header.magic == PROBE_MAGIC &&
+              header.version == PROBE_VERSION &&
+              header.recordSize == (int32_t) sizeof(StreamRecord) &&
+              header.streamCount >= 0 && header.streamCount <= MAX_STREAMS;
+    if (ok) {
+        entry->fileSize = header.fileSize;
+        entry->fileMtime = header.fileMtime;
+        entry->duration = header.duration;
+        entry->startTime = header.startTime;
+        entry->bitRate = header.bitRate;
+        entry->streams.resize((size_t) header.streamCount);
+        entry->extradata.resize((size_t) header.streamCount);
+        for (int i = 0; ok && i < header.streamCount; i++) {
+            StreamRecord& rec = entry->streams[i];
+            ok = fread(&rec, sizeof(rec), 1, fp) == 1 &&
+                 rec.extradataSize >= 0 && rec.extradataSize <= MAX_EXTRADATA;
+            if (ok && rec.extradataSize > 0) {
+                entry->extradata[i].resize((size_t) rec.extradataSize);
+                ok = fread(entry->extradata[i].data(), 1, (size_t) rec.extradataSize, fp) ==
+                     (size_t) rec.extradataSize;
+            }
+        }
+    }
+    fclose(fp);
+    if (!ok) {
+        unlink(file.c_str());
+    }
+    return ok;
+}
+
+void ProbeCache::saveSidecar(const std::string& file, const Entry& entry) {
+    ProbeFileHeader header{};
+    header.magic = PROBE_MAGIC;
+    header.version = PROBE_VERSION;
+    header.fileSize = entry.fileSize;
+    header.fileMtime = entry.fileMtime;
+    header.duration = entry.duration;
+    header.startTime = entry.startTime;
+    header.bitRate = entry.bitRate;
+    header.streamCount = (int32_t) entry.streams.size();
+    header.recordSize = (int32_t) sizeof(StreamRecord);
+
+    std::string tmp = file + ".tmp";
+    FILE* fp = fopen(tmp.c_str(), "wb");
+    if (!fp) {
+        LOGE("ProbeCache: cannot write %s", tmp.c_str());
+        return;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    for (size_t i = 0; ok && i < entry.streams.size(); i++) {
+        const std::vector<uint8_t>& extra = entry.extradata[i];
+        ok = fwrite(&entry.streams[i], sizeof(StreamRecord), 1, fp) == 1 &&
+             (extra.empty() || fwrite(extra.data(), 1, extra.size(), fp) == extra.size());
+    }
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), file.c_str()) != 0) {
+        unlink(tmp.c_str());
+    }
+}
@@ -0,0 +1,115 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+struct ProbeCacheStats {
+    uint64_t hits = 0;         // opens that skipped avformat_find_stream_info()
+    uint64_t misses = 0;       // nothing cached for the file (or it changed)
+    uint64_t mismatches = 0;   // cached layout did not fit what the header declared
+    uint64_t stores = 0;
+};
+
+/**
+ * avformat_find_stream_info() results keyed by path + size + mtime, kept in
+ * memory and as a small sidecar next to the keyframe indexes. A reopen (meta
+ * query then prepare, audio after video, the next app start) restores the
+ * stream layout and codec parameters, extradata included, right after
+ * avformat_open_input() and skips probing.
+ *
+ * Only applied when the header declares the same streams as the cached probe;
+ * containers that create streams while reading (MPEG-TS) always probe.
+ * Network and in-memory sources are never cached.
+ */
+class ProbeCache {
+public:
+    // directory for sidecar files; empty = memory only
+    static void setCacheDir(const char* dir);
+    // off: every open probes (benchmarks, debugging)
+    static void setEnabled(bool enable);
+
+    // after avformat_open_input(): true when fmtCtx was filled from the cache
+    static bool restore(const char* path, AVFormatContext* fmtCtx);
+    // after a successful avformat_find_stream_info()
+    static void store(const char* path, const AVFormatContext* fmtCtx);
+    // forget `path`, memory and disk; the next open probes again
+    static void invalidate(const char* path);
+
+    static ProbeCacheStats getStats();
+
+    // codec parameters of one stream, also the sidecar record layout
+    struct StreamRecord {
+        int32_t  codecType;
+        int32_t  codecId;
+        uint32_t codecTag;
+        int32_t  format;
+        int64_t  bitRate;
+        int32_t  profile;
+        int32_t  level;
+        int32_t  width;
+        int32_t  height;
+        int32_t  sarNum;
+        int32_t  sarDen;
+        int32_t  fieldOrder;
+        int32_t  colorRange;
+        int32_t  colorPrimaries;
+        int32_t  colorTrc;
+        int32_t  colorSpace;
+        int32_t  chromaLocation;
+        int32_t  videoDelay;
+        uint64_t channelLayout;
+        int32_t  channels;
+        int32_t  sampleRate;
+        int32_t  frameSize;
+        int32_t  blockAlign;
+        int32_t  initialPadding;
+        int32_t  bitsPerCodedSample;
+        int32_t  bitsPerRawSample;
+        int32_t  rFrameRateNum;
+        int32_t  rFrameRateDen;
+        int32_t  avgFrameRateNum;
+        int32_t  avgFrameRateDen;
+        int32_t  extradataSize;
+        int64_t  startTime;
+        int64_t  duration;
+        int64_t  nbFrames;
+    };
+
+private:
+    struct Entry {
+        int64_t fileSize = 0;
+        int64_t fileMtime = 0;
+        int64_t duration = 0;
+        int64_t startTime = 0;
+        int64_t bitRate = 0;
+        std::vector<StreamRecord> streams;
+        std::vector<std::vector<uint8_t>> extradata;
+        uint64_t lastUse = 0;
+    };
+
+    static constexpr int MAX_MEMORY_ENTRIES = 32;
+
+    // mutex held
+    static bool loadSidecar(const std::string& file, Entry* entry);
+    static void saveSidecar(const std::string& file, const Entry& entry);
+    static std::string sidecarPath(const std::string& dir, const std::string& path);
+    static void remember(const std::string& path, const Entry& entry);
+
+    static pthread_mutex_t mutex;
+    static std::string cacheDir;
+    static bool enabled;
+    static uint64_t useCounter;
+    static std::map<std::string, Entry> entries;
+    static ProbeCacheStats stats;
+};
@@ -0,0 +1,290 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include "slice_converter.h"
+#include <unistd.h>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+#include <libavutil/time.h>
+}
+
+#define LOG_TAG "SliceConverter"
+#include "CommonTools.h"
+
+struct WorkerArg {
+    SliceConverter* self;
+    int index;
+};
+
+// vertical subsampling of one plane (0 for luma, alpha and packed/RGB planes)
+static int planeVShift(const AVPixFmtDescriptor* desc, int plane) {
+    if (!desc || plane == 0 || plane == 3) return 0;
+    if (desc->flags & AV_PIX_FMT_FLAG_RGB) return 0;
+    return desc->log2_chroma_h;
+}
+
+SliceConverter::SliceConverter() {
+    pthread_mutex_init(&jobMutex, nullptr);
+    pthread_cond_init(&jobCond, nullptr);
+    pthread_cond_init(&doneCond, nullptr);
+}
+
+SliceConverter::~SliceConverter() {
+    release();
+    pthread_mutex_destroy(&jobMutex);
+    pthread_cond_destroy(&jobCond);
+    pthread_cond_destroy(&doneCond);
+}
+
+int SliceConverter::defaultThreadCount() {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int count = (int) (cores / 2);
+    if (count < 1) count = 1;
+    if (count > 4) count = 4;
+    return count;
+}
+
+void SliceConverter::setThreadCount(int count) {
+    if (count < 1) count = 1;
+    if (count > MAX_THREADS) count = MAX_THREADS;
+    if (count == threadCount && workerCount == count - 1) return;
+
+    stopWorkers();
+    threadCount = count;
+    startWorkers(count - 1);
+    LOGI("SliceConverter::setThreadCount %d", count);
+}
+
+void SliceConverter::release() {
+    stopWorkers();
+    for (Band& band : bands) {
+        if (band.ctx) {
+            sws_freeContext(band.ctx);
+            band.ctx = nullptr;
+        }
+    }
+}
+
+void SliceConverter::startWorkers(int count) {
+    pthread_mutex_lock(&jobMutex);
+    quit = false;
+    pthread_mutex_unlock(&jobMutex);
+
+    workerCount = 0;
+    for (int i = 0; i < count; i++) {
+        auto* arg = new WorkerArg{this, i + 1};   // band 0 belongs to the caller
+        if (pthread_create(&workers[i], nullptr, &SliceConverter::workerEntry, arg) != 0) {
+            LOGE("SliceConverter: pthread_create failed, running with %d workers", i);
+            delete arg;
+            break;
+        }
+        workerCount++;
+    }
+    threadCount = workerCount + 1;
+}
+
+void SliceConverter::stopWorkers() {
+    if (workerCount == 0) return;
+
+    pthread_mutex_lock(&jobMutex);
+    quit = true;
+    pthread_cond_broadcast(&jobCond);
+    pthread_mutex_unlock(&jobMutex);
+
+    for (int i = 0; i < workerCount; i++) {
+        pthread_join(workers[i], nullptr);
+    }
+    workerCount = 0;
+}
+
+void* SliceConverter::workerEntry(void* arg) {
+    auto* workerArg = static_cast<WorkerArg*>(arg);
+    SliceConverter* self = workerArg->self;
+    int index = workerArg->index;
+    delete workerArg;
+    self->workerLoop(index);
+    return nullptr;
+}
+
+void SliceConverter::workerLoop(int index) {
+    uint64_t seenGeneration = 0;
+    pthread_mutex_lock(&jobMutex);
+    seenGeneration = jobGeneration;
+
+    while (true) {
+        while (!quit && jobGeneration == seenGeneration) {
+            pthread_cond_wait(&jobCond, &jobMutex);
+        }
+        if (quit) break;
+        seenGeneration = jobGeneration;
+        bool hasBand = index < activeBands;
+        pthread_mutex_unlock(&jobMutex);
+
+        if (hasBand) {
+            runBand(index);
+        }
+
+        pthread_mutex_lock(&jobMutex);
+        if (hasBand && --pending == 0) {
+            pthread_cond_signal(&doneCond);
+        }
+    }
+    pthread_mutex_unlock(&jobMutex);
+}
+
+void SliceConverter::runBand(int index) {
+    Band& band = bands[index];
+    if (transformSrc) {
+        band.result = FrameTransform::convertRows(transformSrc, plan, band.y0, band.height,
+                                                  dstFormat, band.dst, band.dstStride,
+                                                  coeffs, band.scratch.data());
+        return;
+    }
+    if (useNative) {
+        band.result = YuvConvert::convertRows(band.src, band.srcStride, srcFormat,
+                                              band.dst[0], band.dstStride[0], dstFormat,
+                                              width, band.height, coeffs);
+        return;
+    }
+    band.ctx = sws_getCachedContext(
+            band.ctx,
+            width, band.height, srcFormat,
+            width, band.height, dstFormat,
+            flags, nullptr, nullptr, nullptr);
+    if (!band.ctx) {
+        band.result = -1;
+        return;
+    }
+    sws_scale(band.ctx, band.src, band.srcStride, 0, band.height, band.dst, band.dstStride);
+    band.result = 0;
+}
+
+int SliceConverter::convert(const AVFrame* src, int w, int h,
+                            AVPixelFormat dstFmt, uint8_t* const dstData[4], const int dstLinesize[4],
+                            int swsFlags) {
+    if (!src || !src->data[0] || w <= 0 || h <= 0) return -1;
+
+    int64_t startUs = av_gettime_relative();
+
+    width = w;
+    transformSrc = nullptr;
+    srcFormat = static_cast<AVPixelFormat>(src->format);
+    dstFormat = dstFmt;
+    flags = swsFlags;
+    useNative = YuvConvert::supports(srcFormat, dstFormat);
+    if (useNative) {
+        coeffs = YuvConvert::coeffsFor(src);
+    }
+
+    const AVPixFmtDescriptor* srcDesc = av_pix_fmt_desc_get(srcFormat);
+    const AVPixFmtDescriptor* dstDesc = av_pix_fmt_desc_get(dstFormat);
+    if (!srcDesc || !dstDesc) return -1;
+
+    // bands must start on a chroma row of both formats
+    int shift = MAX(srcDesc->log2_chroma_h, dstDesc->log2_chroma_h);
+    int align = 1 << MAX(shift, 1);
+
+    int bandCount = threadCount;
+    // no point splitting tiny frames further than a few rows per band
+    while (bandCount > 1 && h / bandCount < align * 8) {
+        bandCount--;
+    }
+
+    int y0 = 0;
+    for (int i = 0; i < bandCount; i++) {
+        int y1 = (i == bandCount - 1) ? h : (h * (i + 1) / bandCount) / align * align;
+        Band& band = bands[i];
+        band.height = y1 - y0;
+        band.result = 0;
+        for (int p = 0; p < 4; p++) {
+            int srcRow = y0 >> planeVShift(srcDesc, p);
+            int dstRow = y0 >> planeVShift(dstDesc, p);
+            band.src[p] = src->data[p] ? src->data[p] + (ptrdiff_t) srcRow * src->linesize[p] : nullptr;
+            band.srcStride[p] = src->linesize[p];
+            band.dst[p] = dstData[p] ? dstData[p] + (ptrdiff_t) dstRow * dstLinesize[p] : nullptr;
+            band.dstStride[p] = dstLinesize[p];
+        }
+        y0 = y1;
+    }
+
+    int ret = runBands(bandCount);
+    lastConvertUs = av_gettime_relative() - startUs;
+    return ret;
+}
+
+int SliceConverter::convertTransformed(const AVFrame* src, const TransformPlan& transformPlan,
+                                       AVPixelFormat dstFmt, uint8_t* const dstData[4],
+                                       const int dstLinesize[4]) {
+    if (!src || !src->data[0] || transformPlan.outWidth <= 0 || transformPlan.outHeight <= 0) {
+        return -1;
+    }
+    if (!FrameTransform::supportsSource(static_cast<AVPixelFormat>(src->format))) return -1;
+
+    int64_t startUs = av_gettime_relative();
+
+    transformSrc = src;
+    plan = transformPlan;
+    srcFormat = static_cast<AVPixelFormat>(src->format);
+    dstFormat = dstFmt;
+    coeffs = YuvConvert::coeffsFor(src);
+
+    const int h = plan.outHeight;
+    const int align = 2;   // 4:2:0 outputs need whole chroma rows per band
+    int bandCount = threadCount;
+    while (bandCount > 1 && h / bandCount < align * 8) {
+        bandCount--;
+    }
+
+    const size_t scratchBytes = (size_t) FrameTransform::scratchSize(plan);
+    int y0 = 0;
+    for (int i = 0; i < bandCount; i++) {
+        int y1 = (i == bandCount - 1) ? h : (h * (i + 1) / bandCount) / align * align;
+        Band& band = bands[i];
+        band.y0 = y0;
+        band.height = y1 - y0;
+        band.result = 0;
+        for (int p = 0; p < 4; p++) {
+            band.dst[p] = dstData[p];
+            band.dstStride[p] = dstLinesize[p];
+        }
+        if (band.scratch.size() < scratchBytes) {
+            band.scratch.resize(scratchBytes);
+        }
+        y0 = y1;
+    }
+
+    int ret = runBands(bandCount);
+    transformSrc = nullptr;
+    lastConvertUs = av_gettime_relative() - startUs;
+    return ret;
+}
+
+int SliceConverter::runBands(int bandCount) {
+    if (bandCount > 1 && workerCount > 0) {
+        pthread_mutex_lock(&jobMutex);
+        activeBands = bandCount;
+        pending = bandCount - 1;
+        jobGeneration++;
+        pthread_cond_broadcast(&jobCond);
+        pthread_mutex_unlock(&jobMutex);
+
+        runBand(0);
+
+        pthread_mutex_lock(&jobMutex);
+        while (pending > 0) {
+            pthread_cond_wait(&doneCond, &jobMutex);
+        }
+        pthread_mutex_unlock(&jobMutex);
+    } else {
+        for (int i = 0; i < bandCount; i++) {
+            runBand(i);
+        }
+    }
+
+    for (int i = 0; i < bandCount; i++) {
+        if (bands[i].result < 0) return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <pthread.h>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
+}
+
+#include "yuv_convert.h"
+#include "frame_transform.h"
+
+/**
+ * Colour conversion split into horizontal bands across a small worker pool.
+ *
+ * Each band gets its own SwsContext sized (width x bandHeight), so bands are
+ * fully independent: the calling thread converts band 0 while the workers
+ * convert the rest, then convert() returns once every band is done.
+ * Band boundaries are aligned to the chroma subsampling of both formats.
+ *
+ * yuv420p / nv12 → RGBA / RGB565 bands use the native YuvConvert kernels
+ * instead of swscale (which has no SIMD in our --disable-asm build).
+ *
+ * convertTransformed() splits the output rows of a FrameTransform plan
+ * (crop / rotate / scale) the same way.
+ */
+class SliceConverter {
+public:
+    static const int MAX_THREADS = 8;
+
+    SliceConverter();
+    ~SliceConverter();
+
+    // half the online cores, clamped to [1, 4]: decode and render threads
+    // still need their own cores
+    static int defaultThreadCount();
+
+    // 1 = convert inline on the calling thread, no workers
+    void setThreadCount(int count);
+    int  getThreadCount() const { return threadCount; }
+
+    // convert the whole frame (width x height) from src into dst planes
+    // return: 0 on success, <0 on error
+    int convert(const AVFrame* src, int width, int height,
+                AVPixelFormat dstFormat, uint8_t* const dstData[4], const int dstLinesize[4],
+                int swsFlags);
+
+    // crop / rotate / scale src according to plan into a plan.outWidth x
+    // plan.outHeight image. Source must be FrameTransform::supportsSource().
+    // return: 0 on success, <0 on error
+    int convertTransformed(const AVFrame* src, const TransformPlan& plan,
+                           AVPixelFormat dstFormat, uint8_t* const dstData[4], const int dstLinesize[4]);
+
+    // wall time of the last convert() / convertTransformed() call
+    int64_t getLastConvertUs() const { return lastConvertUs; }
+
+    void release();
+
+private:
+    struct Band {
+        SwsContext* ctx = nullptr;
+        const uint8_t* src[4] = {nullptr, nullptr, nullptr, nullptr};
+        int srcStride[4] = {0, 0, 0, 0};
+        uint8_t* dst[4] = {nullptr, nullptr, nullptr, nullptr};
+        int dstStride[4] = {0, 0, 0, 0};
+        int y0 = 0;                     // first output row (transform jobs)
+        std::vector<uint8_t> scratch;   // per-band row buffers (transform jobs)
+        int height = 0;
+        int result = 0;
+    };
+
+    static void* workerEntry(void* arg);
+    void workerLoop(int index);
+    void runBand(int index);
+    // run bands [0, bandCount) on the caller and the workers, wait for all
+    int runBands(int bandCount);
+
+    void startWorkers(int count);
+    void stopWorkers();
+
+private:
+    int threadCount = 1;
+    int workerCount = 0;   // threadCount - 1 helper threads
+
+    Band bands[MAX_THREADS];
+    int  activeBands = 0;
+
+    // setup of the current job
+    int width = 0;
+    AVPixelFormat srcFormat = AV_PIX_FMT_NONE;
+    AVPixelFormat dstFormat = AV_PIX_FMT_NONE;
+    int flags = 0;
+    bool useNative = false;   // YuvConvert instead of swscale
+    YuvCoeffs coeffs{};
+    const AVFrame* transformSrc = nullptr;   // non-null: transform job
+    TransformPlan plan;
+
+    pthread_t workers[MAX_THREADS]{};
+    pthread_mutex_t jobMutex{};
+    pthread_cond_t  jobCond{};      // workers wait for a new job
+    pthread_cond_t  doneCond{};     // caller waits for pending == 0
+    uint64_t jobGeneration = 0;
+    int      pending = 0;
+    bool     quit = false;
+
+    int64_t lastConvertUs = 0;
+};
@@ -0,0 +1,355 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include "thumbnail_generator.h"
+#include "video_decoder.h"
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+#define LOG_TAG "ThumbnailGenerator"
+#include "CommonTools.h"
+
+static const uint32_t ATLAS_MAGIC = 0x4C425448;   // "HTBL"
+static const uint32_t ATLAS_VERSION = 2;
+
+// options first, then the layout they produced for this file
+struct AtlasFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    int64_t  fileSize;
+    int64_t  fileMtime;
+    int64_t  intervalMs;
+    int32_t  maxCount;
+    int32_t  requestedColumns;
+    int32_t  lowres;
+    int32_t  count;
+    int32_t  columns;
+    int32_t  cellWidth;
+    int32_t  cellHeight;
+    int32_t  format;
+};
+
+static int bytesPerPixel(int format) {
+    return format == VIDEO_FORMAT_RGB565 ? 2 : 4;
+}
+
+ThumbnailGenerator::ThumbnailGenerator() {
+    pthread_mutex_init(&mutex, nullptr);
+}
+
+ThumbnailGenerator::~ThumbnailGenerator() {
+    stop();
+    pthread_mutex_destroy(&mutex);
+}
+
+int ThumbnailGenerator::start(const char* path, const ThumbnailOptions& opts) {
+    stop();
+
+    options = opts;
+    if (options.format != VIDEO_FORMAT_RGB565) options.format = VIDEO_FORMAT_RGBA;
+    if (options.intervalMs <= 0 || options.cellWidth < 2 || options.columns <= 0 ||
+        options.maxCount <= 0) {
+        return -1;
+    }
+    hasFileKey = fileKey.load(path);
+
+    abortRequested = false;
+    done = false;
+
+    // the header holds the layout: no need to open the file at all
+    if (loadCache()) {
+        LOGI("ThumbnailGenerator: %d cells loaded from cache", info.count);
+        done = true;
+        return 0;
+    }
+
+    decoder = new VideoDecoder();
+    // seeks every interval: must not move the player's read position
+    decoder->setShareDemuxer(false);
+    decoder->setLowres(options.lowres);
+    // one keyframe per seek: frame threads would wait for a pipeline's worth
+    decoder->setThreadPolicy(VIDEO_THREADS_SLICE, 0);
+    int ret = decoder->open(path);
+    if (ret < 0) {
+        delete decoder;
+        decoder = nullptr;
+        return ret;
+    }
+    decoder->setKeyframesOnly(true);
+
+    // cell size follows the displayed (rotated) aspect ratio
+    int rotation = decoder->getDisplayRotation();
+    bool swapped = rotation == 90 || rotation == 270;
+    int srcW = swapped ? decoder->getHeight() : decoder->getWidth();
+    int srcH = swapped ? decoder->getWidth() : decoder->getHeight();
+    int cellW = options.cellWidth & ~1;
+    int cellH = srcW > 0 ? ((int) ((int64_t) cellW * srcH / srcW) & ~1) : 0;
+    if (cellH < 2) cellH = 2;
+
+    int64_t durationMs = decoder->getDurationMs();
+    int count = (int) (durationMs > 0 ? (durationMs + options.intervalMs - 1) / options.intervalMs : 1);
+    count = MAX(1, MIN(count, options.maxCount));
+
+    info.count = count;
+    info.columns = MIN(options.columns, count);
+    info.rows = (count + info.columns - 1) / info.columns;
+    info.cellWidth = cellW;
+    info.cellHeight = cellH;
+    info.format = options.format;
+    info.atlasBytes = info.columns * cellW * info.rows * cellH * bytesPerPixel(options.format);
+
+    VideoTransform transform;
+    transform.dstWidth = cellW;
+    transform.dstHeight = cellH;
+    transform.keepAspect = false;
+    decoder->setOutputTransform(transform);
+
+    pthread_mutex_lock(&mutex);
+    atlas.assign((size_t) info.atlasBytes, 0);
+    ptsTable.assign((size_t) count, -1);
+    readyCount = 0;
+    pthread_mutex_unlock(&mutex);
+
+    if (pthread_create(&worker, nullptr, &ThumbnailGenerator::workerEntry, this) != 0) {
+        delete decoder;
+        decoder = nullptr;
+        return -1;
+    }
+    workerStarted = true;
+    LOGI("ThumbnailGenerator::start %d cells of %dx%d every %lld ms",
+         count, cellW, cellH, (long long) options.intervalMs);
+    return 0;
+}
+
+void ThumbnailGenerator::stop() {
+    abortRequested = true;
+    if (workerStarted) {
+        pthread_join(worker, nullptr);
+        workerStarted = false;
+    }
+    if (decoder) {
+        decoder->close();
+        delete decoder;
+        decoder = nullptr;
+    }
+}
+
+void* ThumbnailGenerator::workerEntry(void* arg) {
+    static_cast<ThumbnailGenerator*>(arg)->workerLoop();
+    return nullptr;
+}
+
+void ThumbnailGenerator::workerLoop() {
+    const int cellBytes = info.cellWidth * info.cellHeight * bytesPerPixel(options.format);
+    std::vector<uint8_t> cell((size_t) cellBytes);
+    AVFrame* keyframe = av_frame_alloc();
+    if (!keyframe) {
+        done = true;
+        return;
+    }
+
+    int64_t startUs = av_gettime_relative();
+    int64_t lastPtsMs = -1;
+    bool complete = true;
+    for (int i = 0; i < info.count; i++) {
+        if (abortRequested) {
+            complete = false;
+            break;
+        }
+
+        decoder->setSeekPosition(i * options.intervalMs);
+        decoder->seekFrame();
+        int ret = decoder->decodeFrame();
+        while (ret == AVERROR(EAGAIN) && !abortRequested) {
+            ret = decoder->decodeFrame();
+        }
+        if (abortRequested) {
+            complete = false;
+            break;
+        }
+        if (ret <= 0) {
+            // past the last keyframe: the remaining cells repeat it
+            if (lastPtsMs < 0) {
+                complete = false;
+                break;
+            }
+            publishCell(i, cell.data(), lastPtsMs);
+            continue;
+        }
+
+        av_frame_unref(keyframe);
+        decoder->takeFrame(keyframe);
+        int64_t ptsMs = (int64_t) decoder->getFramePtsMs(keyframe);
+
+        // long GOPs land on the same keyframe again, reuse the last cell
+        if (ptsMs != lastPtsMs || lastPtsMs < 0) {
+            if (decoder->convertTo(keyframe, options.format, cell.data(), cellBytes, nullptr) < 0) {
+                // the slot stays empty: don't cache the atlas, the next run retries
+                LOGE("ThumbnailGenerator: convert failed at cell %d", i);
+                complete = false;
+                continue;
+            }
+            lastPtsMs = ptsMs;
+        }
+        publishCell(i, cell.data(), ptsMs);
+    }
+    av_frame_free(&keyframe);
+
+    pthread_mutex_lock(&mutex);
+    const int filled = readyCount;
+    pthread_mutex_unlock(&mutex);
+    LOGI("ThumbnailGenerator: %d/%d cells in %lld ms", filled, info.count,
+         (long long) ((av_gettime_relative() - startUs) / 1000));
+    // only a full atlas is cached
+    if (complete && filled == info.count) {
+        saveCache();
+    }
+    done = true;
+}
+
+void ThumbnailGenerator::publishCell(int index, const uint8_t* cell, int64_t ptsMs) {
+    const int bpp = bytesPerPixel(options.format);
+    const int rowBytes = info.cellWidth * bpp;
+    const int atlasStride = info.columns * rowBytes;
+    const int col = index % info.columns;
+    const int row = index / info.columns;
+
+    pthread_mutex_lock(&mutex);
+    uint8_t* dst = atlas.data() + (size_t) row * info.cellHeight * atlasStride + (size_t) col * rowBytes;
+    for (int y = 0; y < info.cellHeight; y++) {
+        memcpy(dst + (size_t) y * atlasStride, cell + (size_t) y * rowBytes, (size_t) rowBytes);
+    }
+    ptsTable[index] = ptsMs;
+    readyCount++;
+    pthread_mutex_unlock(&mutex);
+}
+
+ThumbnailAtlasInfo ThumbnailGenerator::getInfo() {
+    pthread_mutex_lock(&mutex);
+    ThumbnailAtlasInfo copy = info;
+    pthread_mutex_unlock(&mutex);
+    return copy;
+}
+
+int ThumbnailGenerator::copyAtlas(uint8_t* dst, int dstSize, int64_t* ptsOut, int ptsCapacity) {
+    pthread_mutex_lock(&mutex);
+    if (atlas.empty() || !dst || dstSize < (int) atlas.size()) {
+        pthread_mutex_unlock(&mutex);
+        return -1;
+    }
+    memcpy(dst, atlas.data(), atlas.size());
+    if (ptsOut) {
+        int n = MIN(ptsCapacity, (int) ptsTable.size());
+        memcpy(ptsOut, ptsTable.data(), (size_t) n * sizeof(int64_t));
+    }
+    int ready = readyCount;
+    pthread_mutex_unlock(&mutex);
+    return ready;
+}
+
+// every option the header checks is in the name: different requests for the
+// same file get their own atlas instead of replacing each other's
+std::string ThumbnailGenerator::cachePath() const {
+    if (options.cacheDir.empty() || !hasFileKey) return {};
+    char name[128];
+    snprintf(name, sizeof(name), "/%016llx_%lld_%d_%d_%d_%d_%d.thumb",
+             (unsigned long long) fileKey.pathHash(), (long long) options.intervalMs,
+             options.cellWidth & ~1, options.columns, options.maxCount, options.format,
+             options.lowres);
+    return options.cacheDir + name;
+}
+
+bool ThumbnailGenerator::loadCache() {
+    std::string file = cachePath();
+    if (file.empty()) return false;
+
+    FILE* fp = fopen(file.c_str(), "rb");
+    if (!fp) return false;
+
+    AtlasFileHeader header{};
+    bool ok = fread(&header, sizeof(header), 1, fp) == 1 &&
+              header.magic == ATLAS_MAGIC &&
+              header.version == ATLAS_VERSION &&
+              fileKey.sameFile(header.fileSize, header.fileMtime) &&
+              header.intervalMs == options.intervalMs &&
+              header.maxCount == options.maxCount &&
+              header.requestedColumns == options.columns &&
+              header.lowres == options.lowres &&
+              header.cellWidth == (options.cellWidth & ~1) &&
+              header.format == options.format &&
+              header.count > 0 && header.count <= options.maxCount &&
+              header.columns == MIN(options.columns, header.count) &&
+              header.cellHeight >= 2;
+    if (ok) {
+        ThumbnailAtlasInfo cached;
+        cached.count = header.count;
+        cached.columns = header.columns;
+        cached.rows = (header.count + header.columns - 1) / header.columns;
+        cached.cellWidth = header.cellWidth;
+        cached.cellHeight = header.cellHeight;
+        cached.format = header.format;
+        cached.atlasBytes = cached.columns * cached.cellWidth * cached.rows * cached.cellHeight *
+                            bytesPerPixel(cached.format);
+
+        pthread_mutex_lock(&mutex);
+        info = cached;
+        atlas.assign((size_t) cached.atlasBytes, 0);
+        ptsTable.assign((size_t) cached.count, -1);
+        ok = fread(ptsTable.data(), sizeof(int64_t), ptsTable.size(), fp) == ptsTable.size() &&
+             fread(atlas.data(), 1, atlas.size(), fp) == atlas.size();
+        readyCount = ok ? cached.count : 0;
+        if (!ok) {
+            info = ThumbnailAtlasInfo();
+            atlas.clear();
+            ptsTable.clear();
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+    fclose(fp);
+    if (!ok) {
+        unlink(file.c_str());
+    }
+    return ok;
+}
+
+void ThumbnailGenerator::saveCache() {
+    std::string file = cachePath();
+    if (file.empty()) return;
+
+    AtlasFileHeader header{};
+    header.magic = ATLAS_MAGIC;
+    header.version = ATLAS_VERSION;
+    header.fileSize = fileKey.size;
+    header.fileMtime = fileKey.mtime;
+    header.intervalMs = options.intervalMs;
+    header.maxCount = options.maxCount;
+    header.requestedColumns = options.columns;
+    header.lowres = options.lowres;
+    header.count = info.count;
+    header.columns = info.columns;
+    header.cellWidth = info.cellWidth;
+    header.cellHeight = info.cellHeight;
+    header.format = info.format;
+
+    std::string tmp = file + ".tmp";
+    FILE* fp = fopen(tmp.c_str(), "wb");
+    if (!fp) {
+        LOGE("ThumbnailGenerator: cannot write %s", tmp.c_str());
+        return;
+    }
+    pthread_mutex_lock(&mutex);
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+              fwrite(ptsTable.data(), sizeof(int64_t), ptsTable.size(), fp) == ptsTable.size() &&
+              fwrite(atlas.data(), 1, atlas.size(), fp) == atlas.size();
+    pthread_mutex_unlock(&mutex);
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), file.c_str()) != 0) {
+        unlink(tmp.c_str());
+    }
+}
@@ -0,0 +1,95 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <pthread.h>
+#include "VideoFormat.h"
+#include "media_file_key.h"
+
+class VideoDecoder;
+
+struct ThumbnailOptions {
+    int64_t intervalMs = 5000;   // one cell per interval
+    int     cellWidth = 160;     // height follows the display aspect ratio
+    int     columns = 10;        // atlas width in cells
+    int     maxCount = 200;
+    int     format = VIDEO_FORMAT_RGBA;   // RGBA or RGB565
+    int     lowres = 1;          // 1/2^lowres decode where the codec supports it
+    std::string cacheDir;        // empty = no disk cache
+};
+
+struct ThumbnailAtlasInfo {
+    int count = 0;          // cells in the atlas
+    int columns = 0;
+    int rows = 0;
+    int cellWidth = 0;
+    int cellHeight = 0;
+    int format = VIDEO_FORMAT_RGBA;
+    int atlasBytes = 0;     // columns * cellWidth * rows * cellHeight * bpp
+};
+
+/**
+ * Keyframe-only thumbnail sprite sheet for the scrubbing UI.
+ *
+ * A private VideoDecoder (skip_frame = NONKEY, lowres where supported) seeks
+ * to every interval and decodes just the keyframe it lands on; the frame is
+ * scaled (and rotated per display matrix) straight into its atlas cell.
+ * Cells are published one by one, so the UI can poll partial results. The
+ * finished atlas + pts table is cached on disk keyed by file path / size /
+ * mtime and options, later requests load it without opening the file.
+ */
+class ThumbnailGenerator {
+public:
+    ThumbnailGenerator();
+    ~ThumbnailGenerator();
+
+    // open the file, size the atlas and start the worker thread
+    // return: 0 on success, <0 on error
+    int start(const char* path, const ThumbnailOptions& options);
+    // abort the worker (partial results stay readable)
+    void stop();
+
+    ThumbnailAtlasInfo getInfo();
+
+    /**
+     * Copy the atlas and the pts table (ms, -1 = cell not ready yet).
+     * return: number of ready cells, <0 on error
+     */
+    int copyAtlas(uint8_t* dst, int dstSize, int64_t* ptsOut, int ptsCapacity);
+
+    bool isDone() const { return done; }
+
+private:
+    static void* workerEntry(void* arg);
+    void workerLoop();
+    void publishCell(int index, const uint8_t* cell, int64_t ptsMs);
+
+    std::string cachePath() const;
+    bool loadCache();
+    void saveCache();
+
+private:
+    ThumbnailOptions options;
+    ThumbnailAtlasInfo info;
+    MediaFileKey fileKey;
+    bool hasFileKey = false;
+
+    VideoDecoder* decoder = nullptr;
+
+    pthread_t worker{};
+    bool workerStarted = false;
+    std::atomic<bool> abortRequested{false};
+    std::atomic<bool> done{false};
+
+    // guarded by mutex: the worker publishes, the UI copies
+    pthread_mutex_t mutex{};
+    std::vector<uint8_t> atlas;
+    std::vector<int64_t> ptsTable;
+    int readyCount = 0;
+};
@@ -5,24 +5,49 @@
 #include "video_decoder.h"
 #include "CommonTools.h"
 
-VideoDecoder::VideoDecoder() = default;
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/display.h>
+#include <libavutil/time.h>
+}
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+static AVPixelFormat toAvPixelFormat(int format) {
+    switch (format) {
+        case VIDEO_FORMAT_RGBA:   return AV_PIX_FMT_RGBA;
+        case VIDEO_FORMAT_I420:   return AV_PIX_FMT_YUV420P;
+        case VIDEO_FORMAT_NV12:   return AV_PIX_FMT_NV12;
+        case VIDEO_FORMAT_RGB565: return AV_PIX_FMT_RGB565LE; // Bitmap.Config.RGB_565
+        default:                  return AV_PIX_FMT_NONE;
+    }
+}
+
+VideoDecoder::VideoDecoder() {
+    pthread_mutex_init(&transformMutex, nullptr);
+    pthread_mutex_init(&statsMutex, nullptr);
+}
 
 VideoDecoder::~VideoDecoder() {
     close();
+    pthread_mutex_destroy(&transformMutex);
+    pthread_mutex_destroy(&statsMutex);
 }
 
 int VideoDecoder::open(const char* path) {
-    close();
+    // a parked codec context stays until the new stream is known
+    releaseStream();
 
     int ret = 0;
 
-    // open container
-    if ((ret = avformat_open_input(&fmtCtx, path, nullptr, nullptr)) < 0) {
-        return ret;
-    }
-    if ((ret = avformat_find_stream_info(fmtCtx, nullptr)) < 0) {
+    // open container (or join the audio decoder's)
+    demuxer = MediaDemuxer::acquire(path, shareDemuxer, &ret, ioOptions);
+    if (!demuxer) {
         return ret;
     }
+    fmtCtx = demuxer->context();
 
     // find best video stream
     videoStreamIndex = av_find_best_stream(fmtCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
@@ -31,7 +56,59 @@ int VideoDecoder::open(const char* path) {
     }
 
     videoStream = fmtCtx->streams[videoStreamIndex];
+    if ((ret = demuxer->subscribe(videoStreamIndex)) < 0) {
+        return ret;
+    }
+
     AVCodecParameters* codecpar = videoStream->codecpar;
+    const bool live = demuxer->isLive();
+    const uint64_t key = codecKey(codecpar, live);
+    codecReused = codecCtx && key == warmCodecKey;
+    if (codecReused) {
+        // same stream parameters as the previous file: skip avcodec_open2
+        avcodec_flush_buffers(codecCtx);
+        LOGI("VideoDecoder::open reusing parked %s context", codecCtx->codec->name);
+    } else {
+        if ((ret = openCodec(codecpar, live)) < 0) {
+            return ret;
+        }
+        warmCodecKey = key;
+    }
+    codecCtx->skip_loop_filter = loopFilterDiscard;
+    codecCtx->skip_frame = frameDiscard;
+
+    width = codecCtx->width;
+    height = codecCtx->height;
+    displayRotation = readDisplayRotation(videoStream);
+
+    pthread_mutex_lock(&transformMutex);
+    outputPlan = FrameTransform::resolve(outputTransform, width, height, displayRotation);
+    pthread_mutex_unlock(&transformMutex);
+    if (displayRotation != 0) {
+        LOGI("VideoDecoder::open display rotation %d", displayRotation);
+    }
+
+    frame = av_frame_alloc();
+    packet = av_packet_alloc();
+
+    resetInFlight();
+    latencyFrames = 0;
+    latencySumUs = 0;
+    latencyMaxUs = 0;
+    maxFramesInFlight = 0;
+    pthread_mutex_lock(&statsMutex);
+    seekStats = VideoSeekStats();
+    pthread_mutex_unlock(&statsMutex);
+
+    return 0;
+}
+
+int VideoDecoder::openCodec(const AVCodecParameters* codecpar, bool live) {
+    if (codecCtx) {
+        avcodec_free_context(&codecCtx);
+    }
+    warmCodecKey = 0;
+
     const AVCodec* codec = avcodec_find_decoder(codecpar->codec_id);
     if (!codec) {
         return AVERROR_DECODER_NOT_FOUND;
@@ -40,29 +117,96 @@ int VideoDecoder::open(const char* path) {
     codecCtx = avcodec_alloc_context3(codec);
     if (!codecCtx) return AVERROR(ENOMEM);
 
+    int ret;
     if ((ret = avcodec_parameters_to_context(codecCtx, codecpar)) < 0) {
         return ret;
     }
 
+    if (requestedLowres > 0) {
+        codecCtx->lowres = MIN(requestedLowres, codec->max_lowres);
+    }
+    applyThreadPolicy(live);
+    if (live && resolvedThreadPolicy != VIDEO_THREADS_FRAME) {
+        // output each frame as soon as it is decodable (FFmpeg turns frame
+        // threading off under this flag, so an explicit FRAME policy skips it)
+        codecCtx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+    }
+
     if ((ret = avcodec_open2(codecCtx, codec, nullptr)) < 0) {
         return ret;
     }
+    decodeThreadCount = codecCtx->thread_count;
+    activeThreadType = codecCtx->active_thread_type;
+    LOGI("VideoDecoder::open %s threads: policy %d, %d thread(s), active type %d",
+         codec->name, resolvedThreadPolicy, decodeThreadCount, activeThreadType);
+    return 0;
+}
+
+uint64_t VideoDecoder::codecKey(const AVCodecParameters* codecpar, bool live) const {
+    const int64_t fields[] = {
+            codecpar->codec_id, codecpar->format, codecpar->width, codecpar->height,
+            codecpar->profile, codecpar->level, requestedLowres,
+            threadPolicy, requestedDecodeThreads, live ? 1 : 0
+    };
+    // FNV-1a over the fields and the extradata (SPS / PPS...)
+    uint64_t h = 1469598103934665603ULL;
+    auto mix = [&h](const uint8_t* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            h ^= data[i];
+            h *= 1099511628211ULL;
+        }
+    };
+    mix(reinterpret_cast<const uint8_t*>(fields), sizeof(fields));
+    if (codecpar->extradata && codecpar->extradata_size > 0) {
+        mix(codecpar->extradata, (size_t) codecpar->extradata_size);
+    }
+    return h ? h : 1;
+}
 
-    width = codecCtx->width;
-    height = codecCtx->height;
+void VideoDecoder::close() {
+    releaseStream();
 
-    frame = av_frame_alloc();
-    packet = av_packet_alloc();
+    converter.release();
 
-    return 0;
+    if (stagingCtx) {
+        sws_freeContext(stagingCtx);
+        stagingCtx = nullptr;
+    }
+    if (stagingFrame) {
+        av_frame_free(&stagingFrame);
+    }
+    if (codecCtx) {
+        avcodec_free_context(&codecCtx);
+        codecCtx = nullptr;
+    }
+    warmCodecKey = 0;
+    codecReused = false;
 }
 
-void VideoDecoder::close() {
-    if (swsCtx) {
-        sws_freeContext(swsCtx);
-        swsCtx = nullptr;
+void VideoDecoder::park() {
+    releaseStream();
+    if (codecCtx) {
+        // drops the references the codec still holds to decoded frames
+        avcodec_flush_buffers(codecCtx);
+        setSkipNonRef(false);
     }
 
+    // settings of the file just played, the next owner sets its own
+    shareDemuxer = true;
+    ioOptions = MediaIoOptions();
+    interruptFlag = nullptr;
+    requestedLowres = 0;
+    loopFilterDiscard = AVDISCARD_DEFAULT;
+    frameDiscard = AVDISCARD_DEFAULT;
+    fastScale = false;
+    accurateSeek = false;
+    requestedConvertThreads = SliceConverter::defaultThreadCount();
+    pthread_mutex_lock(&transformMutex);
+    outputTransform = VideoTransform();
+    pthread_mutex_unlock(&transformMutex);
+}
+
+void VideoDecoder::releaseStream() {
     if (frame) {
         av_frame_free(&frame);
         frame = nullptr;
@@ -71,83 +215,525 @@ void VideoDecoder::close() {
         av_packet_free(&packet);
         packet = nullptr;
     }
-    if (codecCtx) {
-        avcodec_free_context(&codecCtx);
-        codecCtx = nullptr;
-    }
-    if (fmtCtx) {
-        avformat_close_input(&fmtCtx);
-        fmtCtx = nullptr;
+    if (demuxer) {
+        if (videoStreamIndex >= 0) {
+            demuxer->unsubscribe(videoStreamIndex);
+        }
+        demuxer.reset();
     }
+    fmtCtx = nullptr;
 
     videoStream = nullptr;
     videoStreamIndex = -1;
     width = height = 0;
+    displayRotation = 0;
+    discardUntilPts = AV_NOPTS_VALUE;
+    seekPending = false;
 }
 
 int VideoDecoder::decodeFrame() {
     int ret = 0;
-    // read packets until we get a decoded frame or hit EOF
+    // drain the decoder first, feed packets only when it needs more input
     while (true) {
-        ret = av_read_frame(fmtCtx, packet);
+        if (interruptFlag && interruptFlag->load()) {
+            return AVERROR_EXIT;
+        }
+        ret = avcodec_receive_frame(codecCtx, frame);
+        if (ret == 0) {
+            onFrameReceived(frame);
+            if (shouldDiscard(frame)) {
+                // before the accurate-seek target: never leaves the decoder
+                av_frame_unref(frame);
+                seekDiscarded++;
+                continue;
+            }
+            if (seekPending) {
+                finishSeek(frame);
+            }
+            // got one frame
+            return 1;
+        } else if (ret == AVERROR_EOF) {
+            if (seekPending) {
+                finishSeek(nullptr);
+            }
+            return 0; // EOF
+        } else if (ret != AVERROR(EAGAIN)) {
+            return ret;
+        }
+
+        // need more data
+        int64_t resumeMs = -1;
+        ret = demuxer->readPacket(videoStreamIndex, packet, &resumeMs);
+        if (ret == MediaDemuxer::DISCONTINUITY) {
+            // the audio decoder repositioned the shared demuxer: continue
+            // from resumeMs without showing the frames leading up to it
+            avcodec_flush_buffers(codecCtx);
+            resetInFlight();
+            av_frame_unref(frame);
+            discardUntilPts = resumeMs >= 0
+                              ? av_rescale_q(resumeMs, AVRational{1, 1000}, videoStream->time_base)
+                              : AV_NOPTS_VALUE;
+            continue;
+        }
+        if (ret == AVERROR(EAGAIN)) {
+            // packet buffer ran dry (slow I/O): let the caller come back
+            return ret;
+        }
         if (ret < 0) {
             // flush decoder
             avcodec_send_packet(codecCtx, nullptr);
-        } else if (packet->stream_index != videoStreamIndex) {
-            av_packet_unref(packet);
             continue;
-        } else {
-            ret = avcodec_send_packet(codecCtx, packet);
-            av_packet_unref(packet);
-            if (ret < 0) {
-                return ret;
-            }
         }
 
-        ret = avcodec_receive_frame(codecCtx, frame);
-        if (ret == AVERROR(EAGAIN)) {
-            continue; // need more data
-        } else if (ret == AVERROR_EOF) {
-            return 0; // EOF
-        } else if (ret < 0) {
+        if (discardUntilPts != AV_NOPTS_VALUE) {
+            // only non-reference frames are affected, and those are shown
+            // exactly once: skipping their filtering is invisible when they
+            // end before the target
+            bool beforeTarget = packet->pts != AV_NOPTS_VALUE &&
+                                packet->pts + packet->duration <= discardUntilPts;
+            setSkipNonRef(beforeTarget);
+        }
+
+        const int64_t sentPts = packet->pts;
+        ret = avcodec_send_packet(codecCtx, packet);
+        av_packet_unref(packet);
+        if (ret == 0) {
+            onPacketSent(sentPts);
+        } else if (ret != AVERROR(EAGAIN)) {
             return ret;
         }
+    }
+}
+
+int VideoDecoder::defaultDecodeThreads() {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return (int) MAX(1L, MIN((long) MAX_DECODE_THREADS, cores));
+}
+
+// codecCtx allocated, before avcodec_open2(); codecs without the requested
+// kind of threading fall back to what they support
+void VideoDecoder::applyThreadPolicy(bool live) {
+    int policy = threadPolicy;
+    if (policy < VIDEO_THREADS_AUTO || policy >= VIDEO_THREAD_POLICY_COUNT) {
+        policy = VIDEO_THREADS_AUTO;
+    }
+    if (policy == VIDEO_THREADS_AUTO) {
+        // frame threads delay every frame by thread_count - 1 frames
+        policy = live ? VIDEO_THREADS_SLICE : VIDEO_THREADS_FRAME;
+    }
+    const int threads = requestedDecodeThreads > 0
+                        ? MIN(requestedDecodeThreads, 2 * MAX_DECODE_THREADS)
+                        : defaultDecodeThreads();
+    switch (policy) {
+        case VIDEO_THREADS_FRAME:
+            codecCtx->thread_count = threads;
+            codecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+            break;
+        case VIDEO_THREADS_SLICE:
+            codecCtx->thread_count = threads;
+            codecCtx->thread_type = FF_THREAD_SLICE;
+            break;
+        default:
+            codecCtx->thread_count = 1;
+            codecCtx->thread_type = 0;
+            break;
+    }
+    resolvedThreadPolicy = policy;
+}
+
+void VideoDecoder::onPacketSent(int64_t pts) {
+    SentPacket& slot = sentPackets[sentSlot];
+    slot.pts = pts;
+    slot.sentUs = av_gettime_relative();
+    slot.sequence = ++packetsSent;
+    sentSlot = (sentSlot + 1) % LATENCY_SLOTS;
+}
 
-        // got one frame
-        return 1;
+void VideoDecoder::onFrameReceived(const AVFrame* decoded) {
+    // the decoder hands the packet pts through to its frame, also when reordering
+    const int64_t pts = decoded->pts;
+    if (pts == AV_NOPTS_VALUE) return;
+    for (SentPacket& slot : sentPackets) {
+        if (slot.pts != pts) continue;
+        const int64_t latencyUs = av_gettime_relative() - slot.sentUs;
+        slot.pts = AV_NOPTS_VALUE;
+        // frame threads and reordering both hold packets back
+        const int inFlight = (int) (packetsSent - slot.sequence + 1);
+        if (inFlight > maxFramesInFlight) maxFramesInFlight = inFlight;
+        latencyFrames++;
+        latencySumUs += latencyUs;
+        if (latencyUs > latencyMaxUs) latencyMaxUs = latencyUs;
+        return;
     }
 }
 
+void VideoDecoder::resetInFlight() {
+    for (SentPacket& slot : sentPackets) slot = SentPacket();
+    sentSlot = 0;
+}
+
+VideoThreadingStats VideoDecoder::getThreadingStats() const {
+    VideoThreadingStats stats;
+    stats.policy = resolvedThreadPolicy;
+    stats.threadCount = decodeThreadCount;
+    stats.activeType = activeThreadType;
+    stats.frames = latencyFrames;
+    stats.avgLatencyUs = stats.frames > 0 ? latencySumUs / (int64_t) stats.frames : 0;
+    stats.maxLatencyUs = latencyMaxUs;
+    stats.maxFramesInFlight = maxFramesInFlight;
+    return stats;
+}
+
+bool VideoDecoder::shouldDiscard(const AVFrame* decoded) const {
+    if (discardUntilPts == AV_NOPTS_VALUE) return false;
+
+    int64_t pts = decoded->best_effort_timestamp;
+    if (pts == AV_NOPTS_VALUE) return false;
+
+    // keep the frame that is on screen at the target: pts <= target < pts + duration
+    int64_t duration = decoded->pkt_duration;
+    if (duration <= 0) {
+        AVRational rate = av_guess_frame_rate(fmtCtx, videoStream, nullptr);
+        duration = (rate.num > 0 && rate.den > 0)
+                   ? av_rescale_q(1, av_inv_q(rate), videoStream->time_base)
+                   : 1;
+    }
+    return pts + duration <= discardUntilPts;
+}
+
+void VideoDecoder::setSkipNonRef(bool skip) {
+    AVDiscard level = skip ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+    codecCtx->skip_loop_filter = MAX(level, loopFilterDiscard);
+    codecCtx->skip_idct = level;
+}
+
+void VideoDecoder::finishSeek(const AVFrame* landed) {
+    if (discardUntilPts != AV_NOPTS_VALUE) {
+        setSkipNonRef(false);
+    }
+    discardUntilPts = AV_NOPTS_VALUE;
+    seekPending = false;
+
+    pthread_mutex_lock(&statsMutex);
+    seekStats.landedMs = landed ? (int64_t) getFramePtsMs(landed) : -1;
+    seekStats.latencyUs = av_gettime_relative() - seekStartUs;
+    seekStats.discardedFrames = seekDiscarded;
+    seekStats.seekCount++;
+    VideoSeekStats stats = seekStats;
+    pthread_mutex_unlock(&statsMutex);
+
+    LOGI("VideoDecoder seek target=%lld landed=%lld ms, discarded=%d, latency=%lld us",
+         (long long) stats.targetMs, (long long) stats.landedMs,
+         stats.discardedFrames, (long long) stats.latencyUs);
+}
+
+VideoSeekStats VideoDecoder::getSeekStats() const {
+    pthread_mutex_lock(&statsMutex);
+    VideoSeekStats stats = seekStats;
+    pthread_mutex_unlock(&statsMutex);
+    return stats;
+}
+
+void VideoDecoder::setKeyframesOnly(bool enable) {
+    setFrameDiscard(enable ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT);
+}
+
+void VideoDecoder::setLoopFilterDiscard(AVDiscard discard) {
+    loopFilterDiscard = discard;
+    // during an accurate seek setSkipNonRef() picks it up with the next packet
+    if (codecCtx && discardUntilPts == AV_NOPTS_VALUE) {
+        codecCtx->skip_loop_filter = discard;
+    }
+}
+
+void VideoDecoder::setFrameDiscard(AVDiscard discard) {
+    frameDiscard = discard;
+    if (codecCtx) {
+        codecCtx->skip_frame = discard;
+    }
+}
+
+int64_t VideoDecoder::getDurationMs() const {
+    if (!fmtCtx) return 0;
+    if (fmtCtx->duration != AV_NOPTS_VALUE) {
+        return fmtCtx->duration / 1000;
+    }
+    if (videoStream && videoStream->duration != AV_NOPTS_VALUE) {
+        return av_rescale_q(videoStream->duration, videoStream->time_base, AVRational{1, 1000});
+    }
+    return 0;
+}
+
+int VideoDecoder::getDecodedFrameBytes() const {
+    if (!codecCtx || width <= 0 || height <= 0) return 0;
+    int bytes = av_image_get_buffer_size(codecCtx->pix_fmt, width, height, 1);
+    return bytes > 0 ? bytes : 0;
+}
+
+double VideoDecoder::getFrameRate() const {
+    if (!fmtCtx || !videoStream) return 0.0;
+    AVRational rate = av_guess_frame_rate(fmtCtx, videoStream, nullptr);
+    return (rate.num > 0 && rate.den > 0) ? av_q2d(rate) : 0.0;
+}
+
+void VideoDecoder::setPacketBufferLimits(int64_t maxBytes, int64_t maxDurationMs) {
+    if (demuxer) {
+        demuxer->setQueueLimits(maxBytes, maxDurationMs);
+    }
+}
+
+MediaDemuxerStats VideoDecoder::getDemuxStats() const {
+    return demuxer ? demuxer->getStats() : MediaDemuxerStats();
+}
+
+MediaIoStats VideoDecoder::getIoStats() const {
+    return demuxer ? demuxer->getIoStats() : MediaIoStats();
+}
+
+MediaDemuxerQueueStats VideoDecoder::getPacketQueueStats(AVMediaType type) const {
+    if (!demuxer || !fmtCtx) return MediaDemuxerQueueStats();
+    int index = type == AVMEDIA_TYPE_VIDEO
+                ? videoStreamIndex
+                : av_find_best_stream(fmtCtx, type, -1, -1, nullptr, 0);
+    return index >= 0 ? demuxer->getQueueStats(index) : MediaDemuxerQueueStats();
+}
+
+void VideoDecoder::takeFrame(AVFrame* dst) {
+    if (!frame || !dst) return;
+    av_frame_move_ref(dst, frame);
+}
+
 int VideoDecoder::toRGBA(uint8_t* outBuffer, int bufferSize) {
-    if (!frame || !codecCtx || width <= 0 || height <= 0) return -1;
-    int needed = width * height * 4;
-    if (bufferSize < needed) return -1;
-
-    if (!swsCtx) {
-        swsCtx = sws_getContext(
-                width, height, codecCtx->pix_fmt,
-                width, height, AV_PIX_FMT_RGBA,
-                SWS_BILINEAR, nullptr, nullptr, nullptr
-        );
-        if (!swsCtx) return -1;
-    }
-
-    uint8_t* dstData[4] = { outBuffer, nullptr, nullptr, nullptr };
-    int dstLinesize[4] = { width * 4, 0, 0, 0 };
-
-    sws_scale(
-            swsCtx,
-            frame->data,
-            frame->linesize,
-            0,
-            height,
-            dstData,
-            dstLinesize
-    );
+    return toRGBA(frame, outBuffer, bufferSize);
+}
+
+int VideoDecoder::toRGBA(const AVFrame* src, uint8_t* outBuffer, int bufferSize) {
+    return convertTo(src, VIDEO_FORMAT_RGBA, outBuffer, bufferSize, nullptr);
+}
+
+int VideoDecoder::getFrameLayout(int format, int w, int h,
+                                 int strides[VIDEO_FORMAT_MAX_PLANES],
+                                 int offsets[VIDEO_FORMAT_MAX_PLANES]) {
+    const int chromaW = (w + 1) / 2;
+    const int chromaH = (h + 1) / 2;
+    for (int i = 0; i < VIDEO_FORMAT_MAX_PLANES; i++) {
+        strides[i] = 0;
+        offsets[i] = 0;
+    }
+
+    switch (format) {
+        case VIDEO_FORMAT_RGBA:
+            strides[0] = w * 4;
+            return strides[0] * h;
+        case VIDEO_FORMAT_RGB565:
+            strides[0] = w * 2;
+            return strides[0] * h;
+        case VIDEO_FORMAT_I420:
+            strides[0] = w;
+            strides[1] = chromaW;
+            strides[2] = chromaW;
+            offsets[1] = w * h;
+            offsets[2] = offsets[1] + chromaW * chromaH;
+            return offsets[2] + chromaW * chromaH;
+        case VIDEO_FORMAT_NV12:
+            strides[0] = w;
+            strides[1] = chromaW * 2;
+            offsets[1] = w * h;
+            return offsets[1] + strides[1] * chromaH;
+        default:
+            return -1;
+    }
+}
+
+int VideoDecoder::convertTo(const AVFrame* src, int format,
+                            uint8_t* outBuffer, int bufferSize, int* strides) {
+    if (!src || !codecCtx || width <= 0 || height <= 0) return -1;
+    if (!src->data[0] || !outBuffer) return -1;
+
+    pthread_mutex_lock(&transformMutex);
+    TransformPlan plan = outputPlan;
+    if (!plan.identity && (src->width != width || src->height != height)) {
+        // lowres decoding or a mid-stream size change: map from the frame's own size
+        plan = FrameTransform::resolve(outputTransform, src->width, src->height, displayRotation);
+    }
+    pthread_mutex_unlock(&transformMutex);
+    const bool fast = fastScale.load();
+    plan.nearest = fast;
+
+    int dstStrides[VIDEO_FORMAT_MAX_PLANES];
+    int dstOffsets[VIDEO_FORMAT_MAX_PLANES];
+    int needed = getFrameLayout(format, plan.outWidth, plan.outHeight, dstStrides, dstOffsets);
+    if (needed < 0 || bufferSize < needed) return -1;
+
+    AVPixelFormat dstFormat = toAvPixelFormat(format);
+    auto srcFormat = static_cast<AVPixelFormat>(src->format);
+
+    uint8_t* dstData[4] = { nullptr, nullptr, nullptr, nullptr };
+    int dstLinesize[4] = { 0, 0, 0, 0 };
+    for (int i = 0; i < VIDEO_FORMAT_MAX_PLANES; i++) {
+        if (dstStrides[i] > 0) {
+            dstData[i] = outBuffer + dstOffsets[i];
+            dstLinesize[i] = dstStrides[i];
+        }
+    }
+    if (strides) {
+        for (int i = 0; i < VIDEO_FORMAT_MAX_PLANES; i++) {
+            strides[i] = dstStrides[i];
+        }
+    }
+
+    int threads = requestedConvertThreads.load();
+    if (threads != converter.getThreadCount()) {
+        converter.setThreadCount(threads);
+    }
+
+    if (!plan.identity) {
+        return convertTransformed(src, plan, format, dstData, dstLinesize) < 0 ? -1 : needed;
+    }
+
+    // Fast path: source already has the requested planar layout, just repack
+    // the planes (drops codec padding), no colour conversion needed.
+    bool samePlanar =
+            (format == VIDEO_FORMAT_I420 &&
+             (srcFormat == AV_PIX_FMT_YUV420P || srcFormat == AV_PIX_FMT_YUVJ420P)) ||
+            (format == VIDEO_FORMAT_NV12 && srcFormat == AV_PIX_FMT_NV12);
+    if (samePlanar) {
+        const int chromaH = (height + 1) / 2;
+        av_image_copy_plane(dstData[0], dstLinesize[0],
+                            src->data[0], src->linesize[0], width, height);
+        for (int i = 1; i < VIDEO_FORMAT_MAX_PLANES; i++) {
+            if (!dstData[i]) continue;
+            av_image_copy_plane(dstData[i], dstLinesize[i],
+                                src->data[i], src->linesize[i], dstLinesize[i], chromaH);
+        }
+        return needed;
+    }
+
+    // Use the frame's own pixel format: frames may be converted on the
+    // consumer thread long after the codec context moved on.
+    if (converter.convert(src, width, height, dstFormat,
+                          dstData, dstLinesize, fast ? SWS_FAST_BILINEAR : SWS_BILINEAR) < 0) {
+        return -1;
+    }
 
     return needed;  // bytes written
 }
 
+int VideoDecoder::convertTransformed(const AVFrame* src, const TransformPlan& plan, int format,
+                                     uint8_t* const dstData[4], const int dstLinesize[4]) {
+    const AVFrame* sampled = src;
+    if (!FrameTransform::supportsSource(static_cast<AVPixelFormat>(src->format))) {
+        // e.g. yuv420p10 / yuv422p: one full-size sws pass to yuv420p, then sample that
+        if (!stagingFrame) {
+            stagingFrame = av_frame_alloc();
+            if (!stagingFrame) return -1;
+        }
+        if (stagingFrame->width != src->width || stagingFrame->height != src->height) {
+            av_frame_unref(stagingFrame);
+            stagingFrame->format = AV_PIX_FMT_YUV420P;
+            stagingFrame->width = src->width;
+            stagingFrame->height = src->height;
+            if (av_frame_get_buffer(stagingFrame, 32) < 0) return -1;
+        }
+        stagingCtx = sws_getCachedContext(
+                stagingCtx,
+                src->width, src->height, static_cast<AVPixelFormat>(src->format),
+                src->width, src->height, AV_PIX_FMT_YUV420P,
+                plan.nearest ? SWS_FAST_BILINEAR : SWS_BILINEAR, nullptr, nullptr, nullptr);
+        if (!stagingCtx) return -1;
+        sws_scale(stagingCtx, src->data, src->linesize, 0, src->height,
+                  stagingFrame->data, stagingFrame->linesize);
+        stagingFrame->colorspace = src->colorspace;
+        stagingFrame->color_range = src->color_range;
+        sampled = stagingFrame;
+    }
+    return converter.convertTransformed(sampled, plan, toAvPixelFormat(format), dstData, dstLinesize);
+}
+
+void VideoDecoder::setOutputTransform(const VideoTransform& transform) {
+    pthread_mutex_lock(&transformMutex);
+    outputTransform = transform;
+    outputPlan = FrameTransform::resolve(outputTransform, width, height, displayRotation);
+    LOGI("VideoDecoder::setOutputTransform %dx%d -> %dx%d rotation=%d crop=%d,%d %dx%d",
+         width, height, outputPlan.outWidth, outputPlan.outHeight, outputPlan.rotation,
+         outputPlan.cropX, outputPlan.cropY, outputPlan.cropWidth, outputPlan.cropHeight);
+    pthread_mutex_unlock(&transformMutex);
+}
+
+int VideoDecoder::getOutputWidth() {
+    pthread_mutex_lock(&transformMutex);
+    int w = outputPlan.outWidth;
+    pthread_mutex_unlock(&transformMutex);
+    return w;
+}
+
+int VideoDecoder::getOutputHeight() {
+    pthread_mutex_lock(&transformMutex);
+    int h = outputPlan.outHeight;
+    pthread_mutex_unlock(&transformMutex);
+    return h;
+}
+
+int VideoDecoder::readDisplayRotation(AVStream* stream) {
+    if (!stream) return 0;
+
+    double theta = 0.0;
+    AVDictionaryEntry* tag = av_dict_get(stream->metadata, "rotate", nullptr, 0);
+    uint8_t* matrix = av_stream_get_side_data(stream, AV_PKT_DATA_DISPLAYMATRIX, nullptr);
+    if (tag && *tag->value && strcmp(tag->value, "0") != 0) {
+        theta = atof(tag->value);
+    } else if (matrix) {
+        // av_display_rotation_get is counter-clockwise
+        theta = -av_display_rotation_get(reinterpret_cast<const int32_t*>(matrix));
+    }
+    if (std::isnan(theta)) return 0;
+
+    theta -= 360.0 * floor(theta / 360.0 + 0.9 / 360.0);
+    int rotation = ((int) lround(theta / 90.0) % 4) * 90;
+    return rotation;
+}
+
+int VideoDecoder::benchmarkConvert(const AVFrame* src, int format, int maxThreads,
+                                   int iterations, int64_t* avgUsOut) {
+    if (!src || !avgUsOut || maxThreads <= 0 || iterations <= 0) return -1;
+    if (maxThreads > SliceConverter::MAX_THREADS) maxThreads = SliceConverter::MAX_THREADS;
+
+    int strides[VIDEO_FORMAT_MAX_PLANES];
+    int offsets[VIDEO_FORMAT_MAX_PLANES];
+    int bytes = getFrameLayout(format, width, height, strides, offsets);
+    if (bytes <= 0) return -1;
+
+    auto* buffer = static_cast<uint8_t*>(av_malloc((size_t) bytes));
+    if (!buffer) return AVERROR(ENOMEM);
+
+    uint8_t* dstData[4] = { nullptr, nullptr, nullptr, nullptr };
+    int dstLinesize[4] = { 0, 0, 0, 0 };
+    for (int i = 0; i < VIDEO_FORMAT_MAX_PLANES; i++) {
+        if (strides[i] > 0) {
+            dstData[i] = buffer + offsets[i];
+            dstLinesize[i] = strides[i];
+        }
+    }
+
+    SliceConverter bench;
+    for (int threads = 1; threads <= maxThreads; threads++) {
+        bench.setThreadCount(threads);
+        // warm-up builds the per-band contexts
+        bench.convert(src, width, height, toAvPixelFormat(format), dstData, dstLinesize, SWS_BILINEAR);
+        int64_t total = 0;
+        for (int i = 0; i < iterations; i++) {
+            bench.convert(src, width, height, toAvPixelFormat(format), dstData, dstLinesize, SWS_BILINEAR);
+            total += bench.getLastConvertUs();
+        }
+        avgUsOut[threads - 1] = total / iterations;
+        LOGI("VideoDecoder::benchmarkConvert %dx%d threads=%d avg=%lld us",
+             width, height, threads, (long long) avgUsOut[threads - 1]);
+    }
+
+    av_free(buffer);
+    return maxThreads;
+}
+
 //milliseconds
 void VideoDecoder::setSeekPosition(int64_t positionMs) {
     time_seek_ms = positionMs;
@@ -168,6 +754,7 @@ void VideoDecoder::seekFrame() {
 
     LOGI("VideoDecoder::seekFrame() start, target=%lld ms",
          static_cast<long long>(time_seek_ms));
+    seekStartUs = av_gettime_relative();
 
     // Convert milliseconds -> pts in videoStream->time_base
     AVRational srcTimeBase = {1, 1000};              // ms
@@ -175,13 +762,15 @@ void VideoDecoder::seekFrame() {
 
     int64_t seekPts = av_rescale_q(time_seek_ms, srcTimeBase, dstTimeBase);
     if (seekPts < 0) seekPts = 0;
+    // frame pts count from the stream's start (MPEG-TS, live captures), the
+    // target from zero
+    if (videoStream->start_time != AV_NOPTS_VALUE) {
+        seekPts += videoStream->start_time;
+    }
 
-    int ret = av_seek_frame(
-            fmtCtx,
-            videoStreamIndex,
-            seekPts,
-            AVSEEK_FLAG_BACKWARD
-    );
+    // keyframe index first, av_seek_frame otherwise; answered without a
+    // reposition when the audio decoder just seeked to the same target
+    int ret = demuxer->seek(videoStreamIndex, time_seek_ms);
 
     if (ret < 0) {
         LOGE("VideoDecoder::seekFrame() av_seek_frame failed, target=%lld ms",
@@ -193,12 +782,22 @@ void VideoDecoder::seekFrame() {
 
     // Flush decoder after seek, drop any buffered state
     avcodec_flush_buffers(codecCtx);
+    resetInFlight();
 
     // Also drop any content in current frame
     if (frame) {
         av_frame_unref(frame);
     }
 
+    // a previous accurate seek may still be in progress
+    setSkipNonRef(false);
+    discardUntilPts = (ret >= 0 && accurateSeek) ? seekPts : AV_NOPTS_VALUE;
+    seekDiscarded = 0;
+    seekPending = true;
+    pthread_mutex_lock(&statsMutex);
+    seekStats.targetMs = time_seek_ms;
+    pthread_mutex_unlock(&statsMutex);
+
     // Clear pending seek flag
     time_seek_ms = -1;
 
@@ -206,10 +805,14 @@ void VideoDecoder::seekFrame() {
 }
 
 double VideoDecoder::getFramePtsMs() const {
-    if (!videoStream || !frame) return 0.0;
+    return getFramePtsMs(frame);
+}
+
+double VideoDecoder::getFramePtsMs(const AVFrame* src) const {
+    if (!videoStream || !src) return 0.0;
     AVRational tb = videoStream->time_base;
-    double pts = (frame->best_effort_timestamp == AV_NOPTS_VALUE)
+    double pts = (src->best_effort_timestamp == AV_NOPTS_VALUE)
                  ? 0.0
-                 : frame->best_effort_timestamp * av_q2d(tb);
+                 : src->best_effort_timestamp * av_q2d(tb);
     return pts * 1000.0; // ms
-}
\ No newline at end of file
+}
@@ -10,30 +10,183 @@ extern "C" {
 #include <libswscale/swscale.h>
 }
 
+#include <atomic>
+#include <memory>
+#include <pthread.h>
+#include "VideoFormat.h"
+#include "slice_converter.h"
+#include "frame_transform.h"
+#include "media_demuxer.h"
+
 #define LOG_TAG "VideoDecoderLog"
 
+// result of the last seek, see VideoDecoder::getSeekStats()
+struct VideoSeekStats {
+    int64_t targetMs = -1;        // requested position
+    int64_t landedMs = -1;        // pts of the first frame returned after the seek
+    int64_t latencyUs = 0;        // seekFrame() start → first returned frame
+    int     discardedFrames = 0;  // frames decoded and dropped to reach the target
+    int     seekCount = 0;        // completed seeks since open()
+};
+
+/**
+ * How the codec spreads decoding over threads, applied at avcodec_open2().
+ * Frame threading decodes several frames at once: best throughput, but each
+ * thread adds one frame of delay. Slice threading splits one frame and adds
+ * none, but only helps streams encoded with several slices per frame.
+ */
+enum VideoThreadPolicy {
+    VIDEO_THREADS_AUTO   = 0,   // frame threads for files, slice threads for live, one per core
+    VIDEO_THREADS_FRAME  = 1,
+    VIDEO_THREADS_SLICE  = 2,
+    VIDEO_THREADS_SINGLE = 3,
+    VIDEO_THREAD_POLICY_COUNT
+};
+
+// threading the codec runs with and the decode delay it causes,
+// see VideoDecoder::getThreadingStats()
+struct VideoThreadingStats {
+    int      policy = VIDEO_THREADS_AUTO;   // resolved, never AUTO after open()
+    int      threadCount = 0;               // codec thread_count
+    int      activeType = 0;                // FF_THREAD_FRAME / FF_THREAD_SLICE / 0
+    uint64_t frames = 0;                    // frames with a measured latency
+    int64_t  avgLatencyUs = 0;              // packet sent → its frame received
+    int64_t  maxLatencyUs = 0;
+    int      maxFramesInFlight = 0;         // packets sent up to the one a frame came from
+};
+
 class VideoDecoder {
 public:
+    // auto policy: one decode thread per online core, up to this
+    static constexpr int MAX_DECODE_THREADS = 8;
+
     VideoDecoder();
     ~VideoDecoder();
 
-    // path: UTF-8 file path
+    // path: UTF-8 file path. A codec context kept by park() is reused when
+    // the new stream has the same codec, geometry and extradata.
     int open(const char* path);
     void close();
+    // release the file but keep the flushed codec context, converter
+    // threads and scalers for the next open(); per-file settings go back to
+    // their defaults. See VideoDecoderPool.
+    void park();
+    // the last open() reused a parked codec context (no avcodec_open2)
+    bool isCodecReused() const { return codecReused; }
+
+    // true (default): read through the MediaDemuxer shared with the audio
+    // decoder of the same path; false: a private one (thumbnails). Set before open().
+    void setShareDemuxer(bool share) { shareDemuxer = share; }
+    // how the container bytes are read (mmap, memory, large-block read-ahead),
+    // see MediaSource. Set before open(); a shared demuxer keeps its first mode.
+    void setIoOptions(const MediaIoOptions& options) { ioOptions = options; }
+
+    // decode at 1/2^lowres resolution where the codec supports it (MJPEG,
+    // MPEG-1/2/4 part 2...); ignored otherwise. Set before open().
+    void setLowres(int lowres) { requestedLowres = lowres; }
+    // true: the decoder drops everything but keyframes (skip_frame = NONKEY)
+    void setKeyframesOnly(bool enable);
+    // VideoThreadPolicy and thread count (<= 0: by core count). Set before open().
+    void setThreadPolicy(int policy, int threads) {
+        threadPolicy = policy;
+        requestedDecodeThreads = threads;
+    }
+    VideoThreadingStats getThreadingStats() const;
+    static int defaultDecodeThreads();
+
+    // quality-of-service knobs, see VideoQosController. Discard levels are
+    // the floor kept while accurate seek raises them; call on the decode thread.
+    void setLoopFilterDiscard(AVDiscard discard);
+    void setFrameDiscard(AVDiscard discard);
+    // nearest-neighbour transform sampling / SWS_FAST_BILINEAR, next convert
+    void setFastScale(bool enable) { fastScale = enable; }
+    int64_t getDurationMs() const;
+    // bytes of one decoded (YUV) frame and the nominal frame rate, 0 if unknown;
+    // used to size frame queues before anything is decoded
+    int getDecodedFrameBytes() const;
+    double getFrameRate() const;
+
+    // compressed read-ahead of the demux thread (shared with the audio
+    // decoder), see MediaDemuxer::setQueueLimits. After open().
+    void setPacketBufferLimits(int64_t maxBytes, int64_t maxDurationMs);
+    MediaDemuxerStats getDemuxStats() const;
+    MediaIoStats getIoStats() const;
+    // streams were restored from ProbeCache instead of probed
+    bool isProbeCached() const { return demuxer && demuxer->probeCached(); }
+    // live source (MediaIoOptions::live): newest media time read, -1 unknown
+    int64_t getLiveEdgeMs() const { return demuxer ? demuxer->getLiveEdgeMs() : -1; }
+    // packets buffered for the best stream of `type`, empty when there is none
+    MediaDemuxerQueueStats getPacketQueueStats(AVMediaType type) const;
+
+    // decodeFrame() gives up with AVERROR_EXIT as soon as *flag is set (a newer
+    // seek is waiting), also in the middle of an accurate-seek discard run
+    void setInterruptFlag(const std::atomic<bool>* flag) { interruptFlag = flag; }
 
     // decode next frame into internal AVFrame (YUV)
-    // return 1: got frame, 0: EOF, <0: error
+    // return 1: got frame, 0: EOF, AVERROR(EAGAIN): no packet buffered yet,
+    //         AVERROR_EXIT: interrupted, other <0: error
     int decodeFrame();
 
+    // move the last decoded frame into dst (dst must be unref'd/empty).
+    // After this call the internal frame is empty until next decodeFrame().
+    void takeFrame(AVFrame* dst);
+
     // convert last decoded frame to RGBA into caller buffer
     // bufferSize = width * height * 4
     int toRGBA(uint8_t* outBuffer, int bufferSize);
 
+    // convert a frame previously taken with takeFrame() to RGBA
+    int toRGBA(const AVFrame* src, uint8_t* outBuffer, int bufferSize);
+
+    // convert a frame into one of the VIDEO_FORMAT_* layouts, tightly packed
+    // plane after plane in outBuffer, at the output size (see
+    // setOutputTransform). strides (optional) receives the per-plane line
+    // size. I420/NV12 are plain plane copies when the source already has that
+    // layout and no transform is set (no sws_scale).
+    // return: bytes written, <0 on error
+    int convertTo(const AVFrame* src, int format,
+                  uint8_t* outBuffer, int bufferSize, int* strides);
+
+    // packed layout of one output frame in the given format
+    // return: total bytes, <0 for an unknown format
+    static int getFrameLayout(int format, int w, int h,
+                              int strides[VIDEO_FORMAT_MAX_PLANES],
+                              int offsets[VIDEO_FORMAT_MAX_PLANES]);
+
+    // number of threads used for colour conversion (applied on next convert)
+    void setConvertThreads(int count) { requestedConvertThreads = count; }
+    int getConvertThreads() const { return converter.getThreadCount(); }
+    int64_t getLastConvertUs() const { return converter.getLastConvertUs(); }
+
+    // convert src `iterations` times with 1..maxThreads workers on a private
+    // converter; avgUsOut[i] = average wall time with (i + 1) threads
+    int benchmarkConvert(const AVFrame* src, int format, int maxThreads,
+                         int iterations, int64_t* avgUsOut);
+
+    // crop / rotate / scale applied by convertTo(), in one pass from the
+    // decoded planes. Safe to call from any thread; applies to the next
+    // converted frame.
+    void setOutputTransform(const VideoTransform& transform);
+    // size of converted frames (== getWidth/getHeight without a transform)
+    int getOutputWidth();
+    int getOutputHeight();
+    // clockwise rotation from the stream's display matrix / rotate tag
+    int getDisplayRotation() const { return displayRotation; }
+
     void setSeekPosition(int64_t positionMs);
     void seekFrame();
+
+    // Accurate seek: after the keyframe seek, decodeFrame() keeps decoding and
+    // drops frames until it reaches the requested pts (no colour conversion,
+    // loop filter / IDCT skipped on the dropped non-reference frames).
+    // Off = return the keyframe frame as before (cheaper, for scrubbing).
+    void setAccurateSeek(bool enable) { accurateSeek = enable; }
+    bool isAccurateSeek() const { return accurateSeek; }
+    VideoSeekStats getSeekStats() const;
     int getWidth() const { return width; }
     int getHeight() const { return height; }
     double getFramePtsMs() const;   // for later A/V sync
+    double getFramePtsMs(const AVFrame* src) const;
 
 private:
     AVFormatContext* fmtCtx = nullptr;
@@ -44,7 +197,79 @@ private:
     AVFrame* frame = nullptr;       // decoded YUV
     AVPacket* packet = nullptr;
 
-    SwsContext* swsCtx = nullptr;
+    // owns fmtCtx, the keyframe index and the read position
+    std::shared_ptr<MediaDemuxer> demuxer;
+    bool shareDemuxer = true;
+    MediaIoOptions ioOptions;
+    const std::atomic<bool>* interruptFlag = nullptr;
+
+    // band-parallel sws_scale, used from the consumer thread
+    SliceConverter converter;
+    std::atomic<int> requestedConvertThreads{SliceConverter::defaultThreadCount()};
     int width = 0;
     int height = 0;
+    int displayRotation = 0;
+    int requestedLowres = 0;
+    int threadPolicy = VIDEO_THREADS_AUTO;
+    int requestedDecodeThreads = 0;
+    int resolvedThreadPolicy = VIDEO_THREADS_AUTO;
+    int decodeThreadCount = 0;
+    int activeThreadType = 0;
+    uint64_t warmCodecKey = 0;     // of codecCtx, 0 = none
+    bool codecReused = false;
+
+    // decode delay: send time of the last packets by pts (decode thread
+    // only), aggregates read from any thread
+    static constexpr int LATENCY_SLOTS = 32;
+    struct SentPacket {
+        int64_t pts = AV_NOPTS_VALUE;
+        int64_t sentUs = 0;
+        int64_t sequence = 0;
+    };
+    SentPacket sentPackets[LATENCY_SLOTS];
+    int sentSlot = 0;
+    int64_t packetsSent = 0;
+    std::atomic<uint64_t> latencyFrames{0};
+    std::atomic<int64_t> latencySumUs{0};
+    std::atomic<int64_t> latencyMaxUs{0};
+    std::atomic<int> maxFramesInFlight{0};
+    AVDiscard loopFilterDiscard = AVDISCARD_DEFAULT;
+    AVDiscard frameDiscard = AVDISCARD_DEFAULT;
+    std::atomic<bool> fastScale{false};
+
+    // accurate seek state (decode thread only, stats copied under statsMutex)
+    std::atomic<bool> accurateSeek{false};
+    int64_t discardUntilPts = AV_NOPTS_VALUE;  // stream time base
+    bool    seekPending = false;               // waiting for the first frame after a seek
+    int64_t seekStartUs = 0;
+    int     seekDiscarded = 0;
+    mutable pthread_mutex_t statsMutex{};
+    VideoSeekStats seekStats;
+
+    // everything tied to the open file, not the codec
+    void releaseStream();
+    int openCodec(const AVCodecParameters* codecpar, bool live);
+    // what a parked codec context must match to be reused
+    uint64_t codecKey(const AVCodecParameters* codecpar, bool live) const;
+    void applyThreadPolicy(bool live);
+    void onPacketSent(int64_t pts);
+    void onFrameReceived(const AVFrame* decoded);
+    // after a flush nothing is in flight any more
+    void resetInFlight();
+    bool shouldDiscard(const AVFrame* decoded) const;
+    void setSkipNonRef(bool skip);
+    void finishSeek(const AVFrame* landed);
+
+    // output geometry, written by setOutputTransform, read by convertTo
+    pthread_mutex_t transformMutex{};
+    VideoTransform outputTransform;
+    TransformPlan outputPlan;
+
+    // sources the transform cannot sample directly go through yuv420p first
+    SwsContext* stagingCtx = nullptr;
+    AVFrame* stagingFrame = nullptr;
+
+    int convertTransformed(const AVFrame* src, const TransformPlan& plan, int format,
+                           uint8_t* const dstData[4], const int dstLinesize[4]);
+    static int readDisplayRotation(AVStream* stream);
 };
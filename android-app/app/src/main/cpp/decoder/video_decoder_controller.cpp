@@ -3,148 +3,205 @@
 //
 
 #include "video_decoder_controller.h"
+#include "video_decoder_pool.h"
 #include "MediaStatus.h"
 #include "CommonTools.h"
+#include <algorithm>
 #include <cstring>
 
+extern "C" {
+#include <libavutil/time.h>
+}
+
 VideoDecoderController::VideoDecoderController() {
-    pthread_mutex_init(&queueMutex, nullptr);
-    pthread_cond_init(&queueCond, nullptr);
+    pthread_mutex_init(&clockMutex, nullptr);
+    pthread_mutex_init(&latencyMutex, nullptr);
 }
 
 VideoDecoderController::~VideoDecoderController() {
     destroy();
-    pthread_mutex_destroy(&queueMutex);
-    pthread_cond_destroy(&queueCond);
+    pthread_mutex_destroy(&latencyMutex);
+    pthread_mutex_destroy(&clockMutex);
 }
 
 int VideoDecoderController::init(const char* path) {
     destroy();  // clean old if any
 
-    videoDecoder = new VideoDecoder();
+    initStartUs = av_gettime_relative();
+    playStartUs = 0;
+    startDecodeUs = 0;
+    startConvertUs = 0;
+    startThreadUs = 0;
+    startPlayToFrameUs = 0;
+    startFirstFrameUs = 0;
+    startPrerolled = false;
+    sourcePath = path;
+    shownPtsUs = 0;
+    stepped = false;
+
+    videoDecoder = VideoDecoderPool::obtain();
+    if (convertThreads > 0) {
+        videoDecoder->setConvertThreads(convertThreads);
+    }
+    videoDecoder->setAccurateSeek(accurateSeek);
+    videoDecoder->setThreadPolicy(threadPolicy, decodeThreads);
+    videoDecoder->setInterruptFlag(&needSeek);
+    MediaIoOptions io = ioOptions;
+    live = io.live;
+    if (live && io.liveMaxBacklogMs <= 0) {
+        io.liveMaxBacklogMs = LiveCatchUp::maxBacklogMs(liveCatchUp.getTarget());
+    }
+    if (fastStart) {
+        if (io.probeSize <= 0) io.probeSize = FAST_START_PROBE_SIZE;
+        if (io.analyzeDurationUs <= 0) io.analyzeDurationUs = FAST_START_ANALYZE_US;
+    }
+    videoDecoder->setIoOptions(io);
     int ret = videoDecoder->open(path);
     if (ret < 0) {
-        delete videoDecoder;
+        VideoDecoderPool::recycle(videoDecoder);
         videoDecoder = nullptr;
         return ret;
     }
-
-    width = videoDecoder->getWidth();
-    height = videoDecoder->getHeight();
+    startOpenUs = av_gettime_relative() - initStartUs;
+    startProbeCached = videoDecoder->isProbeCached();
+    startCodecReused = videoDecoder->isCodecReused();
+    videoDecoder->setOutputTransform(outputTransform);
+
+    // frames are handed out at the output size, not the coded size
+    width = videoDecoder->getOutputWidth();
+    height = videoDecoder->getOutputHeight();
+
+    // size the pool from the stream geometry and queue budget up front
+    framePool.init(budgetFrameCount() + POOL_SPARE_FRAMES, width * height * 4);
+
+    qos.restart();
+    appliedQosLevel = VIDEO_QOS_FULL;
+    liveCatchUp.reset();
+    appliedCatchUp = false;
+    lateDrops = 0;
+    clockHeldSerial = -1;
+    seekRequests = 0;
+    coalescedSeeks = 0;
+    abortedDecodes = 0;
+    pthread_mutex_lock(&latencyMutex);
+    seekLatencyCount = seekLatencyNext = 0;
+    lastSeekLatencyUs = 0;
+    pthread_mutex_unlock(&latencyMutex);
 
     running = false;
-    isFinished = false;
+    finishedSerial = -1;
     return MEDIA_STATUS_OK;
 }
 
 void VideoDecoderController::destroy() {
     // 1. stop thread
-    if (running) {
-        running = false;
-        pthread_mutex_lock(&queueMutex);
-        pthread_cond_broadcast(&queueCond);
-        pthread_mutex_unlock(&queueMutex);
-
-        pthread_join(decodeThread, nullptr);
+    running = false;
+    decodeWaiter.notify();
+    if (decodeThread) {
+        // also reaps a thread that already ended on EOF
+        DecodeWorker::join(decodeThread);
+        decodeThread = nullptr;
     }
 
     // 2. clear queue
-    pthread_mutex_lock(&queueMutex);
-    while (!frameQueue.empty()) {
-        VideoFrame* f = frameQueue.front();
-        frameQueue.pop();
-        freeFrame(f);
+    drainFrameQueue();
+
+    if (gopCache) {
+        delete gopCache;
+        gopCache = nullptr;
     }
-    pthread_mutex_unlock(&queueMutex);
 
-    // 3. close decoder
+    // 3. close decoder, its codec stays warm for the next clip
     if (videoDecoder) {
-        videoDecoder->close();
-        delete videoDecoder;
+        VideoDecoderPool::recycle(videoDecoder);
         videoDecoder = nullptr;
     }
+    prerolling = false;
+
+    VideoFramePoolStats poolStats = framePool.getStats();
+    if (poolStats.capacity > 0) {
+        LOGI("VideoDecoderController::destroy frame pool hits=%llu misses=%llu",
+             (unsigned long long) poolStats.hits, (unsigned long long) poolStats.misses);
+    }
+    framePool.release();
 
-    isFinished = false;
+    finishedSerial = -1;
     width = height = 0;
 }
 
-void* VideoDecoderController::decodeThreadEntry(void* arg) {
+void VideoDecoderController::decodeThreadEntry(void* arg) {
     auto* self = static_cast<VideoDecoderController*>(arg);
     self->decodeLoop();
-    return nullptr;
 }
 
 void VideoDecoderController::decodeLoop() {
     if (!videoDecoder) return;
 
-    const int frameSizeBytes = width * height * 4;
+    const int64_t loopStartUs = av_gettime_relative();
+    if (startThreadUs == 0 && playStartUs > 0) {
+        startThreadUs = loopStartUs - playStartUs;
+    }
 
     while (running) {
-        // 1) handle pending seek
-        if (needSeek) {
+        // 1) handle pending seek; frames of the previous serial still queued
+        //    are dropped by the consumer
+        if (needSeek.exchange(false)) {
+            decodeSerial = seekSerial.load();
             int64_t target = pendingSeekMs.load();
+            const bool exact = pendingSeekExact.exchange(false);
 
             videoDecoder->setSeekPosition(target);
+            if (exact) videoDecoder->setAccurateSeek(true);
             videoDecoder->seekFrame();      // av_seek_frame + flush inside
-            clearFrameQueue();              // drop old frames in queue
-
-            // reset EOF state after seek
-            pthread_mutex_lock(&queueMutex);
-            isFinished = false;
-            pthread_mutex_unlock(&queueMutex);
-
-            needSeek = false;
+            if (exact) videoDecoder->setAccurateSeek(accurateSeek);
             continue;
         }
 
-        // 2) back-pressure + pause handling
-        pthread_mutex_lock(&queueMutex);
-        // IMPORTANT: add parentheses to avoid precedence bug
-        while (running &&
-               (frameQueue.size() >= QUEUE_MAX_SIZE || !playing)) {
-            // If queue is full OR we are paused → wait
-            pthread_cond_wait(&queueCond, &queueMutex);
-        }
-        pthread_mutex_unlock(&queueMutex);
+        // 2) back-pressure + pause handling: park until the consumer drained
+        //    the queue to the low watermark, playback resumes or a seek comes in
+        decodeWaiter.wait([this] {
+            return !running || needSeek || ((playing || prerolling) && !queueFull());
+        });
 
         if (!running) break;
 
-        // If we got resumed / woken while still paused, skip decoding this round
-        if (!playing) {
+        // If we got woken for a seek or while still paused, go around again
+        if (needSeek || (!playing && !prerolling)) {
             continue;
         }
 
+        int qosLevel = qos.getLevel();
+        const bool catchUp = live && liveCatchUp.isCatchingUp();
+        if (qosLevel != appliedQosLevel || catchUp != appliedCatchUp) {
+            appliedCatchUp = catchUp;
+            applyQosLevel(qosLevel);
+        }
+
         // 3) decode next frame
         int ret = videoDecoder->decodeFrame();
+        if (ret == AVERROR_EXIT) {
+            // a newer seek arrived mid-decode, go and serve it
+            abortedDecodes++;
+            continue;
+        }
+        if (ret == AVERROR(EAGAIN)) {
+            // demux thread is still reading, check seek / stop and retry
+            continue;
+        }
         if (ret <= 0) {
             // EOF or error
-            pthread_mutex_lock(&queueMutex);
-            // push EOF marker once
-            if (!isFinished) {
-                VideoFrame* eofFrame = new VideoFrame();
-                memset(eofFrame, 0, sizeof(VideoFrame)); // safe init
-                eofFrame->eof = true;
-                frameQueue.push(eofFrame);
-                pthread_cond_broadcast(&queueCond);
-                isFinished = true;
-            }
-            pthread_mutex_unlock(&queueMutex);
+            pushEofMarker();
             break;
         }
 
-        // 4) allocate RGBA buffer and convert
-        VideoFrame* vf = new VideoFrame();
-        vf->width    = width;
-        vf->height   = height;
-        vf->ptsMs    = videoDecoder->getFramePtsMs(); // already ms
-        vf->dataSize = frameSizeBytes;
-        vf->eof      = false;
-        vf->data     = new uint8_t[frameSizeBytes];
-
-        int convRet = videoDecoder->toRGBA(vf->data, frameSizeBytes);
-        if (convRet <= 0) {
-            // conversion failed, drop frame
-            freeFrame(vf);
+        if (startDecodeUs == 0) {
+            startDecodeUs = av_gettime_relative() - loopStartUs;
+        }
+
+        // 4) keep a reference to the decoded YUV frame; RGBA conversion is
+        //    deferred to the consumer so dropped/flushed frames cost nothing
+        VideoFrame* vf = wrapDecodedFrame();
+        if (!vf) {
             continue;
         }
 
@@ -153,128 +210,342 @@ void VideoDecoderController::decodeLoop() {
     }
 
     // optional: on thread exit, ensure readers see EOF
-    pthread_mutex_lock(&queueMutex);
-    if (!isFinished) {
-        VideoFrame* eofFrame = new VideoFrame();
-        memset(eofFrame, 0, sizeof(VideoFrame));
-        eofFrame->eof = true;
-        frameQueue.push(eofFrame);
-        pthread_cond_broadcast(&queueCond);
-        isFinished = true;
-    }
+    pushEofMarker();
     running = false;
-    pthread_mutex_unlock(&queueMutex);
 }
 
-void VideoDecoderController::clearFrameQueue() {
-    // Protect queue while clearing
-    pthread_mutex_lock(&queueMutex);
+void VideoDecoderController::applyQosLevel(int level) {
+    videoDecoder->setLoopFilterDiscard(level >= VIDEO_QOS_SKIP_LOOP_FILTER ? AVDISCARD_ALL : AVDISCARD_DEFAULT);
+    // live catch-up drops non-reference frames whatever the QoS level
+    videoDecoder->setFrameDiscard(level >= VIDEO_QOS_SKIP_NONREF || appliedCatchUp
+                                  ? AVDISCARD_NONREF : AVDISCARD_DEFAULT);
+    videoDecoder->setFastScale(level >= VIDEO_QOS_FAST_SCALE);
+    appliedQosLevel = level;
+}
 
-    while (!frameQueue.empty()) {
-        VideoFrame* frame = frameQueue.front();
-        frameQueue.pop();
+void VideoDecoderController::drainFrameQueue() {
+    VideoFrame* frame = nullptr;
+    while (frameQueue.pop(frame)) {
+        queuedBytes -= frame->decodedBytes;
+        freeFrame(frame);
+    }
+    LOGI("VideoDecoderController::drainFrameQueue() - all frames cleared");
+}
+
+VideoFrame* VideoDecoderController::wrapDecodedFrame() {
+    VideoFrame* vf = framePool.acquire();
+    if (!vf) {
+        return nullptr;
+    }
+    vf->width    = width;
+    vf->height   = height;
+    vf->ptsMs    = videoDecoder->getFramePtsMs(); // already ms
+    vf->eof      = false;
+    videoDecoder->takeFrame(vf->avFrame);
+    for (AVBufferRef* buf : vf->avFrame->buf) {
+        if (buf) vf->decodedBytes += buf->size;
+    }
+    return vf;
+}
 
-        if (frame) {
-            // You already use this in decodeLoop, so reuse it here
-            freeFrame(frame);
+void VideoDecoderController::pushFrame(VideoFrame* frame) {
+    frame->serial = decodeSerial;
+    // never happens while the budget caps the queue below the ring size
+    queuedBytes += frame->decodedBytes;
+    if (!frameQueue.push(frame)) {
+        LOGE("VideoDecoderController::pushFrame: ring full, frame dropped");
+        queuedBytes -= frame->decodedBytes;
+        freeFrame(frame);
+        return;
+    }
+    if (!frame->eof) {
+        if (newestSerial != (int64_t) decodeSerial) {
+            firstPtsMs = (int64_t) frame->ptsMs;
+        }
+        newestPtsMs = (int64_t) frame->ptsMs;
+        newestSerial = decodeSerial;
+    }
+}
+
+void VideoDecoderController::pushEofMarker() {
+    // once per serial
+    if (finishedSerial == (int64_t) decodeSerial) return;
+    VideoFrame* eofFrame = framePool.acquire();
+    if (eofFrame) {
+        eofFrame->eof = true;
+        pushFrame(eofFrame);
+    }
+    finishedSerial = decodeSerial;
+}
+
+VideoFrame* VideoDecoderController::popFrameInternal(int64_t clockMs) {
+    const int64_t serial = seekSerial.load();
+    VideoFrame* f = nullptr;
+    while (frameQueue.pop(f)) {
+        queuedBytes -= f->decodedBytes;
+        // decoded before the last seek
+        if ((int64_t) f->serial != serial) {
+            freeFrame(f);
+            continue;
+        }
+        // after a seek the master clock still reads the old position until
+        // audio follows: nothing is late before it is back near the target
+        if (clockHeldSerial == serial) {
+            if (clockMs > 0 && clockMs <= clockHeldTargetMs + lateThresholdMs) {
+                clockHeldSerial = -1;
+            } else {
+                clockMs = -1;
+            }
+        }
+        // already behind the clock: the renderer would drop it anyway, so
+        // don't pay for conversion, the copy and the JNI crossing
+        if (clockMs > 0 && !f->eof && f->ptsMs < clockMs - lateThresholdMs) {
+            freeFrame(f);
+            lateDrops++;
+            continue;
+        }
+        if (!f->eof) {
+            takenPtsMs = (int64_t) f->ptsMs;
+            shownPtsUs = GopCache::ptsUs(f->ptsMs);
+            takenSerial = serial;
+            if (live) {
+                liveCatchUp.update(videoDecoder->getLiveEdgeMs() - takenPtsMs,
+                                   av_gettime_relative() / 1000);
+            }
+            if (serial != latencySerial) {
+                latencySerial = serial;
+                int64_t startUs = seekRequestUs;
+                if (startUs > 0) {
+                    recordSeekLatency(av_gettime_relative() - startUs);
+                }
+            }
         }
+        return f;
     }
+    return nullptr;
+}
 
-    pthread_mutex_unlock(&queueMutex);
+void VideoDecoderController::recordSeekLatency(int64_t latencyUs) {
+    pthread_mutex_lock(&latencyMutex);
+    seekLatencyUs[seekLatencyNext] = latencyUs;
+    seekLatencyNext = (seekLatencyNext + 1) % SEEK_LATENCY_WINDOW;
+    seekLatencyCount = MIN(seekLatencyCount + 1, SEEK_LATENCY_WINDOW);
+    lastSeekLatencyUs = latencyUs;
+    pthread_mutex_unlock(&latencyMutex);
+}
 
-    LOGI("VideoDecoderController::clearFrameQueue() - all frames cleared");
+VideoSeekLatencyStats VideoDecoderController::getSeekLatencyStats() {
+    VideoSeekLatencyStats stats;
+    stats.requests = seekRequests;
+    stats.coalesced = coalescedSeeks;
+    stats.aborted = abortedDecodes;
+
+    int64_t sorted[SEEK_LATENCY_WINDOW];
+    pthread_mutex_lock(&latencyMutex);
+    const int n = seekLatencyCount;
+    std::copy(seekLatencyUs, seekLatencyUs + n, sorted);
+    stats.lastUs = lastSeekLatencyUs;
+    pthread_mutex_unlock(&latencyMutex);
+
+    stats.samples = n;
+    if (n > 0) {
+        std::sort(sorted, sorted + n);
+        // nearest rank
+        auto percentile = [&](int p) { return sorted[MAX((n * p + 99) / 100 - 1, 0)]; };
+        stats.p50Us = percentile(50);
+        stats.p90Us = percentile(90);
+        stats.p99Us = percentile(99);
+        stats.maxUs = sorted[n - 1];
+    }
+    return stats;
 }
 
-void VideoDecoderController::pushFrame(VideoFrame* frame) {
-    pthread_mutex_lock(&queueMutex);
-    frameQueue.push(frame);
-    pthread_cond_broadcast(&queueCond);
-    pthread_mutex_unlock(&queueMutex);
+bool VideoDecoderController::isFinished() const {
+    return finishedSerial == (int64_t) seekSerial.load();
+}
+
+
+int64_t VideoDecoderController::queuedDurationMs() const {
+    const int64_t serial = newestSerial.load();
+    // nothing decoded since the last seek yet
+    if (serial != (int64_t) seekSerial.load()) return 0;
+    // from the frame on screen (or the first one after the seek) to the newest
+    const int64_t base = takenSerial == serial ? takenPtsMs.load() : firstPtsMs.load();
+    return MAX(newestPtsMs - base, (int64_t) 0);
+}
+
+// how much of the tighter budget is used, 100 = full
+int VideoDecoderController::queueFillPercent() const {
+    const int64_t maxBytes = queueMaxBytes;
+    const int64_t maxMs = queueMaxDurationMs;
+    // RGBA staging buffers count against the same memory
+    const int64_t bytes = queuedBytes + framePool.getBufferBytes();
+    int64_t byBytes = maxBytes > 0 ? bytes * 100 / maxBytes : 0;
+    int64_t byDuration = maxMs > 0 ? queuedDurationMs() * 100 / maxMs : 0;
+    return (int) MIN(MAX(byBytes, byDuration), (int64_t) 100);
+}
+
+bool VideoDecoderController::queueFull() const {
+    const int frames = (int) frameQueue.size();
+    if (frames >= QUEUE_MAX_FRAMES) return true;
+    return frames >= QUEUE_MIN_FRAMES && queueFillPercent() >= 100;
+}
+
+bool VideoDecoderController::queueBelowLowWater() const {
+    return (int) frameQueue.size() < QUEUE_MIN_FRAMES ||
+           queueFillPercent() <= QUEUE_LOW_WATER_PERCENT;
+}
+
+int VideoDecoderController::budgetFrameCount() const {
+    int frames = QUEUE_MAX_FRAMES;
+    const int frameBytes = videoDecoder ? videoDecoder->getDecodedFrameBytes() : 0;
+    const double fps = videoDecoder ? videoDecoder->getFrameRate() : 0.0;
+    if (frameBytes > 0) {
+        const int64_t available = queueMaxBytes - framePool.getBufferBytes();
+        frames = (int) MIN((int64_t) frames, MAX(available, (int64_t) 0) / frameBytes);
+    }
+    if (fps > 0.0) {
+        // the span of n frames is (n - 1) frame durations
+        frames = MIN(frames, (int) (queueMaxDurationMs * fps / 1000.0) + 1);
+    }
+    return MAX(frames, QUEUE_MIN_FRAMES);
+}
+
+void VideoDecoderController::setQueueBudget(int64_t maxBytes, int64_t maxDurationMs) {
+    if (maxBytes > 0) queueMaxBytes = maxBytes;
+    if (maxDurationMs > 0) queueMaxDurationMs = maxDurationMs;
+    if (videoDecoder) {
+        framePool.resize(budgetFrameCount() + POOL_SPARE_FRAMES);
+    }
+    // a larger budget lets the decoder continue right away
+    decodeWaiter.notify();
+}
+
+VideoQueueStats VideoDecoderController::getQueueStats() {
+    VideoQueueStats stats;
+    stats.frames = (int) frameQueue.size();
+    stats.bytes = queuedBytes + framePool.getBufferBytes();
+    stats.durationMs = queuedDurationMs();
+    stats.maxBytes = queueMaxBytes;
+    stats.maxDurationMs = queueMaxDurationMs;
+    stats.poolCapacity = framePool.getStats().capacity;
+    return stats;
+}
+
+int64_t VideoDecoderController::readMasterClock() {
+    pthread_mutex_lock(&clockMutex);
+    int64_t clockMs = masterClock ? masterClock(masterClockOpaque) : -1;
+    pthread_mutex_unlock(&clockMutex);
+    return clockMs;
 }
 
-VideoFrame* VideoDecoderController::popFrameInternal() {
-    if (frameQueue.empty()) return nullptr;
-    VideoFrame* f = frameQueue.front();
-    frameQueue.pop();
-    return f;
+int64_t VideoDecoderController::pushedMasterClock(void* controller) {
+    return static_cast<VideoDecoderController*>(controller)->pushedClockMs;
+}
+
+void VideoDecoderController::setMasterClock(MasterClockFn fn, void* opaque, int64_t thresholdMs) {
+    pthread_mutex_lock(&clockMutex);
+    masterClock = fn;
+    masterClockOpaque = opaque;
+    lateThresholdMs = thresholdMs;
+    pthread_mutex_unlock(&clockMutex);
+    if (fn != &VideoDecoderController::pushedMasterClock) {
+        pushedClockMs = -1;
+    }
+}
+
+int VideoDecoderController::convertFrame(VideoFrame* frame, int format,
+                                         uint8_t* dst, int dstSize, int* strides) {
+    if (!videoDecoder || !frame || !frame->avFrame) {
+        return -1;
+    }
+    int ret = videoDecoder->convertTo(frame->avFrame, format, dst, dstSize, strides);
+    // YUV reference is no longer needed once converted
+    av_frame_unref(frame->avFrame);
+    return ret;
 }
 
 int VideoDecoderController::getFrame(VideoFrame*& frameOut) {
     frameOut = nullptr;
 
-    pthread_mutex_lock(&queueMutex);
-
-    // no frames yet
-    if (frameQueue.empty()) {
-        if (isFinished) {
-            pthread_mutex_unlock(&queueMutex);
+    int64_t clockMs = readMasterClock();
+    VideoFrame* f = popFrameInternal(clockMs);
+    if (!f) {
+        // nothing queued, or everything queued was stale / late
+        decodeWaiter.notify();
+        if (isFinished()) {
             return MEDIA_STATUS_EOF;  // EOF
-        } else {
-            pthread_mutex_unlock(&queueMutex);
-            return MEDIA_STATUS_BUFFERING; // buffering
         }
+        if (playing) qos.onUnderrun();
+        return MEDIA_STATUS_BUFFERING; // buffering
     }
+    qos.onFrameTaken(queueFillPercent(), 100);
 
-    VideoFrame* f = popFrameInternal();
-
-    // wake producer if queue was full
-    if (frameQueue.size() < QUEUE_MIN_SIZE) {
-        pthread_cond_signal(&queueCond);
+    // wake producer once the queue has drained to the low watermark
+    if (queueBelowLowWater()) {
+        decodeWaiter.notify();
     }
 
-    pthread_mutex_unlock(&queueMutex);
-
     if (f->eof) {
         // EOF marker
         freeFrame(f);
         return MEDIA_STATUS_EOF;
     }
 
+    // lazy conversion: only frames actually handed out are converted
+    // (a fast-start frame may already hold another format)
+    if (f->dataSize <= 0 || f->dataFormat != VIDEO_FORMAT_RGBA) {
+        if (!framePool.ensureBuffer(f)) {
+            freeFrame(f);
+            return MEDIA_STATUS_ERROR;
+        }
+        f->width = videoDecoder->getOutputWidth();
+        f->height = videoDecoder->getOutputHeight();
+        f->dataSize = convertFrame(f, VIDEO_FORMAT_RGBA, f->data, f->bufferCapacity, nullptr);
+        f->dataFormat = VIDEO_FORMAT_RGBA;
+        if (f->dataSize <= 0) {
+            freeFrame(f);
+            return MEDIA_STATUS_ERROR;
+        }
+    }
+
     frameOut = f;
     return MEDIA_STATUS_OK;
 }
 
 int VideoDecoderController::readFrameRGBA(uint8_t* dst, int64_t* ptsMs) {
+    return readFrame(VIDEO_FORMAT_RGBA, dst, width * height * 4, nullptr, ptsMs);
+}
+
+int VideoDecoderController::getFrameBufferSize(int format) const {
+    int strides[VIDEO_FORMAT_MAX_PLANES];
+    int offsets[VIDEO_FORMAT_MAX_PLANES];
+    return VideoDecoder::getFrameLayout(format, width, height, strides, offsets);
+}
+
+int VideoDecoderController::readFrame(int format, uint8_t* dst, int dstSize,
+                                      int* strides, int64_t* ptsMs) {
     if (!dst || !ptsMs) {
         return MEDIA_STATUS_ERROR;
     }
 
-    // Quick check: nothing running and nothing in queue → EOF
-    if (!running && isFinished) {
-        pthread_mutex_lock(&queueMutex);
-        bool empty = frameQueue.empty();
-        pthread_mutex_unlock(&queueMutex);
-        if (empty) {
-            return MEDIA_STATUS_EOF;
-        }
-    }
-
-    pthread_mutex_lock(&queueMutex);
-    if (frameQueue.empty()) {
-        // No frame available yet
-        if (isFinished) {
+    // Get front frame, stale and late ones are dropped before conversion
+    int64_t clockMs = readMasterClock();
+    VideoFrame* vf = popFrameInternal(clockMs);
+    if (!vf) {
+        decodeWaiter.notify();
+        if (isFinished()) {
             // decoder has finished, and no more frames in queue
-            pthread_mutex_unlock(&queueMutex);
             return MEDIA_STATUS_EOF;
-        } else {
-            // still decoding, just no frame right now
-            pthread_mutex_unlock(&queueMutex);
-            return MEDIA_STATUS_BUFFERING;
         }
+        // still decoding, just no frame right now
+        if (playing) qos.onUnderrun();
+        return MEDIA_STATUS_BUFFERING;
     }
-    // Get front frame
-    VideoFrame* vf = frameQueue.front();
-    frameQueue.pop();
-
-    size_t currentSize = frameQueue.size();
-    if (running && currentSize <= QUEUE_MIN_SIZE) {
-        pthread_cond_signal(&queueCond);
-    }
-
-    pthread_mutex_unlock(&queueMutex);
 
-    if (!vf) {
-        return MEDIA_STATUS_ERROR;
+    qos.onFrameTaken(queueFillPercent(), 100);
+    if (running && queueBelowLowWater()) {
+        decodeWaiter.notify();
     }
 
     // EOF marker frame (virtual frame to indicate end)
@@ -283,118 +554,380 @@ int VideoDecoderController::readFrameRGBA(uint8_t* dst, int64_t* ptsMs) {
         return MEDIA_STATUS_EOF;
     }
 
-    // Normal frame: copy RGBA data
-    const int frameSizeBytes = width * height * 4;
-    if (vf->dataSize < frameSizeBytes) {
-        // Data size mismatch → treat as error and drop
+    const bool firstFrame = startFirstFrameUs == 0;
+    const int64_t convertStartUs = firstFrame ? av_gettime_relative() : 0;
+    if (vf->dataSize > 0 && vf->dataFormat == format && vf->width == width &&
+        vf->height == height && vf->dataSize <= dstSize) {
+        // primed by fast start for this format and output size
+        memcpy(dst, vf->data, (size_t) vf->dataSize);
+        if (strides) {
+            int offsets[VIDEO_FORMAT_MAX_PLANES];
+            VideoDecoder::getFrameLayout(format, width, height, strides, offsets);
+        }
+    } else if (convertFrame(vf, format, dst, dstSize, strides) <= 0) {
+        // Normal frame: convert YUV straight into the caller buffer (no staging copy).
+        // conversion failed → treat as error and drop
         freeFrame(vf);
         return MEDIA_STATUS_ERROR;
+    } else if (firstFrame && startConvertUs == 0) {
+        startConvertUs = av_gettime_relative() - convertStartUs;
     }
 
-    std::memcpy(dst, vf->data, frameSizeBytes);
-
     if (ptsMs) {
         *ptsMs = vf->ptsMs;
     }
 
     freeFrame(vf);
 
+    if (firstFrame) {
+        const int64_t nowUs = av_gettime_relative();
+        startFirstFrameUs = nowUs - initStartUs;
+        if (playStartUs > 0) startPlayToFrameUs = nowUs - playStartUs;
+        LOGI("VideoDecoderController: first frame after %lld ms (open %lld, decode %lld, convert %lld us)",
+             (long long) (startFirstFrameUs / 1000), (long long) (startOpenUs / 1000),
+             (long long) startDecodeUs, (long long) startConvertUs);
+    }
+
     return MEDIA_STATUS_OK;
 }
 
 void VideoDecoderController::freeFrame(VideoFrame* frame) {
-    if (!frame) return;
-    if (frame->data) {
-        delete[] frame->data;
-        frame->data = nullptr;
+    framePool.recycle(frame);
+}
+
+void VideoDecoderController::setConvertThreads(int count) {
+    convertThreads = count;
+    if (videoDecoder) {
+        videoDecoder->setConvertThreads(count);
+    }
+}
+
+int VideoDecoderController::getConvertThreads() const {
+    return videoDecoder ? videoDecoder->getConvertThreads() : convertThreads;
+}
+
+int VideoDecoderController::benchmarkConvert(int format, int maxThreads, int iterations,
+                                             int64_t* avgUsOut) {
+    if (!videoDecoder || !avgUsOut) return MEDIA_STATUS_ERROR;
+
+    // borrow a reference to the next queued frame, the queue keeps its own
+    AVFrame* sample = av_frame_alloc();
+    if (!sample) return MEDIA_STATUS_ERROR;
+
+    bool gotFrame = false;
+    VideoFrame** front = frameQueue.front();
+    if (front) {
+        VideoFrame* f = *front;
+        if (f && !f->eof && f->avFrame && f->avFrame->data[0]) {
+            gotFrame = av_frame_ref(sample, f->avFrame) == 0;
+        }
+    }
+
+    int ret = MEDIA_STATUS_ERROR;
+    if (gotFrame) {
+        ret = videoDecoder->benchmarkConvert(sample, format, maxThreads, iterations, avgUsOut);
+    }
+    av_frame_free(&sample);
+    return ret;
+}
+
+void VideoDecoderController::setOutputTransform(const VideoTransform& transform) {
+    outputTransform = transform;
+    if (!videoDecoder) return;
+
+    videoDecoder->setOutputTransform(transform);
+    width = videoDecoder->getOutputWidth();
+    height = videoDecoder->getOutputHeight();
+    framePool.setFrameBytes(width * height * 4);
+}
+
+void VideoDecoderController::setAccurateSeek(bool enable) {
+    accurateSeek = enable;
+    if (videoDecoder) {
+        videoDecoder->setAccurateSeek(enable);
     }
-    delete frame;
+}
+
+void VideoDecoderController::setQosEnabled(bool enable, int maxLevel) {
+    qos.setMaxLevel(maxLevel);
+    qos.setEnabled(enable);
+}
+
+void VideoDecoderController::setPacketBufferLimits(int64_t maxBytes, int64_t maxDurationMs) {
+    if (videoDecoder) {
+        videoDecoder->setPacketBufferLimits(maxBytes, maxDurationMs);
+    }
+}
+
+MediaDemuxerStats VideoDecoderController::getDemuxStats() const {
+    return videoDecoder ? videoDecoder->getDemuxStats() : MediaDemuxerStats();
+}
+
+MediaIoStats VideoDecoderController::getIoStats() const {
+    return videoDecoder ? videoDecoder->getIoStats() : MediaIoStats();
+}
+
+VideoThreadingStats VideoDecoderController::getThreadingStats() const {
+    return videoDecoder ? videoDecoder->getThreadingStats() : VideoThreadingStats();
+}
+
+MediaDemuxerQueueStats VideoDecoderController::getPacketQueueStats(AVMediaType type) const {
+    return videoDecoder ? videoDecoder->getPacketQueueStats(type) : MediaDemuxerQueueStats();
+}
+
+VideoSeekStats VideoDecoderController::getSeekStats() const {
+    return videoDecoder ? videoDecoder->getSeekStats() : VideoSeekStats();
 }
 
 void VideoDecoderController::seek(int64_t positionMs) {
-    LOGI("VideoDecoderController::seek -> %lld ms", (long long)positionMs);
+    seekInternal(positionMs, false);
+}
+
+void VideoDecoderController::seekInternal(int64_t positionMs, bool exact) {
+    LOGI("VideoDecoderController::seek -> %lld ms%s", (long long)positionMs, exact ? " (exact)" : "");
 
     if (!videoDecoder) {
         LOGE("VideoDecoderController::seek: videoDecoder is null, ignore");
         return;
     }
 
+    // the queue is about to be flushed, refilling it is not falling behind
+    qos.onDiscontinuity();
+
+    // everything queued (including an EOF marker) is stale from here on;
+    // set up before a restarted thread can look at needSeek.
+    // A target the decode thread has not picked up yet is simply overwritten;
+    // one it is working on gets interrupted through needSeek.
+    seekRequests++;
+    seekRequestUs = av_gettime_relative();
+    pendingSeekMs = positionMs;
+    pendingSeekExact = exact;
+    shownPtsUs = positionMs * 1000;
+    stepped = false;
+    // a pushed clock is from before the seek as well
+    pushedClockMs = -1;
+    clockHeldTargetMs = positionMs;
+    clockHeldSerial = (int64_t) (seekSerial.load() + 1u);
+    seekSerial++;
+    if (needSeek.exchange(true)) {
+        coalescedSeeks++;
+    }
+
     // If decode thread already finished (EOF or after stop),
     // we may need to restart it so that 'needSeek' is actually processed.
     if (!running) {
         LOGI("VideoDecoderController::seek: thread not running, restart decode thread");
-
-        clearFrameQueue();        // safe: decode thread not running
-        // Reset EOF / queue state
-        pthread_mutex_lock(&queueMutex);
-        isFinished = false;
-        pthread_mutex_unlock(&queueMutex);
-
-        needSeek = false;
-
-        running = true;
-        int createRet = pthread_create(
-                &decodeThread,
-                nullptr,
-                &VideoDecoderController::decodeThreadEntry,
-                this
-        );
-        if (createRet != 0) {
-            LOGE("VideoDecoderController::seek: pthread_create failed=%d", createRet);
-            running = false;
+        if (!startDecodeThread()) {
             return;
         }
     }
 
-    // Now thread is alive, tell it to seek
-    needSeek = true;
-    pendingSeekMs = positionMs;
-
-    // Wake decodeLoop if it is waiting on the queueCond
-    pthread_mutex_lock(&queueMutex);
-    pthread_cond_broadcast(&queueCond);
-    pthread_mutex_unlock(&queueMutex);
+    // Wake decodeLoop if it is parked on a full queue
+    decodeWaiter.notify();
 }
 
 void VideoDecoderController::play() {
+    qos.onDiscontinuity();
+    if (prerolling.exchange(false) && running) {
+        // the thread already decoded ahead: continue with the queued frames
+        if (playStartUs == 0) playStartUs = av_gettime_relative();
+        playing = true;
+        decodeWaiter.notify();
+        return;
+    }
     if (!running) {
         // First time: start decode thread
-        running = true;
+        if (playStartUs == 0) playStartUs = av_gettime_relative();
         playing = true;
-
-        int createRet = pthread_create(
-                &decodeThread,
-                nullptr,
-                &VideoDecoderController::decodeThreadEntry,
-                this
-        );
-        if (createRet != 0) {
-            running = false;
-
-            delete videoDecoder;
+        if (!startDecodeThread()) {
+            VideoDecoderPool::recycle(videoDecoder);
             videoDecoder = nullptr;
             return;
         }
     } else {
         // Thread already exists → treat this as "play from start"
+        seekRequestUs = 0;
+        seekSerial++;
         needSeek = true;
 //        pendingSeekMs = 0;   // seek to 0ms (beginning)
         playing = true;
+        decodeWaiter.notify();
+    }
+}
+
+int VideoDecoderController::preroll() {
+    if (!videoDecoder || running) {
+        return MEDIA_STATUS_ERROR;
+    }
+    prerolling = true;
+    startPrerolled = true;
+    if (!startDecodeThread()) {
+        prerolling = false;
+        return MEDIA_STATUS_ERROR;
+    }
+    return MEDIA_STATUS_OK;
+}
+
+int VideoDecoderController::primeFirstFrame(int format) {
+    if (prerolling) {
+        // the preroll thread is decoding the first frames already
+        return MEDIA_STATUS_OK;
+    }
+    if (!videoDecoder || running || !frameQueue.empty()) {
+        return MEDIA_STATUS_ERROR;
     }
+
+    // the decode thread does not exist yet: this thread is the producer
+    const int64_t beginUs = av_gettime_relative();
+    int ret;
+    do {
+        ret = videoDecoder->decodeFrame();
+    } while (ret == AVERROR(EAGAIN) &&
+             av_gettime_relative() - beginUs < FAST_START_DECODE_TIMEOUT_US);
+    if (ret <= 0) {
+        LOGE("VideoDecoderController::primeFirstFrame: decode failed %d", ret);
+        return MEDIA_STATUS_ERROR;
+    }
+    VideoFrame* vf = wrapDecodedFrame();
+    if (!vf) {
+        return MEDIA_STATUS_ERROR;
+    }
+    const int64_t decodedUs = av_gettime_relative();
+    startDecodeUs = decodedUs - beginUs;
+
+    // converting now builds the sws context (and slice workers) for this
+    // format; the YUV reference stays in case the consumer asks for another
+    if (framePool.ensureBuffer(vf)) {
+        int bytes = videoDecoder->convertTo(vf->avFrame, format, vf->data, vf->bufferCapacity, nullptr);
+        if (bytes > 0) {
+            vf->dataSize = bytes;
+            vf->dataFormat = format;
+        }
+    }
+    startConvertUs = av_gettime_relative() - decodedUs;
+
+    decodeSerial = seekSerial.load();
+    pushFrame(vf);
+    LOGI("VideoDecoderController::primeFirstFrame pts=%.1f ms, decode %lld us, convert %lld us",
+         vf->ptsMs, (long long) startDecodeUs, (long long) startConvertUs);
+    return MEDIA_STATUS_OK;
+}
+
+int VideoDecoderController::stepFrame(int direction, int format, uint8_t* dst, int dstSize,
+                                      int* strides, int64_t* ptsMs, int64_t timeoutMs) {
+    if (!videoDecoder || !dst || live) {
+        return MEDIA_STATUS_ERROR;
+    }
+    if (!gopCache) {
+        gopCache = new GopCache();
+        gopCache->setBudget(gopCacheBudget);
+        if (gopCache->open(sourcePath.c_str(), ioOptions, threadPolicy, decodeThreads) < 0) {
+            LOGE("VideoDecoderController::stepFrame: GOP cache open failed");
+            delete gopCache;
+            gopCache = nullptr;
+            return MEDIA_STATUS_ERROR;
+        }
+    }
+
+    // forward decoding waits; resume() seeks to the stepped frame
+    playing = false;
+    stepped = true;
+
+    AVFrame* frame = av_frame_alloc();
+    if (!frame) return MEDIA_STATUS_ERROR;
+    int64_t pts = 0;
+    int ret = gopCache->step(shownPtsUs, direction, timeoutMs, frame, &pts);
+    if (ret == MEDIA_STATUS_OK) {
+        // converted like queued frames: same output transform and converter
+        if (videoDecoder->convertTo(frame, format, dst, dstSize, strides) <= 0) {
+            ret = MEDIA_STATUS_ERROR;
+        } else {
+            shownPtsUs = pts;
+            if (ptsMs) *ptsMs = pts / 1000;
+        }
+    }
+    av_frame_free(&frame);
+    return ret;
+}
+
+void VideoDecoderController::setGopCacheBudget(int64_t bytes) {
+    if (bytes <= 0) return;
+    gopCacheBudget = bytes;
+    if (gopCache) gopCache->setBudget(bytes);
+}
+
+GopCacheStats VideoDecoderController::getGopCacheStats() {
+    GopCacheStats stats;
+    if (gopCache) {
+        stats = gopCache->getStats();
+    } else {
+        stats.budgetBytes = gopCacheBudget > 0 ? gopCacheBudget : GopCache::DEFAULT_BUDGET_BYTES;
+    }
+    return stats;
+}
+
+VideoLiveStats VideoDecoderController::getLiveStats() const {
+    VideoLiveStats stats;
+    stats.live = live;
+    stats.targetMs = liveCatchUp.getTarget();
+    if (!live) return stats;
+    stats.catchingUp = liveCatchUp.isCatchingUp();
+    stats.bufferMs = liveCatchUp.getLatencyMs();
+    stats.catchUps = liveCatchUp.getCatchUps();
+    stats.catchUpMs = liveCatchUp.getCatchUpMs(av_gettime_relative() / 1000);
+    if (videoDecoder) {
+        MediaDemuxerStats demux = videoDecoder->getDemuxStats();
+        stats.skips = demux.liveSkips;
+        stats.skippedMs = demux.liveSkippedMs;
+    }
+    return stats;
+}
+
+VideoStartupStats VideoDecoderController::getStartupStats() const {
+    VideoStartupStats stats;
+    stats.fastStart = fastStart;
+    stats.probeCached = startProbeCached;
+    stats.openUs = startOpenUs;
+    stats.firstDecodeUs = startDecodeUs;
+    stats.firstConvertUs = startConvertUs;
+    stats.threadStartUs = startThreadUs;
+    stats.playToFirstFrameUs = startPlayToFrameUs;
+    stats.firstFrameUs = startFirstFrameUs;
+    stats.codecReused = startCodecReused;
+    stats.prerolled = startPrerolled;
+    return stats;
+}
+
+bool VideoDecoderController::startDecodeThread() {
+    if (decodeThread) {
+        // ended on EOF; its worker is parked by the join
+        DecodeWorker::join(decodeThread);
+        decodeThread = nullptr;
+    }
+    running = true;
+    // a parked worker of an earlier clip when there is one
+    decodeThread = DecodeWorker::run(&VideoDecoderController::decodeThreadEntry, this);
+    if (!decodeThread) {
+        running = false;
+        return false;
+    }
+    return true;
 }
 
 void VideoDecoderController::resume() {
+    qos.onDiscontinuity();
+    if (stepped.exchange(false) && videoDecoder) {
+        // the queued frames are from before the stepping
+        const int64_t shownUs = shownPtsUs;
+        seekInternal(shownUs / 1000, true);
+    }
     playing = true;
-    pthread_mutex_lock(&queueMutex);
-    pthread_cond_broadcast(&queueCond);
-    pthread_mutex_unlock(&queueMutex);
+    decodeWaiter.notify();
 }
 
 void VideoDecoderController::pause() {
     playing = false;
-    pthread_mutex_lock(&queueMutex);
-    pthread_cond_broadcast(&queueCond);
-    pthread_mutex_unlock(&queueMutex);
+    decodeWaiter.notify();
 }
 
 void VideoDecoderController::stop() {
@@ -402,27 +935,29 @@ void VideoDecoderController::stop() {
     running = false;
     needSeek = false;
 
-    // Wake up decodeLoop if it's waiting on queueCond
-    pthread_mutex_lock(&queueMutex);
-    pthread_cond_broadcast(&queueCond);
-    pthread_mutex_unlock(&queueMutex);
+    // Wake up decodeLoop if it's parked
+    decodeWaiter.notify();
 
     // 2) Join decode thread
-    //    (assuming decodeThread was created with pthread_create)
     if (decodeThread) {
-        pthread_join(decodeThread, nullptr);
-        decodeThread = 0;
+        DecodeWorker::join(decodeThread);
+        decodeThread = nullptr;
     }
 
-    // 3) Clear remaining frames in queue
-    clearFrameQueue();
+    // 3) Clear remaining frames in queue (the reader must be stopped too)
+    drainFrameQueue();
 
     // 4) Reset state flags
-    isFinished = false;
+    finishedSerial = -1;
+    if (gopCache) {
+        delete gopCache;
+        gopCache = nullptr;
+    }
 
-    // 5) Destroy underlying decoder
+    // 5) Park the underlying decoder for the next clip
     if (videoDecoder) {
-        delete videoDecoder;
+        VideoDecoderPool::recycle(videoDecoder);
         videoDecoder = nullptr;
     }
+    prerolling = false;
 }
@@ -4,10 +4,67 @@
 
 #pragma once
 
-#include <queue>
+#include <atomic>
+#include <string>
 #include <pthread.h>
+#include "spsc_ring.h"
+#include "gop_cache.h"
+#include "live_latency.h"
 #include "video_decoder.h"   // your FFmpeg-based VideoDecoder
+#include "video_decoder_pool.h"
 #include "video_frame.h"
+#include "video_frame_pool.h"
+#include "video_qos_controller.h"
+
+struct VideoQueueStats {
+    int     frames = 0;
+    int64_t bytes = 0;          // decoded frames queued plus RGBA staging buffers
+    int64_t durationMs = 0;     // pts span of the queued frames
+    int64_t maxBytes = 0;
+    int64_t maxDurationMs = 0;
+    int     poolCapacity = 0;   // frames the pool was sized for
+};
+
+struct VideoSeekLatencyStats {
+    uint64_t requests = 0;   // seek() calls
+    uint64_t coalesced = 0;  // replaced by a newer seek before the decode thread saw them
+    uint64_t aborted = 0;    // decodes / accurate-seek discard runs cut short by a newer seek
+    int      samples = 0;    // latencies in the window below
+    int64_t  p50Us = 0;      // seek() → first frame of that seek handed to the consumer
+    int64_t  p90Us = 0;
+    int64_t  p99Us = 0;
+    int64_t  maxUs = 0;
+    int64_t  lastUs = 0;
+};
+
+// time-to-first-frame by stage, microseconds; 0 = stage not reached (yet)
+struct VideoStartupStats {
+    bool    fastStart = false;
+    bool    probeCached = false;       // ProbeCache skipped avformat_find_stream_info
+    int64_t openUs = 0;                // init(): container open, probe, codec open
+    int64_t firstDecodeUs = 0;         // decoding the first frame
+    int64_t firstConvertUs = 0;        // converting it, includes building the sws context
+    int64_t threadStartUs = 0;         // play() → decode loop running
+    int64_t playToFirstFrameUs = 0;    // play() → first frame handed to the consumer
+    int64_t firstFrameUs = 0;          // init() → first frame handed to the consumer
+    bool    codecReused = false;       // VideoDecoderPool: no avcodec_open2 for this file
+    bool    prerolled = false;         // decoding started before play(), see preroll()
+};
+
+// live sources only (MediaIoOptions::live), see LiveCatchUp
+struct VideoLiveStats {
+    bool     live = false;
+    bool     catchingUp = false;   // skipping non-reference frames right now
+    int64_t  targetMs = 0;
+    int64_t  bufferMs = -1;        // live edge - pts of the last frame handed out
+    uint64_t catchUps = 0;         // times the buffer went over the target
+    int64_t  catchUpMs = 0;        // time spent catching up
+    uint64_t skips = 0;            // demuxer cut the backlog at a keyframe
+    int64_t  skippedMs = 0;        // content dropped by those cuts
+};
+
+// master clock in ms (e.g. the audio clock), <=0 while it is not running yet
+typedef int64_t (*MasterClockFn)(void* opaque);
 
 class VideoDecoderController {
 public:
@@ -20,7 +77,9 @@ public:
     // Stop decode thread and release everything
     void destroy();
 
-    // Consumer API: pop one frame from queue
+    // Consumer API: pop one frame from queue, converted to RGBA on take.
+    // getFrame / readFrame* / benchmarkConvert form the single consumer of
+    // the lock-free frame queue: call them from one thread at a time.
     // return:
     //   >0 : got frame, frameOut is valid
     //   0  : EOF, no more frames (frameOut=nullptr)
@@ -40,15 +99,167 @@ public:
     */
     int readFrameRGBA(uint8_t* dst, int64_t* ptsMs);
 
-    // After rendering, caller must free frame buffer
-    static void freeFrame(VideoFrame* frame);
+    /**
+    * Consumer side: read one decoded frame in the requested output format.
+    *
+    * Planes are packed one after another in dst (see VideoDecoder::getFrameLayout).
+    * I420 from a yuv420p stream is a plain plane copy, RGB565/NV12 halve the
+    * bytes moved compared with RGBA.
+    *
+    * @param format   VIDEO_FORMAT_RGBA / I420 / NV12 / RGB565
+    * @param dst      output buffer, size >= getFrameBufferSize(format)
+    * @param dstSize  capacity of dst in bytes
+    * @param strides  [out, optional] VIDEO_FORMAT_MAX_PLANES line sizes
+    * @param ptsMs    [out] presentation timestamp in milliseconds
+    *
+    * @return MediaStatus_OK / MediaStatus_EOF / MediaStatus_BUFFERING / MediaStatus_ERROR
+    */
+    int readFrame(int format, uint8_t* dst, int dstSize, int* strides, int64_t* ptsMs);
+
+    // bytes needed by readFrame() for one frame in `format`, <0 if unknown
+    int getFrameBufferSize(int format) const;
 
+    // After rendering, caller must give the frame back (recycled into the pool)
+    void freeFrame(VideoFrame* frame);
+
+    VideoFramePoolStats getFramePoolStats() { return framePool.getStats(); }
+
+    /**
+     * Frame queue budget: the decoder stops once the queued frames hold
+     * maxBytes (decoded buffers plus RGBA staging buffers) or maxDurationMs of
+     * content, whichever comes first, and resumes when the queue has drained
+     * to a quarter of both.
+     * Memory stays the same across resolutions; small streams get more frames.
+     * <=0 keeps the current value. The frame pool is resized to match.
+     */
+    void setQueueBudget(int64_t maxBytes, int64_t maxDurationMs);
+    VideoQueueStats getQueueStats();
+
+    // Colour conversion worker count (1 = single-threaded sws_scale).
+    // Takes effect on the next converted frame.
+    void setConvertThreads(int count);
+    int getConvertThreads() const;
+
+    // codec threading for the next init(), see VideoThreadPolicy;
+    // threads <= 0 picks by core count
+    void setThreadPolicy(int policy, int threads) {
+        threadPolicy = policy;
+        decodeThreads = threads;
+    }
+    VideoThreadingStats getThreadingStats() const;
+
+    /**
+     * Convert the next queued frame `iterations` times with 1..maxThreads
+     * workers and report the average conversion time for each count.
+     * Consumer side, like readFrame().
+     *
+     * @param avgUsOut  [out] maxThreads entries, microseconds per frame
+     * @return number of entries written, <0 if no frame is available
+     */
+    int benchmarkConvert(int format, int maxThreads, int iterations, int64_t* avgUsOut);
+
+    /**
+     * Crop / rotate / scale-to-surface for converted frames (see VideoTransform).
+     * Can be called before init() or while playing; getWidth()/getHeight()
+     * then report the output size.
+     */
+    void setOutputTransform(const VideoTransform& transform);
+    int getDisplayRotation() const { return videoDecoder ? videoDecoder->getDisplayRotation() : 0; }
+
+    /**
+     * Latest seek wins: a seek replaces one the decode thread has not picked
+     * up yet, and interrupts the decode (or accurate-seek discard loop) of one
+     * it is working on. Frames queued for older seeks are never handed out.
+     */
     void seek(int64_t positionMs);
 
-    // For later A/V sync
+    // decode-and-discard up to the exact seek target (see VideoDecoder::setAccurateSeek)
+    void setAccurateSeek(bool enable);
+
+    /**
+     * Frame stepping and reverse playback: convert the frame before
+     * (direction < 0) or after the one last handed out (or the last seek
+     * target) into dst, served from the GOP cache (see GopCache), which is
+     * created on first use. Pauses forward decoding; resume() continues from
+     * the stepped frame. Waits up to timeoutMs for a GOP that is not decoded
+     * yet. Consumer side, like readFrame(); not for live sources.
+     *
+     * @return MediaStatus_OK / MediaStatus_EOF (start or end reached) /
+     *         MediaStatus_BUFFERING (GOP still decoding) / MediaStatus_ERROR
+     */
+    int stepFrame(int direction, int format, uint8_t* dst, int dstSize, int* strides,
+                  int64_t* ptsMs, int64_t timeoutMs);
+    // decoded bytes the GOP cache may hold, <=0 keeps the default
+    void setGopCacheBudget(int64_t bytes);
+    GopCacheStats getGopCacheStats();
+    VideoSeekStats getSeekStats() const;
+    // percentiles over the last SEEK_LATENCY_WINDOW completed seeks
+    VideoSeekLatencyStats getSeekLatencyStats();
+
+    /**
+     * Adaptive quality: when the queue keeps running dry, step down
+     * skip loop filter → skip non-reference frames → fast scaling, and back up
+     * once the decoder has headroom again (see VideoQosController).
+     */
+    void setQosEnabled(bool enable, int maxLevel);
+    VideoQosStats getQosStats() { return qos.getStats(); }
+
+    /**
+     * Compressed packets buffered by the demux thread ahead of the decoders,
+     * bounded by bytes and by buffered duration (see MediaDemuxer).
+     */
+    void setPacketBufferLimits(int64_t maxBytes, int64_t maxDurationMs);
+    MediaDemuxerStats getDemuxStats() const;
+    // custom AVIO (mmap / memory / read-ahead), used by the next init()
+    void setIoOptions(const MediaIoOptions& options) { ioOptions = options; }
+    // path passed to init()
+    const std::string& getSourcePath() const { return sourcePath; }
+    MediaIoStats getIoStats() const;
+    MediaDemuxerQueueStats getPacketQueueStats(AVMediaType type) const;
+
+    /**
+     * Late-frame culling: frames whose pts is more than lateThresholdMs behind
+     * the master clock are dropped on take, before any colour conversion or
+     * copy. fn == nullptr disables it. The clock is read on the consumer thread.
+     * After a seek nothing is culled until the clock is back near the target.
+     */
+    void setMasterClock(MasterClockFn fn, void* opaque, int64_t lateThresholdMs);
+    // clock source for setMasterClock(pushedMasterClock, controller, ...)
+    // when the clock lives on the Java side (AudioTrack)
+    void updateMasterClock(int64_t clockMs) { pushedClockMs = clockMs; }
+    static int64_t pushedMasterClock(void* controller);
+    uint64_t getLateDropCount() const { return lateDrops; }
+
+    // size of the frames handed out (after the output transform)
     int getWidth() const { return width; }
     int getHeight() const { return height; }
 
+    /**
+     * Fast start: the next init() probes with a small probesize /
+     * analyzeduration, and primeFirstFrame() decodes and converts the first
+     * keyframe before play(), so it is handed out without waiting for the
+     * decode thread or a cold sws context.
+     */
+    void setFastStart(bool enable) { fastStart = enable; }
+    // after init() and setOutputTransform(), before play(); `format` as readFrame()
+    int primeFirstFrame(int format);
+    /**
+     * After init(), instead of primeFirstFrame(): start the decode thread
+     * without playing, it fills the frame queue and waits. play() then hands
+     * out the queued frames at once (next playlist item opened ahead of time).
+     */
+    int preroll();
+    VideoStartupStats getStartupStats() const;
+
+    /**
+     * Live latency target, used when the source is opened with
+     * MediaIoOptions::live: over it, non-reference frames are skipped until
+     * the buffer is back at the target; a backlog beyond
+     * LiveCatchUp::maxBacklogMs() is cut by the demuxer. Any time.
+     */
+    void setLiveTarget(int64_t targetMs) { liveCatchUp.setTarget(targetMs); }
+    VideoLiveStats getLiveStats() const;
+
     // Play from start or current seek position
     void play();
 
@@ -64,25 +275,73 @@ public:
     void stop();
 
 private:
-    static void* decodeThreadEntry(void* arg);
+    static void decodeThreadEntry(void* arg);
     void decodeLoop();
 
+    // convert a queued YUV frame into dst, called on the consumer side
+    int convertFrame(VideoFrame* frame, int format, uint8_t* dst, int dstSize, int* strides);
+
+    // decode thread: push the QoS level into the decoder
+    void applyQosLevel(int level);
+
+    // decode thread (or primeFirstFrame() before it exists)
+    VideoFrame* wrapDecodedFrame();
     void pushFrame(VideoFrame* frame);
-    VideoFrame* popFrameInternal();
-    void clearFrameQueue();
+    void pushEofMarker();
+    // consumer: pops the next frame, dropping stale (pre-seek) and late ones
+    VideoFrame* popFrameInternal(int64_t clockMs);
+    // EOF marker of the current serial was queued
+    bool isFinished() const;
+    // decode thread joined and nobody reading
+    void drainFrameQueue();
+    int64_t queuedDurationMs() const;
+    int queueFillPercent() const;
+    bool queueFull() const;
+    bool queueBelowLowWater() const;
+    // frames the budget holds for this stream, sizes the pool
+    int budgetFrameCount() const;
+    int64_t readMasterClock();
+    // consumer: first frame of a new serial handed out
+    void recordSeekLatency(int64_t latencyUs);
+    // (re)start the decode thread, reaping one that ended on EOF
+    bool startDecodeThread();
+    // exact: decode-and-discard to the target whatever setAccurateSeek() says
+    void seekInternal(int64_t positionMs, bool exact);
 private:
     VideoDecoder* videoDecoder = nullptr;
 
-    pthread_t decodeThread{};
-    bool isFinished = false;
+    DecodeWorker* decodeThread = nullptr;   // parked again after the clip
 
-    // Producer-consumer queue
-    std::queue<VideoFrame*> frameQueue;
-    pthread_mutex_t queueMutex{};
-    pthread_cond_t  queueCond{};
+    // Decoded frames, decode thread → consumer, lock-free (holds refcounted
+    // YUV frames, not RGBA). A seek bumps seekSerial instead of clearing the
+    // queue from the wrong side; the consumer drops frames of older serials.
+    SpscRing<VideoFrame*> frameQueue{QUEUE_RING_CAPACITY};
+    // decode thread parks here on a full queue / pause
+    SpscWaiter decodeWaiter;
+    std::atomic<uint32_t> seekSerial{0};
+    uint32_t decodeSerial = 0;                  // decode thread: serial it produces
+    std::atomic<int64_t> finishedSerial{-1};    // serial whose EOF marker was queued
 
+    // preallocated frames, recycled through freeFrame()
+    VideoFramePool framePool;
+
+    // seek mailbox: the newest target overwrites pendingSeekMs; needSeek
+    // doubles as the decoder's interrupt flag
     std::atomic<bool>  needSeek{false};
     std::atomic<int64_t> pendingSeekMs{0};
+    std::atomic<bool>  pendingSeekExact{false};
+    std::atomic<int64_t> seekRequestUs{0};      // 0: serial bumped by play(), not timed
+    std::atomic<uint64_t> seekRequests{0};
+    std::atomic<uint64_t> coalescedSeeks{0};
+    std::atomic<uint64_t> abortedDecodes{0};
+    int64_t latencySerial = -1;                 // consumer: last serial timed
+
+    static const int SEEK_LATENCY_WINDOW = 128;
+    pthread_mutex_t latencyMutex{};             // once per seek, never per frame
+    int64_t seekLatencyUs[SEEK_LATENCY_WINDOW] = {0};
+    int     seekLatencyCount = 0;
+    int     seekLatencyNext = 0;
+    int64_t lastSeekLatencyUs = 0;
 
     std::atomic<bool> running{false};   // decode thread exists
     std::atomic<bool> playing{false};   // currently playing (not paused)
@@ -90,7 +349,80 @@ private:
     int width = 0;
     int height = 0;
 
-    // queue thresholds
-    static const int QUEUE_MAX_SIZE = 30;   // max buffered frames
-    static const int QUEUE_MIN_SIZE = 5;    // wake producer when low
+    int convertThreads = 0;   // 0 = decoder default (SliceConverter::defaultThreadCount)
+    int threadPolicy = VIDEO_THREADS_AUTO;
+    int decodeThreads = 0;
+    VideoTransform outputTransform;
+    bool accurateSeek = false;
+    MediaIoOptions ioOptions;
+    std::string sourcePath;
+
+    // frame stepping, see stepFrame()
+    GopCache* gopCache = nullptr;
+    int64_t gopCacheBudget = 0;
+    std::atomic<int64_t> shownPtsUs{0};     // frame last handed out (or seek target)
+    std::atomic<bool> stepped{false};       // forward queue is behind the stepped frame
+
+    // time-to-first-frame, see VideoStartupStats
+    bool fastStart = false;
+    bool startProbeCached = false;
+    bool startCodecReused = false;
+    bool startPrerolled = false;
+    std::atomic<bool> prerolling{false};    // decode thread runs ahead of play()
+    std::atomic<int64_t> initStartUs{0};
+    std::atomic<int64_t> playStartUs{0};        // first play() after init()
+    std::atomic<int64_t> startOpenUs{0};
+    std::atomic<int64_t> startDecodeUs{0};
+    std::atomic<int64_t> startConvertUs{0};
+    std::atomic<int64_t> startThreadUs{0};
+    std::atomic<int64_t> startPlayToFrameUs{0};
+    std::atomic<int64_t> startFirstFrameUs{0};
+
+    // late-frame culling
+    pthread_mutex_t clockMutex{};
+    MasterClockFn masterClock = nullptr;
+    void* masterClockOpaque = nullptr;
+    std::atomic<int64_t> lateThresholdMs{0};
+    std::atomic<int64_t> pushedClockMs{-1};
+    std::atomic<uint64_t> lateDrops{0};
+    // serial whose culling waits for the clock to reach clockHeldTargetMs, -1 none
+    std::atomic<int64_t> clockHeldSerial{-1};
+    std::atomic<int64_t> clockHeldTargetMs{0};
+
+    VideoQosController qos;
+    int appliedQosLevel = VIDEO_QOS_FULL;   // decode thread only
+
+    // live catch-up: buffer measured by the consumer, applied by the decoder
+    bool live = false;
+    LiveCatchUp liveCatchUp;
+    bool appliedCatchUp = false;            // decode thread only
+
+    // queue budget, see setQueueBudget()
+    std::atomic<int64_t> queueMaxBytes{DEFAULT_QUEUE_BYTES};
+    std::atomic<int64_t> queueMaxDurationMs{DEFAULT_QUEUE_DURATION_MS};
+    std::atomic<int64_t> queuedBytes{0};
+    // pts span for the duration budget: newest frame pushed, frame last taken
+    // (or the first one of a serial before anything was taken)
+    std::atomic<int64_t> newestPtsMs{0};
+    std::atomic<int64_t> newestSerial{-1};
+    std::atomic<int64_t> firstPtsMs{0};
+    std::atomic<int64_t> takenPtsMs{0};
+    std::atomic<int64_t> takenSerial{-1};
+
+    static constexpr int64_t DEFAULT_QUEUE_BYTES = 64 * 1024 * 1024;
+    static constexpr int64_t DEFAULT_QUEUE_DURATION_MS = 1000;
+    static const int QUEUE_LOW_WATER_PERCENT = 25;  // wake producer below this fill
+    static const int QUEUE_MIN_FRAMES = 2;          // even when one frame exceeds the budget
+    static const int QUEUE_MAX_FRAMES = 120;        // tiny frames at high frame rates
+    // ring slots: QUEUE_MAX_FRAMES plus EOF markers of flushed serials
+    static const int QUEUE_RING_CAPACITY = 128;
+    // frames outside the queue: one held by the consumer, one being filled by
+    // the decoder and the EOF marker
+    static const int POOL_SPARE_FRAMES = 3;
+
+    // fast start: enough for the header and first GOP of typical files
+    static constexpr int64_t FAST_START_PROBE_SIZE = 512 * 1024;
+    static constexpr int64_t FAST_START_ANALYZE_US = 500 * 1000;
+    // primeFirstFrame() gives up and leaves it to the decode thread after this
+    static constexpr int64_t FAST_START_DECODE_TIMEOUT_US = 3 * 1000 * 1000;
 };
@@ -0,0 +1,176 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include "video_decoder_pool.h"
+#include "video_decoder.h"
+
+#define LOG_TAG "VideoDecoderPool"
+#include "CommonTools.h"
+
+pthread_mutex_t VideoDecoderPool::mutex = PTHREAD_MUTEX_INITIALIZER;
+std::vector<VideoDecoder*> VideoDecoderPool::idle;
+VideoDecoderPoolStats VideoDecoderPool::stats;
+
+VideoDecoder* VideoDecoderPool::obtain() {
+    VideoDecoder* decoder = nullptr;
+    pthread_mutex_lock(&mutex);
+    stats.obtained++;
+    if (!idle.empty()) {
+        decoder = idle.back();
+        idle.pop_back();
+        stats.warm++;
+    }
+    pthread_mutex_unlock(&mutex);
+    return decoder ? decoder : new VideoDecoder();
+}
+
+void VideoDecoderPool::recycle(VideoDecoder* decoder) {
+    if (!decoder) return;
+    // outside the lock: unsubscribing may wait for the demux thread
+    decoder->park();
+
+    VideoDecoder* evicted = nullptr;
+    pthread_mutex_lock(&mutex);
+    idle.push_back(decoder);
+    if ((int) idle.size() > MAX_IDLE) {
+        evicted = idle.front();
+        idle.erase(idle.begin());
+        stats.evictions++;
+    }
+    pthread_mutex_unlock(&mutex);
+    delete evicted;
+}
+
+void VideoDecoderPool::clear() {
+    std::vector<VideoDecoder*> parked;
+    pthread_mutex_lock(&mutex);
+    parked.swap(idle);
+    pthread_mutex_unlock(&mutex);
+    for (VideoDecoder* decoder : parked) {
+        delete decoder;
+    }
+    if (!parked.empty()) {
+        LOGI("VideoDecoderPool::clear released %d decoder(s)", (int) parked.size());
+    }
+}
+
+VideoDecoderPoolStats VideoDecoderPool::getStats() {
+    pthread_mutex_lock(&mutex);
+    VideoDecoderPoolStats copy = stats;
+    copy.idle = (int) idle.size();
+    pthread_mutex_unlock(&mutex);
+    return copy;
+}
+
+pthread_mutex_t DecodeWorker::poolMutex = PTHREAD_MUTEX_INITIALIZER;
+std::vector<DecodeWorker*> DecodeWorker::parked;
+
+DecodeWorker::DecodeWorker() {
+    pthread_mutex_init(&mutex, nullptr);
+    pthread_cond_init(&cond, nullptr);
+}
+
+DecodeWorker::~DecodeWorker() {
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+}
+
+DecodeWorker* DecodeWorker::run(void (*task)(void*), void* arg) {
+    DecodeWorker* worker = nullptr;
+    pthread_mutex_lock(&poolMutex);
+    if (!parked.empty()) {
+        worker = parked.back();
+        parked.pop_back();
+    }
+    pthread_mutex_unlock(&poolMutex);
+
+    if (!worker) {
+        worker = new DecodeWorker();
+        int ret = pthread_create(&worker->thread, nullptr, &DecodeWorker::threadEntry, worker);
+        if (ret != 0) {
+            LOGE("DecodeWorker: pthread_create failed=%d", ret);
+            delete worker;
+            return nullptr;
+        }
+    }
+
+    pthread_mutex_lock(&worker->mutex);
+    worker->task = task;
+    worker->taskArg = arg;
+    worker->busy = true;
+    pthread_cond_broadcast(&worker->cond);
+    pthread_mutex_unlock(&worker->mutex);
+    return worker;
+}
+
+void DecodeWorker::join(DecodeWorker* worker) {
+    if (!worker) return;
+    pthread_mutex_lock(&worker->mutex);
+    while (worker->busy) {
+        pthread_cond_wait(&worker->cond, &worker->mutex);
+    }
+    pthread_mutex_unlock(&worker->mutex);
+
+    bool keep = false;
+    pthread_mutex_lock(&poolMutex);
+    if ((int) parked.size() < MAX_IDLE) {
+        parked.push_back(worker);
+        keep = true;
+    }
+    pthread_mutex_unlock(&poolMutex);
+    if (!keep) worker->quit();
+}
+
+void DecodeWorker::clear() {
+    std::vector<DecodeWorker*> workers;
+    pthread_mutex_lock(&poolMutex);
+    workers.swap(parked);
+    pthread_mutex_unlock(&poolMutex);
+    for (DecodeWorker* worker : workers) {
+        worker->quit();
+    }
+}
+
+int DecodeWorker::idleCount() {
+    pthread_mutex_lock(&poolMutex);
+    int count = (int) parked.size();
+    pthread_mutex_unlock(&poolMutex);
+    return count;
+}
+
+void* DecodeWorker::threadEntry(void* arg) {
+    static_cast<DecodeWorker*>(arg)->loop();
+    return nullptr;
+}
+
+void DecodeWorker::loop() {
+    pthread_mutex_lock(&mutex);
+    while (true) {
+        while (!task && !quitting) {
+            pthread_cond_wait(&cond, &mutex);
+        }
+        if (!task) break;
+        void (*current)(void*) = task;
+        void* arg = taskArg;
+        pthread_mutex_unlock(&mutex);
+
+        current(arg);
+
+        pthread_mutex_lock(&mutex);
+        task = nullptr;
+        taskArg = nullptr;
+        busy = false;
+        pthread_cond_broadcast(&cond);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+void DecodeWorker::quit() {
+    pthread_mutex_lock(&mutex);
+    quitting = true;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+    pthread_join(thread, nullptr);
+    delete this;
+}
@@ -0,0 +1,89 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <pthread.h>
+
+class VideoDecoder;
+
+struct VideoDecoderPoolStats {
+    int      idle = 0;           // parked decoders ready for the next clip
+    uint64_t obtained = 0;       // decoders handed out
+    uint64_t warm = 0;           // ... of which came out of the pool
+    uint64_t evictions = 0;      // parked decoders destroyed to stay under the cap
+};
+
+/**
+ * Decoders of finished clips, kept warm for the next one. A parked
+ * VideoDecoder keeps its flushed codec context (with FFmpeg's frame / slice
+ * worker threads), the colour-conversion workers and the scalers; when the
+ * next file has the same codec, geometry and extradata, open() skips
+ * avcodec_open2() and the first convert needs no new sws context.
+ *
+ * Most recently parked first: a playlist of same-format clips alternates
+ * between at most two decoders (the one playing and the one preloading the
+ * next clip). Any thread.
+ */
+class VideoDecoderPool {
+public:
+    static constexpr int MAX_IDLE = 2;
+
+    // a parked decoder, or a new one when the pool is empty
+    static VideoDecoder* obtain();
+    // park `decoder` (closes its file), or delete it when the pool is full
+    static void recycle(VideoDecoder* decoder);
+    // delete every parked decoder (memory pressure)
+    static void clear();
+
+    static VideoDecoderPoolStats getStats();
+
+private:
+    static pthread_mutex_t mutex;
+    static std::vector<VideoDecoder*> idle;
+    static VideoDecoderPoolStats stats;
+};
+
+/**
+ * Decode threads of finished clips, parked instead of exiting. run() hands a
+ * task to a parked worker (or starts one), join() waits for it to return and
+ * parks the worker for the next clip, so a playlist switch or a preload does
+ * not pay for pthread_create(). Any thread.
+ */
+class DecodeWorker {
+public:
+    static constexpr int MAX_IDLE = 2;
+
+    // runs task(arg) on a worker; nullptr when no thread could be started
+    static DecodeWorker* run(void (*task)(void*), void* arg);
+    // waits until the task of `worker` returned, then parks or ends it
+    static void join(DecodeWorker* worker);
+    // end every parked worker
+    static void clear();
+
+    static int idleCount();
+
+private:
+    DecodeWorker();
+    ~DecodeWorker();
+
+    static void* threadEntry(void* arg);
+    void loop();
+    // ends the thread; the worker must be idle
+    void quit();
+
+    pthread_t thread{};
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    // guarded by mutex
+    void (*task)(void*) = nullptr;
+    void* taskArg = nullptr;
+    bool busy = false;
+    bool quitting = false;
+
+    static pthread_mutex_t poolMutex;
+    static std::vector<DecodeWorker*> parked;
+};
@@ -6,15 +6,31 @@
 
 #include <cstdint>
 
+extern "C" {
+#include <libavutil/frame.h>
+}
+
 struct VideoFrame {
     int width = 0;
     int height = 0;
     double ptsMs = 0.0;      // presentation timestamp in ms
 
-    int dataSize = 0;        // bytes in buffer
-    uint8_t* data = nullptr; // RGBA data (width * height * 4)
+    // decoded YUV frame (refcounted, owns a reference to the codec's buffer).
+    // RGBA conversion is deferred until the consumer actually takes the frame,
+    // so frames dropped or flushed by a seek never pay for sws_scale.
+    AVFrame* avFrame = nullptr;
+
+    int decodedBytes = 0;    // size of the buffers behind avFrame, for the queue budget
+
+    int dataSize = 0;        // bytes converted into data (0 = not converted yet)
+    int dataFormat = 0;      // VIDEO_FORMAT_* of data, valid while dataSize > 0
+    uint8_t* data = nullptr; // RGBA data (width * height * 4), filled lazily
+    int bufferCapacity = 0;  // allocated bytes behind data (64-byte aligned)
+
+    bool pooled = false;     // owned by VideoFramePool (false = heap fallback)
 
     bool eof = false;        // true when this is an EOF marker
+    uint32_t serial = 0;     // seek generation it was decoded in
 
     VideoFrame() = default;
     ~VideoFrame() = default;
@@ -0,0 +1,234 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include "video_frame_pool.h"
+#include <cstdlib>
+
+#define LOG_TAG "VideoFramePool"
+#include "CommonTools.h"
+
+VideoFramePool::VideoFramePool() {
+    pthread_mutex_init(&mutex, nullptr);
+}
+
+VideoFramePool::~VideoFramePool() {
+    release();
+    pthread_mutex_destroy(&mutex);
+}
+
+int VideoFramePool::init(int cap, int bytes) {
+    release();
+
+    pthread_mutex_lock(&mutex);
+    capacity = cap;
+    frameBytes = bytes;
+    hits = misses = 0;
+    freeList.reserve(cap);
+    for (int i = 0; i < cap; i++) {
+        VideoFrame* f = createFrame(true);
+        if (!f) break;
+        freeList.push_back(f);
+        allocated++;
+    }
+    int created = (int) freeList.size();
+    pthread_mutex_unlock(&mutex);
+
+    LOGI("VideoFramePool::init capacity=%d frameBytes=%d", created, bytes);
+    return created == cap ? 0 : -1;
+}
+
+void VideoFramePool::release() {
+    pthread_mutex_lock(&mutex);
+    for (VideoFrame* f : freeList) {
+        destroyFrame(f);
+    }
+    allocated -= (int) freeList.size();
+    freeList.clear();
+    std::vector<std::pair<uint8_t*, int>> buffers;
+    buffers.swap(parked);
+    capacity = 0;
+    pthread_mutex_unlock(&mutex);
+
+    for (auto& buffer : buffers) {
+        freeBuffer(buffer.first, buffer.second);
+    }
+}
+
+void VideoFramePool::resize(int cap) {
+    pthread_mutex_lock(&mutex);
+    capacity = cap;
+    while (allocated < capacity) {
+        VideoFrame* f = createFrame(true);
+        if (!f) break;
+        freeList.push_back(f);
+        allocated++;
+    }
+    while (allocated > capacity && !freeList.empty()) {
+        destroyFrame(freeList.back());
+        freeList.pop_back();
+        allocated--;
+    }
+    pthread_mutex_unlock(&mutex);
+    LOGI("VideoFramePool::resize capacity=%d", cap);
+}
+
+VideoFrame* VideoFramePool::acquire() {
+    pthread_mutex_lock(&mutex);
+    if (!freeList.empty()) {
+        VideoFrame* f = freeList.back();
+        freeList.pop_back();
+        hits++;
+        pthread_mutex_unlock(&mutex);
+        return f;
+    }
+    misses++;
+    pthread_mutex_unlock(&mutex);
+
+    // pool exhausted (consumer is holding frames longer than the queue depth)
+    return createFrame(false);
+}
+
+void VideoFramePool::recycle(VideoFrame* frame) {
+    if (!frame) return;
+
+    parkBuffer(frame);
+
+    if (!frame->pooled) {
+        destroyFrame(frame);
+        return;
+    }
+
+    resetFrame(frame);
+
+    pthread_mutex_lock(&mutex);
+    bool keep = allocated <= capacity;
+    if (keep) {
+        freeList.push_back(frame);
+    } else {
+        allocated--;
+    }
+    pthread_mutex_unlock(&mutex);
+
+    // pool was released (or shrunk) while this frame was out
+    if (!keep) {
+        destroyFrame(frame);
+    }
+}
+
+bool VideoFramePool::ensureBuffer(VideoFrame* frame) {
+    if (!frame) return false;
+    const int bytes = frameBytes.load();
+    if (frame->data && frame->bufferCapacity >= bytes) {
+        return true;
+    }
+    if (frame->data) {
+        freeBuffer(frame->data, frame->bufferCapacity);
+        frame->data = nullptr;
+        frame->bufferCapacity = 0;
+    }
+
+    // a parked buffer first; ones from before a size change are dropped
+    std::vector<std::pair<uint8_t*, int>> tooSmall;
+    pthread_mutex_lock(&mutex);
+    while (!parked.empty() && !frame->data) {
+        std::pair<uint8_t*, int> buffer = parked.back();
+        parked.pop_back();
+        if (buffer.second >= bytes) {
+            frame->data = buffer.first;
+            frame->bufferCapacity = buffer.second;
+        } else {
+            tooSmall.push_back(buffer);
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+    for (auto& buffer : tooSmall) {
+        freeBuffer(buffer.first, buffer.second);
+    }
+    if (frame->data) {
+        return true;
+    }
+
+    void* mem = nullptr;
+    if (posix_memalign(&mem, BUFFER_ALIGNMENT, (size_t) bytes) != 0) {
+        return false;
+    }
+    frame->data = static_cast<uint8_t*>(mem);
+    frame->bufferCapacity = bytes;
+    bufferBytes += bytes;
+    return true;
+}
+
+void VideoFramePool::parkBuffer(VideoFrame* frame) {
+    uint8_t* data = frame->data;
+    const int size = frame->bufferCapacity;
+    if (!data) return;
+    frame->data = nullptr;
+    frame->bufferCapacity = 0;
+
+    pthread_mutex_lock(&mutex);
+    bool keep = (int) parked.size() < MAX_PARKED_BUFFERS && size >= frameBytes.load();
+    if (keep) {
+        parked.emplace_back(data, size);
+    }
+    pthread_mutex_unlock(&mutex);
+
+    if (!keep) {
+        freeBuffer(data, size);
+    }
+}
+
+void VideoFramePool::freeBuffer(uint8_t* data, int size) {
+    free(data);
+    bufferBytes -= size;
+}
+
+VideoFramePoolStats VideoFramePool::getStats() {
+    VideoFramePoolStats stats;
+    pthread_mutex_lock(&mutex);
+    stats.capacity = capacity;
+    stats.available = (int) freeList.size();
+    stats.hits = hits;
+    stats.misses = misses;
+    pthread_mutex_unlock(&mutex);
+    stats.bufferBytes = bufferBytes.load();
+    return stats;
+}
+
+VideoFrame* VideoFramePool::createFrame(bool pooled) {
+    VideoFrame* f = new VideoFrame();
+    f->avFrame = av_frame_alloc();
+    if (!f->avFrame) {
+        delete f;
+        return nullptr;
+    }
+    f->pooled = pooled;
+    return f;
+}
+
+void VideoFramePool::destroyFrame(VideoFrame* frame) {
+    if (!frame) return;
+    if (frame->avFrame) {
+        av_frame_free(&frame->avFrame);
+    }
+    if (frame->data) {
+        free(frame->data);
+        frame->data = nullptr;
+    }
+    delete frame;
+}
+
+void VideoFramePool::resetFrame(VideoFrame* frame) {
+    // drop the reference to the codec buffer, keep the shell
+    if (frame->avFrame) {
+        av_frame_unref(frame->avFrame);
+    }
+    frame->width = 0;
+    frame->height = 0;
+    frame->ptsMs = 0.0;
+    frame->decodedBytes = 0;
+    frame->dataSize = 0;
+    frame->dataFormat = 0;
+    frame->eof = false;
+    frame->serial = 0;
+}
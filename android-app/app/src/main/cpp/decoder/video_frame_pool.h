@@ -0,0 +1,89 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <atomic>
+#include <cstdint>
+#include <pthread.h>
+#include "video_frame.h"
+
+struct VideoFramePoolStats {
+    int      capacity = 0;   // preallocated frames
+    int      available = 0;  // frames currently in the free list
+    uint64_t hits = 0;       // acquire() served from the pool
+    uint64_t misses = 0;     // acquire() fell back to the heap
+    int64_t  bufferBytes = 0;  // RGBA staging buffers alive, attached or parked
+};
+
+/**
+ * Fixed-capacity pool of VideoFrame objects.
+ *
+ * Each slot owns its VideoFrame and an AVFrame shell (the decoded data itself
+ * is refcounted by libavcodec's own buffer pool). RGBA staging buffers are not
+ * per slot: readFrame() converts into the caller's memory, only getFrame() and
+ * fast start need one, so ensureBuffer() lends a 64-byte aligned buffer to the
+ * frame and recycle() takes it back. At most MAX_PARKED_BUFFERS stay parked.
+ * In steady-state playback acquire()/recycle() therefore never touch the heap.
+ *
+ * acquire() is called by the decode thread, recycle() by whichever thread
+ * releases the frame, so both are guarded by a mutex.
+ */
+class VideoFramePool {
+public:
+    static const int BUFFER_ALIGNMENT = 64;
+    // staging buffers kept for reuse: the consumer's frame and a primed one
+    static const int MAX_PARKED_BUFFERS = 2;
+
+    VideoFramePool();
+    ~VideoFramePool();
+
+    // preallocate `capacity` frames; staging buffers will hold `frameBytes` bytes
+    int init(int capacity, int frameBytes);
+    void release();
+
+    // new queue depth: grows right away, frames beyond it are destroyed as
+    // they come back
+    void resize(int capacity);
+
+    // never returns a pooled frame twice; falls back to the heap when empty
+    VideoFrame* acquire();
+
+    // give a frame back, its staging buffer is parked; heap frames (misses)
+    // are destroyed here
+    void recycle(VideoFrame* frame);
+
+    // lend frame->data a staging buffer of at least frameBytes
+    bool ensureBuffer(VideoFrame* frame);
+
+    // output size changed (e.g. new output transform): smaller parked buffers
+    // are dropped when ensureBuffer() next needs one
+    void setFrameBytes(int bytes) { frameBytes = bytes; }
+
+    // memory held by staging buffers, for the queue's byte budget
+    int64_t getBufferBytes() const { return bufferBytes.load(); }
+
+    VideoFramePoolStats getStats();
+
+private:
+    VideoFrame* createFrame(bool pooled);
+    static void destroyFrame(VideoFrame* frame);
+    static void resetFrame(VideoFrame* frame);
+    void parkBuffer(VideoFrame* frame);
+    void freeBuffer(uint8_t* data, int capacity);
+
+private:
+    pthread_mutex_t mutex{};
+    std::vector<VideoFrame*> freeList;
+    std::vector<std::pair<uint8_t*, int>> parked;   // staging buffers and their capacity
+
+    int capacity = 0;
+    int allocated = 0;       // pooled frames alive, in the free list or handed out
+    std::atomic<int> frameBytes{0};
+    std::atomic<int64_t> bufferBytes{0};
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
@@ -0,0 +1,142 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include "video_qos_controller.h"
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+#define LOG_TAG "VideoQosController"
+#include "CommonTools.h"
+
+static const char* levelName(int level) {
+    switch (level) {
+        case VIDEO_QOS_FULL:             return "full";
+        case VIDEO_QOS_SKIP_LOOP_FILTER: return "skip-loop-filter";
+        case VIDEO_QOS_SKIP_NONREF:      return "skip-nonref";
+        case VIDEO_QOS_FAST_SCALE:       return "fast-scale";
+        default:                         return "?";
+    }
+}
+
+VideoQosController::VideoQosController() {
+    pthread_mutex_init(&mutex, nullptr);
+}
+
+VideoQosController::~VideoQosController() {
+    pthread_mutex_destroy(&mutex);
+}
+
+void VideoQosController::restart() {
+    pthread_mutex_lock(&mutex);
+    bool enabled = stats.enabled;
+    int maxLevel = stats.maxLevel;
+    stats = VideoQosStats();
+    stats.enabled = enabled;
+    stats.maxLevel = maxLevel;
+    stats.levelSinceUs = av_gettime_relative();
+    level = VIDEO_QOS_FULL;
+    primed = false;
+    underrunStreak = 0;
+    healthyFrames = 0;
+    upHoldFrames = UP_HOLD_FRAMES;
+    lastStepUpUs = 0;
+    pthread_mutex_unlock(&mutex);
+}
+
+void VideoQosController::onDiscontinuity() {
+    pthread_mutex_lock(&mutex);
+    primed = false;
+    underrunStreak = 0;
+    healthyFrames = 0;
+    pthread_mutex_unlock(&mutex);
+}
+
+void VideoQosController::onFrameTaken(int queued, int capacity) {
+    const int lowWater = capacity / 4;
+    const int highWater = capacity * 3 / 4;
+
+    pthread_mutex_lock(&mutex);
+    if (queued >= lowWater) {
+        primed = true;
+        underrunStreak = 0;
+    }
+    if (!stats.enabled || level == VIDEO_QOS_FULL || queued < highWater) {
+        healthyFrames = 0;
+        pthread_mutex_unlock(&mutex);
+        return;
+    }
+
+    // decoder keeps the queue topped up: try the next better level
+    if (++healthyFrames >= upHoldFrames &&
+        av_gettime_relative() - stats.levelSinceUs >= UP_COOLDOWN_US) {
+        lastStepUpUs = av_gettime_relative();
+        stats.stepUps++;
+        stepTo(level - 1);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+void VideoQosController::onUnderrun() {
+    pthread_mutex_lock(&mutex);
+    healthyFrames = 0;
+    if (!primed) {
+        pthread_mutex_unlock(&mutex);
+        return;
+    }
+    stats.underruns++;
+    if (!stats.enabled || level >= stats.maxLevel) {
+        pthread_mutex_unlock(&mutex);
+        return;
+    }
+
+    int64_t now = av_gettime_relative();
+    if (++underrunStreak >= DOWN_UNDERRUNS && now - stats.levelSinceUs >= DOWN_COOLDOWN_US) {
+        if (lastStepUpUs > 0 && now - lastStepUpUs < FLAP_WINDOW_US) {
+            // the better level did not hold: wait longer before trying it again
+            upHoldFrames = MIN(upHoldFrames * 2, UP_HOLD_MAX_FRAMES);
+        }
+        stats.stepDowns++;
+        underrunStreak = 0;
+        stepTo(level + 1);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+void VideoQosController::setEnabled(bool enable) {
+    pthread_mutex_lock(&mutex);
+    stats.enabled = enable;
+    if (!enable && level != VIDEO_QOS_FULL) {
+        stepTo(VIDEO_QOS_FULL);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+void VideoQosController::setMaxLevel(int maxLevel) {
+    maxLevel = MAX(VIDEO_QOS_FULL, MIN(maxLevel, VIDEO_QOS_LEVEL_COUNT - 1));
+    pthread_mutex_lock(&mutex);
+    stats.maxLevel = maxLevel;
+    if (level > maxLevel) {
+        stepTo(maxLevel);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+VideoQosStats VideoQosController::getStats() {
+    pthread_mutex_lock(&mutex);
+    VideoQosStats copy = stats;
+    copy.level = level;
+    pthread_mutex_unlock(&mutex);
+    return copy;
+}
+
+// mutex held
+void VideoQosController::stepTo(int newLevel) {
+    LOGI("VideoQosController: %s -> %s (underruns=%llu)",
+         levelName(level), levelName(newLevel), (unsigned long long) stats.underruns);
+    level = newLevel;
+    stats.levelSinceUs = av_gettime_relative();
+    healthyFrames = 0;
+}
@@ -0,0 +1,89 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <pthread.h>
+
+// degradation ladder, each level keeps everything the previous one dropped
+enum VideoQosLevel {
+    VIDEO_QOS_FULL = 0,             // decode and convert at full quality
+    VIDEO_QOS_SKIP_LOOP_FILTER = 1, // skip_loop_filter = ALL (deblocking off)
+    VIDEO_QOS_SKIP_NONREF = 2,      // skip_frame = NONREF (B-frames never decoded)
+    VIDEO_QOS_FAST_SCALE = 3,       // nearest-neighbour / SWS_FAST_BILINEAR scaling
+    VIDEO_QOS_LEVEL_COUNT
+};
+
+struct VideoQosStats {
+    int      level = VIDEO_QOS_FULL;
+    int      maxLevel = VIDEO_QOS_LEVEL_COUNT - 1;
+    bool     enabled = true;
+    uint64_t stepDowns = 0;     // transitions to a cheaper level
+    uint64_t stepUps = 0;       // transitions back towards full quality
+    uint64_t underruns = 0;     // queue found empty while the decoder was running
+    int64_t  levelSinceUs = 0;  // av_gettime_relative() of the last transition
+};
+
+/**
+ * Quality-of-service ladder for the decode thread.
+ *
+ * The consumer reports every take from the frame queue and every time it finds
+ * the queue empty. Repeated underruns step one level down the ladder; a queue
+ * that stays near full for long enough steps one level back up. A step down
+ * shortly after a step up doubles the hold time before the next step up, so a
+ * stream that sits right at the edge does not oscillate.
+ *
+ * After a seek or (re)start the queue is refilling, underruns are ignored
+ * until it has reached the low watermark once.
+ *
+ * Report calls come from the consumer thread, getLevel() from the decode
+ * thread, which applies the level to the decoder itself.
+ */
+class VideoQosController {
+public:
+    VideoQosController();
+    ~VideoQosController();
+
+    // new stream: back to full quality, counters cleared
+    void restart();
+    // seek / play: the queue is refilling, this is not falling behind
+    void onDiscontinuity();
+
+    // consumer took a frame, the queue is left `queued` / `capacity` full
+    // (VideoDecoderController reports percent of its byte/duration budget)
+    void onFrameTaken(int queued, int capacity);
+    // consumer found nothing queued while the decoder is still running
+    void onUnderrun();
+
+    // disabled = always VIDEO_QOS_FULL
+    void setEnabled(bool enable);
+    // deepest level the ladder may reach
+    void setMaxLevel(int level);
+
+    int getLevel() const { return level; }
+    VideoQosStats getStats();
+
+private:
+    void stepTo(int newLevel);
+
+private:
+    static constexpr int     DOWN_UNDERRUNS = 3;                 // underruns in a row to step down
+    static constexpr int64_t DOWN_COOLDOWN_US = 1000 * 1000;     // min time between step downs
+    static constexpr int     UP_HOLD_FRAMES = 90;                // healthy takes to step up
+    static constexpr int     UP_HOLD_MAX_FRAMES = 90 * 8;
+    static constexpr int64_t UP_COOLDOWN_US = 3 * 1000 * 1000;   // min time at a level before stepping up
+    static constexpr int64_t FLAP_WINDOW_US = 5 * 1000 * 1000;   // step down this soon after a step up = flap
+
+    pthread_mutex_t mutex{};
+    std::atomic<int> level{VIDEO_QOS_FULL};
+    VideoQosStats stats;
+
+    bool primed = false;      // queue reached the low watermark since the last discontinuity
+    int  underrunStreak = 0;
+    int  healthyFrames = 0;
+    int  upHoldFrames = UP_HOLD_FRAMES;
+    int64_t lastStepUpUs = 0;
+};
@@ -0,0 +1,164 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include "yuv_convert.h"
+#include <cmath>
+
+#define LOG_TAG "YuvConvert"
+#include "CommonTools.h"
+
+static inline uint8_t clampToByte(int v) {
+    return (uint8_t) (v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+static inline void yuvPixel(int y, int u, int v, const YuvCoeffs* c,
+                            uint8_t* r, uint8_t* g, uint8_t* b) {
+    const int round = 1 << (YUV_COEFF_SHIFT - 1);
+    int yy = (y - c->yOffset) * c->yc;
+    u -= 128;
+    v -= 128;
+    *r = clampToByte((yy + c->rv * v + round) >> YUV_COEFF_SHIFT);
+    *g = clampToByte((yy - c->gu * u - c->gv * v + round) >> YUV_COEFF_SHIFT);
+    *b = clampToByte((yy + c->bu * u + round) >> YUV_COEFF_SHIFT);
+}
+
+static inline uint16_t packRGB565(uint8_t r, uint8_t g, uint8_t b) {
+    return (uint16_t) (((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+}
+
+static void i420ToRGBARowC(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                           uint8_t* dst, int width, const YuvCoeffs* c) {
+    for (int x = 0; x < width; x++) {
+        yuvPixel(y[x], u[x >> 1], v[x >> 1], c, &dst[0], &dst[1], &dst[2]);
+        dst[3] = 0xFF;
+        dst += 4;
+    }
+}
+
+static void nv12ToRGBARowC(const uint8_t* y, const uint8_t* uv, const uint8_t* /*unused*/,
+                           uint8_t* dst, int width, const YuvCoeffs* c) {
+    for (int x = 0; x < width; x++) {
+        int ci = (x >> 1) * 2;
+        yuvPixel(y[x], uv[ci], uv[ci + 1], c, &dst[0], &dst[1], &dst[2]);
+        dst[3] = 0xFF;
+        dst += 4;
+    }
+}
+
+static void i420ToRGB565RowC(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                             uint8_t* dst, int width, const YuvCoeffs* c) {
+    auto* out = reinterpret_cast<uint16_t*>(dst);
+    for (int x = 0; x < width; x++) {
+        uint8_t r, g, b;
+        yuvPixel(y[x], u[x >> 1], v[x >> 1], c, &r, &g, &b);
+        out[x] = packRGB565(r, g, b);
+    }
+}
+
+static void nv12ToRGB565RowC(const uint8_t* y, const uint8_t* uv, const uint8_t* /*unused*/,
+                             uint8_t* dst, int width, const YuvCoeffs* c) {
+    auto* out = reinterpret_cast<uint16_t*>(dst);
+    for (int x = 0; x < width; x++) {
+        int ci = (x >> 1) * 2;
+        uint8_t r, g, b;
+        yuvPixel(y[x], uv[ci], uv[ci + 1], c, &r, &g, &b);
+        out[x] = packRGB565(r, g, b);
+    }
+}
+
+const YuvRowKernels& YuvConvert::scalarKernels() {
+    static const YuvRowKernels table = {
+            "scalar",
+            i420ToRGBARowC,
+            nv12ToRGBARowC,
+            i420ToRGB565RowC,
+            nv12ToRGB565RowC,
+    };
+    return table;
+}
+
+const YuvRowKernels& YuvConvert::kernels() {
+    // function-local static: initialised once, thread-safe
+    static const YuvRowKernels* selected = []() {
+        const YuvRowKernels* k = yuvNeonKernels();
+        if (!k) k = yuvAvx2Kernels();
+        if (!k) k = yuvSse2Kernels();
+        if (!k) k = &scalarKernels();
+        LOGI("YuvConvert: using %s kernels", k->name);
+        return k;
+    }();
+    return *selected;
+}
+
+YuvCoeffs YuvConvert::makeCoeffs(bool bt709, bool fullRange) {
+    // Kr/Kb of the colour matrix
+    const double kr = bt709 ? 0.2126 : 0.299;
+    const double kb = bt709 ? 0.0722 : 0.114;
+    const double kg = 1.0 - kr - kb;
+
+    const double yScale = fullRange ? 1.0 : 255.0 / 219.0;
+    const double cScale = fullRange ? 1.0 : 255.0 / 224.0;
+
+    const double rv = 2.0 * (1.0 - kr) * cScale;
+    const double bu = 2.0 * (1.0 - kb) * cScale;
+    const double gu = 2.0 * (1.0 - kb) * kb / kg * cScale;
+    const double gv = 2.0 * (1.0 - kr) * kr / kg * cScale;
+
+    const double one = (double) (1 << YUV_COEFF_SHIFT);
+    YuvCoeffs c{};
+    c.yOffset = (int16_t) (fullRange ? 0 : 16);
+    c.yc = (int16_t) lround(yScale * one);
+    c.rv = (int16_t) lround(rv * one);
+    c.gu = (int16_t) lround(gu * one);
+    c.gv = (int16_t) lround(gv * one);
+    c.bu = (int16_t) lround(bu * one);
+    return c;
+}
+
+YuvCoeffs YuvConvert::coeffsFor(const AVFrame* frame) {
+    bool bt709 = false;
+    bool fullRange = false;
+    if (frame) {
+        bt709 = frame->colorspace == AVCOL_SPC_BT709;
+        fullRange = frame->color_range == AVCOL_RANGE_JPEG ||
+                    frame->format == AV_PIX_FMT_YUVJ420P;
+    }
+    // the four 601/709 × limited/full combinations, computed once
+    static const YuvCoeffs table[2][2] = {
+            {makeCoeffs(false, false), makeCoeffs(false, true)},
+            {makeCoeffs(true, false),  makeCoeffs(true, true)},
+    };
+    return table[bt709 ? 1 : 0][fullRange ? 1 : 0];
+}
+
+static bool isI420(AVPixelFormat f) {
+    return f == AV_PIX_FMT_YUV420P || f == AV_PIX_FMT_YUVJ420P;
+}
+
+bool YuvConvert::supports(AVPixelFormat srcFormat, AVPixelFormat dstFormat) {
+    bool src = isI420(srcFormat) || srcFormat == AV_PIX_FMT_NV12;
+    bool dst = dstFormat == AV_PIX_FMT_RGBA || dstFormat == AV_PIX_FMT_RGB565LE;
+    return src && dst;
+}
+
+int YuvConvert::convertRows(const uint8_t* const src[4], const int srcStride[4],
+                            AVPixelFormat srcFormat,
+                            uint8_t* dst, int dstStride, AVPixelFormat dstFormat,
+                            int width, int height, const YuvCoeffs& coeffs) {
+    if (!supports(srcFormat, dstFormat)) return -1;
+
+    const YuvRowKernels& k = kernels();
+    const bool nv12 = srcFormat == AV_PIX_FMT_NV12;
+    const bool rgba = dstFormat == AV_PIX_FMT_RGBA;
+    YuvRowFn row = nv12 ? (rgba ? k.nv12ToRGBA : k.nv12ToRGB565)
+                        : (rgba ? k.i420ToRGBA : k.i420ToRGB565);
+
+    for (int j = 0; j < height; j++) {
+        const uint8_t* yRow = src[0] + (ptrdiff_t) j * srcStride[0];
+        const uint8_t* uRow = src[1] + (ptrdiff_t) (j >> 1) * srcStride[1];
+        const uint8_t* vRow = nv12 ? nullptr : src[2] + (ptrdiff_t) (j >> 1) * srcStride[2];
+        row(yRow, uRow, vRow, dst + (ptrdiff_t) j * dstStride, width, &coeffs);
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <cstdint>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+/**
+ * Native yuv420p / nv12 → RGBA / RGB565 conversion.
+ *
+ * The bundled FFmpeg is built with --disable-asm, so swscale only has its
+ * scalar C paths. These kernels replace it for the common decoder outputs:
+ * scalar fallback everywhere, NEON on ARM, SSE2/AVX2 on x86, picked once at
+ * runtime from the CPU features. All kernels share the same Q13 fixed-point
+ * maths, so every path produces identical output.
+ *
+ * Chroma is upsampled by pixel replication (same as swscale's unscaled
+ * yuv2rgb path).
+ */
+
+// fixed-point coefficients, Q13
+struct YuvCoeffs {
+    int16_t yOffset;   // 16 (limited range) or 0 (full range)
+    int16_t yc;        // luma gain
+    int16_t rv;        // V → R
+    int16_t gu;        // U → G (subtracted)
+    int16_t gv;        // V → G (subtracted)
+    int16_t bu;        // U → B
+};
+
+// Converts one row. For nv12 `u` points at the interleaved UV row and `v` is unused.
+typedef void (*YuvRowFn)(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                         uint8_t* dst, int width, const YuvCoeffs* c);
+
+struct YuvRowKernels {
+    const char* name;
+    YuvRowFn i420ToRGBA;
+    YuvRowFn nv12ToRGBA;
+    YuvRowFn i420ToRGB565;
+    YuvRowFn nv12ToRGB565;
+};
+
+static const int YUV_COEFF_SHIFT = 13;
+
+class YuvConvert {
+public:
+    // kernels for the running CPU (selected once, thread-safe)
+    static const YuvRowKernels& kernels();
+
+    // portable reference kernels
+    static const YuvRowKernels& scalarKernels();
+
+    // BT.601 / BT.709, limited / full range coefficients for this frame
+    static YuvCoeffs coeffsFor(const AVFrame* frame);
+    static YuvCoeffs makeCoeffs(bool bt709, bool fullRange);
+
+    // true when (src pixel format → dst pixel format) has a native kernel
+    static bool supports(AVPixelFormat srcFormat, AVPixelFormat dstFormat);
+
+    /**
+     * Convert `height` rows. Plane pointers must point at the first row of
+     * the band, and the band must start on an even row (4:2:0 chroma).
+     * return: 0 on success, <0 if the formats are not supported
+     */
+    static int convertRows(const uint8_t* const src[4], const int srcStride[4],
+                           AVPixelFormat srcFormat,
+                           uint8_t* dst, int dstStride, AVPixelFormat dstFormat,
+                           int width, int height, const YuvCoeffs& coeffs);
+};
+
+// per-ISA tables, nullptr when not compiled in or not supported by the CPU
+const YuvRowKernels* yuvNeonKernels();
+const YuvRowKernels* yuvSse2Kernels();
+const YuvRowKernels* yuvAvx2Kernels();
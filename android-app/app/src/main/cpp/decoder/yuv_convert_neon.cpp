@@ -0,0 +1,165 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+// NEON row kernels for YuvConvert (arm64-v8a, and armeabi-v7a when built with NEON).
+// Same Q13 maths as the scalar path: vqrshrn_n_s32(x, 13) is (x + 4096) >> 13,
+// so every result is bit-identical.
+//
+
+#include "yuv_convert.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+#include <arm_neon.h>
+
+#if defined(__arm__)
+#include <sys/auxv.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#endif
+
+static void tailRow(YuvRowFn scalar, const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                    uint8_t* dst, int done, int width, int bytesPerPixel, bool nv12,
+                    const YuvCoeffs* c) {
+    if (done >= width) return;
+    const uint8_t* uTail = nv12 ? u + done : u + done / 2;
+    const uint8_t* vTail = nv12 ? nullptr : v + done / 2;
+    scalar(y + done, uTail, vTail, dst + done * bytesPerPixel, width - done, c);
+}
+
+// 8 pixels, chroma already replicated → saturated 8-bit channels
+static inline void yuvToRgb8(int16x8_t y, int16x8_t u, int16x8_t v, const YuvCoeffs* c,
+                             uint8x8_t* r8, uint8x8_t* g8, uint8x8_t* b8) {
+    int16x4_t yl = vget_low_s16(y), yh = vget_high_s16(y);
+    int16x4_t ul = vget_low_s16(u), uh = vget_high_s16(u);
+    int16x4_t vl = vget_low_s16(v), vh = vget_high_s16(v);
+
+    int32x4_t yyl = vmull_n_s16(yl, c->yc);
+    int32x4_t yyh = vmull_n_s16(yh, c->yc);
+
+    int32x4_t rl = vmlal_n_s16(yyl, vl, c->rv);
+    int32x4_t rh = vmlal_n_s16(yyh, vh, c->rv);
+    int32x4_t gl = vmlsl_n_s16(vmlsl_n_s16(yyl, ul, c->gu), vl, c->gv);
+    int32x4_t gh = vmlsl_n_s16(vmlsl_n_s16(yyh, uh, c->gu), vh, c->gv);
+    int32x4_t bl = vmlal_n_s16(yyl, ul, c->bu);
+    int32x4_t bh = vmlal_n_s16(yyh, uh, c->bu);
+
+    *r8 = vqmovun_s16(vcombine_s16(vqrshrn_n_s32(rl, YUV_COEFF_SHIFT), vqrshrn_n_s32(rh, YUV_COEFF_SHIFT)));
+    *g8 = vqmovun_s16(vcombine_s16(vqrshrn_n_s32(gl, YUV_COEFF_SHIFT), vqrshrn_n_s32(gh, YUV_COEFF_SHIFT)));
+    *b8 = vqmovun_s16(vcombine_s16(vqrshrn_n_s32(bl, YUV_COEFF_SHIFT), vqrshrn_n_s32(bh, YUV_COEFF_SHIFT)));
+}
+
+static inline int16x8_t widenOffset(uint8x8_t x, int16x8_t offset) {
+    return vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(x)), offset);
+}
+
+// 16 pixels: y16 luma, u8/v8 the 8 chroma samples that cover them
+static inline void convert16(uint8x16_t y16, uint8x8_t u8, uint8x8_t v8, const YuvCoeffs* c,
+                             uint8x16_t* r, uint8x16_t* g, uint8x16_t* b) {
+    const int16x8_t yOffset = vdupq_n_s16(c->yOffset);
+    const int16x8_t chromaOffset = vdupq_n_s16(128);
+    // u0 u0 u1 u1 ... (pixel replication)
+    uint8x8x2_t uu = vzip_u8(u8, u8);
+    uint8x8x2_t vv = vzip_u8(v8, v8);
+
+    uint8x8_t rLo, gLo, bLo, rHi, gHi, bHi;
+    yuvToRgb8(widenOffset(vget_low_u8(y16), yOffset),
+              widenOffset(uu.val[0], chromaOffset), widenOffset(vv.val[0], chromaOffset),
+              c, &rLo, &gLo, &bLo);
+    yuvToRgb8(widenOffset(vget_high_u8(y16), yOffset),
+              widenOffset(uu.val[1], chromaOffset), widenOffset(vv.val[1], chromaOffset),
+              c, &rHi, &gHi, &bHi);
+    *r = vcombine_u8(rLo, rHi);
+    *g = vcombine_u8(gLo, gHi);
+    *b = vcombine_u8(bLo, bHi);
+}
+
+static inline void storeRGBA(uint8_t* dst, uint8x16_t r, uint8x16_t g, uint8x16_t b) {
+    uint8x16x4_t px;
+    px.val[0] = r;
+    px.val[1] = g;
+    px.val[2] = b;
+    px.val[3] = vdupq_n_u8(0xFF);
+    vst4q_u8(dst, px);
+}
+
+static inline uint16x8_t packRGB565(uint8x8_t r, uint8x8_t g, uint8x8_t b) {
+    uint16x8_t px = vshll_n_u8(r, 8);
+    px = vsriq_n_u16(px, vshll_n_u8(g, 8), 5);
+    px = vsriq_n_u16(px, vshll_n_u8(b, 8), 11);
+    return px;
+}
+
+static inline void storeRGB565(uint8_t* dst, uint8x16_t r, uint8x16_t g, uint8x16_t b) {
+    auto* out = reinterpret_cast<uint16_t*>(dst);
+    vst1q_u16(out, packRGB565(vget_low_u8(r), vget_low_u8(g), vget_low_u8(b)));
+    vst1q_u16(out + 8, packRGB565(vget_high_u8(r), vget_high_u8(g), vget_high_u8(b)));
+}
+
+static void i420ToRGBARowNeon(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                              uint8_t* dst, int width, const YuvCoeffs* c) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t r, g, b;
+        convert16(vld1q_u8(y + x), vld1_u8(u + x / 2), vld1_u8(v + x / 2), c, &r, &g, &b);
+        storeRGBA(dst + x * 4, r, g, b);
+    }
+    tailRow(YuvConvert::scalarKernels().i420ToRGBA, y, u, v, dst, x, width, 4, false, c);
+}
+
+static void nv12ToRGBARowNeon(const uint8_t* y, const uint8_t* uv, const uint8_t* v,
+                              uint8_t* dst, int width, const YuvCoeffs* c) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x8x2_t chroma = vld2_u8(uv + x);   // deinterleave u / v
+        uint8x16_t r, g, b;
+        convert16(vld1q_u8(y + x), chroma.val[0], chroma.val[1], c, &r, &g, &b);
+        storeRGBA(dst + x * 4, r, g, b);
+    }
+    tailRow(YuvConvert::scalarKernels().nv12ToRGBA, y, uv, v, dst, x, width, 4, true, c);
+}
+
+static void i420ToRGB565RowNeon(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                                uint8_t* dst, int width, const YuvCoeffs* c) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t r, g, b;
+        convert16(vld1q_u8(y + x), vld1_u8(u + x / 2), vld1_u8(v + x / 2), c, &r, &g, &b);
+        storeRGB565(dst + x * 2, r, g, b);
+    }
+    tailRow(YuvConvert::scalarKernels().i420ToRGB565, y, u, v, dst, x, width, 2, false, c);
+}
+
+static void nv12ToRGB565RowNeon(const uint8_t* y, const uint8_t* uv, const uint8_t* v,
+                                uint8_t* dst, int width, const YuvCoeffs* c) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x8x2_t chroma = vld2_u8(uv + x);
+        uint8x16_t r, g, b;
+        convert16(vld1q_u8(y + x), chroma.val[0], chroma.val[1], c, &r, &g, &b);
+        storeRGB565(dst + x * 2, r, g, b);
+    }
+    tailRow(YuvConvert::scalarKernels().nv12ToRGB565, y, uv, v, dst, x, width, 2, true, c);
+}
+
+const YuvRowKernels* yuvNeonKernels() {
+    static const YuvRowKernels table = {
+            "neon",
+            i420ToRGBARowNeon,
+            nv12ToRGBARowNeon,
+            i420ToRGB565RowNeon,
+            nv12ToRGB565RowNeon,
+    };
+#if defined(__arm__)
+    // armeabi-v7a does not guarantee NEON
+    if (!(getauxval(AT_HWCAP) & HWCAP_NEON)) return nullptr;
+#endif
+    return &table;
+}
+
+#else
+
+const YuvRowKernels* yuvNeonKernels() { return nullptr; }
+
+#endif
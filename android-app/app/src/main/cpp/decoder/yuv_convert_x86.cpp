@@ -0,0 +1,346 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+// SSE2 / AVX2 row kernels for YuvConvert (x86 / x86_64 ABIs).
+// Same Q13 maths as the scalar path: products are formed with madd_epi16 on
+// interleaved (a, b) int16 pairs, so every result is bit-identical.
+//
+
+#include "yuv_convert.h"
+
+#if defined(__i386__) || defined(__x86_64__)
+
+#include <immintrin.h>
+
+// scalar tails
+static void tailRow(YuvRowFn scalar, const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                    uint8_t* dst, int done, int width, int bytesPerPixel, bool nv12,
+                    const YuvCoeffs* c) {
+    if (done >= width) return;
+    const uint8_t* uTail = nv12 ? u + done : u + done / 2;
+    const uint8_t* vTail = nv12 ? nullptr : v + done / 2;
+    scalar(y + done, uTail, vTail, dst + done * bytesPerPixel, width - done, c);
+}
+
+static inline int32_t pairCoeff(int16_t lo, int16_t hi) {
+    return (int32_t) (((uint32_t) (uint16_t) hi << 16) | (uint16_t) lo);
+}
+
+// ---------------------------------------------------------------- SSE2
+
+struct Sse2Coeffs {
+    __m128i yOffset, chromaOffset;
+    __m128i yR, yB, yG, vG, round;
+};
+
+static inline Sse2Coeffs loadSse2(const YuvCoeffs* c) {
+    Sse2Coeffs k;
+    k.yOffset = _mm_set1_epi16(c->yOffset);
+    k.chromaOffset = _mm_set1_epi16(128);
+    k.yR = _mm_set1_epi32(pairCoeff(c->yc, c->rv));
+    k.yB = _mm_set1_epi32(pairCoeff(c->yc, c->bu));
+    k.yG = _mm_set1_epi32(pairCoeff(c->yc, (int16_t) -c->gu));
+    k.vG = _mm_set1_epi32(pairCoeff((int16_t) -c->gv, 0));
+    k.round = _mm_set1_epi32(1 << (YUV_COEFF_SHIFT - 1));
+    return k;
+}
+
+// 8 pixels: y16/u16/v16 hold one int16 per pixel (chroma already replicated)
+static inline void yuvToRgb16Sse2(__m128i y16, __m128i u16, __m128i v16, const Sse2Coeffs& k,
+                                  __m128i* r16, __m128i* g16, __m128i* b16) {
+    const __m128i zero = _mm_setzero_si128();
+    y16 = _mm_sub_epi16(y16, k.yOffset);
+    u16 = _mm_sub_epi16(u16, k.chromaOffset);
+    v16 = _mm_sub_epi16(v16, k.chromaOffset);
+
+    __m128i yvLo = _mm_unpacklo_epi16(y16, v16), yvHi = _mm_unpackhi_epi16(y16, v16);
+    __m128i yuLo = _mm_unpacklo_epi16(y16, u16), yuHi = _mm_unpackhi_epi16(y16, u16);
+    __m128i v0Lo = _mm_unpacklo_epi16(v16, zero), v0Hi = _mm_unpackhi_epi16(v16, zero);
+
+    __m128i rLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yvLo, k.yR), k.round), YUV_COEFF_SHIFT);
+    __m128i rHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yvHi, k.yR), k.round), YUV_COEFF_SHIFT);
+    __m128i bLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yuLo, k.yB), k.round), YUV_COEFF_SHIFT);
+    __m128i bHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yuHi, k.yB), k.round), YUV_COEFF_SHIFT);
+    __m128i gLo = _mm_add_epi32(_mm_madd_epi16(yuLo, k.yG), _mm_madd_epi16(v0Lo, k.vG));
+    __m128i gHi = _mm_add_epi32(_mm_madd_epi16(yuHi, k.yG), _mm_madd_epi16(v0Hi, k.vG));
+    gLo = _mm_srai_epi32(_mm_add_epi32(gLo, k.round), YUV_COEFF_SHIFT);
+    gHi = _mm_srai_epi32(_mm_add_epi32(gHi, k.round), YUV_COEFF_SHIFT);
+
+    *r16 = _mm_packs_epi32(rLo, rHi);
+    *g16 = _mm_packs_epi32(gLo, gHi);
+    *b16 = _mm_packs_epi32(bLo, bHi);
+}
+
+static inline void loadI420Sse2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                                __m128i* y16, __m128i* u16, __m128i* v16) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i y8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(y));
+    int32_t u4, v4;
+    __builtin_memcpy(&u4, u, 4);
+    __builtin_memcpy(&v4, v, 4);
+    __m128i u8 = _mm_cvtsi32_si128(u4);
+    __m128i v8 = _mm_cvtsi32_si128(v4);
+    *y16 = _mm_unpacklo_epi8(y8, zero);
+    *u16 = _mm_unpacklo_epi8(_mm_unpacklo_epi8(u8, u8), zero);
+    *v16 = _mm_unpacklo_epi8(_mm_unpacklo_epi8(v8, v8), zero);
+}
+
+static inline void loadNv12Sse2(const uint8_t* y, const uint8_t* uv,
+                                __m128i* y16, __m128i* u16, __m128i* v16) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i y8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(y));
+    __m128i uv16 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(uv)), zero);
+    *y16 = _mm_unpacklo_epi8(y8, zero);
+    // u0 v0 u1 v1 ... → u0 u0 u1 u1 ... / v0 v0 v1 v1 ...
+    *u16 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv16, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+    *v16 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv16, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+}
+
+static inline void storeRGBASse2(uint8_t* dst, __m128i r16, __m128i g16, __m128i b16) {
+    __m128i rb = _mm_packus_epi16(r16, b16);                    // r0..7 b0..7
+    __m128i ga = _mm_packus_epi16(g16, _mm_set1_epi16(255));    // g0..7 a0..7
+    __m128i rg = _mm_unpacklo_epi8(rb, ga);                     // r0 g0 r1 g1 ...
+    __m128i ba = _mm_unpackhi_epi8(rb, ga);                     // b0 a0 b1 a1 ...
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_unpackhi_epi16(rg, ba));
+}
+
+static inline void storeRGB565Sse2(uint8_t* dst, __m128i r16, __m128i g16, __m128i b16) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi16(255);
+    r16 = _mm_min_epi16(_mm_max_epi16(r16, zero), max);
+    g16 = _mm_min_epi16(_mm_max_epi16(g16, zero), max);
+    b16 = _mm_min_epi16(_mm_max_epi16(b16, zero), max);
+    __m128i px = _mm_or_si128(
+            _mm_slli_epi16(_mm_and_si128(r16, _mm_set1_epi16(0xF8)), 8),
+            _mm_or_si128(_mm_slli_epi16(_mm_and_si128(g16, _mm_set1_epi16(0xFC)), 3),
+                         _mm_srli_epi16(b16, 3)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), px);
+}
+
+static void i420ToRGBARowSse2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                              uint8_t* dst, int width, const YuvCoeffs* c) {
+    const Sse2Coeffs k = loadSse2(c);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i y16, u16, v16, r16, g16, b16;
+        loadI420Sse2(y + x, u + x / 2, v + x / 2, &y16, &u16, &v16);
+        yuvToRgb16Sse2(y16, u16, v16, k, &r16, &g16, &b16);
+        storeRGBASse2(dst + x * 4, r16, g16, b16);
+    }
+    tailRow(YuvConvert::scalarKernels().i420ToRGBA, y, u, v, dst, x, width, 4, false, c);
+}
+
+static void nv12ToRGBARowSse2(const uint8_t* y, const uint8_t* uv, const uint8_t* v,
+                              uint8_t* dst, int width, const YuvCoeffs* c) {
+    const Sse2Coeffs k = loadSse2(c);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i y16, u16, v16, r16, g16, b16;
+        loadNv12Sse2(y + x, uv + x, &y16, &u16, &v16);
+        yuvToRgb16Sse2(y16, u16, v16, k, &r16, &g16, &b16);
+        storeRGBASse2(dst + x * 4, r16, g16, b16);
+    }
+    tailRow(YuvConvert::scalarKernels().nv12ToRGBA, y, uv, v, dst, x, width, 4, true, c);
+}
+
+static void i420ToRGB565RowSse2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                                uint8_t* dst, int width, const YuvCoeffs* c) {
+    const Sse2Coeffs k = loadSse2(c);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i y16, u16, v16, r16, g16, b16;
+        loadI420Sse2(y + x, u + x / 2, v + x / 2, &y16, &u16, &v16);
+        yuvToRgb16Sse2(y16, u16, v16, k, &r16, &g16, &b16);
+        storeRGB565Sse2(dst + x * 2, r16, g16, b16);
+    }
+    tailRow(YuvConvert::scalarKernels().i420ToRGB565, y, u, v, dst, x, width, 2, false, c);
+}
+
+static void nv12ToRGB565RowSse2(const uint8_t* y, const uint8_t* uv, const uint8_t* v,
+                                uint8_t* dst, int width, const YuvCoeffs* c) {
+    const Sse2Coeffs k = loadSse2(c);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i y16, u16, v16, r16, g16, b16;
+        loadNv12Sse2(y + x, uv + x, &y16, &u16, &v16);
+        yuvToRgb16Sse2(y16, u16, v16, k, &r16, &g16, &b16);
+        storeRGB565Sse2(dst + x * 2, r16, g16, b16);
+    }
+    tailRow(YuvConvert::scalarKernels().nv12ToRGB565, y, uv, v, dst, x, width, 2, true, c);
+}
+
+// ---------------------------------------------------------------- AVX2
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+struct Avx2Coeffs {
+    __m256i yOffset, chromaOffset;
+    __m256i yR, yB, yG, vG, round;
+};
+
+AVX2_TARGET static inline Avx2Coeffs loadAvx2(const YuvCoeffs* c) {
+    Avx2Coeffs k;
+    k.yOffset = _mm256_set1_epi16(c->yOffset);
+    k.chromaOffset = _mm256_set1_epi16(128);
+    k.yR = _mm256_set1_epi32(pairCoeff(c->yc, c->rv));
+    k.yB = _mm256_set1_epi32(pairCoeff(c->yc, c->bu));
+    k.yG = _mm256_set1_epi32(pairCoeff(c->yc, (int16_t) -c->gu));
+    k.vG = _mm256_set1_epi32(pairCoeff((int16_t) -c->gv, 0));
+    k.round = _mm256_set1_epi32(1 << (YUV_COEFF_SHIFT - 1));
+    return k;
+}
+
+// 16 pixels. unpack/pack both work per 128-bit lane, so packs_epi32 restores
+// the original pixel order produced by the unpacks.
+AVX2_TARGET static inline void yuvToRgb16Avx2(__m256i y16, __m256i u16, __m256i v16,
+                                              const Avx2Coeffs& k,
+                                              __m256i* r16, __m256i* g16, __m256i* b16) {
+    const __m256i zero = _mm256_setzero_si256();
+    y16 = _mm256_sub_epi16(y16, k.yOffset);
+    u16 = _mm256_sub_epi16(u16, k.chromaOffset);
+    v16 = _mm256_sub_epi16(v16, k.chromaOffset);
+
+    __m256i yvLo = _mm256_unpacklo_epi16(y16, v16), yvHi = _mm256_unpackhi_epi16(y16, v16);
+    __m256i yuLo = _mm256_unpacklo_epi16(y16, u16), yuHi = _mm256_unpackhi_epi16(y16, u16);
+    __m256i v0Lo = _mm256_unpacklo_epi16(v16, zero), v0Hi = _mm256_unpackhi_epi16(v16, zero);
+
+    __m256i rLo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yvLo, k.yR), k.round), YUV_COEFF_SHIFT);
+    __m256i rHi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yvHi, k.yR), k.round), YUV_COEFF_SHIFT);
+    __m256i bLo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yuLo, k.yB), k.round), YUV_COEFF_SHIFT);
+    __m256i bHi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(yuHi, k.yB), k.round), YUV_COEFF_SHIFT);
+    __m256i gLo = _mm256_add_epi32(_mm256_madd_epi16(yuLo, k.yG), _mm256_madd_epi16(v0Lo, k.vG));
+    __m256i gHi = _mm256_add_epi32(_mm256_madd_epi16(yuHi, k.yG), _mm256_madd_epi16(v0Hi, k.vG));
+    gLo = _mm256_srai_epi32(_mm256_add_epi32(gLo, k.round), YUV_COEFF_SHIFT);
+    gHi = _mm256_srai_epi32(_mm256_add_epi32(gHi, k.round), YUV_COEFF_SHIFT);
+
+    *r16 = _mm256_packs_epi32(rLo, rHi);
+    *g16 = _mm256_packs_epi32(gLo, gHi);
+    *b16 = _mm256_packs_epi32(bLo, bHi);
+}
+
+AVX2_TARGET static inline void loadI420Avx2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                                            __m256i* y16, __m256i* u16, __m256i* v16) {
+    __m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y));
+    __m128i u8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(u));
+    __m128i v8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(v));
+    *y16 = _mm256_cvtepu8_epi16(y8);
+    *u16 = _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(u8, u8));
+    *v16 = _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(v8, v8));
+}
+
+AVX2_TARGET static inline void loadNv12Avx2(const uint8_t* y, const uint8_t* uv,
+                                            __m256i* y16, __m256i* u16, __m256i* v16) {
+    __m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y));
+    __m256i uv16 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(uv)));
+    *y16 = _mm256_cvtepu8_epi16(y8);
+    *u16 = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(uv16, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+    *v16 = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(uv16, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+}
+
+AVX2_TARGET static inline void storeRGBAAvx2(uint8_t* dst, __m256i r16, __m256i g16, __m256i b16) {
+    __m256i rb = _mm256_packus_epi16(r16, b16);                     // per lane: r0..7 b0..7
+    __m256i ga = _mm256_packus_epi16(g16, _mm256_set1_epi16(255));  // per lane: g0..7 a0..7
+    __m256i rg = _mm256_unpacklo_epi8(rb, ga);
+    __m256i ba = _mm256_unpackhi_epi8(rb, ga);
+    __m256i lo = _mm256_unpacklo_epi16(rg, ba);   // pixels 0-3 | 8-11
+    __m256i hi = _mm256_unpackhi_epi16(rg, ba);   // pixels 4-7 | 12-15
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+AVX2_TARGET static inline void storeRGB565Avx2(uint8_t* dst, __m256i r16, __m256i g16, __m256i b16) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi16(255);
+    r16 = _mm256_min_epi16(_mm256_max_epi16(r16, zero), max);
+    g16 = _mm256_min_epi16(_mm256_max_epi16(g16, zero), max);
+    b16 = _mm256_min_epi16(_mm256_max_epi16(b16, zero), max);
+    __m256i px = _mm256_or_si256(
+            _mm256_slli_epi16(_mm256_and_si256(r16, _mm256_set1_epi16(0xF8)), 8),
+            _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(g16, _mm256_set1_epi16(0xFC)), 3),
+                            _mm256_srli_epi16(b16, 3)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), px);
+}
+
+AVX2_TARGET static void i420ToRGBARowAvx2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                                          uint8_t* dst, int width, const YuvCoeffs* c) {
+    const Avx2Coeffs k = loadAvx2(c);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i y16, u16, v16, r16, g16, b16;
+        loadI420Avx2(y + x, u + x / 2, v + x / 2, &y16, &u16, &v16);
+        yuvToRgb16Avx2(y16, u16, v16, k, &r16, &g16, &b16);
+        storeRGBAAvx2(dst + x * 4, r16, g16, b16);
+    }
+    tailRow(i420ToRGBARowSse2, y, u, v, dst, x, width, 4, false, c);
+}
+
+AVX2_TARGET static void nv12ToRGBARowAvx2(const uint8_t* y, const uint8_t* uv, const uint8_t* v,
+                                          uint8_t* dst, int width, const YuvCoeffs* c) {
+    const Avx2Coeffs k = loadAvx2(c);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i y16, u16, v16, r16, g16, b16;
+        loadNv12Avx2(y + x, uv + x, &y16, &u16, &v16);
+        yuvToRgb16Avx2(y16, u16, v16, k, &r16, &g16, &b16);
+        storeRGBAAvx2(dst + x * 4, r16, g16, b16);
+    }
+    tailRow(nv12ToRGBARowSse2, y, uv, v, dst, x, width, 4, true, c);
+}
+
+AVX2_TARGET static void i420ToRGB565RowAvx2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                                            uint8_t* dst, int width, const YuvCoeffs* c) {
+    const Avx2Coeffs k = loadAvx2(c);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i y16, u16, v16, r16, g16, b16;
+        loadI420Avx2(y + x, u + x / 2, v + x / 2, &y16, &u16, &v16);
+        yuvToRgb16Avx2(y16, u16, v16, k, &r16, &g16, &b16);
+        storeRGB565Avx2(dst + x * 2, r16, g16, b16);
+    }
+    tailRow(i420ToRGB565RowSse2, y, u, v, dst, x, width, 2, false, c);
+}
+
+AVX2_TARGET static void nv12ToRGB565RowAvx2(const uint8_t* y, const uint8_t* uv, const uint8_t* v,
+                                            uint8_t* dst, int width, const YuvCoeffs* c) {
+    const Avx2Coeffs k = loadAvx2(c);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i y16, u16, v16, r16, g16, b16;
+        loadNv12Avx2(y + x, uv + x, &y16, &u16, &v16);
+        yuvToRgb16Avx2(y16, u16, v16, k, &r16, &g16, &b16);
+        storeRGB565Avx2(dst + x * 2, r16, g16, b16);
+    }
+    tailRow(nv12ToRGB565RowSse2, y, uv, v, dst, x, width, 2, true, c);
+}
+
+const YuvRowKernels* yuvSse2Kernels() {
+    static const YuvRowKernels table = {
+            "sse2",
+            i420ToRGBARowSse2,
+            nv12ToRGBARowSse2,
+            i420ToRGB565RowSse2,
+            nv12ToRGB565RowSse2,
+    };
+    // SSE2 is part of the x86_64 baseline and of Android's x86 ABI
+    return &table;
+}
+
+const YuvRowKernels* yuvAvx2Kernels() {
+    static const YuvRowKernels table = {
+            "avx2",
+            i420ToRGBARowAvx2,
+            nv12ToRGBARowAvx2,
+            i420ToRGB565RowAvx2,
+            nv12ToRGB565RowAvx2,
+    };
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? &table : nullptr;
+}
+
+#else
+
+const YuvRowKernels* yuvSse2Kernels() { return nullptr; }
+const YuvRowKernels* yuvAvx2Kernels() { return nullptr; }
+
+#endif
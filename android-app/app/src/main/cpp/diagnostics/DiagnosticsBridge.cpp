@@ -0,0 +1,153 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include <jni.h>
+#include <string>
+#include "MediaStatus.h"
+#include "decode_benchmark.h"
+#include "open_benchmark.h"
+#include "queue_benchmark.h"
+#include "slow_source_check.h"
+#include "yuv_convert_check.h"
+
+#define LOG_TAG "DiagnosticsBridge"
+#include "CommonTools.h"
+
+// Benchmarks and self-checks for EngineDiagnostics (debug builds and
+// androidTest only, see FFMPEGDECODER_DIAGNOSTICS in CMakeLists.txt).
+
+extern "C" {
+
+static std::string JStringToStdString(JNIEnv* env, jstring jstr) {
+    if (!jstr) return {};
+    const char* utf = env->GetStringUTFChars(jstr, nullptr);
+    std::string result(utf ? utf : "");
+    env->ReleaseStringUTFChars(jstr, utf);
+    return result;
+}
+
+/**
+ * static int nativeBenchmarkOpen(String path, int rounds, long[] usOut)
+ *
+ * usOut[0] open without the probe cache, usOut[1] with it: us per open.
+ */
+JNIEXPORT jint JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_EngineDiagnostics_nativeBenchmarkOpen(
+        JNIEnv* env,
+        jclass /*clazz*/,
+        jstring jPath,
+        jint rounds,
+        jlongArray jUsOut) {
+    if (!jUsOut || env->GetArrayLength(jUsOut) < 2) return (jint)MEDIA_STATUS_ERROR;
+
+    std::string path = JStringToStdString(env, jPath);
+    int64_t us[2] = {0, 0};
+    int ret = benchmarkOpen(path.c_str(), rounds, us);
+    if (ret == 0) {
+        jlong values[2] = {(jlong)us[0], (jlong)us[1]};
+        env->SetLongArrayRegion(jUsOut, 0, 2, values);
+    }
+    return ret;
+}
+
+/**
+ * static int nativeBenchmarkDecodeThreads(String path, int frames, long[] out)
+ *
+ * 8 values per thread policy (auto, frame, slice, single): thread count,
+ * active FF_THREAD_* type, frames, fps * 100, first frame us, avg latency us,
+ * max latency us, max frames in flight.
+ */
+JNIEXPORT jint JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_EngineDiagnostics_nativeBenchmarkDecodeThreads(
+        JNIEnv* env,
+        jclass /*clazz*/,
+        jstring jPath,
+        jint frames,
+        jlongArray jOut) {
+    const int fields = 8;
+    if (!jOut || env->GetArrayLength(jOut) < fields * VIDEO_THREAD_POLICY_COUNT) {
+        return (jint)MEDIA_STATUS_ERROR;
+    }
+
+    std::string path = JStringToStdString(env, jPath);
+    DecodeThreadBench results[VIDEO_THREAD_POLICY_COUNT];
+    int ret = benchmarkDecodeThreads(path.c_str(), frames, results);
+    if (ret == 0) {
+        jlong values[fields * VIDEO_THREAD_POLICY_COUNT];
+        for (int i = 0; i < VIDEO_THREAD_POLICY_COUNT; i++) {
+            const DecodeThreadBench& r = results[i];
+            jlong* v = values + i * fields;
+            v[0] = r.threadCount;
+            v[1] = r.activeType;
+            v[2] = r.frames;
+            v[3] = r.fpsX100;
+            v[4] = r.firstFrameUs;
+            v[5] = r.avgLatencyUs;
+            v[6] = r.maxLatencyUs;
+            v[7] = r.maxFramesInFlight;
+        }
+        env->SetLongArrayRegion(jOut, 0, fields * VIDEO_THREAD_POLICY_COUNT, values);
+    }
+    return ret;
+}
+
+/**
+ * static int nativeCheckColorConversion()
+ *
+ * Largest per-channel difference of the native YUV kernels to sws_scale,
+ * <0 when swscale could not be set up.
+ */
+JNIEXPORT jint JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_EngineDiagnostics_nativeCheckColorConversion(
+        JNIEnv* /*env*/,
+        jclass /*clazz*/) {
+    return checkYuvKernels(nullptr);
+}
+
+/**
+ * static int nativeCheckSlowSourceAbort(long[] msOut)
+ *
+ * msOut[0] demuxer seek, msOut[1] controller stop, both issued while the
+ * source stalls mid-stream: ms until they returned.
+ */
+JNIEXPORT jint JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_EngineDiagnostics_nativeCheckSlowSourceAbort(
+        JNIEnv* env,
+        jclass /*clazz*/,
+        jlongArray jMsOut) {
+    if (!jMsOut || env->GetArrayLength(jMsOut) < 2) return (jint)MEDIA_STATUS_ERROR;
+
+    int64_t ms[2] = {0, 0};
+    int ret = checkSlowSourceAbort(ms);
+    if (ret == 0) {
+        jlong values[2] = {(jlong)ms[0], (jlong)ms[1]};
+        env->SetLongArrayRegion(jMsOut, 0, 2, values);
+    }
+    return ret;
+}
+
+/**
+ * static int nativeBenchmarkQueues(int items, int depth, long[] nsOut)
+ *
+ * nsOut[0] mutex + condvar queue, nsOut[1] SPSC ring: ns per hand-off.
+ */
+JNIEXPORT jint JNICALL
+Java_com_audio_study_ffmpegdecoder_player_engine_EngineDiagnostics_nativeBenchmarkQueues(
+        JNIEnv* env,
+        jclass /*clazz*/,
+        jint items,
+        jint depth,
+        jlongArray jNsOut) {
+    if (!jNsOut || env->GetArrayLength(jNsOut) < 2) return (jint)MEDIA_STATUS_ERROR;
+
+    int64_t ns[2] = {0, 0};
+    int ret = benchmarkFrameQueues(items, depth, ns);
+    if (ret == 0) {
+        jlong values[2] = {(jlong)ns[0], (jlong)ns[1]};
+        env->SetLongArrayRegion(jNsOut, 0, 2, values);
+    }
+    return ret;
+}
+
+} // extern "C"
@@ -0,0 +1,66 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include "decode_benchmark.h"
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+#define LOG_TAG "DecodeBenchmark"
+#include "CommonTools.h"
+
+static int runPolicy(const char* path, int policy, int frames, DecodeThreadBench* out) {
+    VideoDecoder decoder;
+    // private demuxer: the player's read position stays untouched
+    decoder.setShareDemuxer(false);
+    decoder.setThreadPolicy(policy, 0);
+    int ret = decoder.open(path);
+    if (ret < 0) return ret;
+
+    int decoded = 0;
+    int64_t firstFrameUs = 0;
+    const int64_t startUs = av_gettime_relative();
+    while (decoded < frames) {
+        ret = decoder.decodeFrame();
+        if (ret == AVERROR(EAGAIN)) continue;   // demux thread still reading
+        if (ret <= 0) break;
+        if (decoded++ == 0) firstFrameUs = av_gettime_relative() - startUs;
+    }
+    const int64_t elapsedUs = av_gettime_relative() - startUs;
+    if (ret < 0 && ret != AVERROR(EAGAIN)) return ret;
+    if (decoded == 0) return AVERROR_INVALIDDATA;
+
+    VideoThreadingStats stats = decoder.getThreadingStats();
+    out->threadCount = stats.threadCount;
+    out->activeType = stats.activeType;
+    out->frames = decoded;
+    out->fpsX100 = elapsedUs > 0 ? (int64_t) decoded * 100 * 1000000 / elapsedUs : 0;
+    out->firstFrameUs = firstFrameUs;
+    out->avgLatencyUs = stats.avgLatencyUs;
+    out->maxLatencyUs = stats.maxLatencyUs;
+    out->maxFramesInFlight = stats.maxFramesInFlight;
+    return 0;
+}
+
+int benchmarkDecodeThreads(const char* path, int frames, DecodeThreadBench* results) {
+    if (!path || frames <= 0 || !results) return AVERROR(EINVAL);
+
+    DecodeThreadBench warmUp;
+    int ret = runPolicy(path, VIDEO_THREADS_SINGLE, MIN(frames, 30), &warmUp);
+    if (ret < 0) return ret;
+
+    for (int policy = VIDEO_THREADS_AUTO; policy < VIDEO_THREAD_POLICY_COUNT; policy++) {
+        DecodeThreadBench& r = results[policy];
+        r = DecodeThreadBench();
+        ret = runPolicy(path, policy, frames, &r);
+        if (ret < 0) return ret;
+        LOGI("benchmarkDecodeThreads %s policy %d: %d thread(s) type %d, %d frames, %lld.%02lld fps, "
+             "first frame %lld us, latency avg %lld max %lld us, in flight %d", path, policy,
+             r.threadCount, r.activeType, r.frames, (long long) (r.fpsX100 / 100),
+             (long long) (r.fpsX100 % 100), (long long) r.firstFrameUs, (long long) r.avgLatencyUs,
+             (long long) r.maxLatencyUs, r.maxFramesInFlight);
+    }
+    return 0;
+}
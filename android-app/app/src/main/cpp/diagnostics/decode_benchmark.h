@@ -0,0 +1,32 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <cstdint>
+#include "video_decoder.h"
+
+// one VideoThreadPolicy run of benchmarkDecodeThreads()
+struct DecodeThreadBench {
+    int     threadCount = 0;       // codec thread_count
+    int     activeType = 0;        // FF_THREAD_* the codec actually used
+    int     frames = 0;
+    int64_t fpsX100 = 0;           // decoded frames per second * 100
+    int64_t firstFrameUs = 0;      // first packet sent → first frame out
+    int64_t avgLatencyUs = 0;      // packet sent → its frame out
+    int64_t maxLatencyUs = 0;
+    int     maxFramesInFlight = 0;
+};
+
+/**
+ * Decode the first `frames` video frames of `path` once per
+ * VideoThreadPolicy (no conversion, no rendering) after one untimed pass
+ * that warms the page cache. Run it on a 1080p and a 4K sample to pick a
+ * policy for a device: frame threads win on fps, slice threads / single on
+ * latency.
+ *
+ * results: VIDEO_THREAD_POLICY_COUNT entries, indexed by policy
+ * return: 0, <0 AVERROR when the file cannot be decoded
+ */
+int benchmarkDecodeThreads(const char* path, int frames, DecodeThreadBench* results);
@@ -0,0 +1,50 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include "open_benchmark.h"
+#include "media_demuxer.h"
+#include "probe_cache.h"
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+#define LOG_TAG "OpenBenchmark"
+#include "CommonTools.h"
+
+// open of one private instance in microseconds (closed again on return)
+static int64_t timeOpen(const char* path, int* err) {
+    int64_t startUs = av_gettime_relative();
+    std::shared_ptr<MediaDemuxer> demuxer = MediaDemuxer::acquire(path, false, err);
+    int64_t elapsedUs = av_gettime_relative() - startUs;
+    return demuxer ? elapsedUs : -1;
+}
+
+int benchmarkOpen(const char* path, int rounds, int64_t* usOut) {
+    if (!path || rounds <= 0 || !usOut) return AVERROR(EINVAL);
+
+    int err = 0;
+    if (timeOpen(path, &err) < 0) return err;
+
+    int64_t coldUs = 0;
+    int64_t warmUs = 0;
+    for (int i = 0; i < rounds; i++) {
+        ProbeCache::invalidate(path);
+        int64_t us = timeOpen(path, &err);
+        if (us < 0) return err;
+        coldUs += us;
+
+        // the cold open just stored the probe again
+        us = timeOpen(path, &err);
+        if (us < 0) return err;
+        warmUs += us;
+    }
+    usOut[0] = coldUs / rounds;
+    usOut[1] = warmUs / rounds;
+    ProbeCacheStats stats = ProbeCache::getStats();
+    LOGI("benchmarkOpen %s: cold %lld us, warm %lld us (cache hits=%llu mismatches=%llu)", path,
+         (long long) usOut[0], (long long) usOut[1],
+         (unsigned long long) stats.hits, (unsigned long long) stats.mismatches);
+    return 0;
+}
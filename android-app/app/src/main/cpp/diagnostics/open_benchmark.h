@@ -0,0 +1,18 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Container open time of `path` with and without ProbeCache, `rounds` times
+ * each after one untimed open (so both sides see a warm page cache and only
+ * differ in avformat_find_stream_info()).
+ *
+ * usOut[0] cold (cache invalidated before every open), usOut[1] warm:
+ * average microseconds per open.
+ * return: 0, <0 AVERROR when the file cannot be opened
+ */
+int benchmarkOpen(const char* path, int rounds, int64_t* usOut);
@@ -0,0 +1,127 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include "queue_benchmark.h"
+#include "spsc_ring.h"
+#include <queue>
+#include <sched.h>
+#include <time.h>
+
+static int64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+namespace {
+
+struct MutexQueueBench {
+    int items = 0;
+    int depth = 0;
+    std::queue<void*> queue;
+    pthread_mutex_t mutex{};
+    pthread_cond_t cond{};
+
+    static void* produce(void* arg) {
+        auto* self = static_cast<MutexQueueBench*>(arg);
+        for (int i = 1; i <= self->items; i++) {
+            pthread_mutex_lock(&self->mutex);
+            while ((int) self->queue.size() >= self->depth) {
+                pthread_cond_wait(&self->cond, &self->mutex);
+            }
+            self->queue.push(reinterpret_cast<void*>((intptr_t) i));
+            pthread_mutex_unlock(&self->mutex);
+        }
+        return nullptr;
+    }
+
+    void consume() {
+        int received = 0;
+        while (received < items) {
+            void* item = nullptr;
+            pthread_mutex_lock(&mutex);
+            if (!queue.empty()) {
+                item = queue.front();
+                queue.pop();
+                if ((int) queue.size() < depth / 4) {
+                    pthread_cond_signal(&cond);
+                }
+            }
+            pthread_mutex_unlock(&mutex);
+            if (item) {
+                received++;
+            } else {
+                sched_yield();
+            }
+        }
+    }
+};
+
+struct SpscRingBench {
+    int items = 0;
+    int depth = 0;
+    SpscRing<void*> ring;
+    SpscWaiter waiter;
+
+    explicit SpscRingBench(int capacity) : ring(capacity) {}
+
+    static void* produce(void* arg) {
+        auto* self = static_cast<SpscRingBench*>(arg);
+        for (int i = 1; i <= self->items; i++) {
+            self->waiter.wait([self] { return (int) self->ring.size() < self->depth; });
+            self->ring.push(reinterpret_cast<void*>((intptr_t) i));
+        }
+        return nullptr;
+    }
+
+    void consume() {
+        int received = 0;
+        while (received < items) {
+            void* item = nullptr;
+            if (ring.pop(item)) {
+                received++;
+                if ((int) ring.size() < depth / 4) {
+                    waiter.notify();
+                }
+            } else {
+                waiter.notify();
+                sched_yield();
+            }
+        }
+    }
+};
+
+template <typename Bench>
+int64_t run(Bench& bench) {
+    pthread_t producer;
+    int64_t start = nowNs();
+    if (pthread_create(&producer, nullptr, &Bench::produce, &bench) != 0) {
+        return -1;
+    }
+    bench.consume();
+    pthread_join(producer, nullptr);
+    return (nowNs() - start) / bench.items;
+}
+
+} // namespace
+
+int benchmarkFrameQueues(int items, int depth, int64_t* nsOut) {
+    if (items <= 0 || depth <= 0 || !nsOut) return -1;
+
+    MutexQueueBench mutexBench;
+    mutexBench.items = items;
+    mutexBench.depth = depth;
+    pthread_mutex_init(&mutexBench.mutex, nullptr);
+    pthread_cond_init(&mutexBench.cond, nullptr);
+    nsOut[0] = run(mutexBench);
+    pthread_cond_destroy(&mutexBench.cond);
+    pthread_mutex_destroy(&mutexBench.mutex);
+
+    SpscRingBench ringBench(depth);
+    ringBench.items = items;
+    ringBench.depth = depth;
+    nsOut[1] = run(ringBench);
+
+    return (nsOut[0] < 0 || nsOut[1] < 0) ? -1 : 0;
+}
@@ -0,0 +1,18 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Decode-thread → consumer hand-off, measured both ways on the device:
+ * a mutex + condvar std::queue (what the controllers used before) and
+ * SpscRing + SpscWaiter, each bounded to `depth` entries with the producer
+ * parking on a full queue and the consumer polling like the render loop.
+ *
+ * nsOut[0] mutex queue, nsOut[1] SPSC ring: average nanoseconds per item.
+ * return: 0, <0 on bad arguments or thread failure
+ */
+int benchmarkFrameQueues(int items, int depth, int64_t* nsOut);
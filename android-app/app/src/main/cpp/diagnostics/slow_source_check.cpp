@@ -0,0 +1,282 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include "slow_source_check.h"
+#include "media_demuxer.h"
+#include "video_decoder_controller.h"
+#include "MediaStatus.h"
+#include <atomic>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/time.h>
+}
+
+#define LOG_TAG "SlowSourceCheck"
+#include "CommonTools.h"
+
+static const int SAMPLE_WIDTH = 320;
+static const int SAMPLE_HEIGHT = 240;
+static const int SAMPLE_FPS = 25;
+static const int SAMPLE_FRAMES = 100;
+// probing must finish on the half that is sent
+static const int64_t PROBE_SIZE = 32 * 1024;
+static const int64_t ANALYZE_US = 200 * 1000;
+// the demux thread has read everything that was sent by then
+static const int DRAIN_WAIT_MS = 1000;
+
+// SAMPLE_FRAMES of noisy MPEG-1 video muxed as MPEG-TS, in memory
+static int makeSample(std::vector<uint8_t>* out) {
+    const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_MPEG1VIDEO);
+    if (!codec) return AVERROR_ENCODER_NOT_FOUND;
+
+    AVFormatContext* oc = nullptr;
+    int ret = avformat_alloc_output_context2(&oc, nullptr, "mpegts", nullptr);
+    if (ret < 0) return ret;
+    AVCodecContext* enc = avcodec_alloc_context3(codec);
+    AVFrame* frame = av_frame_alloc();
+    AVPacket* pkt = av_packet_alloc();
+    AVStream* st = avformat_new_stream(oc, nullptr);
+    if (!enc || !frame || !pkt || !st) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    enc->width = SAMPLE_WIDTH;
+    enc->height = SAMPLE_HEIGHT;
+    enc->pix_fmt = AV_PIX_FMT_YUV420P;
+    enc->time_base = AVRational{1, SAMPLE_FPS};
+    enc->framerate = AVRational{SAMPLE_FPS, 1};
+    enc->gop_size = 12;
+    enc->bit_rate = 4000000;
+    if ((ret = avcodec_open2(enc, codec, nullptr)) < 0) goto end;
+    if ((ret = avcodec_parameters_from_context(st->codecpar, enc)) < 0) goto end;
+    st->time_base = enc->time_base;
+    if ((ret = avio_open_dyn_buf(&oc->pb)) < 0) goto end;
+    if ((ret = avformat_write_header(oc, nullptr)) < 0) goto end;
+
+    frame->format = enc->pix_fmt;
+    frame->width = enc->width;
+    frame->height = enc->height;
+    if ((ret = av_frame_get_buffer(frame, 32)) < 0) goto end;
+
+    {
+        uint32_t seed = 1;
+        for (int i = 0; i <= SAMPLE_FRAMES && ret >= 0; i++) {
+            AVFrame* in = nullptr;
+            if (i < SAMPLE_FRAMES) {
+                if ((ret = av_frame_make_writable(frame)) < 0) break;
+                // noise: every frame costs the encoder real bits
+                for (int p = 0; p < 3; p++) {
+                    const int w = p ? SAMPLE_WIDTH / 2 : SAMPLE_WIDTH;
+                    const int h = p ? SAMPLE_HEIGHT / 2 : SAMPLE_HEIGHT;
+                    for (int y = 0; y < h; y++) {
+                        uint8_t* row = frame->data[p] + y * frame->linesize[p];
+                        for (int x = 0; x < w; x++) {
+                            seed = seed * 1664525u + 1013904223u;
+                            row[x] = (uint8_t) (seed >> 24);
+                        }
+                    }
+                }
+                frame->pts = i;
+                in = frame;
+            }
+            ret = avcodec_send_frame(enc, in);
+            while (ret >= 0) {
+                ret = avcodec_receive_packet(enc, pkt);
+                if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+                    ret = 0;
+                    break;
+                }
+                if (ret < 0) break;
+                av_packet_rescale_ts(pkt, enc->time_base, st->time_base);
+                pkt->stream_index = st->index;
+                ret = av_interleaved_write_frame(oc, pkt);
+            }
+        }
+    }
+    if (ret >= 0) ret = av_write_trailer(oc);
+
+end:
+    if (oc && oc->pb) {
+        uint8_t* buffer = nullptr;
+        int size = avio_close_dyn_buf(oc->pb, &buffer);
+        oc->pb = nullptr;
+        if (ret >= 0 && size > 0) out->assign(buffer, buffer + size);
+        av_free(buffer);
+    }
+    av_packet_free(&pkt);
+    av_frame_free(&frame);
+    avcodec_free_context(&enc);
+    avformat_free_context(oc);
+    return ret < 0 ? ret : (out->empty() ? AVERROR(EIO) : 0);
+}
+
+/**
+ * Loopback server: every connection gets the first `sendBytes` of the
+ * sample and then nothing, until stop().
+ */
+class StallingServer {
+public:
+    ~StallingServer() { stop(); }
+
+    // port, <0 AVERROR
+    int start(const std::vector<uint8_t>* sample, size_t sendBytes) {
+        data = sample;
+        prefix = sendBytes;
+        listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd < 0) return AVERROR(errno);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t length = sizeof(addr);
+        if (bind(listenFd, (sockaddr*) &addr, sizeof(addr)) != 0 || listen(listenFd, 4) != 0 ||
+            getsockname(listenFd, (sockaddr*) &addr, &length) != 0) {
+            return AVERROR(errno);
+        }
+        if (pthread_create(&thread, nullptr, &StallingServer::threadEntry, this) != 0) {
+            return AVERROR(EAGAIN);
+        }
+        started = true;
+        return ntohs(addr.sin_port);
+    }
+
+    void stop() {
+        if (started) {
+            done = true;
+            pthread_join(thread, nullptr);
+            started = false;
+        }
+        for (int fd : clients) ::close(fd);
+        clients.clear();
+        if (listenFd >= 0) {
+            ::close(listenFd);
+            listenFd = -1;
+        }
+    }
+
+private:
+    static void* threadEntry(void* arg) {
+        static_cast<StallingServer*>(arg)->serve();
+        return nullptr;
+    }
+
+    void serve() {
+        while (!done) {
+            pollfd pfd = {listenFd, POLLIN, 0};
+            if (poll(&pfd, 1, 100) <= 0) continue;
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd < 0) continue;
+            // the reader may take its time: don't let a full socket buffer
+            // keep stop() waiting
+            timeval timeout = {0, 100 * 1000};
+            setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            size_t sent = 0;
+            while (!done && sent < prefix) {
+                ssize_t n = send(fd, data->data() + sent, prefix - sent, MSG_NOSIGNAL);
+                if (n > 0) {
+                    sent += (size_t) n;
+                } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    break;
+                }
+            }
+            // kept open and silent: the client's next read blocks
+            clients.push_back(fd);
+        }
+    }
+
+    const std::vector<uint8_t>* data = nullptr;
+    size_t prefix = 0;
+    int listenFd = -1;
+    pthread_t thread{};
+    bool started = false;
+    std::atomic<bool> done{false};
+    std::vector<int> clients;   // server thread until stop()
+};
+
+static MediaIoOptions slowIoOptions() {
+    MediaIoOptions io;
+    io.probeSize = PROBE_SIZE;
+    io.analyzeDurationUs = ANALYZE_US;
+    return io;
+}
+
+// demuxer seek while its thread is blocked on the stalled read, ms
+static int64_t timeSeek(const char* url, int* err) {
+    std::shared_ptr<MediaDemuxer> demuxer = MediaDemuxer::acquire(url, false, err, slowIoOptions());
+    if (!demuxer) return -1;
+    const int stream = av_find_best_stream(demuxer->context(), AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (stream < 0 || demuxer->subscribe(stream) < 0) {
+        *err = stream < 0 ? stream : AVERROR(EINVAL);
+        return -1;
+    }
+    // drain what was sent until the queue stays empty
+    AVPacket* pkt = av_packet_alloc();
+    const int64_t drainUntilUs = av_gettime_relative() + DRAIN_WAIT_MS * 1000LL;
+    while (av_gettime_relative() < drainUntilUs) {
+        int ret = demuxer->readPacket(stream, pkt, nullptr);
+        av_packet_unref(pkt);
+        if (ret < 0 && ret != AVERROR(EAGAIN)) break;
+    }
+    av_packet_free(&pkt);
+
+    const int64_t startUs = av_gettime_relative();
+    int ret = demuxer->seek(stream, 0);
+    const int64_t elapsedMs = (av_gettime_relative() - startUs) / 1000;
+    LOGI("checkSlowSourceAbort: seek returned %d after %lld ms", ret, (long long) elapsedMs);
+    return elapsedMs;
+}
+
+// stop() of a prerolled controller whose source stalled, ms
+static int64_t timeStop(const char* url, int* err) {
+    VideoDecoderController controller;
+    controller.setIoOptions(slowIoOptions());
+    if (controller.init(url) != MEDIA_STATUS_OK || controller.preroll() != MEDIA_STATUS_OK) {
+        *err = AVERROR(EIO);
+        return -1;
+    }
+    // the decode thread is idle on an empty packet queue by then
+    usleep(DRAIN_WAIT_MS * 1000);
+
+    const int64_t startUs = av_gettime_relative();
+    controller.stop();
+    const int64_t elapsedMs = (av_gettime_relative() - startUs) / 1000;
+    LOGI("checkSlowSourceAbort: stop returned after %lld ms", (long long) elapsedMs);
+    return elapsedMs;
+}
+
+int checkSlowSourceAbort(int64_t* msOut) {
+    if (!msOut) return AVERROR(EINVAL);
+
+    std::vector<uint8_t> sample;
+    int ret = makeSample(&sample);
+    if (ret < 0) {
+        LOGE("checkSlowSourceAbort: cannot build the sample: %d", ret);
+        return ret;
+    }
+    StallingServer server;
+    int port = server.start(&sample, sample.size() / 2);
+    if (port < 0) {
+        LOGE("checkSlowSourceAbort: cannot listen: %d", port);
+        return port;
+    }
+    char url[64];
+    snprintf(url, sizeof(url), "tcp://127.0.0.1:%d", port);
+    LOGI("checkSlowSourceAbort: %zu byte sample, half of it served at %s", sample.size(), url);
+
+    int err = 0;
+    msOut[0] = timeSeek(url, &err);
+    if (msOut[0] < 0) return err < 0 ? err : AVERROR(EIO);
+    msOut[1] = timeStop(url, &err);
+    if (msOut[1] < 0) return err < 0 ? err : AVERROR(EIO);
+    return 0;
+}
@@ -0,0 +1,20 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Interruptible I/O against a deliberately slow source: a loopback TCP
+ * server sends the first half of a generated MPEG-TS clip and then stalls,
+ * so the demux thread ends up blocked inside av_read_frame().
+ *
+ * msOut[0] MediaDemuxer::seek() issued while the read is blocked,
+ *          bounded by MediaDemuxer::SEEK_TIMEOUT_MS
+ * msOut[1] VideoDecoderController::stop() of a prerolled controller on the
+ *          same kind of stalled source, returns within a few interrupt polls
+ * return: 0, <0 AVERROR when the sample or the server could not be set up
+ */
+int checkSlowSourceAbort(int64_t* msOut);
@@ -0,0 +1,185 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#include "yuv_convert_check.h"
+#include <cstdlib>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+#define LOG_TAG "YuvConvertCheck"
+#include "CommonTools.h"
+
+// not a multiple of any vector width: the kernels' tails are covered too
+static const int CHECK_WIDTH = 250;
+static const int CHECK_HEIGHT = 256;
+static const int BLOCK = 16;
+// pixels this close to a chroma block edge are not compared
+static const int EDGE = 2;
+
+static bool interior(int v) {
+    const int offset = v % BLOCK;
+    return offset >= EDGE && offset < BLOCK - EDGE;
+}
+
+// luma ramps in both directions, chroma per 16x16 block: U across, V down
+static AVFrame* makeFrame(AVPixelFormat format) {
+    AVFrame* frame = av_frame_alloc();
+    if (!frame) return nullptr;
+    frame->format = format;
+    frame->width = CHECK_WIDTH;
+    frame->height = CHECK_HEIGHT;
+    if (av_frame_get_buffer(frame, 32) < 0) {
+        av_frame_free(&frame);
+        return nullptr;
+    }
+    for (int y = 0; y < CHECK_HEIGHT; y++) {
+        uint8_t* row = frame->data[0] + y * frame->linesize[0];
+        for (int x = 0; x < CHECK_WIDTH; x++) {
+            row[x] = (uint8_t) ((x * 7 + y * 13) & 0xFF);
+        }
+    }
+    for (int cy = 0; cy < CHECK_HEIGHT / 2; cy++) {
+        const uint8_t v = (uint8_t) (255 - (cy * 2 / BLOCK) * 17);
+        for (int cx = 0; cx < CHECK_WIDTH / 2; cx++) {
+            const uint8_t u = (uint8_t) ((cx * 2 / BLOCK) * 17);
+            if (format == AV_PIX_FMT_NV12) {
+                uint8_t* uv = frame->data[1] + cy * frame->linesize[1] + cx * 2;
+                uv[0] = u;
+                uv[1] = v;
+            } else {
+                frame->data[1][cy * frame->linesize[1] + cx] = u;
+                frame->data[2][cy * frame->linesize[2] + cx] = v;
+            }
+        }
+    }
+    return frame;
+}
+
+// swscale's RGBA for `src`, point-sampled full-resolution chroma
+static int swsReference(const AVFrame* src, bool bt709, bool fullRange, std::vector<uint8_t>* rgba) {
+    SwsContext* sws = sws_getContext(CHECK_WIDTH, CHECK_HEIGHT, (AVPixelFormat) src->format,
+                                     CHECK_WIDTH, CHECK_HEIGHT, AV_PIX_FMT_RGBA,
+                                     SWS_POINT | SWS_ACCURATE_RND | SWS_FULL_CHR_H_INT,
+                                     nullptr, nullptr, nullptr);
+    if (!sws) return AVERROR(EINVAL);
+    sws_setColorspaceDetails(sws, sws_getCoefficients(bt709 ? SWS_CS_ITU709 : SWS_CS_ITU601),
+                             fullRange ? 1 : 0, sws_getCoefficients(SWS_CS_DEFAULT), 1,
+                             0, 1 << 16, 1 << 16);
+    rgba->assign((size_t) CHECK_WIDTH * CHECK_HEIGHT * 4, 0);
+    uint8_t* dst[4] = {rgba->data(), nullptr, nullptr, nullptr};
+    int dstStride[4] = {CHECK_WIDTH * 4, 0, 0, 0};
+    sws_scale(sws, src->data, src->linesize, 0, CHECK_HEIGHT, dst, dstStride);
+    sws_freeContext(sws);
+    return 0;
+}
+
+static int compareRGBA(const uint8_t* out, const uint8_t* ref) {
+    int maxDiff = 0;
+    for (int y = 0; y < CHECK_HEIGHT; y++) {
+        if (!interior(y)) continue;
+        for (int x = 0; x < CHECK_WIDTH; x++) {
+            if (!interior(x)) continue;
+            const size_t i = ((size_t) y * CHECK_WIDTH + x) * 4;
+            for (int c = 0; c < 3; c++) {
+                maxDiff = MAX(maxDiff, abs(out[i + c] - ref[i + c]));
+            }
+            if (out[i + 3] != 0xFF) maxDiff = MAX(maxDiff, 255 - out[i + 3]);
+        }
+    }
+    return maxDiff;
+}
+
+// RGB565 against the reference packed the same way, in 5/6-bit steps
+static int compareRGB565(const uint16_t* out, const uint8_t* ref) {
+    int maxDiff = 0;
+    for (int y = 0; y < CHECK_HEIGHT; y++) {
+        if (!interior(y)) continue;
+        for (int x = 0; x < CHECK_WIDTH; x++) {
+            if (!interior(x)) continue;
+            const size_t i = (size_t) y * CHECK_WIDTH + x;
+            const uint8_t* rgb = ref + i * 4;
+            const uint16_t got = out[i];
+            maxDiff = MAX(maxDiff, abs((got >> 11) - (rgb[0] >> 3)));
+            maxDiff = MAX(maxDiff, abs(((got >> 5) & 0x3F) - (rgb[1] >> 2)));
+            maxDiff = MAX(maxDiff, abs((got & 0x1F) - (rgb[2] >> 3)));
+        }
+    }
+    return maxDiff;
+}
+
+// every row of `src` through one kernel
+static void runKernel(YuvRowFn row, const AVFrame* src, uint8_t* dst, int dstStride, const YuvCoeffs& coeffs) {
+    const bool nv12 = src->format == AV_PIX_FMT_NV12;
+    for (int y = 0; y < CHECK_HEIGHT; y++) {
+        const uint8_t* yRow = src->data[0] + y * src->linesize[0];
+        const uint8_t* uRow = src->data[1] + (y >> 1) * src->linesize[1];
+        const uint8_t* vRow = nv12 ? nullptr : src->data[2] + (y >> 1) * src->linesize[2];
+        row(yRow, uRow, vRow, dst + (size_t) y * dstStride, CHECK_WIDTH, &coeffs);
+    }
+}
+
+static void logCheck(const YuvKernelCheck& check) {
+    if (check.maxDiff <= 1) return;
+    LOGE("checkYuvKernels: %s %s -> %s %s %s range differs by %d", check.kernels,
+         av_get_pix_fmt_name(check.srcFormat), av_get_pix_fmt_name(check.dstFormat),
+         check.bt709 ? "bt709" : "bt601", check.fullRange ? "full" : "limited", check.maxDiff);
+}
+
+int checkYuvKernels(std::vector<YuvKernelCheck>* results) {
+    const YuvRowKernels* sets[] = {
+            &YuvConvert::scalarKernels(), yuvNeonKernels(), yuvSse2Kernels(), yuvAvx2Kernels(),
+    };
+    const AVPixelFormat srcFormats[] = {AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12};
+
+    std::vector<uint8_t> reference;
+    std::vector<uint8_t> rgba((size_t) CHECK_WIDTH * CHECK_HEIGHT * 4);
+    std::vector<uint16_t> rgb565((size_t) CHECK_WIDTH * CHECK_HEIGHT);
+    int worst = 0;
+    for (AVPixelFormat srcFormat : srcFormats) {
+        AVFrame* src = makeFrame(srcFormat);
+        if (!src) return AVERROR(ENOMEM);
+        for (int matrix = 0; matrix < 2; matrix++) {
+            for (int range = 0; range < 2; range++) {
+                const bool bt709 = matrix == 1;
+                const bool fullRange = range == 1;
+                int ret = swsReference(src, bt709, fullRange, &reference);
+                if (ret < 0) {
+                    av_frame_free(&src);
+                    return ret;
+                }
+                const YuvCoeffs coeffs = YuvConvert::makeCoeffs(bt709, fullRange);
+                for (const YuvRowKernels* k : sets) {
+                    if (!k) continue;
+                    const bool nv12 = srcFormat == AV_PIX_FMT_NV12;
+
+                    runKernel(nv12 ? k->nv12ToRGBA : k->i420ToRGBA, src, rgba.data(), CHECK_WIDTH * 4, coeffs);
+                    YuvKernelCheck check;
+                    check.kernels = k->name;
+                    check.srcFormat = srcFormat;
+                    check.dstFormat = AV_PIX_FMT_RGBA;
+                    check.bt709 = bt709;
+                    check.fullRange = fullRange;
+                    check.maxDiff = compareRGBA(rgba.data(), reference.data());
+                    logCheck(check);
+                    worst = MAX(worst, check.maxDiff);
+                    if (results) results->push_back(check);
+
+                    runKernel(nv12 ? k->nv12ToRGB565 : k->i420ToRGB565, src,
+                              reinterpret_cast<uint8_t*>(rgb565.data()), CHECK_WIDTH * 2, coeffs);
+                    check.dstFormat = AV_PIX_FMT_RGB565LE;
+                    check.maxDiff = compareRGB565(rgb565.data(), reference.data());
+                    logCheck(check);
+                    worst = MAX(worst, check.maxDiff);
+                    if (results) results->push_back(check);
+                }
+            }
+        }
+        av_frame_free(&src);
+    }
+    LOGI("checkYuvKernels: max difference to swscale %d", worst);
+    return worst;
+}
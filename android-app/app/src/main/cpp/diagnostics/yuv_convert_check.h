@@ -0,0 +1,32 @@
+//
+// Created by xinggen guo on 2026/10/17.
+//
+
+#pragma once
+
+#include <vector>
+#include "yuv_convert.h"
+
+// one kernel set × format × colour matrix × range of checkYuvKernels()
+struct YuvKernelCheck {
+    const char*   kernels = nullptr;   // YuvRowKernels::name
+    AVPixelFormat srcFormat = AV_PIX_FMT_NONE;
+    AVPixelFormat dstFormat = AV_PIX_FMT_NONE;
+    bool          bt709 = false;
+    bool          fullRange = false;
+    int           maxDiff = 0;         // per channel; RGB565 in its own 5/6-bit units
+};
+
+/**
+ * Compare every kernel set built for this CPU (scalar, NEON, SSE2, AVX2)
+ * against sws_scale on a synthetic frame that sweeps luma and chroma, for
+ * yuv420p / nv12 → RGBA / RGB565, BT.601 / 709, limited / full range.
+ *
+ * Chroma is constant inside 16x16 luma blocks and only block interiors are
+ * compared, so the result measures the colour maths, not where swscale
+ * sites the chroma samples. The kernels are expected within 1 of swscale.
+ *
+ * results: optional, one entry per combination
+ * return: the largest difference seen, <0 AVERROR when swscale failed
+ */
+int checkYuvKernels(std::vector<YuvKernelCheck>* results);
@@ -106,8 +106,9 @@ void SoundService::producePacket() {
                 frameBuffer,
                 samples * sizeof(short));
 
-        // Remember how many frames this buffer has
-        mFramesPerBuffer[mCurrentFrame] = frames;
+        // Remember how many frames of media this buffer covers
+        mFramesPerBuffer[mCurrentFrame] =
+                (int) (frames * decoderController->getLastPacketSpeed() + 0.5f);
         mCurrentFrame = (mCurrentFrame + 1) % QUEUE_BUFFER_COUNT;
     } else {
         // Should rarely happen; be safe: send silence
@@ -264,6 +265,14 @@ bool SoundService::initSongDecoder(const char* accompanyPath) {
     SAFE_DELETE_ARRAY(mBuffer);
 
     decoderController = new AudioDecoderController();
+    if (liveMode) {
+        // the demuxer shared with the video decoder is opened here first
+        MediaIoOptions io;
+        io.live = true;
+        io.liveMaxBacklogMs = LiveCatchUp::maxBacklogMs(liveTargetMs);
+        decoderController->setIoOptions(io);
+        decoderController->setLiveTarget(liveTargetMs);
+    }
     int metaData[3] = {0};
     int ret = decoderController->getMusicMeta(accompanyPath, metaData);
     if (ret != 0) {
@@ -524,12 +533,9 @@ int64_t SoundService::getAudioClockMs() {
         return base;   // 0 at start, or seek_time after seek
     }
 
+    // read for every video frame (late-frame culling): no logging here
     int64_t playedMs = frames * 1000LL / sr;
-    int64_t result   = base + playedMs;
-
-    LOGI("getAudioClockMs frames=%lld sr=%d base=%lld result:%lld",
-         (long long)frames, sr, (long long)base, (long long)result);
-    return result;
+    return base + playedMs;
 }
 
 void SoundService::setStartPtsMs(int64_t startPtsMs) {
@@ -547,6 +553,15 @@ void SoundService::onBufferConsumed(int bufferFrames) {
          bufferFrames, (long long)playedFrames);
 }
 
+void SoundService::setLiveMode(bool live, int64_t targetMs) {
+    liveMode = live;
+    if (targetMs > 0) liveTargetMs = targetMs;
+}
+
+int64_t SoundService::getLiveLatencyMs() {
+    return liveMode && decoderController ? decoderController->getLiveLatencyMs() : -1;
+}
+
 bool SoundService::isPlaying() {
     return playingState != PLAYING_STATE_STOPPED;
 }
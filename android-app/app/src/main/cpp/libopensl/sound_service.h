@@ -33,7 +33,8 @@ private:
     // play index: which buffer OpenSL has just consumed
     int      mPlayFrameIndex = 0;
 
-    // Per-buffer PCM frame count (for each queued buffer)
+    // Per-buffer frame count in media time (for each queued buffer); more
+    // than was played while live catch-up time-compresses the audio
     int      mFramesPerBuffer[QUEUE_BUFFER_COUNT] = {0};
 
     // Per-packet PCM sample count (SHORTS, not bytes)
@@ -56,6 +57,10 @@ private:
 
     bool initedSoundTrack = false;
 
+    // applied by the next initSongDecoder()
+    bool    liveMode     = false;
+    int64_t liveTargetMs = LiveCatchUp::DEFAULT_TARGET_MS;
+
     // ---- audio clock based on CONSUMED frames ----
     // frames actually played by the device
     int64_t playedFrames   = 0;
@@ -184,6 +189,12 @@ public:
 
     void setVisualizerEnabled(bool enabled);
 
+    // live stream for the next initSongDecoder(): low-latency open, audio
+    // time-compressed while more than targetMs is buffered
+    void setLiveMode(bool live, int64_t targetMs);
+    // buffered live content in ms, -1 when not live or unknown
+    int64_t getLiveLatencyMs();
+
     void callReady();
     void callComplete();
 };
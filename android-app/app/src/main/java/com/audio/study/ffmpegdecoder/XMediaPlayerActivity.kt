@@ -41,6 +41,9 @@ class XMediaPlayerActivity : AppCompatActivity() {
         binding = ActivityXmediaPlayerBinding.inflate(layoutInflater)
         setContentView(binding.root)
 
+        FfmpegVideoEngine.setIndexCacheDir(File(cacheDir, "keyframe_index"))
+        FfmpegVideoEngine.setNetworkCache(File(cacheDir, "media_cache"))
+
         val renderer = SoftwareCanvasRenderer(binding.surfaceView)
         val audioEngine: AudioEngine = OpenSlAudioEngine()
 //        val videoEngine: VideoEngine = FfmpegVideoEngine()
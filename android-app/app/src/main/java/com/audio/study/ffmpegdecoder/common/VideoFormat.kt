@@ -0,0 +1,28 @@
+package com.audio.study.ffmpegdecoder.common
+
+/**
+ * @author xinggen.guo
+ * @date 2026/10/17 10:12
+ * Output pixel formats for the FFmpeg software read path.
+ * Keep in sync with cpp/common/VideoFormat.h.
+ */
+object VideoFormat {
+
+    /** Packed RGBA8888, 4 bytes per pixel (default) */
+    const val RGBA = 0
+
+    /** Planar Y, U, V (4:2:0), 1.5 bytes per pixel; plane copy when source is yuv420p */
+    const val I420 = 1
+
+    /** Planar Y + interleaved UV (4:2:0), 1.5 bytes per pixel */
+    const val NV12 = 2
+
+    /** Packed RGB565 (little-endian, matches Bitmap.Config.RGB_565), 2 bytes per pixel */
+    const val RGB565 = 3
+
+    /** Number of plane strides reported by the native read call */
+    const val MAX_PLANES = 3
+
+    /** Output rotation that follows the stream's display matrix */
+    const val ROTATION_AUTO = -1
+}
@@ -6,11 +6,14 @@ import android.view.Surface
 import com.audio.study.ffmpegdecoder.common.MediaStatus
 import com.audio.study.ffmpegdecoder.player.data.SyncDecision
 import com.audio.study.ffmpegdecoder.player.engine.AvSyncController
+import com.audio.study.ffmpegdecoder.player.engine.FfmpegVideoEngine
+import com.audio.study.ffmpegdecoder.player.engine.OpenSlAudioEngine
 import com.audio.study.ffmpegdecoder.player.enum.DecodeType
 import com.audio.study.ffmpegdecoder.player.interfaces.AudioEngine
 import com.audio.study.ffmpegdecoder.player.interfaces.VideoEngine
 import com.audio.study.ffmpegdecoder.player.interfaces.VideoRenderer
 import com.audio.study.ffmpegdecoder.player.interfaces.XMediaPlayerListener
+import com.audio.study.ffmpegdecoder.player.render.SoftwareCanvasRenderer
 import com.audio.study.ffmpegdecoder.utils.LogUtil
 import java.nio.ByteBuffer
 
@@ -31,6 +34,8 @@ class XMediaPlayer(
     companion object {
         private const val TAG = "XMediaPlayer"
         private const val PROGRESS_INTERVAL_MS = 200L
+        // a single step waits this long for its GOP before retrying
+        private const val STEP_TIMEOUT_MS = 500L
     }
 
     private val syncController = AvSyncController()
@@ -46,6 +51,9 @@ class XMediaPlayer(
     @Volatile private var reachedEof = false
     @Volatile private var seekTargetMs: Long = -1L
 
+    // gapless playlist: played right after the current item, see setNextDataSource
+    @Volatile private var nextPath: String? = null
+
     @Volatile private var lastPositionMs: Long = 0L
     @Volatile private var lastProgressCallbackTime = 0L
 
@@ -57,10 +65,17 @@ class XMediaPlayer(
     @Volatile private var previewRequested = false     // render thread should process new preview
     @Volatile private var wasPlayingBeforePreview = false
 
+    // ---------- frame stepping / reverse playback (FFmpeg video engine) ----------
+    @Volatile private var stepRequest = 0              // direction for the render thread, 0 = none
+    @Volatile private var reverseMode = false
+    @Volatile private var steppedPositionMs = -1L      // frame shown by stepping, resume() continues there
+    private var reverseAnchorPtsMs = -1L               // render thread: pacing of reverse playback
+    private var reverseAnchorNs = 0L
+
     // ---------- cached video info / buffer ----------
-    private var videoWidth: Int = 0
-    private var videoHeight: Int = 0
-    private var frameBuffer: ByteBuffer? = null
+    @Volatile private var videoWidth: Int = 0
+    @Volatile private var videoHeight: Int = 0
+    @Volatile private var frameBuffer: ByteBuffer? = null
     private val ptsOut = LongArray(1)
 
     /** Set or update output surface (SurfaceView / TextureView / SurfaceTexture). */
@@ -81,8 +96,18 @@ class XMediaPlayer(
      * This is a synchronous prepare; call it off the main thread if file is large.
      */
     fun prepare(path: String): Boolean {
+        setEnginesLive(false, FfmpegVideoEngine.DEFAULT_LIVE_TARGET_MS)
+        return prepareSource(path)
+    }
+
+    private fun prepareSource(path: String): Boolean {
         LogUtil.i(TAG, "prepare path=$path")
 
+        // the canvas renderer copies the engine's bytes as they are
+        if (videoEngine is FfmpegVideoEngine && videoRenderer is SoftwareCanvasRenderer) {
+            videoEngine.outputFormat = videoRenderer.pixelFormat
+        }
+
         val aOk = audioEngine.prepare(path)
         val vOk = videoEngine.prepare(path)
 
@@ -111,6 +136,7 @@ class XMediaPlayer(
         prepared = true
         reachedEof = false
         syncController.reset()
+        setNativeFrameCulling(true)
 
         val duration = audioEngine.getDurationMs()
         mainHandler.post {
@@ -121,13 +147,62 @@ class XMediaPlayer(
     }
 
 
+    /**
+     * Queue [path] to play as soon as the current item ends, without a gap:
+     * the FFmpeg video engine opens and starts decoding it in the background
+     * now, and reuses the current decoder when codec and size match. Null
+     * clears it. Not for live streams.
+     */
+    fun setNextDataSource(path: String?) {
+        LogUtil.i(TAG, "setNextDataSource $path")
+        nextPath = path
+        val engine = videoEngine as? FfmpegVideoEngine ?: return
+        if (path != null) engine.preload(path) else engine.cancelPreload()
+    }
+
+    // render thread, at EOF of the current item
+    private fun advanceToNext(path: String): Boolean {
+        LogUtil.i(TAG, "advance to $path")
+        nextPath = null
+        if (!prepareSource(path)) return false
+        audioEngine.play()
+        videoEngine.start()
+        return true
+    }
+
     /**
      * Convenience: prepare a live TCP FLV stream.
      * Example URL: tcp://192.168.0.10:9000
      */
     fun prepareLiveTcp(host: String, port: Int): Boolean {
         val url = "tcp://$host:$port"
-        return prepare(url)
+        return prepareLive(url)
+    }
+
+    /**
+     * Prepare a live stream, e.g. the stream-server's http://host:8080/live.flv.
+     * Opens with minimal probing and buffering; whenever more than
+     * [latencyTargetMs] is buffered the engines catch up (faster audio,
+     * skipped non-reference frames). Engines without live support play it
+     * like a file.
+     */
+    fun prepareLive(url: String, latencyTargetMs: Long = FfmpegVideoEngine.DEFAULT_LIVE_TARGET_MS): Boolean {
+        setEnginesLive(true, latencyTargetMs)
+        return prepareSource(url)
+    }
+
+    private fun setEnginesLive(live: Boolean, targetMs: Long) {
+        (audioEngine as? OpenSlAudioEngine)?.setLiveMode(live, targetMs)
+        (videoEngine as? FfmpegVideoEngine)?.setLiveMode(live, targetMs)
+    }
+
+    /**
+     * Live content buffered ahead of playback in ms (newest received - shown),
+     * -1 when not playing a live stream.
+     */
+    fun getLiveLatencyMs(): Long {
+        (audioEngine as? OpenSlAudioEngine)?.getLiveLatencyMs()?.takeIf { it >= 0 }?.let { return it }
+        return (videoEngine as? FfmpegVideoEngine)?.getLiveStats()?.bufferMs ?: -1L
     }
 
     /** Start playback from current position. */
@@ -147,6 +222,9 @@ class XMediaPlayer(
         previewMode = false
         previewRequested = false
         reachedEof = false
+        reverseMode = false
+        stepRequest = 0
+        steppedPositionMs = -1L
 
         audioEngine.play()
         videoEngine.start()
@@ -156,6 +234,7 @@ class XMediaPlayer(
 
     /** Pause playback, keeping position. */
     fun pause() {
+        reverseMode = false
         if (!playing) return
         LogUtil.i(TAG, "pause")
 
@@ -176,6 +255,15 @@ class XMediaPlayer(
         }
 
         LogUtil.i(TAG, "resume")
+        reverseMode = false
+        stepRequest = 0
+        val stepped = steppedPositionMs
+        if (stepped >= 0) {
+            // continue from the stepped frame; the video engine seeks there itself
+            steppedPositionMs = -1L
+            audioEngine.seekTo(stepped)
+            syncController.reset()
+        }
         playing = true
         previewMode = false
         previewRequested = false
@@ -197,6 +285,7 @@ class XMediaPlayer(
         seekTargetMs = target
         isSeeking = true
         reachedEof = false
+        steppedPositionMs = -1L
 
         // 1) Tell engines
         audioEngine.seekTo(target)
@@ -210,6 +299,41 @@ class XMediaPlayer(
         listener?.onProgress(target)
     }
 
+    // ---------- Frame stepping / reverse playback ----------
+
+    /**
+     * Show the previous ([direction] < 0) or next frame and stay paused. Both
+     * directions are cheap: the FFmpeg video engine serves frames from whole
+     * decoded GOPs instead of decoding from the keyframe for every step.
+     * [resume] continues from the frame shown.
+     */
+    fun stepFrame(direction: Int) {
+        if (!prepared || videoEngine !is FfmpegVideoEngine) return
+        if (playing) pause()
+        reverseMode = false
+        stepRequest = if (direction < 0) -1 else 1
+        running = true
+        startRenderThreadIfNeeded()
+    }
+
+    /**
+     * Play the video backwards from the current frame, without sound, until
+     * [pause], [resume] or the first frame.
+     */
+    fun playReverse() {
+        if (!prepared || videoEngine !is FfmpegVideoEngine) return
+        if (playing) pause()
+        LogUtil.i(TAG, "playReverse")
+        previewMode = false
+        stepRequest = 0
+        reverseAnchorPtsMs = -1L
+        reverseMode = true
+        running = true
+        startRenderThreadIfNeeded()
+    }
+
+    fun isPlayingReverse(): Boolean = reverseMode
+
     // ---------- Preview API (for seek bar / gesture) ----------
 
     /** Called when user starts dragging the seek bar / timeline. */
@@ -231,6 +355,9 @@ class XMediaPlayer(
         // but keep video engine alive (do NOT call videoEngine.pause()).
         playing = false
 
+        // audio clock is frozen while scrubbing, preview frames must not be culled
+        setNativeFrameCulling(false)
+
         // Enter preview mode: renderLoop will go into handlePreviewInRenderLoop()
         previewMode = true
         previewRequested = false
@@ -270,6 +397,7 @@ class XMediaPlayer(
         // Leave preview mode
         previewMode = false
         previewRequested = false
+        setNativeFrameCulling(true)
 
         // Perform real A/V seek (this updates audio + video decoders)
         val reachedStatus = reachedEof
@@ -315,6 +443,8 @@ class XMediaPlayer(
         playing = false
         previewMode = false
         previewRequested = false
+        reverseMode = false
+        stepRequest = 0
 
         renderThread?.let { t ->
             try {
@@ -327,8 +457,9 @@ class XMediaPlayer(
         audioEngine.release()
     }
 
-    /** Current position in ms, using audio clock. */
-    fun getCurrentPositionMs(): Long = audioEngine.getAudioClockMs()
+    /** Current position in ms: the stepped frame, otherwise the audio clock. */
+    fun getCurrentPositionMs(): Long =
+        steppedPositionMs.takeIf { it >= 0 } ?: audioEngine.getAudioClockMs()
 
     /** Media duration in ms (from audio engine). */
     fun getDurationMs(): Long = audioEngine.getDurationMs()
@@ -350,14 +481,14 @@ class XMediaPlayer(
     private fun renderLoop() {
         LogUtil.i(TAG, "renderLoop start")
 
-        val w = videoWidth
-        val h = videoHeight
+        var w = videoWidth
+        var h = videoHeight
         if (w <= 0 || h <= 0) {
             LogUtil.e(TAG, "renderLoop: invalid video size ${w}x$h")
             return
         }
 
-        val buffer = frameBuffer
+        var buffer = frameBuffer
         if (videoEngine.decodeType == DecodeType.FFMPEG && buffer == null) {
             LogUtil.e(TAG, "renderLoop: frameBuffer is null for FFmpeg decode")
             return
@@ -371,6 +502,12 @@ class XMediaPlayer(
                 continue
             }
 
+            // ---------- Frame stepping / reverse: video only ----------
+            if (!playing && (reverseMode || stepRequest != 0)) {
+                handleStepInRenderLoop(buffer, w, h)
+                continue
+            }
+
             // ---------- Not playing & not previewing: idle ----------
             if (!playing) {
                 Thread.sleep(10)
@@ -382,6 +519,7 @@ class XMediaPlayer(
             ptsOut[0] = 0L
 
             val audioClock = audioEngine.getAudioClockMs().takeIf { it > 0 }
+            (videoEngine as? FfmpegVideoEngine)?.updateMasterClock(audioClock ?: -1L)
             val status = videoEngine.readFrameInto(buffer, ptsOut)
             val framePtsMs = ptsOut[0]
 
@@ -390,6 +528,15 @@ class XMediaPlayer(
                     MediaStatus.EOF -> {
                         LogUtil.i(TAG, "EOF reached in renderLoop")
 
+                        val next = nextPath
+                        if (next != null && advanceToNext(next)) {
+                            // sizes may differ between items
+                            w = videoWidth
+                            h = videoHeight
+                            buffer = frameBuffer
+                            continue
+                        }
+
                         // Mark as not playing, but keep last frame on screen
                         reachedEof = true
                         playing = false
@@ -495,6 +642,78 @@ class XMediaPlayer(
         // No progress callback here; UI progress is driven by updateSeekPreview().
     }
 
+    /**
+     * One step (or one frame of reverse playback) on the render thread.
+     * Reverse playback is paced by the pts distance between frames and never
+     * blocks on a GOP that is still decoding; a single step waits for it.
+     */
+    private fun handleStepInRenderLoop(buffer: ByteBuffer?, w: Int, h: Int) {
+        val engine = videoEngine as? FfmpegVideoEngine
+        if (engine == null || buffer == null) {
+            reverseMode = false
+            stepRequest = 0
+            return
+        }
+        val reverse = reverseMode
+        val direction = if (reverse) -1 else stepRequest
+
+        buffer.clear()
+        ptsOut[0] = 0L
+        val status = engine.stepFrame(direction, buffer, ptsOut, if (reverse) 0L else STEP_TIMEOUT_MS)
+        when (status) {
+            MediaStatus.OK -> {
+                val ptsMs = ptsOut[0]
+                if (reverse) waitForReverseFrame(ptsMs)
+                videoRenderer.renderFrame(buffer, w, h)
+                steppedPositionMs = ptsMs
+                lastPositionMs = ptsMs
+                if (!reverse) stepRequest = 0
+                val now = System.currentTimeMillis()
+                if (!reverse || now - lastProgressCallbackTime >= PROGRESS_INTERVAL_MS) {
+                    lastProgressCallbackTime = now
+                    mainHandler.post { listener?.onProgress(ptsMs) }
+                }
+            }
+            MediaStatus.BUFFERING -> {
+                // the GOP is still decoding: restart the pacing once it is there
+                reverseAnchorPtsMs = -1L
+                if (reverse) Thread.sleep(5)
+            }
+            else -> {
+                LogUtil.i(TAG, "handleStepInRenderLoop: direction=$direction status=$status, stop")
+                reverseMode = false
+                stepRequest = 0
+            }
+        }
+    }
+
+    // sleep until the frame at ptsMs is due, counting backwards from the first one
+    private fun waitForReverseFrame(ptsMs: Long) {
+        val now = System.nanoTime()
+        if (reverseAnchorPtsMs < 0) {
+            reverseAnchorPtsMs = ptsMs
+            reverseAnchorNs = now
+            return
+        }
+        val dueMs = (reverseAnchorPtsMs - ptsMs) - (now - reverseAnchorNs) / 1_000_000L
+        if (dueMs > 0) Thread.sleep(dueMs)
+    }
+
+    /**
+     * Let the FFmpeg engine drop late frames before conversion, using the same
+     * threshold as [syncController]. OpenSL's clock is read natively, any other
+     * audio engine's clock is pushed from the render loop.
+     */
+    private fun setNativeFrameCulling(enable: Boolean) {
+        val engine = videoEngine as? FfmpegVideoEngine ?: return
+        val source = when {
+            !enable -> FfmpegVideoEngine.CLOCK_NONE
+            audioEngine is OpenSlAudioEngine -> FfmpegVideoEngine.CLOCK_OPENSL
+            else -> FfmpegVideoEngine.CLOCK_EXTERNAL
+        }
+        engine.setMasterClock(source, syncController.maxLateMs)
+    }
+
     // ------------------------------------------------------------------------
     // Callback helpers
     // ------------------------------------------------------------------------
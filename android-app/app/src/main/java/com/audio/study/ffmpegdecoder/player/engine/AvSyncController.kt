@@ -21,7 +21,7 @@ class AvSyncController(
      * How much video is allowed to be late (behind audio) before we drop the frame.
      * e.g. 80ms means: if videoPts < audioClock - 80 => drop frame.
      */
-    private val maxLateMs: Long = 80L,
+    val maxLateMs: Long = 80L,
 
     /**
      * How much video is allowed to be early (ahead of audio) before we sleep.
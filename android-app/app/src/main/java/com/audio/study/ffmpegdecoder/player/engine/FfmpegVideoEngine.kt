@@ -1,10 +1,13 @@
 package com.audio.study.ffmpegdecoder.player.engine
 
+import android.graphics.Rect
 import android.view.Surface
 import com.audio.study.ffmpegdecoder.common.MediaStatus
+import com.audio.study.ffmpegdecoder.common.VideoFormat
 import com.audio.study.ffmpegdecoder.player.enum.DecodeType
 import com.audio.study.ffmpegdecoder.player.interfaces.VideoEngine
 import com.audio.study.ffmpegdecoder.utils.LogUtil
+import java.io.File
 import java.nio.ByteBuffer
 
 /**
@@ -30,6 +33,116 @@ class FfmpegVideoEngine : VideoEngine {
                 LogUtil.e(TAG, "Failed to load native library: ${e.message}")
             }
         }
+
+        /**
+         * Directory for keyframe index and probe cache sidecars (small files
+         * per played local media file). Later opens skip stream probing and
+         * seek straight to keyframe offsets. Shared by the FFmpeg audio and
+         * video decoders.
+         */
+        fun setIndexCacheDir(dir: File) {
+            if (!dir.exists() && !dir.mkdirs()) {
+                LogUtil.e(TAG, "setIndexCacheDir: cannot create ${dir.absolutePath}")
+                return
+            }
+            nativeSetIndexCacheDir(dir.absolutePath)
+        }
+
+        @JvmStatic
+        private external fun nativeSetIndexCacheDir(dir: String)
+
+        /**
+         * Persistent disk cache for http(s) media, off until this is called.
+         * Fetched byte ranges are kept in [dir], so replays and seeks into
+         * already played parts do not hit the network again; the least
+         * recently played entries are evicted beyond [maxBytes]. Only servers
+         * that report a length and accept range requests are cached.
+         */
+        fun setNetworkCache(dir: File, maxBytes: Long = DEFAULT_NETWORK_CACHE_BYTES) {
+            if (!dir.exists() && !dir.mkdirs()) {
+                LogUtil.e(TAG, "setNetworkCache: cannot create ${dir.absolutePath}")
+                return
+            }
+            nativeSetNetworkCache(dir.absolutePath, maxBytes)
+        }
+
+        /** Stop caching http(s) media; entries already on disk are kept. */
+        fun disableNetworkCache() = nativeSetNetworkCache("", 0)
+
+        /** Delete every cache entry that is not being played. */
+        fun clearNetworkCache() = nativeClearNetworkCache()
+
+        /** Null when the library is not loaded. */
+        fun getNetworkCacheStats(): NetworkCacheStats? {
+            val out = LongArray(3)
+            if (!nativeGetNetworkCacheStats(out)) return null
+            return NetworkCacheStats(out[0], out[1].toInt(), out[2])
+        }
+
+        @JvmStatic
+        private external fun nativeSetNetworkCache(dir: String, maxBytes: Long)
+
+        @JvmStatic
+        private external fun nativeClearNetworkCache()
+
+        @JvmStatic
+        private external fun nativeGetNetworkCacheStats(out: LongArray): Boolean
+
+        /**
+         * Free the decoders kept warm after [release]. They make the next
+         * [prepare] of a file with the same codec and size cheaper; trim them
+         * when no more video is coming (or on memory pressure).
+         */
+        fun trimDecoderPool() = nativeTrimDecoderPool()
+
+        /** Null when the library is not loaded. */
+        fun getDecoderPoolStats(): DecoderPoolStats? {
+            val out = LongArray(4)
+            if (!nativeGetDecoderPoolStats(out)) return null
+            return DecoderPoolStats(out[0].toInt(), out[1], out[2], out[3])
+        }
+
+        @JvmStatic
+        private external fun nativeTrimDecoderPool()
+
+        @JvmStatic
+        private external fun nativeGetDecoderPoolStats(out: LongArray): Boolean
+
+        /** Adaptive quality levels, keep in sync with VideoQosLevel in video_qos_controller.h */
+        const val QOS_FULL = 0
+        const val QOS_SKIP_LOOP_FILTER = 1
+        const val QOS_SKIP_NONREF = 2
+        const val QOS_FAST_SCALE = 3
+
+        /** How [prepare] reads the file, see [setIoMode]. Keep in sync with MediaIoMode. */
+        const val IO_DEFAULT = 0
+        /** Memory-mapped, the kernel prefetches ahead of the demuxer */
+        const val IO_MMAP = 1
+        /** Large pread() blocks, for slow storage (SD card, FUSE) */
+        const val IO_READ_AHEAD = 3
+        /** http(s) through the network cache, chosen automatically, see [setNetworkCache] */
+        const val IO_CACHE = 4
+
+        /** Size cap of the network cache. Keep in sync with MediaCache::DEFAULT_MAX_BYTES. */
+        const val DEFAULT_NETWORK_CACHE_BYTES = 256L * 1024 * 1024
+
+        /** Codec threading, see [setThreadPolicy]. Keep in sync with VideoThreadPolicy. */
+        const val THREADS_AUTO = 0
+        /** Several frames decoded at once: best fps, one frame of delay per thread */
+        const val THREADS_FRAME = 1
+        /** One frame split over its slices: no added delay, needs multi-slice streams */
+        const val THREADS_SLICE = 2
+        const val THREADS_SINGLE = 3
+
+        /** Default live latency target, see [setLiveMode]. Keep in sync with LiveCatchUp. */
+        const val DEFAULT_LIVE_TARGET_MS = 1500L
+
+        /** Master clock sources for late-frame culling, see [setMasterClock] */
+        const val CLOCK_NONE = 0
+        /** OpenSlAudioEngine: the native side reads SoundService's audio clock itself */
+        const val CLOCK_OPENSL = 1
+        /** Any other audio engine: push the clock with [updateMasterClock] */
+        const val CLOCK_EXTERNAL = 2
     }
 
     override val decodeType: DecodeType = DecodeType.FFMPEG
@@ -37,9 +150,269 @@ class FfmpegVideoEngine : VideoEngine {
     private var videoWidth: Int = 0
     private var videoHeight: Int = 0
 
+    /**
+     * Output layout written by [readFrameInto], one of VideoFormat.*.
+     * RGB565 / I420 / NV12 move half (or less) of the bytes of RGBA.
+     */
+    var outputFormat: Int = VideoFormat.RGBA
+
+    /** Per-plane line sizes of the last frame read (I420: Y, U, V; NV12: Y, UV). */
+    val planeStrides = IntArray(VideoFormat.MAX_PLANES)
+
+    // output transform, applied on prepare() when set before it
+    private var targetWidth = 0
+    private var targetHeight = 0
+    private var rotation = VideoFormat.ROTATION_AUTO
+    private var crop: Rect? = null
+    private var keepAspect = true
+    private var prepared = false
+
+    /**
+     * Accurate seek: decode and drop frames up to the exact target instead of
+     * showing the previous keyframe. Slower per seek, so leave it off while scrubbing.
+     */
+    var accurateSeek: Boolean = false
+        set(value) {
+            field = value
+            if (prepared) nativeSetAccurateSeek(value)
+        }
+
+    /**
+     * Step decode quality down (no deblocking → no B-frames → fast scaling)
+     * while the decoder cannot keep the queue filled, and back up once it can.
+     * [maxQosLevel] caps how far it may go.
+     */
+    var adaptiveQuality: Boolean = true
+        set(value) {
+            field = value
+            if (prepared) nativeSetAdaptiveQuality(value, maxQosLevel)
+        }
+
+    var maxQosLevel: Int = QOS_FAST_SCALE
+        set(value) {
+            field = value
+            if (prepared) nativeSetAdaptiveQuality(adaptiveQuality, value)
+        }
+
+    private var frameQueueBytes = 0L
+    private var frameQueueMs = 0L
+
+    private var packetBufferBytes = 0L
+    private var packetBufferMs = 0L
+
+    private var gopCacheBytes = 0L
+
+    private var ioMode = IO_DEFAULT
+    private var ioBlockSize = 0
+
+    /**
+     * Optimise time-to-first-frame for the next [prepare]: probe less of the
+     * file, and decode + convert the first frame in [prepare] (with the output
+     * transform and [outputFormat] set by then) so [start] can show it at once.
+     */
+    var fastStart: Boolean = false
+
+    private var liveMode = false
+    private var liveTargetMs = DEFAULT_LIVE_TARGET_MS
+
+    private var threadPolicy = THREADS_AUTO
+    private var decodeThreads = 0
+
+    private var clockSource = CLOCK_NONE
+    private var lateThresholdMs = 0L
+
+    /** Current adaptive quality level and how often it changed. */
+    data class QosStats(
+        val level: Int,
+        val stepDowns: Long,
+        val stepUps: Long,
+        val underruns: Long,
+        val levelDurationUs: Long
+    )
+
+    /** Decoded frames queued ahead of the renderer, against their budget. */
+    data class FrameQueueStats(
+        val frames: Int,
+        val bytes: Long,
+        val bufferedMs: Long,
+        val maxBytes: Long,
+        val maxDurationMs: Long,
+        val poolCapacity: Int
+    )
+
+    /**
+     * Compressed packets the demux thread holds ahead of the decoders.
+     * *Waits count how often a decoder found its queue empty (I/O too slow).
+     * [ioInterrupts] are reads abandoned for a seek or release, [ioTimeouts]
+     * open / read / seek calls that gave up on a stalled source.
+     */
+    data class DemuxStats(
+        val videoPackets: Int,
+        val videoBytes: Long,
+        val videoBufferedMs: Long,
+        val videoWaits: Long,
+        val audioPackets: Int,
+        val audioBytes: Long,
+        val audioBufferedMs: Long,
+        val audioWaits: Long,
+        val queuedBytes: Long,
+        val packetsRead: Long,
+        val ioInterrupts: Long,
+        val ioTimeouts: Long
+    )
+
+    /**
+     * Custom I/O layer counters. [syscalls] are the read / pread / madvise
+     * calls behind [readCalls] AVIO refills; 0 for in-memory sources.
+     * IO_CACHE only: [cachedBytes] of the source are on disk (-1 otherwise),
+     * [cacheHitBytes] were read without waiting for the network and
+     * [downloadedBytes] were fetched by this player.
+     */
+    data class IoStats(
+        val mode: Int,
+        val size: Long,
+        val bytesRead: Long,
+        val readCalls: Long,
+        val syscalls: Long,
+        val seeks: Long,
+        val cachedBytes: Long,
+        val cacheHitBytes: Long,
+        val downloadedBytes: Long
+    )
+
+    /** Whole network cache, see [setNetworkCache]. */
+    data class NetworkCacheStats(
+        val usedBytes: Long,
+        val entries: Int,
+        val evictions: Long
+    )
+
+    /**
+     * Time-to-first-frame by stage, microseconds; 0 = not reached yet.
+     * [openUs] covers open + probe + codec open ([probeCached]: probe skipped),
+     * [firstConvertUs] includes building the scaler, [threadStartUs] runs from
+     * start() to the decode thread running. [codecReused]: the codec context
+     * came warm from the decoder pool; [prerolled]: opened and decoding in the
+     * background by [preload].
+     */
+    data class StartupStats(
+        val fastStart: Boolean,
+        val probeCached: Boolean,
+        val openUs: Long,
+        val firstDecodeUs: Long,
+        val firstConvertUs: Long,
+        val threadStartUs: Long,
+        val playToFirstFrameUs: Long,
+        val firstFrameUs: Long,
+        val codecReused: Boolean,
+        val prerolled: Boolean
+    )
+
+    /**
+     * Live playback state. [bufferMs] is the content between the newest packet
+     * received and the frame last handed out (-1 unknown); while it is over
+     * [targetMs] the decoder skips non-reference frames ([catchingUp]).
+     * [skips] count backlogs too large to catch up with, cut at a keyframe.
+     */
+    data class LiveStats(
+        val live: Boolean,
+        val catchingUp: Boolean,
+        val targetMs: Long,
+        val bufferMs: Long,
+        val catchUps: Long,
+        val catchUpMs: Long,
+        val skips: Long,
+        val skippedMs: Long
+    )
+
+    /**
+     * Codec threading in use: [policy] as resolved (never THREADS_AUTO),
+     * [activeType] the FF_THREAD_* kind the codec actually runs (1 frame,
+     * 2 slice, 0 none). Latency runs from sending a packet to receiving its
+     * frame; [maxFramesInFlight] is the deepest pipeline seen.
+     */
+    data class ThreadingStats(
+        val policy: Int,
+        val threadCount: Int,
+        val activeType: Int,
+        val frames: Long,
+        val avgLatencyUs: Long,
+        val maxLatencyUs: Long,
+        val maxFramesInFlight: Int
+    )
+
+    /**
+     * Decoders parked after [release] for reuse ([idle]); [warm] of the
+     * [obtained] ones kept their codec context, [evictions] were freed.
+     */
+    data class DecoderPoolStats(
+        val idle: Int,
+        val obtained: Long,
+        val warm: Long,
+        val evictions: Long
+    )
+
+    /**
+     * Frames decoded for [stepFrame]: [runs] are contiguous stretches of the
+     * stream (usually whole GOPs). [hits] steps were answered from memory,
+     * [misses] waited for a decode; [prefetched] of the [gopsDecoded] runs
+     * were decoded ahead of the steps.
+     */
+    data class GopCacheStats(
+        val runs: Int,
+        val frames: Int,
+        val bytes: Long,
+        val budgetBytes: Long,
+        val hits: Long,
+        val misses: Long,
+        val gopsDecoded: Long,
+        val prefetched: Long,
+        val evictions: Long,
+        val lastDecodeUs: Long
+    )
+
+    /** Result of the last completed seek. */
+    data class SeekStats(
+        val targetMs: Long,
+        val landedMs: Long,
+        val latencyUs: Long,
+        val discardedFrames: Int,
+        val seekCount: Int
+    )
+
+    /**
+     * Seek responsiveness while scrubbing: latencies run from seekTo() to the
+     * first frame of that seek handed to the renderer, over the last 128 seeks.
+     * [coalesced] seeks were replaced before decoding started, [aborted] counts
+     * decodes cut short by a newer seek.
+     */
+    data class SeekLatencyStats(
+        val requests: Long,
+        val coalesced: Long,
+        val aborted: Long,
+        val samples: Int,
+        val p50Us: Long,
+        val p90Us: Long,
+        val p99Us: Long,
+        val maxUs: Long,
+        val lastUs: Long
+    )
+
     // --------- JNI declarations (implement in C/C++) ---------
 
     private external fun nativePrepare(path: String): Boolean
+    private external fun nativePrepareMemory(data: ByteBuffer, size: Int): Boolean
+    private external fun nativePreload(path: String)
+    private external fun nativeCancelPreload()
+    private external fun nativeSetIoMode(mode: Int, blockSize: Int)
+    private external fun nativeGetIoStats(out: LongArray): Boolean
+    private external fun nativeSetFastStart(enable: Boolean)
+    private external fun nativePrimeFirstFrame(format: Int): Boolean
+    private external fun nativeGetStartupStats(out: LongArray): Boolean
+    private external fun nativeSetLiveMode(enable: Boolean, targetMs: Long)
+    private external fun nativeGetLiveStats(out: LongArray): Boolean
+    private external fun nativeSetThreadPolicy(policy: Int, threads: Int)
+    private external fun nativeGetThreadingStats(out: LongArray): Boolean
     private external fun nativeStart()
     private external fun nativePause()
     private external fun nativeResume()
@@ -58,18 +431,141 @@ class FfmpegVideoEngine : VideoEngine {
      */
     private external fun nativeReadFrame(buffer: ByteBuffer?, ptsOut: LongArray): Int
 
+    /**
+     * Read one decoded frame in [format] (VideoFormat.*), planes packed back to back.
+     *
+     * @param stridesOut length >= VideoFormat.MAX_PLANES, per-plane line size
+     * @return MediaStatus.* code
+     */
+    private external fun nativeReadFrameFormat(
+        buffer: ByteBuffer?,
+        format: Int,
+        ptsOut: LongArray,
+        stridesOut: IntArray
+    ): Int
+
+    private external fun nativeGetFrameBufferSize(format: Int): Int
+
+    private external fun nativeStepFrame(
+        direction: Int,
+        buffer: ByteBuffer,
+        format: Int,
+        ptsOut: LongArray,
+        stridesOut: IntArray?,
+        timeoutMs: Long
+    ): Int
+    private external fun nativeSetGopCacheBudget(maxBytes: Long)
+    private external fun nativeGetGopCacheStats(out: LongArray): Boolean
+
+    private external fun nativeSetConvertThreads(count: Int)
+    private external fun nativeBenchmarkConvert(format: Int, iterations: Int, avgUsOut: LongArray): Int
+
+    private external fun nativeSetOutputTransform(
+        dstWidth: Int,
+        dstHeight: Int,
+        rotation: Int,
+        cropX: Int,
+        cropY: Int,
+        cropWidth: Int,
+        cropHeight: Int,
+        keepAspect: Boolean
+    )
+    private external fun nativeGetDisplayRotation(): Int
+
+    private external fun nativeSetAccurateSeek(enable: Boolean)
+    private external fun nativeGetSeekStats(out: LongArray): Boolean
+    private external fun nativeGetSeekLatencyStats(out: LongArray): Boolean
+
+    private external fun nativeSetMasterClock(source: Int, lateThresholdMs: Long)
+    private external fun nativeUpdateMasterClock(clockMs: Long)
+    private external fun nativeGetLateDropCount(): Long
+
+    private external fun nativeSetAdaptiveQuality(enable: Boolean, maxLevel: Int)
+    private external fun nativeGetQosStats(out: LongArray): Boolean
+
+    private external fun nativeSetFrameQueueBudget(maxBytes: Long, maxDurationMs: Long)
+    private external fun nativeGetFrameQueueStats(out: LongArray): Boolean
+
+    private external fun nativeSetPacketBufferLimits(maxBytes: Long, maxDurationMs: Long)
+    private external fun nativeGetDemuxStats(out: LongArray): Boolean
+
     // --------- VideoEngine interface implementation ---------
 
     override fun prepare(path: String): Boolean {
         LogUtil.i(TAG, "prepare: $path")
+        applyPrepareSettings()
         val ok = nativePrepare(path)
         if (!ok) {
             LogUtil.e(TAG, "nativePrepare failed")
             return false
         }
+        return onPrepared()
+    }
+
+    /**
+     * Open [path] in the background and start decoding it without playing,
+     * with the settings [prepare] would use. A later [prepare] of the same
+     * path (on this or another engine) takes it over with its first frames
+     * already queued: the next item of a playlist starts without a gap.
+     * Replaces an earlier preload; one with other settings is discarded. The
+     * path that is playing right now is not preloaded (it shares the demuxer).
+     */
+    fun preload(path: String) {
+        LogUtil.i(TAG, "preload: $path")
+        applyPrepareSettings()
+        nativePreload(path)
+    }
+
+    /** Drop the clip opened by [preload]. */
+    fun cancelPreload() = nativeCancelPreload()
+
+    private fun applyPrepareSettings() {
+        nativeSetIoMode(ioMode, ioBlockSize)
+        nativeSetFastStart(fastStart)
+        nativeSetLiveMode(liveMode, liveTargetMs)
+        nativeSetThreadPolicy(threadPolicy, decodeThreads)
+    }
+
+    /**
+     * Play media that is already in memory. The bytes are not duplicated on
+     * the native heap: packets are copied straight out of [data], which must
+     * be a direct buffer. Its bytes from position 0 up to limit are the
+     * file; it stays referenced until [release].
+     */
+    fun prepareFromMemory(data: ByteBuffer): Boolean {
+        if (!data.isDirect) {
+            LogUtil.e(TAG, "prepareFromMemory: buffer is not direct")
+            return false
+        }
+        LogUtil.i(TAG, "prepareFromMemory: ${data.limit()} bytes")
+        nativeSetFastStart(fastStart)
+        nativeSetThreadPolicy(threadPolicy, decodeThreads)
+        if (!nativePrepareMemory(data, data.limit())) {
+            LogUtil.e(TAG, "nativePrepareMemory failed")
+            return false
+        }
+        return onPrepared()
+    }
+
+    private fun onPrepared(): Boolean {
+        prepared = true
+        applyOutputTransform()
+        nativeSetAccurateSeek(accurateSeek)
+        nativeSetAdaptiveQuality(adaptiveQuality, maxQosLevel)
+        nativeSetMasterClock(clockSource, lateThresholdMs)
+        if (frameQueueBytes > 0 || frameQueueMs > 0) {
+            nativeSetFrameQueueBudget(frameQueueBytes, frameQueueMs)
+        }
+        if (packetBufferBytes > 0 || packetBufferMs > 0) {
+            nativeSetPacketBufferLimits(packetBufferBytes, packetBufferMs)
+        }
+        if (gopCacheBytes > 0) nativeSetGopCacheBudget(gopCacheBytes)
         videoWidth = nativeGetVideoWidth()
         videoHeight = nativeGetVideoHeight()
         LogUtil.i(TAG, "video size: ${videoWidth}x$videoHeight")
+        if (fastStart && !nativePrimeFirstFrame(outputFormat)) {
+            LogUtil.w(TAG, "fast start: first frame not primed")
+        }
         return true
     }
 
@@ -95,6 +591,7 @@ class FfmpegVideoEngine : VideoEngine {
 
     override fun release() {
         LogUtil.i(TAG, "release")
+        prepared = false
         nativeRelease()
     }
 
@@ -102,6 +599,256 @@ class FfmpegVideoEngine : VideoEngine {
         return videoWidth to videoHeight
     }
 
+    /**
+     * Number of threads used for colour conversion (1 = single sws_scale call).
+     * Call after [prepare]; takes effect on the next frame.
+     */
+    fun setConvertThreads(count: Int) {
+        LogUtil.i(TAG, "setConvertThreads: $count")
+        nativeSetConvertThreads(count)
+    }
+
+    /**
+     * Convert the next queued frame with 1..[maxThreads] threads.
+     * @return average microseconds per frame, index i = (i + 1) threads;
+     *         empty if no frame was queued yet
+     */
+    fun benchmarkConvert(maxThreads: Int = 8, iterations: Int = 20): LongArray {
+        val avgUs = LongArray(maxThreads)
+        val count = nativeBenchmarkConvert(outputFormat, iterations, avgUs)
+        if (count <= 0) return LongArray(0)
+        avgUs.forEachIndexed { i, us -> LogUtil.i(TAG, "benchmarkConvert threads=${i + 1} avg=${us}us") }
+        return avgUs.copyOf(count)
+    }
+
+    /**
+     * Crop / rotate / scale frames to the target surface during conversion, so
+     * only [targetWidth] x [targetHeight] pixels are ever produced (0 = native).
+     * [rotation] is 0/90/180/270 clockwise or VideoFormat.ROTATION_AUTO, [crop]
+     * is in decoded pixels. Set before [prepare] to size the first frame;
+     * afterwards re-read [getVideoSize] and [getFrameBufferSize].
+     */
+    fun setOutputTransform(
+        targetWidth: Int,
+        targetHeight: Int,
+        rotation: Int = VideoFormat.ROTATION_AUTO,
+        crop: Rect? = null,
+        keepAspect: Boolean = true
+    ) {
+        this.targetWidth = targetWidth
+        this.targetHeight = targetHeight
+        this.rotation = rotation
+        this.crop = crop
+        this.keepAspect = keepAspect
+        if (prepared) {
+            applyOutputTransform()
+            videoWidth = nativeGetVideoWidth()
+            videoHeight = nativeGetVideoHeight()
+            LogUtil.i(TAG, "output size: ${videoWidth}x$videoHeight")
+        }
+    }
+
+    /** Stats of the last completed seek, null before the first one. */
+    fun getSeekStats(): SeekStats? {
+        val out = LongArray(5)
+        if (!nativeGetSeekStats(out) || out[4] == 0L) return null
+        return SeekStats(out[0], out[1], out[2], out[3].toInt(), out[4].toInt())
+    }
+
+    /** Seek-to-first-frame percentiles, null before [prepare]. */
+    fun getSeekLatencyStats(): SeekLatencyStats? {
+        val out = LongArray(9)
+        if (!nativeGetSeekLatencyStats(out)) return null
+        return SeekLatencyStats(
+            out[0], out[1], out[2], out[3].toInt(),
+            out[4], out[5], out[6], out[7], out[8]
+        )
+    }
+
+    /**
+     * Drop frames more than [lateThresholdMs] behind the master clock natively,
+     * before they are converted and copied out. [source] is one of CLOCK_*;
+     * CLOCK_NONE turns culling off (e.g. while scrubbing with audio paused).
+     */
+    fun setMasterClock(source: Int, lateThresholdMs: Long = 80L) {
+        clockSource = source
+        this.lateThresholdMs = lateThresholdMs
+        if (prepared) nativeSetMasterClock(source, lateThresholdMs)
+    }
+
+    /** Latest audio clock for CLOCK_EXTERNAL, call before each [readFrameInto]. */
+    fun updateMasterClock(clockMs: Long) {
+        if (clockSource == CLOCK_EXTERNAL && prepared) nativeUpdateMasterClock(clockMs)
+    }
+
+    /** Frames dropped natively for being late since [prepare]. */
+    fun getLateDropCount(): Long = nativeGetLateDropCount()
+
+    /** Adaptive quality state, null before [prepare]. */
+    fun getQosStats(): QosStats? {
+        val out = LongArray(5)
+        if (!nativeGetQosStats(out)) return null
+        return QosStats(out[0].toInt(), out[1], out[2], out[3], out[4])
+    }
+
+    /**
+     * Bound the decoded frame queue by memory and by content duration: decoding
+     * pauses at [maxBytes] of frames or [maxDurationMs] of pts span, whichever
+     * comes first. <= 0 keeps the native default (64 MB / 1 s).
+     */
+    fun setFrameQueueBudget(maxBytes: Long, maxDurationMs: Long) {
+        frameQueueBytes = maxBytes
+        frameQueueMs = maxDurationMs
+        if (prepared) nativeSetFrameQueueBudget(maxBytes, maxDurationMs)
+    }
+
+    /**
+     * Show the frame before ([direction] < 0) or after the current one, in
+     * [outputFormat], without decoding from the keyframe each time: whole GOPs
+     * are decoded into a cache by a second decoder, the previous GOP ahead of
+     * time when stepping backwards. Calling it repeatedly, paced by the pts
+     * differences, plays the video in reverse. Pauses forward decoding;
+     * [resume] continues from the stepped frame. Waits up to [timeoutMs] for a
+     * GOP that is not decoded yet. Not for live streams.
+     * @return MediaStatus.* code; EOF at the first / last frame
+     */
+    fun stepFrame(direction: Int, buffer: ByteBuffer, ptsOut: LongArray, timeoutMs: Long = 0L): Int {
+        if (ptsOut.isEmpty()) return MediaStatus.ERROR
+        return nativeStepFrame(direction, buffer, outputFormat, ptsOut, planeStrides, timeoutMs)
+    }
+
+    /** Decoded bytes [stepFrame] may keep, <= 0 keeps the native default (128 MB). */
+    fun setGopCacheBudget(maxBytes: Long) {
+        gopCacheBytes = maxBytes
+        if (prepared) nativeSetGopCacheBudget(maxBytes)
+    }
+
+    /** Null before [prepare]. */
+    fun getGopCacheStats(): GopCacheStats? {
+        val out = LongArray(10)
+        if (!nativeGetGopCacheStats(out)) return null
+        return GopCacheStats(
+            out[0].toInt(), out[1].toInt(), out[2], out[3], out[4],
+            out[5], out[6], out[7], out[8], out[9]
+        )
+    }
+
+    /** Frame queue fill, null before [prepare]. */
+    fun getFrameQueueStats(): FrameQueueStats? {
+        val out = LongArray(6)
+        if (!nativeGetFrameQueueStats(out)) return null
+        return FrameQueueStats(out[0].toInt(), out[1], out[2], out[3], out[4], out[5].toInt())
+    }
+
+    /**
+     * Bound the demux read-ahead: reading pauses once [maxBytes] are queued in
+     * total or every stream holds [maxDurationMs]. <= 0 keeps the native default.
+     */
+    fun setPacketBufferLimits(maxBytes: Long, maxDurationMs: Long) {
+        packetBufferBytes = maxBytes
+        packetBufferMs = maxDurationMs
+        if (prepared) nativeSetPacketBufferLimits(maxBytes, maxDurationMs)
+    }
+
+    /** Demux packet buffer state, null before [prepare]. */
+    fun getDemuxStats(): DemuxStats? {
+        val out = LongArray(12)
+        if (!nativeGetDemuxStats(out)) return null
+        return DemuxStats(
+            out[0].toInt(), out[1], out[2], out[3],
+            out[4].toInt(), out[5], out[6], out[7],
+            out[8], out[9], out[10], out[11]
+        )
+    }
+
+    /**
+     * How the next [prepare] reads the file: one of IO_*. [blockSize] is the
+     * mmap prefetch window or the read-ahead block, <= 0 keeps the native default.
+     * A file already opened by the audio decoder keeps its mode.
+     */
+    fun setIoMode(mode: Int, blockSize: Int = 0) {
+        ioMode = mode
+        ioBlockSize = blockSize
+    }
+
+    /**
+     * Open the next [prepare] path as a live stream (HTTP-FLV, RTMP...):
+     * minimal probing, no demuxer buffering, and catch-up when more than
+     * [targetMs] is buffered. The target can be changed while playing.
+     */
+    fun setLiveMode(enable: Boolean, targetMs: Long = DEFAULT_LIVE_TARGET_MS) {
+        liveMode = enable
+        liveTargetMs = targetMs
+        if (prepared) nativeSetLiveMode(enable, targetMs)
+    }
+
+    /**
+     * Codec threading for the next [prepare]: one of THREADS_*. [threads]
+     * <= 0 uses one per core (at most 8). THREADS_AUTO is frame threading
+     * for files and slice threading in live mode, where frame threads would
+     * add a frame of latency each.
+     */
+    fun setThreadPolicy(policy: Int, threads: Int = 0) {
+        threadPolicy = policy
+        decodeThreads = threads
+    }
+
+    /** Null before [prepare]. */
+    fun getThreadingStats(): ThreadingStats? {
+        val out = LongArray(7)
+        if (!nativeGetThreadingStats(out)) return null
+        return ThreadingStats(
+            out[0].toInt(), out[1].toInt(), out[2].toInt(), out[3],
+            out[4], out[5], out[6].toInt()
+        )
+    }
+
+    /** Null before [prepare]. */
+    fun getLiveStats(): LiveStats? {
+        val out = LongArray(8)
+        if (!nativeGetLiveStats(out)) return null
+        return LiveStats(
+            out[0] != 0L, out[1] != 0L, out[2], out[3],
+            out[4], out[5], out[6], out[7]
+        )
+    }
+
+    /** Null before [prepare]. */
+    fun getStartupStats(): StartupStats? {
+        val out = LongArray(10)
+        if (!nativeGetStartupStats(out)) return null
+        return StartupStats(
+            out[0] != 0L, out[1] != 0L, out[2], out[3],
+            out[4], out[5], out[6], out[7],
+            out[8] != 0L, out[9] != 0L
+        )
+    }
+
+    /** Null before [prepare] or with IO_DEFAULT (FFmpeg reads the file itself). */
+    fun getIoStats(): IoStats? {
+        val out = LongArray(9)
+        if (!nativeGetIoStats(out) || out[0] == IO_DEFAULT.toLong()) return null
+        return IoStats(
+            out[0].toInt(), out[1], out[2], out[3], out[4], out[5],
+            out[6], out[7], out[8]
+        )
+    }
+
+    /** Clockwise rotation stored in the stream's display matrix. */
+    fun getDisplayRotation(): Int = nativeGetDisplayRotation()
+
+    private fun applyOutputTransform() {
+        val c = crop
+        nativeSetOutputTransform(
+            targetWidth, targetHeight, rotation,
+            c?.left ?: 0, c?.top ?: 0, c?.width() ?: 0, c?.height() ?: 0,
+            keepAspect
+        )
+    }
+
+    /** Bytes needed in the ByteBuffer for one frame in [format]. */
+    fun getFrameBufferSize(format: Int = outputFormat): Int = nativeGetFrameBufferSize(format)
+
     override fun readFrameInto(buffer: ByteBuffer?, ptsOut: LongArray): Int {
         // For FFMPEG, we expect a non-null RGBA buffer
         if (buffer == null) {
@@ -113,7 +860,11 @@ class FfmpegVideoEngine : VideoEngine {
             return MediaStatus.ERROR
         }
 
-        val status = nativeReadFrame(buffer, ptsOut)
+        val status = if (outputFormat == VideoFormat.RGBA) {
+            nativeReadFrame(buffer, ptsOut)
+        } else {
+            nativeReadFrameFormat(buffer, outputFormat, ptsOut, planeStrides)
+        }
         // Optionally log:
          LogUtil.d(TAG, "readFrameInto -> status=$status pts=${ptsOut[0]}")
         return status
@@ -44,13 +44,32 @@ class OpenSlAudioEngine : AudioEngine {
     private external fun nativeGetDurationMs(): Long
     private external fun nativeGetAudioClockMs(): Long
 
+    private external fun nativeSetLiveMode(enable: Boolean, targetMs: Long)
+    private external fun nativeGetLiveLatencyMs(): Long
+
+    private var liveMode = false
+    private var liveTargetMs = FfmpegVideoEngine.DEFAULT_LIVE_TARGET_MS
+
     // --------- AudioEngine interface implementation ---------
 
     override fun prepare(path: String): Boolean {
         LogUtil.i(TAG, "prepare: $path")
+        nativeSetLiveMode(liveMode, liveTargetMs)
         return nativePrepare(path)
     }
 
+    /**
+     * Open the next [prepare] path as a live stream; while more than
+     * [targetMs] is buffered the audio plays slightly faster to catch up.
+     */
+    fun setLiveMode(enable: Boolean, targetMs: Long = FfmpegVideoEngine.DEFAULT_LIVE_TARGET_MS) {
+        liveMode = enable
+        liveTargetMs = targetMs
+    }
+
+    /** Live content buffered ahead of the audio being played, -1 when not live. */
+    fun getLiveLatencyMs(): Long = nativeGetLiveLatencyMs()
+
     override fun play() {
         LogUtil.i(TAG, "play")
         nativePlay()
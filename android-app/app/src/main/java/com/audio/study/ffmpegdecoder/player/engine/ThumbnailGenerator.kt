@@ -0,0 +1,141 @@
+package com.audio.study.ffmpegdecoder.player.engine
+
+import com.audio.study.ffmpegdecoder.common.VideoFormat
+import com.audio.study.ffmpegdecoder.utils.LogUtil
+import java.io.File
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * @author xinggen.guo
+ * @date 2026/10/17 16:40
+ * Scrubbing thumbnails as one packed sprite sheet.
+ *
+ * Native side decodes only keyframes (lowres where the codec supports it),
+ * one cell every [Options.intervalMs], on its own thread. Poll [copyAtlas]
+ * for partial results; finished atlases are cached in [Options.cacheDir].
+ */
+class ThumbnailGenerator {
+
+    companion object {
+        private const val TAG = "ThumbnailGenerator"
+
+        init {
+            try {
+                System.loadLibrary("ffmpegdecoder")
+            } catch (e: UnsatisfiedLinkError) {
+                LogUtil.e(TAG, "Failed to load native library: ${e.message}")
+            }
+        }
+    }
+
+    data class Options(
+        val intervalMs: Long = 5000,
+        val cellWidth: Int = 160,
+        val columns: Int = 10,
+        val maxCount: Int = 200,
+        /** VideoFormat.RGBA or VideoFormat.RGB565 */
+        val format: Int = VideoFormat.RGBA,
+        /** decode at 1/2^lowres where supported, 0 = full size */
+        val lowres: Int = 1,
+        val cacheDir: File? = null
+    )
+
+    /** Atlas geometry: [count] cells of [cellWidth] x [cellHeight], [columns] per row. */
+    data class AtlasInfo(
+        val count: Int,
+        val columns: Int,
+        val rows: Int,
+        val cellWidth: Int,
+        val cellHeight: Int,
+        val format: Int,
+        val atlasBytes: Int
+    )
+
+    private var info: AtlasInfo? = null
+    private var atlas: ByteBuffer? = null
+
+    /** Per-cell pts in ms, -1 while the cell is not decoded yet. */
+    var ptsTable = LongArray(0)
+        private set
+
+    // --------- JNI declarations (implement in C/C++) ---------
+
+    private external fun nativeStart(
+        path: String,
+        intervalMs: Long,
+        cellWidth: Int,
+        columns: Int,
+        maxCount: Int,
+        format: Int,
+        lowres: Int,
+        cacheDir: String?
+    ): Boolean
+    private external fun nativeGetInfo(out: IntArray): Boolean
+    private external fun nativeCopyAtlas(buffer: ByteBuffer, ptsOut: LongArray): Int
+    private external fun nativeIsDone(): Boolean
+    private external fun nativeRelease()
+
+    fun start(path: String, options: Options = Options()): AtlasInfo? {
+        LogUtil.i(TAG, "start: $path $options")
+        val dir = options.cacheDir
+        if (dir != null && !dir.exists() && !dir.mkdirs()) {
+            LogUtil.e(TAG, "start: cannot create ${dir.absolutePath}")
+        }
+        val ok = nativeStart(
+            path, options.intervalMs, options.cellWidth, options.columns,
+            options.maxCount, options.format, options.lowres,
+            dir?.takeIf { it.isDirectory }?.absolutePath
+        )
+        if (!ok) {
+            LogUtil.e(TAG, "nativeStart failed")
+            return null
+        }
+        val out = IntArray(7)
+        if (!nativeGetInfo(out)) return null
+        val atlasInfo = AtlasInfo(out[0], out[1], out[2], out[3], out[4], out[5], out[6])
+        info = atlasInfo
+        atlas = ByteBuffer.allocateDirect(atlasInfo.atlasBytes).order(ByteOrder.nativeOrder())
+        ptsTable = LongArray(atlasInfo.count) { -1L }
+        return atlasInfo
+    }
+
+    /**
+     * Refresh the sprite sheet and [ptsTable] with whatever cells are ready.
+     * The returned buffer is reused by the next call.
+     * @return the atlas, or null before [start]
+     */
+    fun copyAtlas(): ByteBuffer? {
+        val buffer = atlas ?: return null
+        buffer.clear()
+        val ready = nativeCopyAtlas(buffer, ptsTable)
+        if (ready < 0) {
+            LogUtil.e(TAG, "nativeCopyAtlas failed")
+            return null
+        }
+        return buffer
+    }
+
+    /** Index of the cell to show for [positionMs], -1 if none is ready. */
+    fun cellForPosition(positionMs: Long): Int {
+        var best = -1
+        for (i in ptsTable.indices) {
+            val pts = ptsTable[i]
+            if (pts < 0) continue
+            if (pts > positionMs && best >= 0) break
+            best = i
+        }
+        return best
+    }
+
+    fun isDone(): Boolean = nativeIsDone()
+
+    fun getInfo(): AtlasInfo? = info
+
+    fun release() {
+        LogUtil.i(TAG, "release")
+        nativeRelease()
+        info = null
+        atlas = null
+    }
+}
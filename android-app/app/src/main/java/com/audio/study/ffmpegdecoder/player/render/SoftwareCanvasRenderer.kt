@@ -6,6 +6,7 @@ import android.view.Surface
 import android.view.SurfaceHolder
 import android.view.SurfaceView
 import android.view.ViewGroup
+import com.audio.study.ffmpegdecoder.common.VideoFormat
 import com.audio.study.ffmpegdecoder.player.interfaces.VideoRenderer
 import com.audio.study.ffmpegdecoder.utils.LogUtil
 import java.nio.ByteBuffer
@@ -14,18 +15,30 @@ import java.nio.ByteBuffer
 /**
  * @author xinggen.guo
  * @date 2025/11/17 15:03
- * Software renderer that draws RGBA frames onto a SurfaceView using Canvas.
+ * Software renderer that draws RGBA (or RGB565) frames onto a SurfaceView using Canvas.
  *
  * NOTE:
  *  - XMediaPlayer will still call setSurface(), but we don't strictly need it here
  *    because we use surfaceView.holder directly.
  */
 class SoftwareCanvasRenderer(
-    private val surfaceView: SurfaceView
+    private val surfaceView: SurfaceView,
+    /**
+     * VideoFormat.RGBA or VideoFormat.RGB565; XMediaPlayer sets a
+     * FfmpegVideoEngine's outputFormat to it. Planar YUV can't be drawn here.
+     */
+    val pixelFormat: Int = VideoFormat.RGBA
 ) : VideoRenderer {
 
     companion object {
         private const val TAG = "SoftwareCanvasRenderer"
+
+        fun supportsFormat(format: Int): Boolean =
+            format == VideoFormat.RGBA || format == VideoFormat.RGB565
+    }
+
+    init {
+        require(supportsFormat(pixelFormat)) { "unsupported pixel format $pixelFormat" }
     }
 
     private var videoWidth: Int = 0
@@ -49,7 +62,7 @@ class SoftwareCanvasRenderer(
         // Recreate bitmap when size changes
         if (width > 0 && height > 0) {
             bitmap?.recycle()
-            bitmap = Bitmap.createBitmap(width, height, Bitmap.Config.ARGB_8888)
+            bitmap = Bitmap.createBitmap(width, height, bitmapConfig())
             srcRect.set(0, 0, width, height)
         }
 
@@ -68,13 +81,13 @@ class SoftwareCanvasRenderer(
         if (bmp.width != width || bmp.height != height) {
             // size changed unexpectedly, recreate
             bitmap?.recycle()
-            bitmap = Bitmap.createBitmap(width, height, Bitmap.Config.ARGB_8888)
+            bitmap = Bitmap.createBitmap(width, height, bitmapConfig())
         }
 
         val holder: SurfaceHolder = surfaceView.holder
         val canvas = holder.lockCanvas() ?: return
         try {
-            // Copy RGBA bytes into bitmap
+            // Copy RGBA / RGB565 bytes into bitmap
             buffer.position(0)
             bitmap!!.copyPixelsFromBuffer(buffer)
 
@@ -106,6 +119,9 @@ class SoftwareCanvasRenderer(
         }
     }
 
+    private fun bitmapConfig(): Bitmap.Config =
+        if (pixelFormat == VideoFormat.RGB565) Bitmap.Config.RGB_565 else Bitmap.Config.ARGB_8888
+
     override fun surfaceChanged(surface: Surface?, format: Int, width: Int, height: Int) {
 
     }
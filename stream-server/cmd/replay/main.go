@@ -0,0 +1,148 @@
+package main
+
+import (
+	"bufio"
+	"encoding/binary"
+	"errors"
+	"flag"
+	"fmt"
+	"io"
+	"log"
+	"net"
+	"os"
+	"time"
+)
+
+// replay pushes a recorded FLV file (e.g. a stream_*.flv written by the
+// server) into the TCP ingest at its original pace, so /live.flv behaves like
+// a real live session. Used to test the player's live mode locally:
+//
+//	go run ./cmd/server &
+//	go run ./cmd/replay -file stream_127.0.0.1_50000.flv -loop
+//
+// With -loop the timestamps keep increasing across iterations; -jitter holds
+// back a burst every few seconds to simulate a congested uplink.
+func main() {
+	file := flag.String("file", "", "FLV file to replay")
+	addr := flag.String("addr", "127.0.0.1:9000", "TCP ingest address")
+	loop := flag.Bool("loop", false, "restart at the end of the file")
+	speed := flag.Float64("speed", 1.0, "playback rate, >1 sends faster than real time")
+	jitter := flag.Duration("jitter", 0, "stall this long every 5 s of media, then send the backlog at once")
+	flag.Parse()
+
+	if *file == "" || *speed <= 0 {
+		flag.Usage()
+		os.Exit(2)
+	}
+
+	conn, err := net.Dial("tcp", *addr)
+	if err != nil {
+		log.Fatalf("connect %s: %v", *addr, err)
+	}
+	defer conn.Close()
+	log.Printf("replaying %s to %s", *file, *addr)
+
+	r := &replayer{out: conn, speed: *speed, jitter: *jitter}
+	for first := true; first || *loop; first = false {
+		if err := r.play(*file, first); err != nil {
+			log.Fatalf("replay: %v", err)
+		}
+		log.Printf("end of file, %d tags sent", r.tags)
+	}
+}
+
+type replayer struct {
+	out    io.Writer
+	speed  float64
+	jitter time.Duration
+
+	start    time.Time // wall clock of media time 0
+	offsetMs uint32    // added to the file's timestamps (looping)
+	lastMs   uint32    // newest timestamp sent
+	stallAt  uint32    // next jitter stall, media ms
+	tags     int
+}
+
+func (r *replayer) play(path string, sendHeader bool) error {
+	f, err := os.Open(path)
+	if err != nil {
+		return err
+	}
+	defer f.Close()
+	in := bufio.NewReaderSize(f, 64*1024)
+
+	header := make([]byte, 9)
+	if _, err := io.ReadFull(in, header); err != nil {
+		return err
+	}
+	if string(header[:3]) != "FLV" {
+		return fmt.Errorf("%s: not an FLV file", path)
+	}
+	headerSize := int(binary.BigEndian.Uint32(header[5:9]))
+	rest := make([]byte, headerSize-9+4) // rest of the header + PreviousTagSize0
+	if _, err := io.ReadFull(in, rest); err != nil {
+		return err
+	}
+	if sendHeader {
+		r.start = time.Now()
+		r.stallAt = 5000
+		if _, err := r.out.Write(append(header, rest...)); err != nil {
+			return err
+		}
+	} else {
+		// continue the timeline of the previous iteration
+		r.offsetMs = r.lastMs + 40
+	}
+
+	tagHeader := make([]byte, 11)
+	for {
+		if _, err := io.ReadFull(in, tagHeader); err != nil {
+			if errors.Is(err, io.EOF) || errors.Is(err, io.ErrUnexpectedEOF) {
+				return nil
+			}
+			return err
+		}
+		dataSize := int(tagHeader[1])<<16 | int(tagHeader[2])<<8 | int(tagHeader[3])
+		tag := make([]byte, 11+dataSize+4)
+		copy(tag, tagHeader)
+		if _, err := io.ReadFull(in, tag[11:]); err != nil {
+			if errors.Is(err, io.ErrUnexpectedEOF) {
+				return nil // recording cut mid-tag
+			}
+			return err
+		}
+
+		ts := r.offsetMs + tagTimestamp(tag)
+		setTagTimestamp(tag, ts)
+		r.pace(ts)
+		if _, err := r.out.Write(tag); err != nil {
+			return err
+		}
+		r.lastMs = ts
+		r.tags++
+	}
+}
+
+// pace sleeps until media time ts is due on the wall clock
+func (r *replayer) pace(ts uint32) {
+	if r.jitter > 0 && ts >= r.stallAt {
+		time.Sleep(r.jitter)
+		r.stallAt = ts + 5000
+		// the backlog goes out at once, the clock is not shifted
+	}
+	due := r.start.Add(time.Duration(float64(ts)/r.speed) * time.Millisecond)
+	if d := time.Until(due); d > 0 {
+		time.Sleep(d)
+	}
+}
+
+func tagTimestamp(tag []byte) uint32 {
+	return uint32(tag[7])<<24 | uint32(tag[4])<<16 | uint32(tag[5])<<8 | uint32(tag[6])
+}
+
+func setTagTimestamp(tag []byte, ts uint32) {
+	tag[4] = byte(ts >> 16)
+	tag[5] = byte(ts >> 8)
+	tag[6] = byte(ts)
+	tag[7] = byte(ts >> 24)
+}